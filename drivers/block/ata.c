@@ -42,6 +42,7 @@ static struct fs_operations ata_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
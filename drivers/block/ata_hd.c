@@ -39,6 +39,7 @@ static struct fs_operations ata_hd_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
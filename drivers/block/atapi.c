@@ -11,6 +11,7 @@
 #include <fiwix/atapi_cd.h>
 #include <fiwix/timer.h>
 #include <fiwix/cpu.h>
+#include <fiwix/mm.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -99,6 +100,58 @@ int atapi_read_data(__dev_t dev, char *data, struct ide *ide, struct ata_drv *dr
 	return 0;
 }
 
+/*
+ * Reads the data of a multi-sector command. Since the byte count limit of the
+ * command is a single sector, every DRQ block brings one sector which is
+ * placed in its corresponding page.
+ */
+int atapi_read_sectors(__dev_t dev, char **pages, struct ide *ide, struct ata_drv *drive, int count)
+{
+	int errno, status;
+	char *buffer;
+	int n, retries, bytes;
+
+	status = 0;
+	n = 0;
+
+	for(retries = 0; retries < MAX_IDE_ERR;) {
+		if(ata_wait_irq(ide, WAIT_FOR_CD, 0)) {
+			retries++;
+			continue;
+		}
+		status = inport_b(ide->base + ATA_STATUS);
+		if(status & ATA_STAT_ERR) {
+			break;
+		}
+
+		if((status & (ATA_STAT_DRQ | ATA_STAT_BSY)) == 0) {
+			break;
+		}
+
+		bytes = (inport_b(ide->base + ATA_HCYL) << 8) + inport_b(ide->base + ATA_LCYL);
+		if(!bytes || bytes > ATAPI_CD_SECTSIZE || n >= count) {
+			break;
+		}
+
+		buffer = pages[n / (PAGE_SIZE / ATAPI_CD_SECTSIZE)];
+		buffer += (n % (PAGE_SIZE / ATAPI_CD_SECTSIZE)) * ATAPI_CD_SECTSIZE;
+		drive->xfer.read_fn(ide->base + ATA_DATA, (void *)buffer, bytes / drive->xfer.copy_raw_factor);
+		n++;
+	}
+
+	if(status & ATA_STAT_ERR) {
+		errno = inport_b(ide->base + ATA_ERROR);
+		printk("WARNING: %s(): error on cdrom device %d,%d, status=0x%x error=0x%x,\n", __FUNCTION__, MAJOR(dev), MINOR(dev), status, errno);
+		return 1;
+	}
+
+	if(retries >= MAX_IDE_ERR || n != count) {
+		printk("WARNING: %s(): timeout on cdrom device %d,%d, status=0x%x (%d of %d sectors).\n", __FUNCTION__, MAJOR(dev), MINOR(dev), status, n, count);
+		return 1;
+	}
+	return 0;
+}
+
 int atapi_cmd_testunit(struct ide *ide, struct ata_drv *drive)
 {
 	unsigned char pkt[12];
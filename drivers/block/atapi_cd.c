@@ -18,6 +18,19 @@
 /* default size of 1GB is enough to read a whole CDROM */
 #define CDROM_DEFAULT_SIZE	(1024 * 1024)	/* in KBs */
 
+#define CD_SECTS_PER_PAGE	(PAGE_SIZE / ATAPI_CD_SECTSIZE)
+#define CD_CACHE_PAGES		(ATAPI_CD_READAHEAD / CD_SECTS_PER_PAGE)
+
+/* sectors read ahead by the last READ(10) command of each drive */
+struct cd_cache {
+	__dev_t dev;
+	__blk_t block;		/* first sector cached */
+	int count;		/* number of sectors cached */
+	char *pages[CD_CACHE_PAGES];
+};
+
+static struct cd_cache cd_cache[NR_IDE_CTRLS][NR_ATA_DRVS];
+
 static struct fs_operations atapi_cd_driver_fsop = {
 	0,
 	0,
@@ -36,6 +49,7 @@ static struct fs_operations atapi_cd_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -61,6 +75,63 @@ static struct fs_operations atapi_cd_driver_fsop = {
 	NULL			/* release_superblock */
 };
 
+static void cd_cache_release(struct cd_cache *c)
+{
+	int n;
+
+	for(n = 0; n < CD_CACHE_PAGES; n++) {
+		if(c->pages[n]) {
+			kfree((unsigned int)c->pages[n]);
+			c->pages[n] = NULL;
+		}
+	}
+	c->count = 0;
+}
+
+/*
+ * Reads ATAPI_CD_READAHEAD sectors starting at 'block' with a single READ(10)
+ * command. Returns 1 if the cache couldn't be filled (e.g. near the end of
+ * the disc), then the caller reads only the sector requested.
+ */
+static int cd_cache_fill(__dev_t dev, struct ide *ide, struct ata_drv *drive, struct cd_cache *c, __blk_t block)
+{
+	unsigned char pkt[12];
+	int n;
+
+	c->count = 0;
+	for(n = 0; n < CD_CACHE_PAGES; n++) {
+		if(!c->pages[n]) {
+			if(!(c->pages[n] = (char *)kmalloc(PAGE_SIZE))) {
+				return 1;
+			}
+		}
+	}
+
+	pkt[0] = ATAPI_READ10;
+	pkt[1] = 0;
+	pkt[2] = (block >> 24) & 0xFF;
+	pkt[3] = (block >> 16) & 0xFF;
+	pkt[4] = (block >> 8) & 0xFF;
+	pkt[5] = block & 0xFF;
+	pkt[6] = 0;
+	pkt[7] = (ATAPI_CD_READAHEAD >> 8) & 0xFF;
+	pkt[8] = ATAPI_CD_READAHEAD & 0xFF;
+	pkt[9] = 0;
+	pkt[10] = 0;
+	pkt[11] = 0;
+
+	if(send_packet_command(pkt, ide, drive, ATAPI_CD_SECTSIZE)) {
+		return 1;
+	}
+	if(atapi_read_sectors(dev, c->pages, ide, drive, ATAPI_CD_READAHEAD)) {
+		return 1;
+	}
+	c->dev = dev;
+	c->block = block;
+	c->count = ATAPI_CD_READAHEAD;
+	return 0;
+}
+
 int atapi_cd_open(struct inode *i, struct fd *fd_table)
 {
 	char *buffer;
@@ -77,6 +148,7 @@ int atapi_cd_open(struct inode *i, struct fd *fd_table)
 	drive = &ide->drive[GET_DRIVE_NUM(i->rdev)];
 
 	lock_resource(&ide->resource);
+	cd_cache[ide->channel][drive->num].count = 0;
 
 	if(!(buffer = (void *)kmalloc(PAGE_SIZE))) {
 		unlock_resource(&ide->resource);
@@ -150,6 +222,9 @@ int atapi_cd_close(struct inode *i, struct fd *fd_table)
 
 	/* FIXME: only if device usage == 0 */
 	invalidate_buffers(i->rdev);
+	lock_resource(&ide->resource);
+	cd_cache_release(&cd_cache[ide->channel][drive->num]);
+	unlock_resource(&ide->resource);
 
 	if(atapi_cmd_mediumrm(CD_UNLOCK_MEDIUM, ide, drive)) {
 		printk("WARNING: %s(): error on cdrom device %d,%d during 0x%x command.\n", __FUNCTION__, MAJOR(i->rdev), MINOR(i->rdev), ATAPI_MEDIUM_REMOVAL);
@@ -169,6 +244,7 @@ int atapi_cd_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 	unsigned char pkt[12];
 	struct ide *ide;
 	struct ata_drv *drive;
+	struct cd_cache *c;
 
 	if(!(ide = get_ide_controller(dev))) {
 		return -EINVAL;
@@ -178,6 +254,20 @@ int atapi_cd_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 	blksize = BLKSIZE_2K;
 	sectors_to_read = blksize / ATAPI_CD_SECTSIZE;
 
+	lock_resource(&ide->resource);
+
+	/* sequential reads are served from the sectors read ahead */
+	c = &cd_cache[ide->channel][drive->num];
+	if(!c->count || c->dev != dev || block < c->block || block >= c->block + c->count) {
+		cd_cache_fill(dev, ide, drive, c, block);
+	}
+	if(c->count && c->dev == dev && block >= c->block && block < c->block + c->count) {
+		n = block - c->block;
+		memcpy_b(buffer, c->pages[n / CD_SECTS_PER_PAGE] + (n % CD_SECTS_PER_PAGE) * ATAPI_CD_SECTSIZE, ATAPI_CD_SECTSIZE);
+		unlock_resource(&ide->resource);
+		return sectors_to_read * ATAPI_CD_SECTSIZE;
+	}
+
 	pkt[0] = ATAPI_READ10;
 	pkt[1] = 0;
 	pkt[2] = (block >> 24) & 0xFF;
@@ -191,7 +281,6 @@ int atapi_cd_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 	pkt[10] = 0;
 	pkt[11] = 0;
 
-	lock_resource(&ide->resource);
 	for(n = 0; n < sectors_to_read; n++, block++) {
 		for(retries = 0; retries < MAX_CD_ERR; retries++) {
 			if(send_packet_command(pkt, ide, drive, blksize)) {
@@ -59,6 +59,22 @@ static struct fddt fdd_type[] = {
 /* buffer area used for I/O operations (1KB) */
 char fdc_transfer_area[BPS * 2];
 
+/*
+ * The track cache holds the last cylinder read (both heads). Its DMA buffer
+ * can't cross a 64KB boundary, hence the space reserved is the double of the
+ * biggest cylinder.
+ */
+static char fdc_track_area[FDC_MAX_CYLSIZE * 2];
+
+struct fdc_track {
+	char fdd;		/* drive of the cylinder cached */
+	char cyl;		/* cylinder cached */
+	struct fddt *type;	/* format of the disk */
+	char *data;		/* DMA buffer (inside fdc_track_area) */
+};
+
+static struct fdc_track fdc_track = { INVALID_TRACK, INVALID_TRACK, NULL, NULL };
+
 struct fdd_status {
 	char type;		/* floppy disk drive type */
 	char motor;
@@ -92,6 +108,7 @@ static struct fs_operations fdc_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -216,6 +233,8 @@ static int fdc_motor_on(void)
 
 static void do_motor_off(unsigned int fdd)
 {
+	/* a disk change can't be detected while the motor is off */
+	fdc_track.fdd = INVALID_TRACK;
 	outport_b(FDC_DOR, FDC_DMA_ENABLE | FDC_ENABLE | fdd);
 	fdd_status[fdd].motor = 0;
 	fdd_status[0].motor = fdd_status[1].motor = 0;
@@ -236,6 +255,7 @@ static void fdc_reset(void)
 	struct callout_req creq;
 
 	need_reset = 0;
+	fdc_track.fdd = INVALID_TRACK;
 
 	fdc_wait_interrupt = FDC_RESET;
 	outport_b(FDC_DOR, 0);			/* enter in reset mode */
@@ -519,41 +539,27 @@ int fdc_close(struct inode *i, struct fd *fd_table)
 	sync_buffers(i->rdev);
 	lock_resource(&floppy_resource);
 	set_current_fdd_type(minor);
+	if(fdc_track.fdd == current_fdd) {
+		fdc_track.fdd = INVALID_TRACK;
+	}
 	unlock_resource(&floppy_resource);
 
 	return 0;
 }
 
-int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
+/*
+ * Transfers 'size' bytes between the disk and 'area' (using DMA) starting at
+ * the sector specified. Since the commands are multi-track, a whole cylinder
+ * (both heads) can be transferred with a single command.
+ */
+static int fdc_transfer(__dev_t dev, int cmd, int cyl, int head, int sector, char *area, int size)
 {
-	unsigned char minor;
-	unsigned int sectors_read;
-	int cyl, head, sector;
+	unsigned int sectors;
 	int retries;
 	struct callout_req creq;
-	struct device *d;
+	char *op;
 
-	minor = MINOR(dev);
-	if(!TEST_MINOR(floppy_device.minors, minor)) {
-		return -ENXIO;
-	}
-
-	if(!blksize) {
-		if(!(d = get_device(BLK_DEV, dev))) {
-			return -EINVAL;
-		}
-		blksize = ((unsigned int *)d->blksize)[MINOR(dev)];
-	}
-	blksize = blksize ? blksize : BLKSIZE_1K;
-
-	lock_resource(&floppy_resource);
-	set_current_fdd_type(minor);
-
-	if(fdc_block2chs(block, blksize, &cyl, &head, &sector)) {
-		printk("WARNING: %s(): fd%d: invalid block number %d on %s device %d,%d.\n", __FUNCTION__, current_fdd, block, floppy_device.name, MAJOR(dev), MINOR(dev));
-		unlock_resource(&floppy_resource);
-		return -EINVAL;
-	}
+	op = cmd == FDC_READ ? "read" : "write";
 
 	for(retries = 0; retries < MAX_FDC_ERR; retries++) {
 		if(need_reset) {
@@ -563,18 +569,19 @@ int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 			printk("%s(): %s disk was changed in device %d,%d!\n", __FUNCTION__, floppy_device.name, MAJOR(dev), MINOR(dev));
 			invalidate_buffers(dev);
 			fdd_status[current_fdd].recalibrated = 0;
+			fdc_track.fdd = INVALID_TRACK;
 		}
 
 		if(fdc_seek(cyl, head)) {
-			printk("WARNING: %s(): fd%d: seek error on %s device %d,%d during read operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
+			printk("WARNING: %s(): fd%d: seek error on %s device %d,%d during %s operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev), op);
 			continue;
 		}
 
-		start_dma(FLOPPY_DMA, fdc_transfer_area, blksize, DMA_MODE_WRITE | DMA_MODE_SINGLE);
+		start_dma(FLOPPY_DMA, area, size, (cmd == FDC_READ ? DMA_MODE_WRITE : DMA_MODE_READ) | DMA_MODE_SINGLE);
 
-		/* send READ command */
-		fdc_wait_interrupt = FDC_READ;
-		fdc_out(FDC_READ);
+		/* send READ or WRITE command */
+		fdc_wait_interrupt = cmd;
+		fdc_out(cmd);
 		fdc_out((head << 2) | current_fdd);
 		fdc_out(cyl);
 		fdc_out(head);
@@ -585,7 +592,7 @@ int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 		fdc_out(0xFF);	/* sector size is 512 bytes */
 
 		if(need_reset) {
-			printk("WARNING: %s(): fd%d: needs reset on %s device %d,%d during read operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
+			printk("WARNING: %s(): fd%d: needs reset on %s device %d,%d during %s operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev), op);
 			continue;
 		}
 		creq.fn = fdc_timer;
@@ -602,6 +609,10 @@ int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 		}
 		del_callout(&creq);
 		fdc_get_results();
+		if(cmd == FDC_WRITE && fdc_results[ST1] & ST1_NW) {
+			fdc_motor_off();
+			return -EROFS;
+		}
 		if(fdc_results[ST0] & (ST0_IC | ST0_UC | ST0_NR)) {
 			need_reset = 1;
 			continue;
@@ -610,38 +621,51 @@ int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 	}
 
 	if(retries >= MAX_FDC_ERR) {
-		printk("WARNING: %s(): fd%d: error on %s device %d,%d during read operation,\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
-		printk("\tblock=%d, sector=%d, cylinder/head=%d/%d\n", block, sector, cyl, head);
-		unlock_resource(&floppy_resource);
+		printk("WARNING: %s(): fd%d: error on %s device %d,%d during %s operation,\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev), op);
+		printk("\tsector=%d, cylinder/head=%d/%d\n", sector, cyl, head);
 		fdc_motor_off();
 		return -EIO;
 	}
 
 	fdc_motor_off();
-	sectors_read = (fdc_results[ST_CYL] - cyl) * (current_fdd_type->heads * current_fdd_type->spt);
-	sectors_read += (fdc_results[ST_HEAD] - head) * current_fdd_type->spt;
-	sectors_read += fdc_results[ST_SECTOR] - sector;
-	if(sectors_read * BPS != blksize) {
-		printk("WARNING: %s(): fd%d: read error on %s device %d,%d (%d sectors read).\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev), sectors_read);
-		printk("\tblock=%d, sector=%d, cylinder/head=%d/%d\n", block, sector, cyl, head);
-		unlock_resource(&floppy_resource);
-		fdc_motor_off();
+	sectors = (fdc_results[ST_CYL] - cyl) * (current_fdd_type->heads * current_fdd_type->spt);
+	sectors += (fdc_results[ST_HEAD] - head) * current_fdd_type->spt;
+	sectors += fdc_results[ST_SECTOR] - sector;
+	if(sectors * BPS != size) {
+		printk("WARNING: %s(): fd%d: %s error on %s device %d,%d (%d sectors).\n", __FUNCTION__, current_fdd, op, floppy_device.name, MAJOR(dev), MINOR(dev), sectors);
+		printk("\tsector=%d, cylinder/head=%d/%d\n", sector, cyl, head);
 		return -EIO;
 	}
 
-	memcpy_b(buffer, (void *)fdc_transfer_area, blksize);
+	return size;
+}
+
+/*
+ * Reads the whole cylinder into the track cache, unless it's already there.
+ * It returns the offset of the sector within the track cache.
+ */
+static int fdc_read_track(__dev_t dev, int cyl, int head, int sector)
+{
+	int size, errno;
 
-	unlock_resource(&floppy_resource);
-	return sectors_read * BPS;
+	size = current_fdd_type->heads * current_fdd_type->spt * FDC_SECTSIZE;
+	if(fdc_track.fdd != current_fdd || fdc_track.type != current_fdd_type || fdc_track.cyl != cyl) {
+		fdc_track.fdd = INVALID_TRACK;
+		if((errno = fdc_transfer(dev, FDC_READ, cyl, 0, 1, fdc_track.data, size)) < 0) {
+			return errno;
+		}
+		fdc_track.fdd = current_fdd;
+		fdc_track.type = current_fdd_type;
+		fdc_track.cyl = cyl;
+	}
+	return ((head * current_fdd_type->spt) + sector - 1) * FDC_SECTSIZE;
 }
 
-int fdc_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
+int fdc_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 {
 	unsigned char minor;
-	unsigned int sectors_written;
 	int cyl, head, sector;
-	int retries;
-	struct callout_req creq;
+	int size, offset, bytes, done;
 	struct device *d;
 
 	minor = MINOR(dev);
@@ -666,88 +690,72 @@ int fdc_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
 		return -EINVAL;
 	}
 
-	for(retries = 0; retries < MAX_FDC_ERR; retries++) {
-		if(need_reset) {
-			fdc_reset();
+	/* a block may span two cylinders if its size is not a divisor */
+	size = current_fdd_type->heads * current_fdd_type->spt * FDC_SECTSIZE;
+	for(done = 0; done < blksize; done += bytes) {
+		if(done) {
+			fdc_block2chs((block * (blksize / FDC_SECTSIZE)) + (done / FDC_SECTSIZE), FDC_SECTSIZE, &cyl, &head, &sector);
 		}
-		if(fdc_motor_on()) {
-			printk("%s(): %s disk was changed in device %d,%d!\n", __FUNCTION__, floppy_device.name, MAJOR(dev), MINOR(dev));
-			invalidate_buffers(dev);
-			fdd_status[current_fdd].recalibrated = 0;
+		if((offset = fdc_read_track(dev, cyl, head, sector)) < 0) {
+			unlock_resource(&floppy_resource);
+			return offset;
 		}
+		bytes = MIN(blksize - done, size - offset);
+		memcpy_b(buffer + done, fdc_track.data + offset, bytes);
+	}
 
-		if(fdc_seek(cyl, head)) {
-			printk("WARNING: %s(): fd%d: seek error on %s device %d,%d during write operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
-			continue;
-		}
+	unlock_resource(&floppy_resource);
+	return blksize;
+}
 
-		start_dma(FLOPPY_DMA, fdc_transfer_area, blksize, DMA_MODE_READ | DMA_MODE_SINGLE);
-		memcpy_b((void *)fdc_transfer_area, buffer, blksize);
+int fdc_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
+{
+	unsigned char minor;
+	int cyl, head, sector;
+	int errno, offset;
+	struct device *d;
 
-		/* send WRITE command */
-		fdc_wait_interrupt = FDC_WRITE;
-		fdc_out(FDC_WRITE);
-		fdc_out((head << 2) | current_fdd);
-		fdc_out(cyl);
-		fdc_out(head);
-		fdc_out(sector);
-		fdc_out(2);	/* sector size is 512 bytes */
-		fdc_out(current_fdd_type->spt);
-		fdc_out(current_fdd_type->gpl1);
-		fdc_out(0xFF);	/* sector size is 512 bytes */
+	minor = MINOR(dev);
+	if(!TEST_MINOR(floppy_device.minors, minor)) {
+		return -ENXIO;
+	}
 
-		if(need_reset) {
-			printk("WARNING: %s(): fd%d: needs reset on %s device %d,%d during write operation.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
-			continue;
-		}
-		creq.fn = fdc_timer;
-		creq.arg = FDC_TR_DEFAULT;
-		add_callout(&creq, WAIT_FDC);
-		/* avoid sleep if interrupt already happened */
-		if(fdc_wait_interrupt) {
-			sleep(&irq_floppy, PROC_UNINTERRUPTIBLE);
-		}
-		if(fdc_timeout) {
-			need_reset = 1;
-			printk("WARNING: %s(): fd%d: timeout on %s device %d,%d.\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
-			continue;
-		}
-		del_callout(&creq);
-		fdc_get_results();
-		if(fdc_results[ST1] & ST1_NW) {
-			unlock_resource(&floppy_resource);
-			fdc_motor_off();
-			return -EROFS;
-		}
-		if(fdc_results[ST0] & (ST0_IC | ST0_UC | ST0_NR)) {
-			need_reset = 1;
-			continue;
+	if(!blksize) {
+		if(!(d = get_device(BLK_DEV, dev))) {
+			return -EINVAL;
 		}
-		break;
+		blksize = ((unsigned int *)d->blksize)[MINOR(dev)];
 	}
+	blksize = blksize ? blksize : BLKSIZE_1K;
 
-	if(retries >= MAX_FDC_ERR) {
-		printk("WARNING: %s(): fd%d: error on %s device %d,%d during write operation,\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev));
-		printk("\tblock=%d, sector=%d, cylinder/head=%d/%d\n", block, sector, cyl, head);
+	lock_resource(&floppy_resource);
+	set_current_fdd_type(minor);
+
+	if(fdc_block2chs(block, blksize, &cyl, &head, &sector)) {
+		printk("WARNING: %s(): fd%d: invalid block number %d on %s device %d,%d.\n", __FUNCTION__, current_fdd, block, floppy_device.name, MAJOR(dev), MINOR(dev));
 		unlock_resource(&floppy_resource);
-		fdc_motor_off();
-		return -EIO;
+		return -EINVAL;
 	}
 
-	fdc_motor_off();
-	sectors_written = (fdc_results[ST_CYL] - cyl) * (current_fdd_type->heads * current_fdd_type->spt);
-	sectors_written += (fdc_results[ST_HEAD] - head) * current_fdd_type->spt;
-	sectors_written += fdc_results[ST_SECTOR] - sector;
-	if(sectors_written * BPS != blksize) {
-		printk("WARNING: %s(): fd%d: write error on %s device %d,%d (%d sectors written).\n", __FUNCTION__, current_fdd, floppy_device.name, MAJOR(dev), MINOR(dev), sectors_written);
-		printk("\tblock=%d, sector=%d, cylinder/head=%d/%d\n", block, sector, cyl, head);
+	memcpy_b((void *)fdc_transfer_area, buffer, blksize);
+	if((errno = fdc_transfer(dev, FDC_WRITE, cyl, head, sector, fdc_transfer_area, blksize)) < 0) {
+		fdc_track.fdd = INVALID_TRACK;
 		unlock_resource(&floppy_resource);
-		fdc_motor_off();
-		return -EIO;
+		return errno;
+	}
+
+	/* keep the track cache up to date */
+	if(fdc_track.fdd == current_fdd && fdc_track.type == current_fdd_type && fdc_track.cyl == cyl) {
+		offset = ((head * current_fdd_type->spt) + sector - 1) * FDC_SECTSIZE;
+		if(offset + blksize <= current_fdd_type->heads * current_fdd_type->spt * FDC_SECTSIZE) {
+			memcpy_b(fdc_track.data + offset, buffer, blksize);
+		} else {
+			fdc_track.fdd = INVALID_TRACK;
+		}
 	}
 
 	unlock_resource(&floppy_resource);
-	return sectors_written * BPS;
+	return blksize;
 }
 
 int fdc_ioctl(struct inode *i, int cmd, unsigned int arg)
@@ -885,6 +893,10 @@ void floppy_init(void)
 
 	if(master || slave) {
 		need_reset = 1;
+		fdc_track.data = fdc_track_area;
+		if((V2P((unsigned int)fdc_track.data) & 0xFFFF) + FDC_MAX_CYLSIZE > 0x10000) {
+			fdc_track.data = (char *)(((unsigned int)fdc_track.data + 0xFFFF) & ~0xFFFF);
+		}
 		dma_init();
 		if(dma_register(FLOPPY_DMA, floppy_device.name)) {
 			printk("WARNING: %s(): fd%d: unable to register DMA channel on %s.\n", __FUNCTION__, current_fdd, floppy_device.name);
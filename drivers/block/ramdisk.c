@@ -6,6 +6,8 @@
  */
 
 #include <fiwix/kernel.h>
+#include <fiwix/asm.h>
+#include <fiwix/cpu.h>
 #include <fiwix/ramdisk.h>
 #include <fiwix/ioctl.h>
 #include <fiwix/devices.h>
@@ -14,6 +16,7 @@
 #include <fiwix/buffer.h>
 #include <fiwix/errno.h>
 #include <fiwix/mm.h>
+#include <fiwix/lz4.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -38,6 +41,7 @@ static struct fs_operations ramdisk_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -70,7 +74,8 @@ static struct device ramdisk_device = {
 	0,
 	0,
 	&ramdisk_driver_fsop,
-	NULL
+	NULL,
+	ramdisk_direct_access
 };
 
 static struct ramdisk *get_ramdisk(int minor)
@@ -81,6 +86,117 @@ static struct ramdisk *get_ramdisk(int minor)
 	return NULL;
 }
 
+/* returns the chunk 'n' of a compressed ramdisk, decompressing it if needed */
+static char *get_chunk(struct ramdisk *ramdisk, int n)
+{
+	unsigned int *table, *tmp;
+	unsigned long long int tsc;
+	char *chunk, *src;
+	int len;
+
+	if(!(table = (unsigned int *)ramdisk->chunk_dir[n / RAMDISK_CHUNKS_PER_TABLE])) {
+		if(!(tmp = (unsigned int *)kmalloc(PAGE_SIZE))) {
+			return NULL;
+		}
+		/* kmalloc() may have slept, check it again */
+		if(!(table = (unsigned int *)ramdisk->chunk_dir[n / RAMDISK_CHUNKS_PER_TABLE])) {
+			memset_b(tmp, 0, PAGE_SIZE);
+			ramdisk->chunk_dir[n / RAMDISK_CHUNKS_PER_TABLE] = (unsigned int)tmp;
+			table = tmp;
+		} else {
+			kfree((unsigned int)tmp);
+		}
+	}
+	if((chunk = (char *)table[n % RAMDISK_CHUNKS_PER_TABLE])) {
+		return chunk;
+	}
+
+	if(!(chunk = (char *)kmalloc(PAGE_SIZE))) {
+		return NULL;
+	}
+	if(table[n % RAMDISK_CHUNKS_PER_TABLE]) {
+		kfree((unsigned int)chunk);
+		return (char *)table[n % RAMDISK_CHUNKS_PER_TABLE];
+	}
+
+	tsc = (cpu_table.flags & CPU_TSC) ? get_rdtsc() : 0;
+	src = (char *)ramdisk->lz4 + ramdisk->lz4->offset[n];
+	len = ramdisk->lz4->offset[n + 1] - ramdisk->lz4->offset[n];
+	if(len == PAGE_SIZE) {
+		memcpy_b(chunk, src, PAGE_SIZE);
+	} else {
+		memset_b(chunk, 0, PAGE_SIZE);
+		if(lz4_decompress(src, len, chunk, PAGE_SIZE) < 0) {
+			printk("WARNING: %s(): chunk %d of the compressed ramdisk is corrupt.\n", __FUNCTION__, n);
+			kfree((unsigned int)chunk);
+			return NULL;
+		}
+	}
+	if(cpu_table.flags & CPU_TSC) {
+		ramdisk->unpack_cycles += get_rdtsc() - tsc;
+	}
+
+	table[n % RAMDISK_CHUNKS_PER_TABLE] = (unsigned int)chunk;
+	ramdisk->unpacked++;
+	return chunk;
+}
+
+/* returns the memory address of the ramdisk data at 'offset' */
+static char *get_addr(struct ramdisk *ramdisk, __off_t offset)
+{
+	char *chunk;
+
+	if(!ramdisk->lz4) {
+		return ramdisk->addr + offset;
+	}
+	if(!(chunk = get_chunk(ramdisk, offset / PAGE_SIZE))) {
+		return NULL;
+	}
+	return chunk + (offset % PAGE_SIZE);
+}
+
+/* checks if the ramdisk contains a compressed image and prepares it */
+static int setup_lz4_image(struct ramdisk *ramdisk)
+{
+	struct ramdisk_lz4_header *lz4;
+	unsigned int n, zsize;
+
+	lz4 = (struct ramdisk_lz4_header *)ramdisk->addr;
+	zsize = ramdisk->size * 1024;
+	if(zsize < sizeof(struct ramdisk_lz4_header) || lz4->magic != RAMDISK_LZ4_MAGIC) {
+		return 0;
+	}
+	if(lz4->chunk_size != PAGE_SIZE || lz4->nr_chunks != PAGE_ALIGN(lz4->size) / PAGE_SIZE) {
+		printk("WARNING: %s(): unsupported compressed ramdisk image.\n", __FUNCTION__);
+		return 0;
+	}
+	if(lz4->nr_chunks > RAMDISK_CHUNKS_PER_TABLE * RAMDISK_CHUNKS_PER_TABLE) {
+		printk("WARNING: %s(): compressed ramdisk image is too big.\n", __FUNCTION__);
+		return 0;
+	}
+	/* the module size was rounded down to KB */
+	zsize += 1023;
+	if((char *)&lz4->offset[lz4->nr_chunks + 1] > ramdisk->addr + zsize) {
+		printk("WARNING: %s(): compressed ramdisk image is truncated.\n", __FUNCTION__);
+		return 0;
+	}
+	for(n = 0; n < lz4->nr_chunks; n++) {
+		if(lz4->offset[n] > lz4->offset[n + 1] || lz4->offset[n + 1] - lz4->offset[n] > PAGE_SIZE || lz4->offset[n + 1] > zsize) {
+			printk("WARNING: %s(): invalid index in compressed ramdisk image.\n", __FUNCTION__);
+			return 0;
+		}
+	}
+
+	if(!(ramdisk->chunk_dir = (unsigned int *)kmalloc(PAGE_SIZE))) {
+		return 0;
+	}
+	memset_b(ramdisk->chunk_dir, 0, PAGE_SIZE);
+	ramdisk->lz4 = lz4;
+	ramdisk->zsize = ramdisk->size;
+	ramdisk->size = lz4->size / 1024;
+	return 1;
+}
+
 int ramdisk_open(struct inode *i, struct fd *fd_table)
 {
 	if(!get_ramdisk(MINOR(i->rdev))) {
@@ -100,6 +216,7 @@ int ramdisk_close(struct inode *i, struct fd *fd_table)
 
 int ramdisk_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 {
+	char *addr;
 	int size;
 	__off_t offset;
 	struct ramdisk *ramdisk;
@@ -119,12 +236,16 @@ int ramdisk_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 		return -EIO;
 	}
 	blksize = MIN(blksize, size - offset);
-	memcpy_b((void *)buffer, ramdisk->addr + offset, blksize);
+	if(!(addr = get_addr(ramdisk, offset))) {
+		return -EIO;
+	}
+	memcpy_b((void *)buffer, addr, blksize);
 	return blksize;
 }
 
 int ramdisk_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
 {
+	char *addr;
 	int size;
 	__off_t offset;
 	struct ramdisk *ramdisk;
@@ -144,10 +265,39 @@ int ramdisk_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
 		return -EIO;
 	}
 	blksize = MIN(blksize, size - offset);
-	memcpy_b(ramdisk->addr + offset, buffer, blksize);
+	if(!(addr = get_addr(ramdisk, offset))) {
+		return -EIO;
+	}
+	memcpy_b(addr, buffer, blksize);
 	return blksize;
 }
 
+/*
+ * The buffer cache uses this to make the buffers point straight to the
+ * ramdisk memory, so the blocks are neither copied nor kept twice in RAM.
+ */
+char *ramdisk_direct_access(__dev_t dev, __blk_t block, int blksize)
+{
+	int size;
+	__off_t offset;
+	struct ramdisk *ramdisk;
+	struct device *d;
+
+	if(!(ramdisk = get_ramdisk(MINOR(dev)))) {
+		return NULL;
+	}
+	if(!(d = get_device(BLK_DEV, dev))) {
+		return NULL;
+	}
+
+	size = ((unsigned int *)d->device_data)[MINOR(dev)] * 1024;
+	offset = block * blksize;
+	if(offset + blksize > size) {
+		return NULL;
+	}
+	return get_addr(ramdisk, offset);
+}
+
 int ramdisk_ioctl(struct inode *i, int cmd, unsigned int arg)
 {
 	struct hd_geometry *geom;
@@ -193,6 +343,23 @@ __loff_t ramdisk_llseek(struct inode *i, __loff_t offset)
 	return offset;
 }
 
+void ramdisk_stats(void)
+{
+	struct ramdisk *ramdisk;
+	int n;
+
+	for(n = 0; n < ramdisk_minors; n++) {
+		ramdisk = get_ramdisk(n);
+		if(ramdisk && ramdisk->lz4) {
+			printk("ram%d      %d of %d chunks decompressed", n, ramdisk->unpacked, ramdisk->lz4->nr_chunks);
+			if(cpu_table.hz >= 1000000) {
+				printk(" in %dus", (unsigned int)(ramdisk->unpack_cycles / (cpu_table.hz / 1000000)));
+			}
+			printk("\n");
+		}
+	}
+}
+
 void ramdisk_init(void)
 {
 	int n;
@@ -206,8 +373,13 @@ void ramdisk_init(void)
 		for(n = 0; n < ramdisk_minors; n++) {
 			SET_MINOR(ramdisk_device.minors, n);
 			ramdisk = get_ramdisk(n);
+			setup_lz4_image(ramdisk);
 			((unsigned int *)ramdisk_device.blksize)[n] = BLKSIZE_1K;
 			((unsigned int *)ramdisk_device.device_data)[n] = ramdisk->size;
+			if(ramdisk->lz4) {
+				printk("ram%d      0x%08x-0x%08x RAMdisk of %dKB size, %dKB blocksize, LZ4 compressed (%dKB saved)\n", n, ramdisk->addr, ramdisk->addr + (ramdisk->zsize * 1024), ramdisk->size, BLKSIZE_1K / 1024, ramdisk->size - ramdisk->zsize);
+				continue;
+			}
 			printk("ram%d      0x%08x-0x%08x RAMdisk of %dKB size, %dKB blocksize\n", n, ramdisk->addr, ramdisk->addr + (ramdisk->size * 1024), ramdisk->size, BLKSIZE_1K / 1024);
 		}
 		register_device(BLK_DEV, &ramdisk_device);
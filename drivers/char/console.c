@@ -70,6 +70,7 @@ static struct fs_operations tty_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -10,6 +10,8 @@
 #include <fiwix/devices.h>
 #include <fiwix/fs.h>
 #include <fiwix/errno.h>
+#include <fiwix/ioctl.h>
+#include <fiwix/process.h>
 #include <fiwix/pic.h>
 #include <fiwix/irq.h>
 #include <fiwix/sleep.h>
@@ -39,6 +41,7 @@ static struct fs_operations serial_driver_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -110,8 +113,21 @@ static int baud_table[] = {
 	9600,
 	19200,
 	38400,
-	57200,
+	57600,		/* B57600 (CBAUDEX | 1) */
 	115200,
+	230400,
+	460800,
+	500000,
+	576000,
+	921600,
+	1000000,
+	1152000,
+	1500000,
+	2000000,
+	2500000,
+	3000000,
+	3500000,
+	4000000,
 	0
 };
 
@@ -122,7 +138,7 @@ static struct pci_supported_devices supported[] = {
 };
 #endif /* CONFIG_PCI */
 
-static struct serial *serial_active = NULL;
+struct serial *serial_active = NULL;
 static struct bh serial_bh = { 0, &irq_serial_bh, NULL };
 
 /* FIXME: this should be allocated dynamically */
@@ -171,10 +187,12 @@ static int serial_identify(struct serial *s)
 				/* 16750 chip is not supported */
 			} else {
 				s->flags |= UART_IS_16550A | UART_HAS_FIFO;
+				s->xmit_fifo_size = UART_FIFO_SIZE;
 				return 4;
 			}
 		} else {
 			s->flags |= UART_IS_16550;
+			s->xmit_fifo_size = 1;
 			return 3;
 		}
 	} else {
@@ -184,6 +202,7 @@ static int serial_identify(struct serial *s)
 		 */
 		value = inport_b(s->ioaddr + UART_SR);	/* save its value */
 		outport_b(s->ioaddr + UART_SR, 0xAA);	/* put a random value */
+		s->xmit_fifo_size = 1;
 		if(inport_b(s->ioaddr + UART_SR) != 0xAA) {
 			s->flags |= UART_IS_8250;
 			return 1;
@@ -203,6 +222,22 @@ static void serial_default(struct serial *s)
 	/* 9600,N,8,1 by default */
 	s->baud = 9600;
 	s->lctrl = UART_LCR_NP | UART_LCR_WL8 | UART_LCR_1STB;
+	s->baud_base = UART_BAUD_BASE;
+
+	switch(SERIAL_FIFO_TRIGGER) {
+		case 1:
+			s->fcr = UART_FCR_FIFO1;
+			break;
+		case 4:
+			s->fcr = UART_FCR_FIFO4;
+			break;
+		case 14:
+			s->fcr = UART_FCR_FIFO14;
+			break;
+		default:
+			s->fcr = UART_FCR_FIFO8;
+			break;
+	}
 }
 
 static void serial_setup(struct serial *s)
@@ -211,7 +246,7 @@ static void serial_setup(struct serial *s)
 
 	outport_b(s->ioaddr + UART_IER, 0);	/* disable all interrupts */
 
-	divisor = 115200 / s->baud;
+	divisor = s->baud_base / s->baud;
 	outport_b(s->ioaddr + UART_LCR, UART_LCR_DLAB);	/* enable DLAB */
 	outport_b(s->ioaddr + UART_DLL, divisor & 0xFF);	/* LSB of divisor */
 	outport_b(s->ioaddr + UART_DLH, divisor >> 8);	/* MSB of divisor */
@@ -292,6 +327,19 @@ static void serial_errors(struct serial *s, int status)
 
 	tty = s->tty;
 
+	if(status & UART_LSR_BI) {
+		s->icount.brk++;
+	}
+	if(status & UART_LSR_OE) {
+		s->icount.overrun++;
+	}
+	if(status & UART_LSR_PE) {
+		s->icount.parity++;
+	}
+	if(status & UART_LSR_FE) {
+		s->icount.frame++;
+	}
+
 	if(!(tty->termios.c_iflag & IGNBRK) && tty->termios.c_iflag & BRKINT) {
 		if(status & UART_LSR_BI) {
 			printk("WARNING: break interrupt in %s.\n", s->name);
@@ -329,11 +377,12 @@ static void serial_send(struct tty *tty)
 	}
 
 	count = 0;
-	while(tty->write_q.count > 0 && count < UART_FIFO_SIZE) {
+	while(tty->write_q.count > 0 && count < s->xmit_fifo_size) {
 		ch = tty_queue_getchar(&tty->write_q);
 		outport_b(s->ioaddr + UART_TD, ch);
 		count++;
 	}
+	s->icount.tx += count;
 
 	if(!tty->write_q.count) {
 		outport_b(s->ioaddr + UART_IER, UART_IER_RDAI);
@@ -341,27 +390,32 @@ static void serial_send(struct tty *tty)
 	wakeup(&tty_write);
 }
 
-static int serial_receive(struct serial *s)
+/*
+ * Empties the UART receiver into the flip buffer currently owned by the
+ * interrupt handler. The characters are moved into the tty read queue later,
+ * in bulk, by the bottom half. Returns the last value read from the LSR.
+ */
+static int serial_receive(struct serial *s, int status)
 {
-	int status, errno;
 	unsigned char ch;
-	struct tty *tty;
+	int cur;
 
-	errno = 0;
-	tty = s->tty;
+	cur = s->flip_cur;
 
 	do {
-		if(!tty_queue_room(&tty->read_q)) {
-			errno = -EAGAIN;
-			break;
-		}
+		serial_errors(s, status);
 		ch = inport_b(s->ioaddr + UART_RD);
-		tty_queue_putchar(tty, &tty->read_q, ch);
+		s->icount.rx++;
+		if(s->flip_count[cur] < SERIAL_FLIP_SIZE) {
+			s->flip_buf[cur][s->flip_count[cur]++] = ch;
+		} else {
+			s->icount.buf_overrun++;
+		}
 		status = inport_b(s->ioaddr + UART_LSR);
 	} while(status & UART_LSR_RDA);
 
 	serial_bh.flags |= BH_ACTIVE;
-	return errno;
+	return status;
 }
 
 void irq_serial(int num, struct sigcontext *sc)
@@ -376,9 +430,7 @@ void irq_serial(int num, struct sigcontext *sc)
 			while(!(inport_b(s->ioaddr + UART_IIR) & UART_IIR_NOINT)) {
 				status = inport_b(s->ioaddr + UART_LSR);
 				if(status & UART_LSR_RDA) {
-					if(serial_receive(s)) {
-						break;
-					}
+					status = serial_receive(s, status);
 				}
 				if(status & UART_LSR_THRE) {
 					serial_send(s->tty);
@@ -404,8 +456,11 @@ int serial_open(struct tty *tty)
 
 	/* enable FIFO */
 	if(s->flags & UART_HAS_FIFO) {
-		outport_b(s->ioaddr + UART_FCR, UART_FCR_FIFO | UART_FCR_FIFO14);
+		outport_b(s->ioaddr + UART_FCR, UART_FCR_FIFO | s->fcr);
 	}
+	s->flip_cur = 0;
+	s->flip_count[0] = s->flip_count[1] = 0;
+	s->flip_off = 0;
 	outport_b(s->ioaddr + UART_MCR, UART_MCR_OUT2 | UART_MCR_RTS | UART_MCR_DTR);
 
 	/* enable interrupts */
@@ -448,20 +503,58 @@ int serial_close(struct tty *tty)
 	return 0;
 }
 
+static int serial_get_divisor(struct serial *s, int cflag)
+{
+	int cbaud, baud;
+
+	cbaud = cflag & CBAUD;
+	if(cbaud & CBAUDEX) {
+		cbaud = (cbaud & ~CBAUDEX) + B38400;
+	}
+	if(!(baud = baud_table[cbaud])) {
+		return 0;
+	}
+
+	/* the ASYNC_SPD_* flags override 38400 bps for legacy applications */
+	if(baud == 38400) {
+		switch(s->spd_flags & ASYNC_SPD_MASK) {
+			case ASYNC_SPD_HI:
+				baud = 57600;
+				break;
+			case ASYNC_SPD_VHI:
+				baud = 115200;
+				break;
+			case ASYNC_SPD_SHI:
+				baud = 230400;
+				break;
+			case ASYNC_SPD_WARP:
+				baud = 460800;
+				break;
+			case ASYNC_SPD_CUST:
+				return s->custom_divisor;
+		}
+	}
+	return s->baud_base / baud;
+}
+
 void serial_set_termios(struct tty *tty)
 {
-	short int divisor;
-	int baud, size, stop;
+	int divisor;
+	int size, stop;
 	int lctrl;
 	struct serial *s;
 
 	s = (struct serial *)tty->driver_data;
 	lctrl = 0;
 
-	if(!(baud = baud_table[tty->termios.c_cflag & CBAUD])) {
+	/* rates above baud_base (or zero) are not possible with this UART */
+	if(!(divisor = serial_get_divisor(s, tty->termios.c_cflag))) {
 		return;
 	}
-	divisor = 115200 / baud;
+	if(divisor > 0xFFFF) {
+		divisor = 0xFFFF;
+	}
+	s->baud = s->baud_base / divisor;
 
 	outport_b(s->ioaddr + UART_LCR, UART_LCR_DLAB);	/* enable DLAB */
 	outport_b(s->ioaddr + UART_DLL, divisor & 0xFF);	/* LSB of divisor */
@@ -517,23 +610,123 @@ void serial_write(struct tty *tty)
 	RESTORE_FLAGS(flags);
 }
 
+int serial_ioctl(struct tty *tty, int cmd, unsigned int arg)
+{
+	struct serial *s;
+	struct serial_struct *ss;
+	int errno;
+
+	s = (struct serial *)tty->driver_data;
+
+	switch(cmd) {
+		case TIOCGSERIAL:
+			if((errno = check_user_area(VERIFY_WRITE, (void *)arg, sizeof(struct serial_struct)))) {
+				return errno;
+			}
+			ss = (struct serial_struct *)arg;
+			memset_b(ss, 0, sizeof(struct serial_struct));
+			ss->type = s->type;
+			ss->line = MINOR(tty->dev) - (1 << SERIAL_MSF);
+			ss->port = s->ioaddr;
+			ss->irq = s->irq;
+			ss->flags = s->spd_flags;
+			ss->xmit_fifo_size = s->xmit_fifo_size;
+			ss->custom_divisor = s->custom_divisor;
+			ss->baud_base = s->baud_base;
+			break;
+		case TIOCSSERIAL:
+			if((errno = check_user_area(VERIFY_READ, (void *)arg, sizeof(struct serial_struct)))) {
+				return errno;
+			}
+			ss = (struct serial_struct *)arg;
+			if(ss->baud_base != s->baud_base || ss->xmit_fifo_size != s->xmit_fifo_size) {
+				if(!IS_SUPERUSER) {
+					return -EPERM;
+				}
+			}
+			if(ss->baud_base < 9600 || ss->xmit_fifo_size < 1) {
+				return -EINVAL;
+			}
+			if(ss->xmit_fifo_size > 1 && !(s->flags & UART_HAS_FIFO)) {
+				return -EINVAL;
+			}
+			s->baud_base = ss->baud_base;
+			s->xmit_fifo_size = MIN(ss->xmit_fifo_size, UART_FIFO_SIZE);
+			s->custom_divisor = ss->custom_divisor;
+			s->spd_flags = ss->flags & ASYNC_SPD_MASK;
+			serial_set_termios(tty);
+			break;
+		case TIOCGICOUNT:
+			if((errno = check_user_area(VERIFY_WRITE, (void *)arg, sizeof(struct serial_icounter_struct)))) {
+				return errno;
+			}
+			memcpy_b((void *)arg, &s->icount, sizeof(struct serial_icounter_struct));
+			break;
+		default:
+			return -EINVAL;
+	}
+	return 0;
+}
+
+/*
+ * Moves the received characters from the flip buffers into the tty read
+ * queue, limited by the room left in the cooked queue so that the data stays
+ * in the flip buffers (instead of being discarded) while the reader is slow.
+ * Returns the number of characters still pending.
+ */
+static int serial_drain_flip(struct serial *s)
+{
+	unsigned int flags;
+	struct tty *tty;
+	int n, room, count;
+
+	tty = s->tty;
+	n = s->flip_cur ^ 1;
+
+	/* once drained, exchange the buffers with the interrupt handler */
+	if(s->flip_off >= s->flip_count[n]) {
+		SAVE_FLAGS(flags); CLI();
+		s->flip_count[n] = 0;
+		s->flip_off = 0;
+		s->flip_cur = n;
+		n ^= 1;
+		RESTORE_FLAGS(flags);
+	}
+
+	room = MIN(tty_queue_room(&tty->read_q), tty_queue_room(&tty->cooked_q));
+	count = MIN(s->flip_count[n] - s->flip_off, room);
+	if(count > 0) {
+		count = tty_queue_putbuf(&tty->read_q, s->flip_buf[n] + s->flip_off, count);
+		s->flip_off += count;
+	}
+
+	return (s->flip_count[n] - s->flip_off) + s->flip_count[n ^ 1];
+}
+
 void irq_serial_bh(struct sigcontext *sc)
 {
 	struct tty *tty;
 	struct serial *s;
+	int pending;
 
 	s = serial_active;
 
 	if(s) {
 		do {
 			tty = s->tty;
-			if(tty->read_q.count) {
-				if(!lock_area(AREA_SERIAL_READ)) {
-					tty->input(tty);
-					unlock_area(AREA_SERIAL_READ);
-				} else {
+			if(!lock_area(AREA_SERIAL_READ)) {
+				do {
+					pending = serial_drain_flip(s);
+					if(tty->read_q.count) {
+						tty->input(tty);
+					}
+				} while(pending && tty_queue_room(&tty->cooked_q));
+				unlock_area(AREA_SERIAL_READ);
+				if(pending) {
 					serial_bh.flags |= BH_ACTIVE;
 				}
+			} else {
+				serial_bh.flags |= BH_ACTIVE;
 			}
 			s = s->next;
 		} while(s);
@@ -548,6 +741,7 @@ static int register_serial(struct serial *s, int minor)
 
 	serial_default(s);
 	if((type = serial_identify(s))) {
+		s->type = type;
 		s->name[4] = '0' + minor;
 		printk("%s	  0x%04x-0x%04x	  %3d\ttype=%s%s\n", s->name, s->ioaddr, s->ioaddr + s->iosize - 1, s->irq, serial_chip[type], s->flags & UART_HAS_FIFO ? " FIFO=yes" : "");
 		SET_MINOR(serial_device.minors, (1 << SERIAL_MSF) + minor);
@@ -570,6 +764,7 @@ static int register_serial(struct serial *s, int minor)
 			tty->open = serial_open;
 			tty->close = serial_close;
 			tty->set_termios = serial_set_termios;
+			tty->ioctl = serial_ioctl;
 			serial_reset(tty);
 			for(n = 0; n < MAX_TAB_COLS; n++) {
 				if(!(n % TAB_SIZE)) {
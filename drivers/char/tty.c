@@ -503,7 +503,7 @@ int tty_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
 
 	/* only the foreground process group is allowed to read from the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
-		if(current->sigaction[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
+		if(current->sighand->action[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
 			return -EIO;
 		}
 		kill_pgrp(current->pgid, SIGTTIN, KERNEL);
@@ -650,7 +650,7 @@ int tty_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t
 	/* only the foreground process group is allowed to write to the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
 		if(tty->termios.c_lflag & TOSTOP) {
-			if(current->sigaction[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
+			if(current->sighand->action[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
 				if(is_orphaned_pgrp(current->pgid)) {
 					return -EIO;
 				}
@@ -985,6 +985,14 @@ int tty_ioctl(struct inode *i, int cmd, unsigned int arg)
 			break;
 		}
 
+		case TIOCGSERIAL:
+		case TIOCSSERIAL:
+		case TIOCGICOUNT:
+			if(!tty->ioctl) {
+				return -EINVAL;
+			}
+			return tty->ioctl(tty, cmd, arg);
+
 		default:
 			return vt_ioctl(tty, cmd, arg);
 	}
@@ -177,6 +177,36 @@ int tty_queue_putchar(struct tty *tty, struct clist *q, unsigned char ch)
 	return errno;
 }
 
+/* appends a block of characters, returns the number of characters queued */
+int tty_queue_putbuf(struct clist *q, const unsigned char *buf, int count)
+{
+	unsigned int flags;
+	struct cblock *cb;
+	int n, total;
+
+	SAVE_FLAGS(flags); CLI();
+
+	total = 0;
+	while(count > 0) {
+		cb = q->tail;
+		if(!cb || cb->end_off >= CBSIZE) {
+			if(!(cb = insert_cblock_in_tail(q))) {
+				break;
+			}
+		}
+		n = MIN(CBSIZE - cb->end_off, count);
+		memcpy_b(cb->data + cb->end_off, buf, n);
+		cb->end_off += n;
+		q->count += n;
+		buf += n;
+		total += n;
+		count -= n;
+	}
+
+	RESTORE_FLAGS(flags);
+	return total;
+}
+
 int tty_queue_unputchar(struct clist *q)
 {
 	unsigned int flags;
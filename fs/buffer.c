@@ -480,11 +480,60 @@ static struct buffer *getblk(__dev_t dev, __blk_t block, int size)
 	}
 }
 
+/*
+ * Buffers of devices that keep their blocks in memory (i.e. ramdisk) have no
+ * data of their own, they point straight to the device memory. They only
+ * exist while someone is using them, so they never go to the free list.
+ */
+static struct buffer *getblk_direct(struct device *d, __dev_t dev, __blk_t block, int size)
+{
+	unsigned int flags;
+	struct buffer *buf, *new;
+	char *data;
+
+	if(!(data = d->direct_access(dev, block, size))) {
+		return NULL;
+	}
+
+	for(;;) {
+		if(!(new = add_buffer_to_pool())) {
+			return NULL;
+		}
+
+		SAVE_FLAGS(flags); CLI();
+		if((buf = search_buffer_hash(dev, block, size))) {
+			del_buffer_from_pool(new);
+			if(buf->flags & BUFFER_LOCKED) {
+				sleep(&buffer_wait, PROC_UNINTERRUPTIBLE);
+				RESTORE_FLAGS(flags);
+				continue;
+			}
+			buf->flags |= BUFFER_LOCKED;
+			RESTORE_FLAGS(flags);
+			return buf;
+		}
+		new->dev = dev;
+		new->block = block;
+		new->size = size;
+		new->data = data;
+		new->flags = BUFFER_DIRECT | BUFFER_VALID | BUFFER_LOCKED;
+		insert_to_hash(new);
+		RESTORE_FLAGS(flags);
+		return new;
+	}
+}
+
 struct buffer *bread(__dev_t dev, __blk_t block, int size)
 {
 	struct buffer *buf;
 	struct device *d;
 
+	if((d = get_device(BLK_DEV, dev)) && d->direct_access) {
+		if((buf = getblk_direct(d, dev, block, size))) {
+			return buf;
+		}
+	}
+
 	if((buf = getblk(dev, block, size))) {
 		if(buf->flags & BUFFER_VALID) {
 			return buf;
@@ -519,6 +568,15 @@ void brelse(struct buffer *buf)
 
 	SAVE_FLAGS(flags); CLI();
 
+	/* the data was written in place, there's nothing to keep */
+	if(buf->flags & BUFFER_DIRECT) {
+		remove_from_hash(buf);
+		del_buffer_from_pool(buf);
+		RESTORE_FLAGS(flags);
+		wakeup(&buffer_wait);
+		return;
+	}
+
 	if(buf->flags & BUFFER_DIRTY) {
 		insert_on_dirty_list(buf);
 	}
@@ -532,6 +590,163 @@ void brelse(struct buffer *buf)
 	wakeup(&buffer_wait);
 }
 
+/*
+ * Transfers a block between the device and 'data' bypassing the buffer cache
+ * (O_DIRECT). A dirty copy of the block in the cache is newer than the one
+ * on disk, so reads are served from it, and a cached copy is updated (and
+ * no longer dirty) when the block is written.
+ */
+int brw_direct(int mode, __dev_t dev, __blk_t block, char *data, int size)
+{
+	unsigned int flags;
+	struct buffer *buf;
+	struct device *d;
+	int errno;
+
+	if(!(d = get_device(BLK_DEV, dev))) {
+		return -ENXIO;
+	}
+	if(mode == BLK_WRITE && !d->fsop->write_block) {
+		return -EROFS;
+	}
+
+	buf = NULL;
+
+	/* devices with direct access have no copies of their blocks */
+	if(!d->direct_access) {
+		for(;;) {
+			SAVE_FLAGS(flags); CLI();
+			if((buf = search_buffer_hash(dev, block, size))) {
+				if(buf->flags & BUFFER_LOCKED) {
+					sleep(&buffer_wait, PROC_UNINTERRUPTIBLE);
+					RESTORE_FLAGS(flags);
+					continue;
+				}
+				buf->flags |= BUFFER_LOCKED;
+				remove_from_free_list(buf);
+			}
+			RESTORE_FLAGS(flags);
+			break;
+		}
+	}
+
+	if(buf && mode == BLK_READ && (buf->flags & BUFFER_DIRTY)) {
+		memcpy_b(data, buf->data, size);
+		brelse(buf);
+		return size;
+	}
+
+	if(mode == BLK_READ) {
+		errno = d->fsop->read_block(dev, block, data, size);
+	} else {
+		errno = d->fsop->write_block(dev, block, data, size);
+	}
+
+	if(buf) {
+		if(mode == BLK_WRITE && errno == size) {
+			memcpy_b(buf->data, data, size);
+			buf->flags |= BUFFER_VALID;
+			if(buf->flags & BUFFER_DIRTY) {
+				buf->flags &= ~BUFFER_DIRTY;
+				remove_from_dirty_list(buf);
+			}
+		}
+		brelse(buf);
+	}
+	return errno;
+}
+
+/*
+ * Reads or writes 'count' bytes of a regular file or a block device opened
+ * with O_DIRECT. Every block is transferred by the driver (with DMA if the
+ * drive supports it) straight from or to the user page that holds it, so
+ * the file offset, the count and the user buffer must be aligned to the
+ * block size. Otherwise it returns -EAGAIN and the caller falls back to the
+ * cached I/O.
+ */
+int direct_io(int mode, struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
+{
+	__blk_t block;
+	__dev_t dev;
+	__loff_t size;
+	__size_t total, bytes;
+	unsigned int addr;
+	struct device *d;
+	struct page *pg;
+	char *data;
+	int blksize, errno;
+
+	if(S_ISBLK(i->i_mode)) {
+		if(!(d = get_device(BLK_DEV, i->rdev)) || !d->device_data) {
+			return -EAGAIN;
+		}
+		dev = i->rdev;
+		blksize = ((unsigned int *)d->blksize)[MINOR(dev)];
+		size = ((unsigned int *)d->device_data)[MINOR(dev)];
+		size *= 1024LLU;
+	} else {
+		if(!i->fsop || !i->fsop->bmap) {
+			return -EAGAIN;
+		}
+		dev = i->dev;
+		blksize = i->sb->s_blocksize;
+		size = i->i_size;
+	}
+	blksize = blksize ? blksize : BLKSIZE_1K;
+
+	if(fd_table->offset % blksize || count % blksize || (unsigned int)buffer % blksize) {
+		return -EAGAIN;
+	}
+
+	/* only regular files can grow */
+	if(mode == BLK_READ || S_ISBLK(i->i_mode)) {
+		if(fd_table->offset >= size) {
+			return mode == BLK_READ ? 0 : -ENOSPC;
+		}
+		if(fd_table->offset + count > size) {
+			count = size - fd_table->offset;
+		}
+	}
+
+	total = 0;
+	errno = 0;
+	while(total < count) {
+		if(S_ISBLK(i->i_mode)) {
+			block = fd_table->offset / blksize;
+		} else if((block = bmap(i, fd_table->offset, mode == BLK_READ ? FOR_READING : FOR_WRITING)) < 0) {
+			errno = block;
+			break;
+		}
+		addr = (unsigned int)buffer + total;
+		if(!(pg = get_user_page(addr, mode == BLK_READ ? VERIFY_WRITE : VERIFY_READ))) {
+			errno = -EFAULT;
+			break;
+		}
+		data = pg->data + (addr & ~PAGE_MASK);
+		if(block) {
+			errno = brw_direct(mode, dev, block, data, blksize);
+		} else {
+			/* fill the hole with zeros */
+			memset_b(data, 0, blksize);
+			errno = blksize;
+		}
+		if(errno != blksize) {
+			release_page(pg);
+			errno = errno < 0 ? errno : -EIO;
+			break;
+		}
+		bytes = MIN(blksize, count - total);
+		if(mode == BLK_WRITE && !S_ISBLK(i->i_mode)) {
+			update_page_cache(i, fd_table->offset, data, bytes);
+		}
+		release_page(pg);
+		total += bytes;
+		fd_table->offset += bytes;
+	}
+
+	return total ? total : errno;
+}
+
 void sync_buffers(__dev_t dev)
 {
 	struct buffer *buf, *first;
@@ -562,6 +777,7 @@ void sync_buffers(__dev_t dev)
 			}
 			buf->flags &= ~BUFFER_LOCKED;
 			wakeup(&buffer_wait);
+			cond_resched();
 		}
 	}
 	unlock_resource(&sync_resource);
@@ -11,6 +11,7 @@
 #include <fiwix/devices.h>
 #include <fiwix/fs.h>
 #include <fiwix/mm.h>
+#include <fiwix/fcntl.h>
 #include <fiwix/process.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -36,6 +37,7 @@ struct fs_operations def_chr_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -79,6 +81,7 @@ struct fs_operations def_blk_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lockup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -237,7 +240,7 @@ int blk_dev_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t co
 	__blk_t block;
 	__size_t total_read;
 	__loff_t device_size;
-	int blksize;
+	int blksize, errno;
 	unsigned int boffset, bytes;
 	struct buffer *buf;
 	struct device *d;
@@ -246,6 +249,12 @@ int blk_dev_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t co
 		return -ENXIO;
 	}
 
+	if(fd_table->flags & O_DIRECT) {
+		if((errno = direct_io(BLK_READ, i, fd_table, buffer, count)) != -EAGAIN) {
+			return errno;
+		}
+	}
+
 	total_read = 0;
 	if(!d->device_data) {
 		printk("%s(): don't know the size of the block device %d,%d.\n", __FUNCTION__, MAJOR(i->rdev), MINOR(i->rdev));
@@ -282,7 +291,7 @@ int blk_dev_write(struct inode *i, struct fd *fd_table, const char *buffer, __si
 	__blk_t block;
 	__size_t total_written;
 	__loff_t device_size;
-	int blksize;
+	int blksize, errno;
 	unsigned int boffset, bytes;
 	struct buffer *buf;
 	struct device *d;
@@ -291,6 +300,12 @@ int blk_dev_write(struct inode *i, struct fd *fd_table, const char *buffer, __si
 		return -ENXIO;
 	}
 
+	if(fd_table->flags & O_DIRECT) {
+		if((errno = direct_io(BLK_WRITE, i, fd_table, (char *)buffer, count)) != -EAGAIN) {
+			return errno;
+		}
+	}
+
 	total_written = 0;
 	if(!d->device_data) {
 		printk("%s(): don't know the size of the block device %d,%d.\n", __FUNCTION__, MAJOR(i->rdev), MINOR(i->rdev));
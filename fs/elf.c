@@ -16,6 +16,8 @@
 #include <fiwix/fs.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/process.h>
+#include <fiwix/vsyscall.h>
+#include <fiwix/aio.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -62,7 +64,7 @@
  * 	+---------------+
  * 0x08048000
  */
-static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned int str_ptr, int at_base, struct elf32_hdr *elf32_h, unsigned int phdr_addr)
+static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned int str_ptr, int at_base, struct elf32_hdr *elf32_h, unsigned int phdr_addr, unsigned int sysinfo)
 {
 	unsigned int n, addr;
 	char *str;
@@ -262,6 +264,34 @@ static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned in
 		sp++;
 	}
 
+	if(sysinfo) {
+		*sp = AT_SYSINFO;
+#ifdef __DEBUG__
+		printk("at 0x%08x -> AT_SYSINFO = %d", sp, *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = sysinfo;
+#ifdef __DEBUG__
+		printk("\t\tAT_SYSINFO = 0x%08x\n", *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+#ifdef CONFIG_VSYSCALL
+		*sp = AT_VTIME;
+#ifdef __DEBUG__
+		printk("at 0x%08x -> AT_VTIME = %d", sp, *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = sysinfo - VSYSCALL_ENTRY + VSYSCALL_VTIME;
+#ifdef __DEBUG__
+		printk("\t\tAT_VTIME = 0x%08x\n", *sp);
+#endif /*__DEBUG__ */
+		sp++;
+#endif /* CONFIG_VSYSCALL */
+	}
+
 	*sp = AT_NULL;
 #ifdef __DEBUG__
 	printk("at 0x%08x -> AT_NULL = %d", sp, *sp);
@@ -286,33 +316,26 @@ static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned in
 static int elf_load_interpreter(struct inode *ii)
 {
 	int n, errno;
-	struct buffer *buf;
 	struct elf32_hdr *elf32_h;
 	struct elf32_phdr *elf32_ph, *last_ptload;
-	__blk_t block;
 	unsigned int start, end, length, offset;
 	unsigned int prot;
 	char *data;
 	char type;
 
-	if((block = bmap(ii, 0, FOR_READING)) < 0) {
-		return block;
-	}
-	if(!(buf = bread(ii->dev, block, ii->sb->s_blocksize))) {
-		return -EIO;
-	}
-
 	/*
-	 * The contents of the buffer is copied and then freed immediately to
-	 * make sure that it won't conflict while zeroing the BSS fractional
-	 * page, in case that the same block is requested during the page fault.
+	 * The header is copied to a separate page to make sure that it won't
+	 * conflict while zeroing the BSS fractional page, in case that the
+	 * same page is requested during the page fault.
 	 */
 	if(!(data = (void *)kmalloc(PAGE_SIZE))) {
-		brelse(buf);
 		return -ENOMEM;
 	}
-	memcpy_b(data, buf->data, ii->sb->s_blocksize);
-	brelse(buf);
+	memset_b(data, 0, PAGE_SIZE);
+	if((errno = kernel_read(ii, 0, data, PAGE_SIZE)) < 0) {
+		kfree((unsigned int)data);
+		return errno;
+	}
 
 	elf32_h = (struct elf32_hdr *)data;
 	if(check_elf(elf32_h)) {
@@ -413,7 +436,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 	int at_base, phdr_addr;
 	char type;
 	unsigned int ae_ptr_len, ae_str_len;
-	unsigned int sp, str;
+	unsigned int sp, str, sysinfo;
 
 	elf32_h = (struct elf32_hdr *)data;
 	if(check_elf(elf32_h)) {
@@ -461,11 +484,18 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 	printk("argc=%d (argv_len=%d) envc=%d (envp_len=%d)  ae_ptr_len=%d ae_str_len=%d\n", barg->argc, barg->argv_len, barg->envc, barg->envp_len, ae_ptr_len, ae_str_len);
 #endif /*__DEBUG__ */
 
+	if((errno = exec_unshare())) {
+		if(interpreter) {
+			iput(ii);
+		}
+		return errno;
+	}
 
 	/* point of no return */
 
+	exit_aio(current->mm);
 	release_binary();
-	current->rss = 0;
+	current->mm->rss = 0;
 
 	current->entry_address = elf32_h->e_entry;
 	if(interpreter) {
@@ -538,7 +568,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk_lower = start;
+	current->mm->brk_lower = start;
 
 	/* setup the HEAP section */
 	start = elf32_ph->p_vaddr + elf32_ph->p_memsz;
@@ -549,7 +579,13 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk = start;
+	current->mm->brk = start;
+
+	sysinfo = 0;
+#ifdef CONFIG_VSYSCALL
+	/* setup the vsyscall page */
+	sysinfo = vsyscall_map();
+#endif /* CONFIG_VSYSCALL */
 
 	/* setup the STACK section */
 	sp = PAGE_OFFSET - 4;	/* formerly 0xBFFFFFFC */
@@ -557,6 +593,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 	str = sp;	/* this is the address of the first string (argv[0]) */
 	sp &= ~3;
 	sp -= at_base ? (AT_ITEMS * 2) * sizeof(unsigned int) : 2 * sizeof(unsigned int);
+	sp -= sysinfo ? 4 * sizeof(unsigned int) : 0;	/* AT_SYSINFO, AT_VTIME */
 	sp -= ae_ptr_len;
 	length = PAGE_OFFSET - (sp & PAGE_MASK);
 	errno = do_mmap(NULL, sp & PAGE_MASK, length, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_FIXED, 0, P_STACK, 0, NULL);
@@ -565,7 +602,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		return -ENOEXEC;
 	}
 
-	elf_create_stack(barg, (unsigned int *)sp, str, at_base, elf32_h, phdr_addr);
+	elf_create_stack(barg, (unsigned int *)sp, str, at_base, elf32_h, phdr_addr, sysinfo);
 
 	/* set %esp to point to 'argc' */
 	sc->oldesp = sp;
@@ -579,5 +616,13 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 	sc->ebp = 0;
 	sc->esi = 0;
 	sc->edi = 0;
+
+	/* the TLS descriptor was cleared */
+	if((sc->fs & ~USER_PL) == TLS) {
+		sc->fs = USER_DS | USER_PL;
+	}
+	if((sc->gs & ~USER_PL) == TLS) {
+		sc->gs = USER_DS | USER_PL;
+	}
 	return 0;
 }
@@ -17,6 +17,8 @@
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
+struct ext2_alloc_stat ext2_alloc_stat;
+
 static int find_first_zero(struct superblock *sb, __blk_t bmblock, struct buffer **buf)
 {
 	unsigned char c;
@@ -38,6 +40,24 @@ static int find_first_zero(struct superblock *sb, __blk_t bmblock, struct buffer
 	return -ENOSPC;
 }
 
+static int find_next_zero(struct buffer *buf, int item, int max)
+{
+	unsigned char c;
+
+	while(item < max) {
+		c = (unsigned char)buf->data[item / 8];
+		if(c == 0xFF && !(item % 8)) {
+			item += 8;
+			continue;
+		}
+		if(!(c & (1 << (item % 8)))) {
+			return item;
+		}
+		item++;
+	}
+	return -ENOSPC;
+}
+
 static int change_bit(int mode, struct superblock *sb, __blk_t bmblock, struct buffer *bmbuf, int item)
 {
 	int byte, bit, mask;
@@ -269,6 +289,129 @@ int ext2_balloc(struct superblock *sb)
 	return block;
 }
 
+/*
+ * Allocates a block for the inode 'i', looking first for a free block from
+ * the one that follows the last block it was given (or from the beginning
+ * of its block group) to the end of that group. If there is none, it falls
+ * back to ext2_balloc().
+ *
+ * For regular files it also reserves up to EXT2_PREALLOC_BLOCKS - 1 free
+ * blocks right after the allocated one, so that files written at the same
+ * time don't end up interleaved block by block on disk. These blocks are
+ * marked as used in the bitmap, and are given back by ext2_discard_prealloc()
+ * when the file is closed or truncated.
+ */
+int ext2_new_block(struct inode *i)
+{
+	__blk_t goal, block, first;
+	struct superblock *sb;
+	struct ext2_group_desc *gd;
+	struct buffer *buf, *bmbuf;
+	int bg, item, max, n, errno;
+
+	sb = i->sb;
+	superblock_lock(sb);
+
+	if(i->u.ext2.i_prealloc_count) {
+		block = i->u.ext2.i_prealloc_block++;
+		i->u.ext2.i_prealloc_count--;
+		i->u.ext2.i_alloc_goal = block + 1;
+		ext2_alloc_stat.allocated++;
+		ext2_alloc_stat.contiguous++;
+		ext2_alloc_stat.prealloc_used++;
+		superblock_unlock(sb);
+		return block;
+	}
+
+	first = sb->u.ext2.sb.s_first_data_block;
+	goal = i->u.ext2.i_alloc_goal;
+	if(goal <= first || goal >= sb->u.ext2.sb.s_blocks_count) {
+		bg = (i->inode - 1) / EXT2_INODES_PER_GROUP(sb);
+		goal = (bg * EXT2_BLOCKS_PER_GROUP(sb)) + first;
+	}
+	bg = (goal - first) / EXT2_BLOCKS_PER_GROUP(sb);
+	item = (goal - first) % EXT2_BLOCKS_PER_GROUP(sb);
+	max = sb->u.ext2.sb.s_blocks_count - first - (bg * EXT2_BLOCKS_PER_GROUP(sb));
+	max = MIN(max, EXT2_BLOCKS_PER_GROUP(sb));
+
+	if(!(buf = bread(sb->dev, SUPERBLOCK + first + (bg / EXT2_DESC_PER_BLOCK(sb)), sb->s_blocksize))) {
+		superblock_unlock(sb);
+		return -EIO;
+	}
+	gd = (struct ext2_group_desc *)(buf->data + ((bg % EXT2_DESC_PER_BLOCK(sb)) * sizeof(struct ext2_group_desc)));
+	bmbuf = NULL;
+	errno = -ENOSPC;
+	if(gd->bg_free_blocks_count) {
+		if(!(bmbuf = bread(sb->dev, gd->bg_block_bitmap, sb->s_blocksize))) {
+			brelse(buf);
+			superblock_unlock(sb);
+			return -EIO;
+		}
+		errno = find_next_zero(bmbuf, item, max);
+	}
+	if(errno < 0) {
+		if(bmbuf) {
+			brelse(bmbuf);
+		}
+		brelse(buf);
+		superblock_unlock(sb);
+
+		/* the group is full from the goal onwards */
+		if((block = ext2_balloc(sb)) < 0) {
+			return block;
+		}
+		ext2_alloc_stat.allocated++;
+		i->u.ext2.i_alloc_goal = block + 1;
+		return block;
+	}
+
+	item = errno;
+	bmbuf->data[item / 8] |= 1 << (item % 8);
+	n = 0;
+	if(S_ISREG(i->i_mode)) {
+		while(n + 1 < EXT2_PREALLOC_BLOCKS && item + n + 1 < max) {
+			if(bmbuf->data[(item + n + 1) / 8] & (1 << ((item + n + 1) % 8))) {
+				break;
+			}
+			bmbuf->data[(item + n + 1) / 8] |= 1 << ((item + n + 1) % 8);
+			n++;
+		}
+	}
+	block = item + (bg * EXT2_BLOCKS_PER_GROUP(sb)) + first;
+	gd->bg_free_blocks_count -= n + 1;
+	sb->u.ext2.sb.s_free_blocks_count -= n + 1;
+	bwrite(bmbuf);
+	bwrite(buf);
+
+	ext2_alloc_stat.allocated++;
+	if(block == i->u.ext2.i_alloc_goal) {
+		ext2_alloc_stat.contiguous++;
+	}
+	i->u.ext2.i_alloc_goal = block + 1;
+	i->u.ext2.i_prealloc_block = block + 1;
+	i->u.ext2.i_prealloc_count = n;
+
+	superblock_unlock(sb);
+	return block;
+}
+
+void ext2_discard_prealloc(struct inode *i)
+{
+	__blk_t block;
+	int count;
+
+	superblock_lock(i->sb);
+	block = i->u.ext2.i_prealloc_block;
+	count = i->u.ext2.i_prealloc_count;
+	i->u.ext2.i_prealloc_count = 0;
+	ext2_alloc_stat.prealloc_freed += count;
+	superblock_unlock(i->sb);
+
+	while(count--) {
+		ext2_bfree(i->sb, block++);
+	}
+}
+
 void ext2_bfree(struct superblock *sb, int block)
 {
 	struct ext2_group_desc *gd;
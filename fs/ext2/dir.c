@@ -34,6 +34,7 @@ struct fs_operations ext2_dir_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	ext2_bmap,
+	NULL,			/* get_page */
 	ext2_lookup,
 	ext2_rmdir,
 	ext2_link,
@@ -13,6 +13,7 @@
 #include <fiwix/filesystems.h>
 #include <fiwix/mm.h>
 #include <fiwix/mman.h>
+#include <fiwix/sched.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -35,6 +36,7 @@ struct fs_operations ext2_file_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	ext2_bmap,
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -72,15 +74,18 @@ int ext2_file_open(struct inode *i, struct fd *fd_table)
 
 int ext2_file_close(struct inode *i, struct fd *fd_table)
 {
+	if((fd_table->flags & O_ACCMODE) != O_RDONLY) {
+		ext2_discard_prealloc(i);
+	}
 	return 0;
 }
 
-int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t count)
+static int do_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t count)
 {
 	__blk_t block;
 	__size_t total_written;
 	unsigned int boffset, bytes;
-	int blksize;
+	int blksize, errno;
 	struct buffer *buf;
 
 	inode_lock(i);
@@ -92,6 +97,16 @@ int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __
 		fd_table->offset = i->i_size;
 	}
 
+	if(fd_table->flags & O_DIRECT) {
+		if((errno = direct_io(BLK_WRITE, i, fd_table, (char *)buffer, count)) != -EAGAIN) {
+			if(errno < 0) {
+				inode_unlock(i);
+				return errno;
+			}
+			total_written = count = errno;
+		}
+	}
+
 	while(total_written < count) {
 		boffset = fd_table->offset % blksize;
 		if((block = bmap(i, fd_table->offset, FOR_WRITING)) < 0) {
@@ -109,6 +124,7 @@ int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __
 		bwrite(buf);
 		total_written += bytes;
 		fd_table->offset += bytes;
+		cond_resched();
 	}
 
 	if(fd_table->offset > i->i_size) {
@@ -122,6 +138,23 @@ int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __
 	return total_written;
 }
 
+int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t count)
+{
+	int retval;
+
+	retval = do_file_write(i, fd_table, buffer, count);
+
+	/*
+	 * The temporary descriptors used to write back the pages of the shared
+	 * mappings (see write_page()) are never closed, so the blocks they have
+	 * preallocated would remain used in the bitmap once the inode is freed.
+	 */
+	if(!fd_table->count) {
+		ext2_discard_prealloc(i);
+	}
+	return retval;
+}
+
 __loff_t ext2_file_llseek(struct inode *i, __loff_t offset)
 {
 	return offset;
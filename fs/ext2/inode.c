@@ -224,19 +224,73 @@ int ext2_write_inode(struct inode *i)
 	return 0;
 }
 
+/*
+ * The extent cache keeps the last runs of contiguous blocks found in the
+ * indirect blocks, so that mapping the blocks of a sequentially-allocated
+ * file doesn't need to read one to three indirect blocks every time.
+ * Since only allocated blocks are cached, allocating a block never makes an
+ * extent stale; only freeing them (ext2_truncate) needs to flush the cache.
+ */
+static __blk_t extent_lookup(struct inode *i, __blk_t lblock)
+{
+	struct ext2_extent *e;
+	int n;
+
+	for(n = 0; n < EXT2_NR_EXTENTS; n++) {
+		e = &i->u.ext2.i_extent[n];
+		if(lblock >= e->ee_lblock && lblock - e->ee_lblock < e->ee_len) {
+			return e->ee_pblock + (lblock - e->ee_lblock);
+		}
+	}
+	return 0;
+}
+
+/* caches the run that starts at 'table[index]', which maps 'lblock' */
+static void extent_add(struct inode *i, __blk_t lblock, __blk_t *table, int index)
+{
+	struct ext2_extent *e;
+	int len;
+
+	len = 1;
+	while(index + len < BLOCKS_PER_IND_BLOCK(i->sb)) {
+		if(table[index + len] != table[index] + len) {
+			break;
+		}
+		len++;
+	}
+	e = &i->u.ext2.i_extent[i->u.ext2.i_next_extent];
+	e->ee_lblock = lblock;
+	e->ee_pblock = table[index];
+	e->ee_len = len;
+	i->u.ext2.i_next_extent = (i->u.ext2.i_next_extent + 1) % EXT2_NR_EXTENTS;
+}
+
+static void extent_flush(struct inode *i)
+{
+	memset_b(i->u.ext2.i_extent, 0, sizeof(i->u.ext2.i_extent));
+	i->u.ext2.i_next_extent = 0;
+}
+
 int ext2_bmap(struct inode *i, __off_t offset, int mode)
 {
 	unsigned char level;
 	__blk_t *indblock, *dindblock, *tindblock;
-	__blk_t block, iblock, dblock, tblock, newblock;
+	__blk_t block, lblock, iblock, dblock, tblock, newblock;
 	int blksize;
 	struct buffer *buf, *buf2, *buf3, *buf4;
 
 	blksize = i->sb->s_blocksize;
 	block = offset / blksize;
+	lblock = block;
 	level = 0;
 	buf3 = NULL;	/* makes GCC happy */
 
+	if(block >= EXT2_NDIR_BLOCKS) {
+		if((newblock = extent_lookup(i, block))) {
+			return newblock;
+		}
+	}
+
 	if(block < EXT2_NDIR_BLOCKS) {
 		level = EXT2_NDIR_BLOCKS - 1;
 	} else {
@@ -252,7 +306,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 
 	if(level < EXT2_NDIR_BLOCKS) {
 		if(!i->u.ext2.i_data[block] && mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+			if((newblock = ext2_new_block(i)) < 0) {
 				return -ENOSPC;
 			}
 			/* initialize the new block */
@@ -270,7 +324,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 
 	if(!i->u.ext2.i_data[level]) {
 		if(mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+			if((newblock = ext2_new_block(i)) < 0) {
 				return -ENOSPC;
 			}
 			/* initialize the new block */
@@ -302,7 +356,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 
 	if(!indblock[block]) {
 		if(mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+			if((newblock = ext2_new_block(i)) < 0) {
 				brelse(buf);
 				return -ENOSPC;
 			}
@@ -328,6 +382,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 	}
 	if(level == EXT2_IND_BLOCK) {
 		newblock = indblock[block];
+		extent_add(i, lblock, indblock, block);
 		brelse(buf);
 		return newblock;
 	}
@@ -343,7 +398,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 		block = tindblock[tblock / BLOCKS_PER_IND_BLOCK(i->sb)];
 		if(!block) {
 			if(mode == FOR_WRITING) {
-				if((newblock = ext2_balloc(i->sb)) < 0) {
+				if((newblock = ext2_new_block(i)) < 0) {
 					brelse(buf);
 					brelse(buf3);
 					return -ENOSPC;
@@ -387,7 +442,7 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 	dindblock = (__blk_t *)buf2->data;
 	block = dindblock[dblock - (iblock * BLOCKS_PER_IND_BLOCK(i->sb))];
 	if(!block && mode == FOR_WRITING) {
-		if((newblock = ext2_balloc(i->sb)) < 0) {
+		if((newblock = ext2_new_block(i)) < 0) {
 			brelse(buf);
 			if(level == EXT2_TIND_BLOCK) {
 				brelse(buf3);
@@ -412,6 +467,9 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 		buf2->flags |= (BUFFER_DIRTY | BUFFER_VALID);
 		block = newblock;
 	}
+	if(block) {
+		extent_add(i, lblock, dindblock, dblock - (iblock * BLOCKS_PER_IND_BLOCK(i->sb)));
+	}
 	brelse(buf);
 	if(level == EXT2_TIND_BLOCK) {
 		brelse(buf3);
@@ -432,6 +490,8 @@ int ext2_truncate(struct inode *i, __off_t length)
 	if(!S_ISDIR(i->i_mode) && !S_ISREG(i->i_mode) && !S_ISLNK(i->i_mode)) {
 		return -EINVAL;
 	}
+	extent_flush(i);
+	ext2_discard_prealloc(i);
 
 	if(block < EXT2_NDIR_BLOCKS) {
 		for(n = block; n < EXT2_NDIR_BLOCKS; n++) {
@@ -515,6 +575,9 @@ int ext2_truncate(struct inode *i, __off_t length)
 		}
 	}
 
+	/* a concurrent bmap may have cached the blocks just freed */
+	extent_flush(i);
+
 	i->i_mtime = CURRENT_TIME;
 	i->i_ctime = CURRENT_TIME;
 	i->i_size = length;
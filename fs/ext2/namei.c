@@ -545,7 +545,7 @@ int ext2_mkdir(struct inode *dir, char *name, __mode_t mode)
 		return -ENOSPC;
 	}
 
-	i->i_mode = ((mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->umask);
+	i->i_mode = ((mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->fs->umask);
 	i->i_mode |= S_IFDIR;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
@@ -661,7 +661,7 @@ int ext2_mknod(struct inode *dir, char *name, __mode_t mode, __dev_t dev)
 		break;
 	}
 
-	i->i_mode = (mode & ~current->umask) & ~S_IFMT;
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
 	i->i_nlink = 1;
@@ -757,7 +757,7 @@ int ext2_create(struct inode *dir, char *name, int flags, __mode_t mode, struct
 	}
 	d->file_type = 0;	/* EXT2_FT_REG_FILE not used */
 
-	i->i_mode = (mode & ~current->umask) & ~S_IFMT;
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
 	i->i_mode |= S_IFREG;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
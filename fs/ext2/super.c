@@ -34,6 +34,7 @@ struct fs_operations ext2_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
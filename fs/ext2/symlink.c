@@ -33,6 +33,7 @@ struct fs_operations ext2_symlink_fsop = {
 	ext2_readlink,
 	ext2_followlink,
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
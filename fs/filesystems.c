@@ -82,6 +82,11 @@ void fs_init(void)
 	if(procfs_init()) {
 		printk("%s(): unable to register 'procfs' filesystem.\n", __FUNCTION__);
 	}
+#ifdef CONFIG_FS_TMPFS
+	if(tmpfs_init()) {
+		printk("%s(): unable to register 'tmpfs' filesystem.\n", __FUNCTION__);
+	}
+#endif /* CONFIG_FS_TMPFS */
 #ifdef CONFIG_NET
 	if(sockfs_init()) {
 		printk("%s(): unable to register 'sockfs' filesystem.\n", __FUNCTION__);
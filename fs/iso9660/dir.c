@@ -33,6 +33,7 @@ struct fs_operations iso9660_dir_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	iso9660_bmap,
+	NULL,			/* get_page */
 	iso9660_lookup,
 	NULL,			/* rmdir */
 	NULL,			/* link */
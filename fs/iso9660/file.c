@@ -34,6 +34,7 @@ struct fs_operations iso9660_file_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	iso9660_bmap,
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
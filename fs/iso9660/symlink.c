@@ -34,6 +34,7 @@ struct fs_operations iso9660_symlink_fsop = {
 	iso9660_readlink,
 	iso9660_followlink,
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
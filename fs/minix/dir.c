@@ -35,6 +35,7 @@ struct fs_operations minix_dir_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	minix_bmap,
+	NULL,			/* get_page */
 	minix_lookup,
 	minix_rmdir,
 	minix_link,
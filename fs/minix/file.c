@@ -36,6 +36,7 @@ struct fs_operations minix_file_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	minix_bmap,
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -483,7 +483,7 @@ int minix_mkdir(struct inode *dir, char *name, __mode_t mode)
 		return -ENOSPC;
 	}
 
-	i->i_mode = ((mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->umask);
+	i->i_mode = ((mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->fs->umask);
 	i->i_mode |= S_IFDIR;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
@@ -592,7 +592,7 @@ int minix_mknod(struct inode *dir, char *name, __mode_t mode, __dev_t dev)
 		d->name[n] = 0;
 	}
 
-	i->i_mode = (mode & ~current->umask) & ~S_IFMT;
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
 	i->i_nlink = 1;
@@ -682,7 +682,7 @@ int minix_create(struct inode *dir, char *name, int flags, __mode_t mode, struct
 		d->name[n] = 0;
 	}
 
-	i->i_mode = (mode & ~current->umask) & ~S_IFMT;
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
 	i->i_mode |= S_IFREG;
 	i->i_uid = current->euid;
 	i->i_gid = current->egid;
@@ -33,6 +33,7 @@ struct fs_operations minix_symlink_fsop = {
 	minix_readlink,
 	minix_followlink,
 	NULL,			/* bmap */
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
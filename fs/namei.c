@@ -144,12 +144,12 @@ int parse_namei(char *path, struct inode *base_dir, struct inode **i_res, struct
 	}
 
 	if(!(dir = base_dir)) {
-		dir = current->pwd;
+		dir = current->fs->pwd;
 	}
 
 	/* it is definitely an absolute path */
 	if(path[0] == '/') {
-		dir = current->root;
+		dir = current->fs->root;
 	}
 	dir->count++;
 	errno = do_namei(path, dir, i_res, d_res, follow_links);
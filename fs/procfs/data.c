@@ -23,9 +23,11 @@
 #include <fiwix/irq.h>
 #include <fiwix/sched.h>
 #include <fiwix/timer.h>
+#include <fiwix/latency.h>
 #include <fiwix/utsname.h>
 #include <fiwix/version.h>
 #include <fiwix/socket.h>
+#include <fiwix/serial.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -154,6 +156,19 @@ int data_proc_dma(char *buffer, __pid_t pid)
 	return size;
 }
 
+int data_proc_ext2alloc(char *buffer, __pid_t pid)
+{
+	int size;
+
+	size = sprintk(buffer, "allocated:       %d\n", ext2_alloc_stat.allocated);
+	size += sprintk(buffer + size, "contiguous:      %d\n", ext2_alloc_stat.contiguous);
+	size += sprintk(buffer + size, "fragmented:      %d\n", ext2_alloc_stat.allocated - ext2_alloc_stat.contiguous);
+	size += sprintk(buffer + size, "prealloc_used:   %d\n", ext2_alloc_stat.prealloc_used);
+	size += sprintk(buffer + size, "prealloc_freed:  %d\n", ext2_alloc_stat.prealloc_freed);
+	size += sprintk(buffer + size, "prealloc_window: %d\n", EXT2_PREALLOC_BLOCKS);
+	return size;
+}
+
 int data_proc_filesystems(char *buffer, __pid_t pid)
 {
 	int n, size;
@@ -191,6 +206,35 @@ int data_proc_interrupts(char *buffer, __pid_t pid)
 	return size;
 }
 
+int data_proc_latency(char *buffer, __pid_t pid)
+{
+#ifdef CONFIG_LATENCY_TEST
+	static int permille[] = { 500, 900, 990, 999 };
+	static char *name[] = { "p50:  ", "p90:  ", "p99:  ", "p99.9:" };
+	unsigned int total, target;
+	int n, us, size;
+
+	size = sprintk(buffer, "samples: %d\n", latency_stats.samples);
+	for(n = 0; n < sizeof(permille) / sizeof(int); n++) {
+		/* split to not overflow on long runs */
+		target = latency_stats.samples / 1000 * permille[n];
+		target += ((latency_stats.samples % 1000) * permille[n] + 999) / 1000;
+		total = 0;
+		for(us = 0; us < LATENCY_BUCKETS - 1; us++) {
+			total += latency_stats.hist[us];
+			if(total >= target) {
+				break;
+			}
+		}
+		size += sprintk(buffer + size, "%s   %s%d us\n", name[n], us < LATENCY_BUCKETS - 1 ? "" : ">=", us);
+	}
+	size += sprintk(buffer + size, "max:     %d us\n", latency_stats.max);
+	return size;
+#else
+	return 0;
+#endif /* CONFIG_LATENCY_TEST */
+}
+
 int data_proc_loadavg(char *buffer, __pid_t pid)
 {
 	int a, b, c;
@@ -355,32 +399,38 @@ int data_proc_rtc(char *buffer, __pid_t pid)
 	return size;
 }
 
-int data_proc_stat(char *buffer, __pid_t pid)
+static int show_proc_stat(struct procfs_seq *m, void *v)
 {
-	int n, size;
+	int n;
 	unsigned int idle;
 	struct interrupt *irq;
 
 	idle = kstat.ticks - (kstat.cpu_user + kstat.cpu_nice + kstat.cpu_system);
-	size = 0;
-	size += sprintk(buffer + size, "cpu %d %d %d %d\n", kstat.cpu_user, kstat.cpu_nice, kstat.cpu_system, idle);
-	size += sprintk(buffer + size, "disk 0 0 0 0\n");
-	size += sprintk(buffer + size, "page 0 0\n");
-	size += sprintk(buffer + size, "swap 0 0\n");
-	size += sprintk(buffer + size, "intr %u", kstat.irqs);
+	procfs_seq_printf(m, "cpu %d %d %d %d\n", kstat.cpu_user, kstat.cpu_nice, kstat.cpu_system, idle);
+	procfs_seq_printf(m, "disk 0 0 0 0\n");
+	procfs_seq_printf(m, "page 0 0\n");
+	procfs_seq_printf(m, "swap 0 0\n");
+	procfs_seq_printf(m, "intr %u", kstat.irqs);
 	for(n = 0; n < NR_IRQS; n++) {
 		irq = irq_table[n];
 		if(irq) {
-			size += sprintk(buffer + size, " %u", irq->ticks);
+			procfs_seq_printf(m, " %u", irq->ticks);
 		}
 	}
-	size += sprintk(buffer + size, "\n");
-	size += sprintk(buffer + size, "ctxt %u\n", kstat.ctxt);
-	size += sprintk(buffer + size, "btime %d\n", kstat.boot_time);
-	size += sprintk(buffer + size, "processes %d\n", kstat.processes);
-	return size;
+	procfs_seq_printf(m, "\n");
+	procfs_seq_printf(m, "ctxt %u\n", kstat.ctxt);
+	procfs_seq_printf(m, "tlb %u %u\n", kstat.tlb_flushes, kstat.tlb_page_flushes);
+	procfs_seq_printf(m, "btime %d\n", kstat.boot_time);
+	return procfs_seq_printf(m, "processes %d\n", kstat.processes);
 }
 
+struct procfs_seq_ops seq_proc_stat = {
+	procfs_seq_single_start,
+	procfs_seq_single_next,
+	procfs_seq_single_stop,
+	show_proc_stat
+};
+
 int data_proc_uptime(char *buffer, __pid_t pid)
 {
 	struct proc *p;
@@ -493,6 +543,37 @@ int data_proc_dirty_background_ratio(char *buffer, __pid_t pid)
 	return sprintk(buffer, "%d\n", BUFFER_DIRTY_RATIO);
 }
 
+int data_proc_tty_serial(char *buffer, __pid_t pid)
+{
+	struct serial *s;
+	int size, trigger;
+
+	size = sprintk(buffer, "serinfo:1.0 driver revision:\n");
+	for(s = serial_active; s; s = s->next) {
+		switch(s->fcr) {
+			case UART_FCR_FIFO1:
+				trigger = 1;
+				break;
+			case UART_FCR_FIFO4:
+				trigger = 4;
+				break;
+			case UART_FCR_FIFO8:
+				trigger = 8;
+				break;
+			default:
+				trigger = 14;
+				break;
+		}
+		size += sprintk(buffer + size, "%d: uart:%s port:%08X irq:%d baud:%d", MINOR(s->tty->dev) - (1 << SERIAL_MSF), serial_chip[s->type], s->ioaddr, s->irq, s->baud);
+		if(s->flags & UART_HAS_FIFO) {
+			size += sprintk(buffer + size, " rxtrig:%d", trigger);
+		}
+		size += sprintk(buffer + size, " tx:%d rx:%d", s->icount.tx, s->icount.rx);
+		size += sprintk(buffer + size, " fe:%d pe:%d brk:%d oe:%d bufovr:%d\n", s->icount.frame, s->icount.parity, s->icount.brk, s->icount.overrun, s->icount.buf_overrun);
+	}
+	return size;
+}
+
 
 /*
  * PID directory related functions
@@ -507,7 +588,7 @@ int data_proc_pid_fd(char *buffer, __pid_t pid, __ino_t inode)
 	size = 0;
 	ufd = inode & 0xFFF;
 	if((p = get_proc_by_pid(pid))) {
-		i = fd_table[p->fd[ufd]].inode;
+		i = fd_table[p->files->fd[ufd]].inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->dev), MINOR(i->dev), i->inode);
 	}
 	return size;
@@ -554,11 +635,11 @@ int data_proc_pid_cwd(char *buffer, __pid_t pid)
 	if((p = get_proc_by_pid(pid))) {
 
 		/* zombie processes don't have current working directory */
-		if(!p->pwd) {
+		if(!p->fs->pwd) {
 			return -ENOENT;
 		}
 
-		i = p->pwd;
+		i = p->fs->pwd;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -610,73 +691,98 @@ int data_proc_pid_exe(char *buffer, __pid_t pid)
 		 * This assumes that the first entry in the vma_table
 		 * contains the program's inode.
 		 */
-		if(!p->vma_table || !p->vma_table->inode) {
+		if(!p->mm->vma_table || !p->mm->vma_table->inode) {
 			return -ENOENT;
 		}
 
-		i = p->vma_table->inode;
+		i = p->mm->vma_table->inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
 }
 
-int data_proc_pid_maps(char *buffer, __pid_t pid)
+/*
+ * The vma region is searched again by its position on every step, since the
+ * process may change its memory map while the snapshot is being rendered.
+ */
+static void *start_proc_pid_maps(struct procfs_seq *m, int *pos)
+{
+	struct proc *p;
+	struct vma *vma;
+	int n;
+
+	if(!(p = get_proc_by_pid(m->pid))) {
+		return NULL;
+	}
+	vma = p->mm->vma_table;
+	for(n = 0; vma && n < *pos; n++) {
+		vma = vma->next;
+	}
+	return vma;
+}
+
+static void *next_proc_pid_maps(struct procfs_seq *m, void *v, int *pos)
+{
+	(*pos)++;
+	return start_proc_pid_maps(m, pos);
+}
+
+static int show_proc_pid_maps(struct procfs_seq *m, void *v)
 {
-	int size, len;
 	__ino_t inode;
 	int major, minor;
 	char *section;
 	char r, w, x, f;
-	struct proc *p;
 	struct vma *vma;
 
-	size = 0;
-	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
-		while(vma) {
-			r = vma->prot & PROT_READ ? 'r' : '-';
-			w = vma->prot & PROT_WRITE ? 'w' : '-';
-			x = vma->prot & PROT_EXEC ? 'x' : '-';
-			if(vma->flags & MAP_SHARED) {
-				f = 's';
-			} else if(vma->flags & MAP_PRIVATE) {
-				f = 'p';
-			} else {
-				f = '-';
-			}
-			switch(vma->s_type) {
-				case P_TEXT:	section = "text";
-						break;
-				case P_DATA:	section = "data";
-						break;
-				case P_BSS:	section = "bss";
-						break;
-				case P_HEAP:	section = "heap";
-						break;
-				case P_STACK:	section = "stack";
-						break;
-				case P_MMAP:	section = "mmap";
-						break;
-				case P_SHM:	section = "shm";
-						break;
-				default:
-					section = NULL;
-					break;
-			}
-			inode = major = minor = 0;
-			if(vma->inode) {
-				inode = vma->inode->inode;
-				major = MAJOR(vma->inode->dev);
-				minor = MINOR(vma->inode->dev);
-			}
-			len = sprintk(buffer + size, "%08x-%08x %c%c%c%c %08x %02d:%02d %- 10u [%s]\n", vma->start, vma->end, r, w, x, f, vma->offset, major, minor, inode, section);
-			size += len;
-			vma = vma->next;
-		}
+	vma = (struct vma *)v;
+	r = vma->prot & PROT_READ ? 'r' : '-';
+	w = vma->prot & PROT_WRITE ? 'w' : '-';
+	x = vma->prot & PROT_EXEC ? 'x' : '-';
+	if(vma->flags & MAP_SHARED) {
+		f = 's';
+	} else if(vma->flags & MAP_PRIVATE) {
+		f = 'p';
+	} else {
+		f = '-';
 	}
-	return size;
+	switch(vma->s_type) {
+		case P_TEXT:	section = "text";
+				break;
+		case P_DATA:	section = "data";
+				break;
+		case P_BSS:	section = "bss";
+				break;
+		case P_HEAP:	section = "heap";
+				break;
+		case P_STACK:	section = "stack";
+				break;
+		case P_MMAP:	section = "mmap";
+				break;
+		case P_SHM:	section = "shm";
+				break;
+		case P_VSYSCALL: section = "vsyscall";
+				break;
+		default:
+			section = NULL;
+			break;
+	}
+	inode = major = minor = 0;
+	if(vma->inode) {
+		inode = vma->inode->inode;
+		major = MAJOR(vma->inode->dev);
+		minor = MINOR(vma->inode->dev);
+	}
+	return procfs_seq_printf(m, "%08x-%08x %c%c%c%c %08x %02d:%02d %- 10u [%s]\n", vma->start, vma->end, r, w, x, f, vma->offset, major, minor, inode, section);
 }
 
+struct procfs_seq_ops seq_proc_pid_maps = {
+	start_proc_pid_maps,
+	next_proc_pid_maps,
+	procfs_seq_single_stop,
+	show_proc_pid_maps
+};
+
 int data_proc_pid_mountinfo(char *buffer, __pid_t pid)
 {
 	int n, size;
@@ -711,11 +817,11 @@ int data_proc_pid_root(char *buffer, __pid_t pid)
 	if((p = get_proc_by_pid(pid))) {
 
 		/* zombie processes don't have root directory */
-		if(!p->root) {
+		if(!p->fs->root) {
 			return -ENOENT;
 		}
 
-		i = p->root;
+		i = p->fs->root;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -736,7 +842,7 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 	vma_start = vma_end = 0;
 
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 
 		/*
 		 * This assumes that the first entry in the vma_table
@@ -769,10 +875,10 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 
 		sigignored = sigcaught = 0;
 		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
+			if(p->sighand->action[signum].sa_handler == SIG_IGN) {
 				sigignored |= mask;
 			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
+			if(p->sighand->action[signum].sa_handler == SIG_DFL) {
 				sigcaught |= mask;
 			}
 		}
@@ -802,7 +908,7 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 			0,			/* itrealvalue */
 			p->start_time,
 			text + data + stack + mmap,
-			p->rss,
+			p->mm->rss,
 			0x7FFFFFFF,		/* rlim */
 			vma_start,		/* startcode */
 			vma_end,		/* endcode */
@@ -828,7 +934,7 @@ int data_proc_pid_statm(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -849,7 +955,7 @@ int data_proc_pid_statm(char *buffer, __pid_t pid)
 		}
 
 		size = sprintk(buffer, "%d", (text + data + stack + mmap) / PAGE_SIZE);
-		size += sprintk(buffer + size, " %d", p->rss);
+		size += sprintk(buffer + size, " %d", p->mm->rss);
 		size += sprintk(buffer + size, " 0");	/* shared mappings */
 		size += sprintk(buffer + size, " %d", text / PAGE_SIZE);
 		size += sprintk(buffer + size, " 0");
@@ -870,7 +976,7 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -892,25 +998,27 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 
 		size = sprintk(buffer, "Name:\t%s\n", p->argv0);
 		size += sprintk(buffer + size, "State:\t%s\n", pstate[p->state]);
+		size += sprintk(buffer + size, "Tgid:\t%d\n", p->tgid);
 		size += sprintk(buffer + size, "Pid:\t%d\n", p->pid);
 		size += sprintk(buffer + size, "PPid:\t%d\n", p->ppid);
 		size += sprintk(buffer + size, "Uid:\t%d\t%d\t%d\t-\n", p->uid, p->euid, p->suid);
 		size += sprintk(buffer + size, "Gid:\t%d\t%d\t%d\t-\n", p->gid, p->egid, p->sgid);
 		size += sprintk(buffer + size, "VmSize:\t%8d kB\n", (text + data + stack + mmap) / 1024);
 		size += sprintk(buffer + size, "VmLck:\t%8d kB\n", 0);
-		size += sprintk(buffer + size, "VmRSS:\t%8d kB\n", p->rss << 2);
+		size += sprintk(buffer + size, "VmRSS:\t%8d kB\n", p->mm->rss << 2);
 		size += sprintk(buffer + size, "VmData:\t%8d kB\n", data / 1024);
 		size += sprintk(buffer + size, "VmStk:\t%8d kB\n", stack / 1024);
 		size += sprintk(buffer + size, "VmExe:\t%8d kB\n", text / 1024);
 		size += sprintk(buffer + size, "VmLib:\t%8d kB\n", 0);
+		size += sprintk(buffer + size, "FaultAround:\t%d\n", p->faults_around);
 		size += sprintk(buffer + size, "SigPnd:\t%08x\n", p->sigpending);
 		size += sprintk(buffer + size, "SigBlk:\t%08x\n", p->sigblocked);
 		sigignored = sigcaught = 0;
 		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
+			if(p->sighand->action[signum].sa_handler == SIG_IGN) {
 				sigignored |= mask;
 			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
+			if(p->sighand->action[signum].sa_handler == SIG_DFL) {
 				sigcaught |= mask;
 			}
 		}
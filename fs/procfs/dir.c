@@ -34,6 +34,7 @@ struct fs_operations procfs_dir_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	procfs_bmap,
+	NULL,			/* get_page */
 	procfs_lookup,
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -93,6 +94,7 @@ static int proc_listdir(char *buffer, int count)
 		}
 		d.name = p->pidstr;
 		d.data_fn = NULL;
+		d.seq_ops = NULL;
 
 		if(size + sizeof(struct procfs_dir_entry) > (count - 1)) {
 			printk("WARNING: kmalloc() is limited to 4096 bytes.\n");
@@ -121,7 +123,7 @@ static int proc_listfd(struct inode *i, char *buffer, int count)
 
 	p = get_proc_by_pid((i->inode >> 12) & 0xFFFF);
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(p->fd[n]) {
+		if(p->files->fd[n]) {
 			d.inode = PROC_FD_INO + (p->pid << 12) + n;
 			d.mode = S_IFLNK | S_IRWXU;
 			d.nlink = 1;
@@ -132,6 +134,7 @@ static int proc_listfd(struct inode *i, char *buffer, int count)
 			d.name_len = sprintk(fdstr, "%d", n);
 			d.name = fdstr;
 			d.data_fn = NULL;
+			d.seq_ops = NULL;
 
 			if(size + sizeof(struct procfs_dir_entry) > (count - 1)) {
 				printk("WARNING: kmalloc() is limited to 4096 bytes.\n");
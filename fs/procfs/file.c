@@ -33,6 +33,7 @@ struct fs_operations procfs_file_fsop = {
 	NULL,			/* readlink */
 	NULL,			/* followlink */
 	procfs_bmap,
+	NULL,			/* get_page */
 	NULL,			/* lookup */
 	NULL,			/* rmdir */
 	NULL,			/* link */
@@ -60,61 +61,67 @@ struct fs_operations procfs_file_fsop = {
 
 int procfs_file_open(struct inode *i, struct fd *fd_table)
 {
+	struct procfs_seq *m;
+
 	if(fd_table->flags & (O_WRONLY | O_RDWR | O_TRUNC | O_APPEND)) {
 		return -EINVAL;
 	}
+	if(!(m = (struct procfs_seq *)kmalloc(sizeof(struct procfs_seq)))) {
+		return -ENOMEM;
+	}
+	memset_b(m, 0, sizeof(struct procfs_seq));
+	m->pid = (i->inode >> 12) & 0xFFFF;
+	fd_table->private_data = m;
 	fd_table->offset = 0;
 	return 0;
 }
 
 int procfs_file_close(struct inode *i, struct fd *fd_table)
 {
+	struct procfs_seq *m;
+
+	if((m = (struct procfs_seq *)fd_table->private_data)) {
+		procfs_seq_release(m);
+		kfree((unsigned int)m);
+		fd_table->private_data = NULL;
+	}
 	return 0;
 }
 
 int procfs_file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
 {
-	__size_t total_read;
-	unsigned int boffset, bytes, size;
-	int blksize;
 	struct procfs_dir_entry *d;
-	char *buf;
+	struct procfs_seq *m;
+	int errno;
 
 	if(!(d = get_procfs_by_inode(i))) {
 		return -EINVAL;
 	}
-	if(!d->data_fn) {
+	if(!d->data_fn && !d->seq_ops) {
 		return -EINVAL;
 	}
-	if(!(buf = (void *)kmalloc(PAGE_SIZE))) {
-		return -ENOMEM;
-	}
-
-	size = d->data_fn(buf, (i->inode >> 12) & 0xFFFF);
-	blksize = i->sb->s_blocksize;
-	if(fd_table->offset > size) {
-		fd_table->offset = size;
+	if(!(m = (struct procfs_seq *)fd_table->private_data)) {
+		return -EINVAL;
 	}
 
-	total_read = 0;
-
-	for(;;) {
-		count = (fd_table->offset + count > size) ? size - fd_table->offset : count;
-		if(!count) {
-			break;
+	/*
+	 * The snapshot is rendered on the first read and every time the file
+	 * is read again from the beginning, the rest of reads are served from
+	 * the same snapshot.
+	 */
+	if(!m->pages || !fd_table->offset) {
+		if((errno = procfs_seq_build(m, d))) {
+			procfs_seq_release(m);
+			return errno;
 		}
-
-		boffset = fd_table->offset % blksize;
-		bytes = blksize - boffset;
-		bytes = MIN(bytes, count);
-		memcpy_b(buffer + total_read, buf + boffset, bytes);
-		total_read += bytes;
-		count -= bytes;
-		fd_table->offset += bytes;
+	}
+	if(fd_table->offset > m->count) {
+		fd_table->offset = m->count;
 	}
 
-	kfree((unsigned int)buf);
-	return total_read;
+	count = procfs_seq_read(m, fd_table->offset, buffer, count);
+	fd_table->offset += count;
+	return count;
 }
 
 __loff_t procfs_file_llseek(struct inode *i, __loff_t offset)
@@ -0,0 +1,160 @@
+/*
+ * fiwix/fs/procfs/seq.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+/*
+ * The contents of a procfs file are rendered into a snapshot that is kept in
+ * the file descriptor until it's closed or read again from the beginning.
+ *
+ * Files with a 'seq_ops' iterator are generated one record at a time by the
+ * show() method, and the snapshot grows page by page as needed. Files with a
+ * 'data_fn' function are rendered at once into a single page.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/fs_proc.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/stdarg.h>
+#include <fiwix/string.h>
+
+static int seq_append(struct procfs_seq *m, const char *buf, int len)
+{
+	unsigned int index, offset;
+	int bytes;
+
+	while(len > 0) {
+		index = m->count / PAGE_SIZE;
+		offset = m->count % PAGE_SIZE;
+		if(index >= PROC_SEQ_PAGES) {
+			return -EFBIG;
+		}
+		if(!m->pages[index]) {
+			if(!(m->pages[index] = (char *)kmalloc(PAGE_SIZE))) {
+				return -ENOMEM;
+			}
+		}
+		bytes = MIN(len, PAGE_SIZE - offset);
+		memcpy_b(m->pages[index] + offset, buf, bytes);
+		m->count += bytes;
+		buf += bytes;
+		len -= bytes;
+	}
+	return 0;
+}
+
+int procfs_seq_printf(struct procfs_seq *m, const char *format, ...)
+{
+	va_list args;
+	int len;
+
+	if(m->error) {
+		return m->error;
+	}
+
+	va_start(args, format);
+	len = vsprintk(m->tmp, format, args);
+	va_end(args);
+
+	if((m->error = seq_append(m, m->tmp, len))) {
+		return m->error;
+	}
+	return len;
+}
+
+/* iterator for the files which are shown as a single record */
+void *procfs_seq_single_start(struct procfs_seq *m, int *pos)
+{
+	return *pos ? NULL : (void *)m;
+}
+
+void *procfs_seq_single_next(struct procfs_seq *m, void *v, int *pos)
+{
+	(*pos)++;
+	return NULL;
+}
+
+void procfs_seq_single_stop(struct procfs_seq *m, void *v)
+{
+}
+
+int procfs_seq_build(struct procfs_seq *m, struct procfs_dir_entry *d)
+{
+	struct procfs_seq_ops *ops;
+	void *v;
+	int pos;
+
+	procfs_seq_release(m);
+	if(!(m->pages = (char **)kmalloc(PAGE_SIZE))) {
+		return -ENOMEM;
+	}
+	memset_b(m->pages, 0, PAGE_SIZE);
+
+	if(!(ops = d->seq_ops)) {
+		if(!(m->pages[0] = (char *)kmalloc(PAGE_SIZE))) {
+			return -ENOMEM;
+		}
+		m->count = d->data_fn(m->pages[0], m->pid);
+		return 0;
+	}
+
+	if(!(m->tmp = (char *)kmalloc(PAGE_SIZE))) {
+		return -ENOMEM;
+	}
+	pos = 0;
+	v = ops->start(m, &pos);
+	while(v) {
+		if(ops->show(m, v) < 0 || m->error) {
+			break;
+		}
+		v = ops->next(m, v, &pos);
+	}
+	ops->stop(m, v);
+	kfree((unsigned int)m->tmp);
+	m->tmp = NULL;
+
+	return m->error;
+}
+
+int procfs_seq_read(struct procfs_seq *m, unsigned int offset, char *buffer, __size_t count)
+{
+	unsigned int boffset, bytes;
+	int total_read;
+
+	if(offset >= m->count) {
+		return 0;
+	}
+	count = MIN(count, m->count - offset);
+
+	total_read = 0;
+	while(count) {
+		boffset = offset % PAGE_SIZE;
+		bytes = PAGE_SIZE - boffset;
+		bytes = MIN(bytes, count);
+		memcpy_b(buffer + total_read, m->pages[offset / PAGE_SIZE] + boffset, bytes);
+		total_read += bytes;
+		offset += bytes;
+		count -= bytes;
+	}
+	return total_read;
+}
+
+void procfs_seq_release(struct procfs_seq *m)
+{
+	int n;
+
+	if(m->pages) {
+		for(n = 0; n < PROC_SEQ_PAGES && m->pages[n]; n++) {
+			kfree((unsigned int)m->pages[n]);
+		}
+		kfree((unsigned int)m->pages);
+		m->pages = NULL;
+	}
+	m->count = 0;
+	m->error = 0;
+}
@@ -45,9 +45,12 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ 16,    REG,  1, 0, 10, "partitions",   data_proc_partitions },
 	{ 17,    REG,  1, 0, 3,  "rtc",          data_proc_rtc },
 	{ 18,    LNK,  1, 0, 4,  "self",         data_proc_self },
-	{ 19,    REG,  1, 0, 4,  "stat",         data_proc_stat },
+	{ 19,    REG,  1, 0, 4,  "stat",         NULL, &seq_proc_stat },
 	{ 20,    REG,  1, 0, 6,  "uptime",       data_proc_uptime },
 	{ 21,    REG,  1, 0, 7,  "version",      data_proc_fullversion },
+	{ 22,    DIR,  2, 7, 3,  "tty",          NULL },
+	{ 23,    REG,  1, 0, 7,  "latency",      data_proc_latency },
+	{ 24,    REG,  1, 0, 9,  "ext2alloc",    data_proc_ext2alloc },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
    },
    {	/* [1] /PID/ */
@@ -58,7 +61,7 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ PROC_PID_CWD,     LNKPID, 1, 1, 3,  "cwd",      data_proc_pid_cwd },
 	{ PROC_PID_ENVIRON, REGUSR, 1, 1, 7,  "environ",  data_proc_pid_environ },
 	{ PROC_PID_EXE,     LNKPID, 1, 1, 3,  "exe",      data_proc_pid_exe },
-	{ PROC_PID_MAPS,    REG,    1, 1, 4,  "maps",     data_proc_pid_maps },
+	{ PROC_PID_MAPS,    REG,    1, 1, 4,  "maps",     NULL, &seq_proc_pid_maps },
 	{ PROC_PID_MOUNTINFO,REG,   1, 1, 9,  "mountinfo",data_proc_pid_mountinfo },
 	{ PROC_PID_ROOT,    LNKPID, 1, 1, 4,  "root",     data_proc_pid_root },
 	{ PROC_PID_STAT,    REG,    1, 1, 4,  "stat",     data_proc_pid_stat },
@@ -106,6 +109,18 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ 4,     DIR,  2, 3, 2,  "..",           NULL },
 	{ 6001,  REG,  1, 6, 22, "dirty_background_ratio",      data_proc_dirty_background_ratio },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
+   },
+   {	/* [7] /tty/ */
+	{ 22,    DIR,  2, 7, 1,  ".",            NULL },
+	{ 1,     DIR,  2, 0, 2,  "..",           NULL },
+	{ 7001,  DIR,  2, 8, 6,  "driver",       NULL },
+	{ 0, 0, 0, 0, 0, NULL, NULL }
+   },
+   {	/* [7001] /tty/driver/ */
+	{ 7001,  DIR,  2, 8, 1,  ".",            NULL },
+	{ 22,    DIR,  2, 7, 2,  "..",           NULL },
+	{ 8001,  REG,  1, 8, 6,  "serial",       data_proc_tty_serial },
+	{ 0, 0, 0, 0, 0, NULL, NULL }
    }
 };
 
@@ -172,6 +172,21 @@ struct superblock *get_superblock(__dev_t dev)
 	return NULL;
 }
 
+/* returns a free device number for a new mount of a nodev filesystem */
+__dev_t get_unnamed_dev(void)
+{
+	__dev_t dev;
+	int minor;
+
+	for(minor = 1; minor < 256; minor++) {
+		dev = MKDEV(UNNAMED_MAJOR, minor);
+		if(!get_superblock(dev)) {
+			return dev;
+		}
+	}
+	return 0;
+}
+
 void sync_superblocks(__dev_t dev)
 {
 	struct superblock *sb;
@@ -253,10 +268,10 @@ int mount_root(void)
 	mp->sb.dir->count++;
 	mp->fs = fs;
 
-	current->root = mp->sb.root;
-	current->root->count++;
-	current->pwd = mp->sb.root;
-	current->pwd->count++;
+	current->fs->root = mp->sb.root;
+	current->fs->root->count++;
+	current->fs->pwd = mp->sb.root;
+	current->fs->pwd->count++;
 	iput(mp->sb.root);
 
 	printk("mounted root device (%s filesystem)", fs->name);
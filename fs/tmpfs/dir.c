@@ -0,0 +1,219 @@
+/*
+ * fiwix/fs/tmpfs/dir.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/stat.h>
+#include <fiwix/dirent.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_dir_fsop = {
+	0,
+	0,
+
+	tmpfs_dir_open,
+	tmpfs_dir_close,
+	tmpfs_dir_read,
+	tmpfs_dir_write,
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	tmpfs_dir_readdir,
+	tmpfs_dir_readdir64,
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	NULL,			/* get_page */
+	tmpfs_lookup,
+	tmpfs_rmdir,
+	tmpfs_link,
+	tmpfs_unlink,
+	tmpfs_symlink,
+	tmpfs_mkdir,
+	tmpfs_mknod,
+	NULL,			/* truncate */
+	tmpfs_create,
+	tmpfs_rename,
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int tmpfs_dir_open(struct inode *i, struct fd *fd_table)
+{
+	fd_table->offset = 0;
+	return 0;
+}
+
+int tmpfs_dir_close(struct inode *i, struct fd *fd_table)
+{
+	return 0;
+}
+
+int tmpfs_dir_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
+{
+	return -EISDIR;
+}
+
+int tmpfs_dir_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t count)
+{
+	return -EBADF;
+}
+
+int tmpfs_dir_readdir(struct inode *i, struct fd *fd_table, struct dirent *dirent, __size_t count)
+{
+	unsigned int doffset, offset;
+	unsigned int size, dirent_len;
+	struct tmpfs_dir_entry *d;
+	int base_dirent_len;
+	struct page *pg;
+
+	if(!(S_ISDIR(i->i_mode))) {
+		return -EBADF;
+	}
+
+	if(fd_table->offset > i->i_size) {
+		fd_table->offset = i->i_size;
+	}
+
+	base_dirent_len = sizeof(dirent->d_ino) + sizeof(dirent->d_off) + sizeof(dirent->d_reclen);
+	offset = size = 0;
+
+	while(fd_table->offset < i->i_size && count > 0) {
+		offset = PAGE_SIZE;
+		if((pg = tmpfs_get_page(i, fd_table->offset, FOR_READING))) {
+			doffset = fd_table->offset;
+			offset = fd_table->offset % PAGE_SIZE;
+			while(offset < PAGE_SIZE) {
+				d = (struct tmpfs_dir_entry *)(pg->data + offset);
+				if(d->inode) {
+					dirent_len = (base_dirent_len + (d->name_len + 1)) + 3;
+					dirent_len &= ~3;	/* round up */
+					dirent->d_ino = d->inode;
+					if((size + dirent_len) < count) {
+						dirent->d_off = doffset;
+						dirent->d_reclen = dirent_len;
+						memcpy_b(dirent->d_name, d->name, d->name_len);
+						dirent->d_name[d->name_len] = 0;
+						dirent = (struct dirent *)((char *)dirent + dirent_len);
+						size += dirent_len;
+						count -= dirent_len;
+					} else {
+						count = 0;
+						break;
+					}
+				}
+				doffset += d->rec_len;
+				offset += d->rec_len;
+				if(!d->rec_len) {
+					break;
+				}
+			}
+			release_page(pg);
+		}
+		fd_table->offset &= PAGE_MASK;
+		fd_table->offset += offset;
+	}
+
+	return size;
+}
+
+int tmpfs_dir_readdir64(struct inode *i, struct fd *fd_table, struct dirent64 *dirent, __size_t count)
+{
+	unsigned int doffset, offset;
+	unsigned int size, dirent_len;
+	struct tmpfs_dir_entry *d;
+	int base_dirent_len;
+	struct page *pg;
+
+	if(!(S_ISDIR(i->i_mode))) {
+		return -EBADF;
+	}
+
+	if(fd_table->offset > i->i_size) {
+		fd_table->offset = i->i_size;
+	}
+
+	base_dirent_len = sizeof(dirent->d_ino) + sizeof(dirent->d_off) + sizeof(dirent->d_reclen) + sizeof(dirent->d_type);
+	offset = size = 0;
+
+	while(fd_table->offset < i->i_size && count > 0) {
+		offset = PAGE_SIZE;
+		if((pg = tmpfs_get_page(i, fd_table->offset, FOR_READING))) {
+			doffset = fd_table->offset;
+			offset = fd_table->offset % PAGE_SIZE;
+			while(offset < PAGE_SIZE) {
+				d = (struct tmpfs_dir_entry *)(pg->data + offset);
+				if(d->inode) {
+					dirent_len = (base_dirent_len + (d->name_len + 1)) + 3;
+					dirent_len &= ~3;	/* round up */
+					dirent->d_ino = d->inode;
+					if((size + dirent_len) < count) {
+						struct inode *dirent_inode = iget(i->sb, dirent->d_ino);
+						dirent->d_off = doffset;
+						dirent->d_reclen = dirent_len;
+						memcpy_b(dirent->d_name, d->name, d->name_len);
+						dirent->d_name[d->name_len] = 0;
+						if (S_ISREG(dirent_inode->i_mode)) {
+							dirent->d_type = DT_REG;
+						} else if (S_ISDIR(dirent_inode->i_mode)) {
+							dirent->d_type = DT_DIR;
+						} else if (S_ISCHR(dirent_inode->i_mode)) {
+							dirent->d_type = DT_CHR;
+						} else if (S_ISBLK(dirent_inode->i_mode)) {
+							dirent->d_type = DT_BLK;
+						} else if (S_ISFIFO(dirent_inode->i_mode)) {
+							dirent->d_type = DT_FIFO;
+						} else if (S_ISSOCK(dirent_inode->i_mode)) {
+							dirent->d_type = DT_SOCK;
+						} else if (S_ISLNK(dirent_inode->i_mode)) {
+							dirent->d_type = DT_LNK;
+						} else {
+							dirent->d_type = DT_UNKNOWN;
+						}
+						iput(dirent_inode);
+						dirent = (struct dirent64 *)((char *)dirent + dirent_len);
+						size += dirent_len;
+						count -= dirent_len;
+					} else {
+						count = 0;
+						break;
+					}
+				}
+				doffset += d->rec_len;
+				offset += d->rec_len;
+				if(!d->rec_len) {
+					break;
+				}
+			}
+			release_page(pg);
+		}
+		fd_table->offset &= PAGE_MASK;
+		fd_table->offset += offset;
+	}
+
+	return size;
+}
+#endif /* CONFIG_FS_TMPFS */
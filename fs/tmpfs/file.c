@@ -0,0 +1,169 @@
+/*
+ * fiwix/fs/tmpfs/file.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/sched.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_file_fsop = {
+	0,
+	0,
+
+	tmpfs_file_open,
+	tmpfs_file_close,
+	tmpfs_file_read,
+	tmpfs_file_write,
+	NULL,			/* ioctl */
+	tmpfs_file_llseek,
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	tmpfs_get_page,
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	tmpfs_truncate,
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int tmpfs_file_open(struct inode *i, struct fd *fd_table)
+{
+	fd_table->offset = 0;
+	if(fd_table->flags & O_TRUNC) {
+		/* i_size must be kept, it tells how many pages are to be freed */
+		tmpfs_truncate(i, 0);
+	}
+	return 0;
+}
+
+int tmpfs_file_close(struct inode *i, struct fd *fd_table)
+{
+	return 0;
+}
+
+int tmpfs_file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
+{
+	__size_t total_read;
+	unsigned int poffset, bytes;
+	struct page *pg;
+
+	inode_lock(i);
+
+	if(fd_table->offset > i->i_size) {
+		fd_table->offset = i->i_size;
+	}
+	count = MIN(count, i->i_size - fd_table->offset);
+	total_read = 0;
+
+	while(total_read < count) {
+		poffset = fd_table->offset % PAGE_SIZE;
+		bytes = PAGE_SIZE - poffset;
+		bytes = MIN(bytes, (count - total_read));
+		if((pg = tmpfs_get_page(i, fd_table->offset, FOR_READING))) {
+			page_lock(pg);
+			memcpy_b(buffer + total_read, pg->data + poffset, bytes);
+			page_unlock(pg);
+			release_page(pg);
+		} else {
+			/* a hole reads as zeros */
+			memset_b(buffer + total_read, 0, bytes);
+		}
+		total_read += bytes;
+		fd_table->offset += bytes;
+		cond_resched();
+	}
+
+	inode_unlock(i);
+	return total_read;
+}
+
+int tmpfs_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t count)
+{
+	__size_t total_written;
+	unsigned int poffset, bytes;
+	struct page *pg;
+
+	inode_lock(i);
+
+	total_written = 0;
+
+	if(fd_table->flags & O_APPEND) {
+		fd_table->offset = i->i_size;
+	}
+
+	while(total_written < count) {
+		poffset = fd_table->offset % PAGE_SIZE;
+		bytes = PAGE_SIZE - poffset;
+		bytes = MIN(bytes, (count - total_written));
+		if(!(pg = tmpfs_get_page(i, fd_table->offset, FOR_WRITING))) {
+			if(!total_written) {
+				inode_unlock(i);
+				return -ENOSPC;
+			}
+			break;
+		}
+		/* write_page() of a shared mapping passes the cached page itself */
+		if(pg->data + poffset != buffer + total_written) {
+			page_lock(pg);
+			memcpy_b(pg->data + poffset, buffer + total_written, bytes);
+			page_unlock(pg);
+		}
+		release_page(pg);
+		total_written += bytes;
+		fd_table->offset += bytes;
+		cond_resched();
+	}
+
+	if(fd_table->offset > i->i_size) {
+		i->i_size = fd_table->offset;
+	}
+	i->i_ctime = CURRENT_TIME;
+	i->i_mtime = CURRENT_TIME;
+	i->state |= INODE_DIRTY;
+
+	inode_unlock(i);
+	return total_written;
+}
+
+__loff_t tmpfs_file_llseek(struct inode *i, __loff_t offset)
+{
+	return offset;
+}
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,297 @@
+/*
+ * fiwix/fs/tmpfs/inode.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/fs_pipe.h>
+#include <fiwix/fs_sock.h>
+#include <fiwix/stat.h>
+#include <fiwix/sched.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+static struct tmpfs_inode *get_tmpfs_inode(struct superblock *sb, __ino_t inode)
+{
+	struct tmpfs_inode *ti;
+
+	if(!sb->u.tmpfs.itable || !inode || inode > sb->u.tmpfs.s_inodes_count) {
+		return NULL;
+	}
+	inode--;
+	if(!(ti = sb->u.tmpfs.itable[inode / TMPFS_INODES_PER_PAGE])) {
+		return NULL;
+	}
+	return ti + (inode % TMPFS_INODES_PER_PAGE);
+}
+
+/*
+ * Returns the page cache page that holds the data at 'offset' with its usage
+ * counter incremented, so the caller must release it afterwards. A hole
+ * returns NULL unless 'mode' is FOR_WRITING, in which case a new zeroed page
+ * is charged to the filesystem and inserted in the page cache.
+ */
+struct page *tmpfs_get_page(struct inode *i, __off_t offset, int mode)
+{
+	struct superblock *sb;
+	struct page *pg;
+	unsigned int addr;
+
+	offset &= PAGE_MASK;
+	if((pg = search_page_hash(i, offset))) {
+		return pg;
+	}
+	if(mode != FOR_WRITING) {
+		return NULL;
+	}
+
+	sb = i->sb;
+	superblock_lock(sb);
+	if(!sb->u.tmpfs.s_free_pages_count) {
+		superblock_unlock(sb);
+		return NULL;
+	}
+	sb->u.tmpfs.s_free_pages_count--;
+	superblock_unlock(sb);
+
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		superblock_lock(sb);
+		sb->u.tmpfs.s_free_pages_count++;
+		superblock_unlock(sb);
+		return NULL;
+	}
+	memset_b((void *)addr, 0, PAGE_SIZE);
+	pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+	add_to_page_cache(pg, i, offset);
+	pg->count++;	/* this is the reference held by the filesystem */
+	i->i_blocks += PAGE_SIZE / 512;
+	i->state |= INODE_DIRTY;
+	return pg;
+}
+
+/* releases all the pages of the inode 'i' beyond 'offset' */
+void tmpfs_free_pages(struct inode *i, __off_t offset)
+{
+	struct superblock *sb;
+	struct page *pg;
+
+	sb = i->sb;
+	for(offset = PAGE_ALIGN(offset); offset < i->i_size; offset += PAGE_SIZE) {
+		if((pg = search_page_hash(i, offset))) {
+			page_lock(pg);
+			remove_from_page_cache(pg);
+			page_unlock(pg);
+			release_page(pg);
+			release_page(pg);
+			i->i_blocks -= PAGE_SIZE / 512;
+			superblock_lock(sb);
+			sb->u.tmpfs.s_free_pages_count++;
+			superblock_unlock(sb);
+		}
+	}
+}
+
+int tmpfs_read_inode(struct inode *i)
+{
+	struct tmpfs_inode *ti;
+
+	if(!(ti = get_tmpfs_inode(i->sb, i->inode)) || !ti->i_mode) {
+		printk("WARNING: %s(): invalid inode %d.\n", __FUNCTION__, i->inode);
+		return -ENOENT;
+	}
+
+	i->i_mode = ti->i_mode;
+	i->i_uid = ti->i_uid;
+	i->i_size = ti->i_size;
+	i->i_atime = ti->i_atime;
+	i->i_ctime = ti->i_ctime;
+	i->i_mtime = ti->i_mtime;
+	i->i_gid = ti->i_gid;
+	i->i_nlink = ti->i_nlink;
+	i->i_blocks = ti->i_blocks;
+	i->i_flags = 0;
+	i->count = 1;
+	switch(i->i_mode & S_IFMT) {
+		case S_IFCHR:
+			i->fsop = &def_chr_fsop;
+			i->rdev = ti->i_rdev;
+			break;
+		case S_IFBLK:
+			i->fsop = &def_blk_fsop;
+			i->rdev = ti->i_rdev;
+			break;
+		case S_IFIFO:
+			i->fsop = &pipefs_fsop;
+			/* it's a union so we need to clear pipefs_i */
+			memset_b(&i->u.pipefs, 0, sizeof(struct pipefs_inode));
+			break;
+		case S_IFDIR:
+			i->fsop = &tmpfs_dir_fsop;
+			break;
+		case S_IFREG:
+			i->fsop = &tmpfs_file_fsop;
+			break;
+		case S_IFLNK:
+			i->fsop = &tmpfs_symlink_fsop;
+			break;
+		case S_IFSOCK:
+#ifdef CONFIG_NET
+			i->fsop = &sockfs_fsop;
+			/* it's a union so we need to clear sockfs_inode */
+			memset_b(&i->u.sockfs, 0, sizeof(struct sockfs_inode));
+#else
+			i->fsop = NULL;
+#endif /* CONFIG_NET */
+			break;
+		default:
+			printk("WARNING: %s(): invalid inode (%d) mode %08o.\n", __FUNCTION__, i->inode, i->i_mode);
+			return -ENOENT;
+	}
+	return 0;
+}
+
+int tmpfs_write_inode(struct inode *i)
+{
+	struct tmpfs_inode *ti;
+
+	/* the inode table is gone once the filesystem is unmounted */
+	if(!(ti = get_tmpfs_inode(i->sb, i->inode))) {
+		i->state &= ~INODE_DIRTY;
+		return 0;
+	}
+
+	ti->i_mode = i->i_mode;
+	ti->i_uid = i->i_uid;
+	ti->i_size = i->i_size;
+	ti->i_atime = i->i_atime;
+	ti->i_ctime = i->i_ctime;
+	ti->i_mtime = i->i_mtime;
+	ti->i_gid = i->i_gid;
+	ti->i_nlink = i->i_nlink;
+	ti->i_blocks = i->i_blocks;
+	if(S_ISCHR(i->i_mode) || S_ISBLK(i->i_mode)) {
+		ti->i_rdev = i->rdev;
+	} else {
+		ti->i_rdev = 0;
+	}
+	i->state &= ~INODE_DIRTY;
+	return 0;
+}
+
+int tmpfs_ialloc(struct inode *i, int mode)
+{
+	struct superblock *sb;
+	struct tmpfs_inode *ti;
+	__ino_t inode;
+	int n;
+
+	sb = i->sb;
+	superblock_lock(sb);
+
+	if(!sb->u.tmpfs.s_free_inodes_count) {
+		superblock_unlock(sb);
+		return -ENOSPC;
+	}
+
+	/* search for a free inode starting from the last one allocated */
+	inode = sb->u.tmpfs.s_last_ino;
+	for(n = 0; n < sb->u.tmpfs.s_inodes_count; n++) {
+		if(++inode > sb->u.tmpfs.s_inodes_count) {
+			inode = TMPFS_ROOT_INO;
+		}
+		if(!sb->u.tmpfs.itable[(inode - 1) / TMPFS_INODES_PER_PAGE]) {
+			if(!(ti = (struct tmpfs_inode *)kmalloc(PAGE_SIZE))) {
+				superblock_unlock(sb);
+				return -ENOMEM;
+			}
+			memset_b(ti, 0, PAGE_SIZE);
+			sb->u.tmpfs.itable[(inode - 1) / TMPFS_INODES_PER_PAGE] = ti;
+		}
+		ti = get_tmpfs_inode(sb, inode);
+		if(!ti->i_mode) {
+			break;
+		}
+	}
+	if(n == sb->u.tmpfs.s_inodes_count) {
+		superblock_unlock(sb);
+		return -ENOSPC;
+	}
+
+	/* a non-zero mode marks the inode as used */
+	memset_b(ti, 0, sizeof(struct tmpfs_inode));
+	ti->i_mode = mode;
+	sb->u.tmpfs.s_free_inodes_count--;
+	sb->u.tmpfs.s_last_ino = inode;
+
+	i->inode = inode;
+	i->i_atime = CURRENT_TIME;
+	i->i_mtime = CURRENT_TIME;
+	i->i_ctime = CURRENT_TIME;
+
+	superblock_unlock(sb);
+	return 0;
+}
+
+void tmpfs_ifree(struct inode *i)
+{
+	struct superblock *sb;
+	struct tmpfs_inode *ti;
+
+	sb = i->sb;
+	if(!(ti = get_tmpfs_inode(sb, i->inode))) {
+		return;
+	}
+
+	if(i->i_blocks) {
+		tmpfs_free_pages(i, 0);
+	}
+
+	superblock_lock(sb);
+	memset_b(ti, 0, sizeof(struct tmpfs_inode));
+	sb->u.tmpfs.s_free_inodes_count++;
+	superblock_unlock(sb);
+
+	/* there is nothing left to be written */
+	i->i_size = 0;
+	i->state &= ~INODE_DIRTY;
+}
+
+int tmpfs_truncate(struct inode *i, __off_t length)
+{
+	struct page *pg;
+	unsigned int poffset;
+
+	if(!S_ISDIR(i->i_mode) && !S_ISREG(i->i_mode) && !S_ISLNK(i->i_mode)) {
+		return -EINVAL;
+	}
+
+	if(length < i->i_size) {
+		tmpfs_free_pages(i, length);
+
+		/* clear the rest of the last page */
+		if((poffset = length % PAGE_SIZE)) {
+			if((pg = tmpfs_get_page(i, length, FOR_READING))) {
+				page_lock(pg);
+				memset_b(pg->data + poffset, 0, PAGE_SIZE - poffset);
+				page_unlock(pg);
+				release_page(pg);
+			}
+		}
+	}
+
+	i->i_mtime = CURRENT_TIME;
+	i->i_ctime = CURRENT_TIME;
+	i->i_size = length;
+	i->state |= INODE_DIRTY;
+
+	return 0;
+}
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,701 @@
+/*
+ * fiwix/fs/tmpfs/namei.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+static void set_dir_entry(struct tmpfs_dir_entry *d, __ino_t inode, char *name)
+{
+	d->inode = inode;
+	d->name_len = strlen(name);
+	/* the name is not null-terminated */
+	memcpy_b(d->name, name, d->name_len);
+}
+
+/* finds a new entry to fit 'name' in the directory 'dir' */
+static struct page *find_first_free_dir_entry(struct inode *dir, struct tmpfs_dir_entry **d_res, char *name)
+{
+	unsigned int offset, doffset;
+	struct page *pg;
+	int rlen, nlen;
+
+	nlen = TMPFS_DIR_ENTRY_LEN(strlen(name));
+
+	for(offset = 0; offset < dir->i_size; offset += PAGE_SIZE) {
+		if(!(pg = tmpfs_get_page(dir, offset, FOR_READING))) {
+			continue;
+		}
+		doffset = 0;
+		do {
+			*d_res = (struct tmpfs_dir_entry *)(pg->data + doffset);
+			/* returns the first entry where name can fit in */
+			if(!(*d_res)->inode) {
+				if(nlen <= (*d_res)->rec_len) {
+					return pg;
+				}
+			} else {
+				rlen = TMPFS_DIR_ENTRY_LEN((*d_res)->name_len);
+				if(rlen + nlen <= (*d_res)->rec_len) {
+					int nrec_len;
+
+					nrec_len = (*d_res)->rec_len - rlen;
+					(*d_res)->rec_len = rlen;
+					doffset += (*d_res)->rec_len;
+					*d_res = (struct tmpfs_dir_entry *)(pg->data + doffset);
+					(*d_res)->inode = 0;
+					(*d_res)->rec_len = nrec_len;
+					return pg;
+				}
+			}
+			doffset += (*d_res)->rec_len;
+		} while((*d_res)->rec_len && doffset < PAGE_SIZE);
+		release_page(pg);
+	}
+
+	*d_res = NULL;
+	return NULL;
+}
+
+/* finds an entry in 'dir' based on the 'name' and/or on the inode 'i' */
+static struct page *find_dir_entry(struct inode *dir, struct inode *i, struct tmpfs_dir_entry **d_res, char *name)
+{
+	unsigned int offset, doffset;
+	struct page *pg;
+	int len;
+
+	len = name ? strlen(name) : 0;
+
+	for(offset = 0; offset < dir->i_size; offset += PAGE_SIZE) {
+		if(!(pg = tmpfs_get_page(dir, offset, FOR_READING))) {
+			continue;
+		}
+		doffset = 0;
+		do {
+			*d_res = (struct tmpfs_dir_entry *)(pg->data + doffset);
+			if(!i) {
+				if((*d_res)->inode) {
+					/* returns the first matching name */
+					if((*d_res)->name_len == len) {
+						if(!strncmp((*d_res)->name, name, len)) {
+							return pg;
+						}
+					}
+				}
+			} else {
+				if((*d_res)->inode == i->inode) {
+					/* returns the first matching inode */
+					if(!name) {
+						return pg;
+					}
+					/* returns the matching inode and name */
+					if((*d_res)->name_len == len) {
+						if(!strncmp((*d_res)->name, name, len)) {
+							return pg;
+						}
+					}
+				}
+			}
+			doffset += (*d_res)->rec_len;
+		} while((*d_res)->rec_len && doffset < PAGE_SIZE);
+		release_page(pg);
+	}
+
+	*d_res = NULL;
+	return NULL;
+}
+
+static struct page *add_dir_entry(struct inode *dir, struct tmpfs_dir_entry **d_res, char *name)
+{
+	struct page *pg;
+
+	if(!(pg = find_first_free_dir_entry(dir, d_res, name))) {
+		if(!(pg = tmpfs_get_page(dir, dir->i_size, FOR_WRITING))) {
+			return NULL;
+		}
+		*d_res = (struct tmpfs_dir_entry *)pg->data;
+		(*d_res)->inode = 0;
+		(*d_res)->rec_len = PAGE_SIZE;
+		dir->i_size += PAGE_SIZE;
+	}
+
+	return pg;
+}
+
+static int is_dir_empty(struct inode *dir)
+{
+	unsigned int offset, doffset;
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+
+	for(offset = 0; offset < dir->i_size; offset += PAGE_SIZE) {
+		if(!(pg = tmpfs_get_page(dir, offset, FOR_READING))) {
+			continue;
+		}
+		doffset = 0;
+		do {
+			d = (struct tmpfs_dir_entry *)(pg->data + doffset);
+			doffset += d->rec_len;
+			if(d->inode && d->name_len == 1 && d->name[0] == '.') {
+				continue;
+			}
+			if(d->inode && d->name_len == 2 && d->name[0] == '.' && d->name[1] == '.') {
+				continue;
+			}
+			if(d->inode) {
+				release_page(pg);
+				return 0;
+			}
+		} while(d->rec_len && doffset < PAGE_SIZE);
+		release_page(pg);
+	}
+
+	return 1;
+}
+
+static int is_subdir(struct inode *dir_new, struct inode *i_old)
+{
+	__ino_t inode;
+	int errno;
+
+	errno = 0;
+	dir_new->count++;
+	for(;;) {
+		if(dir_new == i_old) {
+			errno = 1;
+			break;
+		}
+		inode = dir_new->inode;
+		if(tmpfs_lookup("..", dir_new, &dir_new)) {
+			break;
+		}
+		if(dir_new->inode == inode) {
+			break;
+		}
+	}
+	iput(dir_new);
+	return errno;
+}
+
+/* creates the entries '.' and '..' of a new directory */
+int tmpfs_init_dir(struct inode *dir, struct inode *parent)
+{
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+
+	if(!(pg = tmpfs_get_page(dir, 0, FOR_WRITING))) {
+		return -ENOSPC;
+	}
+	d = (struct tmpfs_dir_entry *)pg->data;
+	set_dir_entry(d, dir->inode, ".");
+	d->rec_len = TMPFS_DIR_ENTRY_LEN(1);
+	d = (struct tmpfs_dir_entry *)(pg->data + TMPFS_DIR_ENTRY_LEN(1));
+	set_dir_entry(d, parent->inode, "..");
+	d->rec_len = PAGE_SIZE - TMPFS_DIR_ENTRY_LEN(1);
+	release_page(pg);
+
+	dir->i_nlink = 2;
+	dir->i_size = PAGE_SIZE;
+	dir->state |= INODE_DIRTY;
+	return 0;
+}
+
+int tmpfs_lookup(const char *name, struct inode *dir, struct inode **i_res)
+{
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+	__ino_t inode;
+
+	if(!(pg = find_dir_entry(dir, NULL, &d, (char *)name))) {
+		iput(dir);
+		return -ENOENT;
+	}
+	inode = d->inode;
+	release_page(pg);
+
+	/*
+	 * This prevents a deadlock in iget() when trying to lock '.' when
+	 * 'dir' is the same directory (ls -lai <dir>).
+	 */
+	if(inode == dir->inode) {
+		*i_res = dir;
+		return 0;
+	}
+
+	if(!(*i_res = iget(dir->sb, inode))) {
+		iput(dir);
+		return -EACCES;
+	}
+	iput(dir);
+	return 0;
+}
+
+int tmpfs_rmdir(struct inode *dir, struct inode *i)
+{
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+
+	inode_lock(i);
+
+	if(!is_dir_empty(i)) {
+		inode_unlock(i);
+		return -ENOTEMPTY;
+	}
+
+	inode_lock(dir);
+
+	if(!(pg = find_dir_entry(dir, i, &d, NULL))) {
+		inode_unlock(i);
+		inode_unlock(dir);
+		return -ENOENT;
+	}
+
+	d->inode = 0;
+	i->i_nlink = 0;
+	dir->i_nlink--;
+
+	i->i_ctime = CURRENT_TIME;
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+
+	i->state |= INODE_DIRTY;
+	dir->state |= INODE_DIRTY;
+
+	release_page(pg);
+	inode_unlock(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_link(struct inode *i_old, struct inode *dir_new, char *name)
+{
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+
+	if(strlen(name) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+
+	inode_lock(i_old);
+	inode_lock(dir_new);
+
+	if(!(pg = add_dir_entry(dir_new, &d, name))) {
+		inode_unlock(i_old);
+		inode_unlock(dir_new);
+		return -ENOSPC;
+	}
+
+	set_dir_entry(d, i_old->inode, name);
+
+	i_old->i_nlink++;
+	i_old->i_ctime = CURRENT_TIME;
+	dir_new->i_mtime = CURRENT_TIME;
+	dir_new->i_ctime = CURRENT_TIME;
+
+	i_old->state |= INODE_DIRTY;
+	dir_new->state |= INODE_DIRTY;
+
+	release_page(pg);
+	inode_unlock(i_old);
+	inode_unlock(dir_new);
+	return 0;
+}
+
+int tmpfs_unlink(struct inode *dir, struct inode *i, char *name)
+{
+	struct page *pg;
+	struct tmpfs_dir_entry *d;
+
+	inode_lock(dir);
+	inode_lock(i);
+
+	if(!(pg = find_dir_entry(dir, i, &d, name))) {
+		inode_unlock(dir);
+		inode_unlock(i);
+		return -ENOENT;
+	}
+
+	d->inode = 0;
+	i->i_nlink--;
+
+	i->i_ctime = CURRENT_TIME;
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+
+	i->state |= INODE_DIRTY;
+	dir->state |= INODE_DIRTY;
+
+	release_page(pg);
+	inode_unlock(dir);
+	inode_unlock(i);
+	return 0;
+}
+
+int tmpfs_symlink(struct inode *dir, char *name, char *oldname)
+{
+	struct page *pg, *pg2;
+	struct inode *i;
+	struct tmpfs_dir_entry *d;
+	int len;
+
+	if(strlen(name) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+	if((len = strlen(oldname)) >= PAGE_SIZE) {
+		return -ENAMETOOLONG;
+	}
+
+	inode_lock(dir);
+
+	/* check again to know if this filename already exists */
+	if((pg = find_dir_entry(dir, NULL, &d, name))) {
+		release_page(pg);
+		inode_unlock(dir);
+		return -EEXIST;
+	}
+
+	if(!(i = ialloc(dir->sb, S_IFLNK))) {
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	i->i_mode = S_IFLNK | (S_IRWXU | S_IRWXG | S_IRWXO);
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->dev = dir->dev;
+	i->count = 1;
+	i->fsop = &tmpfs_symlink_fsop;
+
+	if(!(pg2 = tmpfs_get_page(i, 0, FOR_WRITING))) {
+		iput(i);
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+	memcpy_b(pg2->data, oldname, len);
+	i->i_size = len;
+	release_page(pg2);
+
+	if(!(pg = add_dir_entry(dir, &d, name))) {
+		iput(i);
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	i->i_nlink = 1;
+	i->state |= INODE_DIRTY;
+	set_dir_entry(d, i->inode, name);
+
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+	dir->state |= INODE_DIRTY;
+
+	release_page(pg);
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_mkdir(struct inode *dir, char *name, __mode_t mode)
+{
+	struct page *pg;
+	struct inode *i;
+	struct tmpfs_dir_entry *d;
+	int errno;
+
+	if(strlen(name) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+
+	inode_lock(dir);
+
+	/* check again to know if this filename already exists */
+	if((pg = find_dir_entry(dir, NULL, &d, name))) {
+		release_page(pg);
+		inode_unlock(dir);
+		return -EEXIST;
+	}
+
+	if(!(i = ialloc(dir->sb, S_IFDIR))) {
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	i->i_mode = ((mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->fs->umask);
+	i->i_mode |= S_IFDIR;
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->dev = dir->dev;
+	i->count = 1;
+	i->fsop = &tmpfs_dir_fsop;
+
+	if((errno = tmpfs_init_dir(i, dir))) {
+		iput(i);
+		inode_unlock(dir);
+		return errno;
+	}
+
+	if(!(pg = add_dir_entry(dir, &d, name))) {
+		i->i_nlink = 0;
+		iput(i);
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	set_dir_entry(d, i->inode, name);
+
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+	dir->i_nlink++;
+	dir->state |= INODE_DIRTY;
+
+	release_page(pg);
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_mknod(struct inode *dir, char *name, __mode_t mode, __dev_t dev)
+{
+	struct page *pg;
+	struct inode *i;
+	struct tmpfs_dir_entry *d;
+
+	if(strlen(name) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+
+	inode_lock(dir);
+
+	/* check again to know if this filename already exists */
+	if((pg = find_dir_entry(dir, NULL, &d, name))) {
+		release_page(pg);
+		inode_unlock(dir);
+		return -EEXIST;
+	}
+
+	if(!(i = ialloc(dir->sb, mode & S_IFMT))) {
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	if(!(pg = add_dir_entry(dir, &d, name))) {
+		i->i_nlink = 0;
+		iput(i);
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	set_dir_entry(d, i->inode, name);
+
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->i_nlink = 1;
+	i->dev = dir->dev;
+	i->count = 1;
+	i->state |= INODE_DIRTY;
+
+	switch(mode & S_IFMT) {
+		case S_IFCHR:
+			i->fsop = &def_chr_fsop;
+			i->rdev = dev;
+			i->i_mode |= S_IFCHR;
+			break;
+		case S_IFBLK:
+			i->fsop = &def_blk_fsop;
+			i->rdev = dev;
+			i->i_mode |= S_IFBLK;
+			break;
+		case S_IFIFO:
+			i->fsop = &pipefs_fsop;
+			i->i_mode |= S_IFIFO;
+			/* it's a union so we need to clear pipefs_i */
+			memset_b(&i->u.pipefs, 0, sizeof(struct pipefs_inode));
+			break;
+#ifdef CONFIG_NET
+		case S_IFSOCK:
+			i->fsop = &sockfs_fsop;
+			i->i_mode |= S_IFSOCK;
+			/* it's a union so we need to clear sockfs_inode */
+			memset_b(&i->u.sockfs, 0, sizeof(struct sockfs_inode));
+			break;
+#endif /* CONFIG_NET */
+	}
+
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+	dir->state |= INODE_DIRTY;
+
+	release_page(pg);
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_create(struct inode *dir, char *name, int flags, __mode_t mode, struct inode **i_res)
+{
+	struct page *pg;
+	struct inode *i;
+	struct tmpfs_dir_entry *d;
+
+	if(IS_RDONLY_FS(dir)) {
+		return -EROFS;
+	}
+	if(strlen(name) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+
+	inode_lock(dir);
+
+	if(flags & O_CREAT) {
+		/* check again to know if this filename already exists */
+		if((pg = find_dir_entry(dir, NULL, &d, name))) {
+			release_page(pg);
+			inode_unlock(dir);
+			return -EEXIST;
+		}
+	}
+
+	if(!(i = ialloc(dir->sb, S_IFREG))) {
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	if(!(pg = add_dir_entry(dir, &d, name))) {
+		i->i_nlink = 0;
+		iput(i);
+		inode_unlock(dir);
+		return -ENOSPC;
+	}
+
+	set_dir_entry(d, i->inode, name);
+
+	i->i_mode = (mode & ~current->fs->umask) & ~S_IFMT;
+	i->i_mode |= S_IFREG;
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->i_nlink = 1;
+	i->i_blocks = 0;
+	i->dev = dir->dev;
+	i->fsop = &tmpfs_file_fsop;
+	i->count = 1;
+	i->state |= INODE_DIRTY;
+
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+	dir->state |= INODE_DIRTY;
+
+	*i_res = i;
+	release_page(pg);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_rename(struct inode *i_old, struct inode *dir_old, struct inode *i_new, struct inode *dir_new, char *oldpath, char *newpath)
+{
+	struct page *pg_old, *pg_new;
+	struct tmpfs_dir_entry *d_old, *d_new;
+	int errno;
+
+	errno = 0;
+
+	if(strlen(newpath) > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+	if(is_subdir(dir_new, i_old)) {
+		return -EINVAL;
+	}
+
+	inode_lock(i_old);
+	inode_lock(dir_old);
+	if(dir_old != dir_new) {
+		inode_lock(dir_new);
+	}
+
+	if(!(pg_old = find_dir_entry(dir_old, i_old, &d_old, oldpath))) {
+		errno = -ENOENT;
+		goto end;
+	}
+	release_page(pg_old);
+
+	if(i_new) {
+		if(S_ISDIR(i_old->i_mode)) {
+			if(!is_dir_empty(i_new)) {
+				errno = -ENOTEMPTY;
+				goto end;
+			}
+		}
+		if(!(pg_new = find_dir_entry(dir_new, i_new, &d_new, newpath))) {
+			errno = -ENOENT;
+			goto end;
+		}
+		if(S_ISDIR(i_new->i_mode)) {
+			/* the '..' of the old directory no longer points to dir_old */
+			i_new->i_nlink = 0;
+			dir_old->i_nlink--;
+		} else {
+			i_new->i_nlink--;
+		}
+		i_new->i_ctime = CURRENT_TIME;
+		i_new->state |= INODE_DIRTY;
+	} else {
+		if(!(pg_new = add_dir_entry(dir_new, &d_new, newpath))) {
+			errno = -ENOSPC;
+			goto end;
+		}
+		set_dir_entry(d_new, i_old->inode, newpath);
+		if(S_ISDIR(i_old->i_mode)) {
+			dir_old->i_nlink--;
+			dir_new->i_nlink++;
+		}
+	}
+
+	d_new->inode = i_old->inode;
+	release_page(pg_new);
+	dir_new->i_mtime = CURRENT_TIME;
+	dir_new->i_ctime = CURRENT_TIME;
+	dir_new->state |= INODE_DIRTY;
+
+	/* the new entry might have been taken from the old one, look it up again */
+	if(!(pg_old = find_dir_entry(dir_old, i_old, &d_old, oldpath))) {
+		errno = -ENOENT;
+		goto end;
+	}
+	d_old->inode = 0;
+	release_page(pg_old);
+	dir_old->i_mtime = CURRENT_TIME;
+	dir_old->i_ctime = CURRENT_TIME;
+	i_old->i_ctime = CURRENT_TIME;
+	i_old->state |= INODE_DIRTY;
+	dir_old->state |= INODE_DIRTY;
+
+	/* update the parent directory */
+	if(S_ISDIR(i_old->i_mode)) {
+		if((pg_new = find_dir_entry(i_old, dir_old, &d_new, ".."))) {
+			d_new->inode = dir_new->inode;
+			release_page(pg_new);
+		}
+	}
+
+end:
+	inode_unlock(i_old);
+	inode_unlock(dir_old);
+	if(dir_old != dir_new) {
+		inode_unlock(dir_new);
+	}
+	return errno;
+}
+#endif /* CONFIG_FS_TMPFS */
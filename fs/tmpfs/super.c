@@ -0,0 +1,322 @@
+/*
+ * fiwix/fs/tmpfs/super.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/stat.h>
+#include <fiwix/mm.h>
+#include <fiwix/sched.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_fsop = {
+	FSOP_UNNAMED_DEV,
+	0,
+
+	NULL,			/* open */
+	NULL,			/* close */
+	NULL,			/* read */
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	NULL,			/* get_page */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	NULL,			/* truncate */
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	tmpfs_read_inode,
+	tmpfs_write_inode,
+	tmpfs_ialloc,
+	tmpfs_ifree,
+	tmpfs_statfs,
+	tmpfs_read_superblock,
+	tmpfs_remount_fs,
+	NULL,			/* write_superblock */
+	tmpfs_release_superblock
+};
+
+/* parses a decimal (or octal) number with an optional k, m, g or % suffix */
+static int get_value(const char *str, int base, unsigned int *value, char *suffix)
+{
+	unsigned int n;
+
+	if(!*str) {
+		return -EINVAL;
+	}
+	for(n = 0; *str >= '0' && *str < '0' + base; str++) {
+		n = (n * base) + (*str - '0');
+	}
+	*suffix = *str;
+	if(*str && *(str + 1)) {
+		return -EINVAL;
+	}
+	*value = n;
+	return 0;
+}
+
+/*
+ * Supported mount options:
+ *
+ * size=<bytes>[k|m|g|%]	maximum size (default is half of the RAM)
+ * nr_inodes=<n>[k|m]		maximum number of inodes
+ * mode=<octal>			permissions of the root directory
+ * uid=<n>, gid=<n>		owner of the root directory
+ */
+static int parse_options(struct superblock *sb, struct tmpfs_sb_info *info)
+{
+	char *opt, *val;
+	char *options;
+	unsigned int value;
+	char suffix;
+
+	if(!(options = sb->options)) {
+		return 0;
+	}
+
+	while(*options) {
+		opt = options;
+		val = NULL;
+		while(*options && *options != ',') {
+			if(*options == '=' && !val) {
+				*options = 0;
+				val = options + 1;
+			}
+			options++;
+		}
+		if(*options) {
+			*(options++) = 0;
+		}
+		if(!*opt) {
+			continue;
+		}
+		if(!val) {
+			printk("WARNING: %s(): unknown option '%s'.\n", __FUNCTION__, opt);
+			return -EINVAL;
+		}
+
+		if(!strcmp(opt, "mode")) {
+			if(get_value(val, 8, &value, &suffix) || suffix) {
+				return -EINVAL;
+			}
+			info->s_mode = value & (S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO);
+			continue;
+		}
+		if(get_value(val, 10, &value, &suffix)) {
+			return -EINVAL;
+		}
+		if(!strcmp(opt, "size")) {
+			switch(suffix) {
+				case 0:
+					value /= PAGE_SIZE;
+					break;
+				case 'k':
+				case 'K':
+					value /= (PAGE_SIZE / 1024);
+					break;
+				case 'm':
+				case 'M':
+					value *= (1024 * 1024) / PAGE_SIZE;
+					break;
+				case 'g':
+				case 'G':
+					value *= (1024 * 1024 * 1024) / PAGE_SIZE;
+					break;
+				case '%':
+					value = (kstat.total_mem_pages * value) / 100;
+					break;
+				default:
+					return -EINVAL;
+			}
+			info->s_pages_count = value;
+		} else if(!strcmp(opt, "nr_inodes")) {
+			switch(suffix) {
+				case 0:
+					break;
+				case 'k':
+				case 'K':
+					value *= 1024;
+					break;
+				case 'm':
+				case 'M':
+					value *= 1024 * 1024;
+					break;
+				default:
+					return -EINVAL;
+			}
+			if(value > TMPFS_MAX_INODES) {
+				return -EINVAL;
+			}
+			info->s_inodes_count = value;
+		} else if(!strcmp(opt, "uid") && !suffix) {
+			info->s_uid = value;
+		} else if(!strcmp(opt, "gid") && !suffix) {
+			info->s_gid = value;
+		} else {
+			printk("WARNING: %s(): unknown option '%s'.\n", __FUNCTION__, opt);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+void tmpfs_statfs(struct superblock *sb, struct statfs *statfsbuf)
+{
+	statfsbuf->f_type = TMPFS_SUPER_MAGIC;
+	statfsbuf->f_bsize = sb->s_blocksize;
+	statfsbuf->f_blocks = sb->u.tmpfs.s_pages_count;
+	statfsbuf->f_bfree = sb->u.tmpfs.s_free_pages_count;
+	statfsbuf->f_bavail = sb->u.tmpfs.s_free_pages_count;
+	statfsbuf->f_files = sb->u.tmpfs.s_inodes_count;
+	statfsbuf->f_ffree = sb->u.tmpfs.s_free_inodes_count;
+	/* statfsbuf->f_fsid = ? */
+	statfsbuf->f_namelen = NAME_MAX;
+}
+
+int tmpfs_read_superblock(__dev_t dev, struct superblock *sb)
+{
+	struct tmpfs_sb_info info;
+	struct inode *i;
+	int errno;
+
+	memset_b(&info, 0, sizeof(struct tmpfs_sb_info));
+	info.s_pages_count = kstat.total_mem_pages / 2;
+	info.s_inodes_count = MIN(kstat.total_mem_pages / 2, TMPFS_MAX_INODES);
+	info.s_mode = S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO;
+	if((errno = parse_options(sb, &info))) {
+		return errno;
+	}
+	if(info.s_inodes_count < TMPFS_ROOT_INO) {
+		return -EINVAL;
+	}
+
+	superblock_lock(sb);
+	if(!(info.itable = (struct tmpfs_inode **)kmalloc(PAGE_SIZE))) {
+		superblock_unlock(sb);
+		return -ENOMEM;
+	}
+	memset_b(info.itable, 0, PAGE_SIZE);
+	info.s_free_inodes_count = info.s_inodes_count;
+	info.s_free_pages_count = info.s_pages_count;
+
+	sb->dev = dev;
+	sb->fsop = &tmpfs_fsop;
+	sb->s_blocksize = PAGE_SIZE;
+	memcpy_b(&sb->u.tmpfs, &info, sizeof(struct tmpfs_sb_info));
+	superblock_unlock(sb);
+
+	/* the first inode allocated is the root directory */
+	if(!(i = ialloc(sb, S_IFDIR))) {
+		kfree((unsigned int)sb->u.tmpfs.itable);
+		sb->u.tmpfs.itable = NULL;
+		return -ENOSPC;
+	}
+	i->i_mode = S_IFDIR | sb->u.tmpfs.s_mode;
+	i->i_uid = sb->u.tmpfs.s_uid;
+	i->i_gid = sb->u.tmpfs.s_gid;
+	i->count = 1;
+	i->fsop = &tmpfs_dir_fsop;
+	if((errno = tmpfs_init_dir(i, i))) {
+		i->i_nlink = 0;
+		iput(i);
+		kfree((unsigned int)sb->u.tmpfs.itable);
+		sb->u.tmpfs.itable = NULL;
+		return errno;
+	}
+	sb->root = i;
+	return 0;
+}
+
+int tmpfs_remount_fs(struct superblock *sb, int flags)
+{
+	struct tmpfs_sb_info info;
+	unsigned int used;
+	int errno;
+
+	memcpy_b(&info, &sb->u.tmpfs, sizeof(struct tmpfs_sb_info));
+	if((errno = parse_options(sb, &info))) {
+		return errno;
+	}
+
+	/* inodes in use can't be renumbered, so the inode table can only grow */
+	if(info.s_inodes_count < sb->u.tmpfs.s_inodes_count) {
+		return -EINVAL;
+	}
+
+	superblock_lock(sb);
+	/* and it can't shrink below the size of its current contents */
+	used = sb->u.tmpfs.s_pages_count - sb->u.tmpfs.s_free_pages_count;
+	if(info.s_pages_count < used) {
+		superblock_unlock(sb);
+		return -EBUSY;
+	}
+	sb->u.tmpfs.s_free_pages_count = info.s_pages_count - used;
+	sb->u.tmpfs.s_pages_count = info.s_pages_count;
+	sb->u.tmpfs.s_free_inodes_count += info.s_inodes_count - sb->u.tmpfs.s_inodes_count;
+	sb->u.tmpfs.s_inodes_count = info.s_inodes_count;
+	superblock_unlock(sb);
+	return 0;
+}
+
+/* the whole filesystem is destroyed when it's unmounted */
+void tmpfs_release_superblock(struct superblock *sb)
+{
+	struct tmpfs_inode *ti;
+	struct inode i;
+	int n, ino;
+
+	if(!sb->u.tmpfs.itable) {
+		return;
+	}
+
+	memset_b(&i, 0, sizeof(struct inode));
+	i.dev = sb->dev;
+	i.sb = sb;
+	for(n = 0; n < TMPFS_ITABLE_PAGES; n++) {
+		if(!(ti = sb->u.tmpfs.itable[n])) {
+			continue;
+		}
+		for(ino = 0; ino < TMPFS_INODES_PER_PAGE; ino++, ti++) {
+			if(S_ISREG(ti->i_mode) || S_ISDIR(ti->i_mode) || S_ISLNK(ti->i_mode)) {
+				i.inode = (n * TMPFS_INODES_PER_PAGE) + ino + 1;
+				i.i_size = ti->i_size;
+				tmpfs_free_pages(&i, 0);
+			}
+		}
+		kfree((unsigned int)sb->u.tmpfs.itable[n]);
+	}
+	kfree((unsigned int)sb->u.tmpfs.itable);
+	sb->u.tmpfs.itable = NULL;
+}
+
+int tmpfs_init(void)
+{
+	return register_filesystem("tmpfs", &tmpfs_fsop);
+}
+#endif /* CONFIG_FS_TMPFS */
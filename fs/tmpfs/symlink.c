@@ -0,0 +1,125 @@
+/*
+ * fiwix/fs/tmpfs/symlink.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/stat.h>
+#include <fiwix/mm.h>
+#include <fiwix/sched.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_symlink_fsop = {
+	0,
+	0,
+
+	NULL,			/* open */
+	NULL,			/* close */
+	NULL,			/* read */
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	tmpfs_readlink,
+	tmpfs_followlink,
+	NULL,			/* bmap */
+	NULL,			/* get_page */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	NULL,			/* truncate */
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int tmpfs_readlink(struct inode *i, char *buffer, __size_t count)
+{
+	struct page *pg;
+
+	if(!S_ISLNK(i->i_mode)) {
+		printk("%s(): Oops, inode '%d' is not a symlink (!?).\n", __FUNCTION__, i->inode);
+		return 0;
+	}
+
+	inode_lock(i);
+	count = MIN(count, i->i_size);
+	if(!count) {
+		inode_unlock(i);
+		return 0;
+	}
+	if(!(pg = tmpfs_get_page(i, 0, FOR_READING))) {
+		inode_unlock(i);
+		return -EIO;
+	}
+	memcpy_b(buffer, pg->data, count);
+	release_page(pg);
+	buffer[count] = 0;
+	inode_unlock(i);
+	return count;
+}
+
+int tmpfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
+{
+	struct page *pg;
+	__ino_t errno;
+
+	if(!i) {
+		return -ENOENT;
+	}
+
+	if(!S_ISLNK(i->i_mode)) {
+		printk("%s(): Oops, inode '%d' is not a symlink (!?).\n", __FUNCTION__, i->inode);
+		return 0;
+	}
+
+	if(current->loopcnt > MAX_SYMLINKS) {
+		iput(i);
+		printk("%s(): too many nested symbolic links!\n", __FUNCTION__);
+		return -ELOOP;
+	}
+
+	inode_lock(i);
+	if(!(pg = tmpfs_get_page(i, 0, FOR_READING))) {
+		inode_unlock(i);
+		return -EIO;
+	}
+	inode_unlock(i);
+
+	current->loopcnt++;
+	iput(i);
+	/* the target was stored null-terminated in a zeroed page */
+	errno = parse_namei(pg->data, dir, i_res, NULL, FOLLOW_LINKS);
+	release_page(pg);
+	current->loopcnt--;
+	return errno;
+}
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,94 @@
+/*
+ * fiwix/include/fiwix/aio.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_AIO_H
+#define _FIWIX_AIO_H
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+#include <fiwix/mm.h>
+
+#define IOCB_CMD_PREAD		0
+#define IOCB_CMD_PWRITE		1
+#define IOCB_CMD_FSYNC		2
+#define IOCB_CMD_FDSYNC		3
+#define IOCB_CMD_NOOP		6
+
+#define IOCB_FLAG_RESFD		1	/* notify completions through aio_resfd */
+
+#define AIO_MAX_EVENTS		(PAGE_SIZE / sizeof(struct io_event))
+#define AIO_MAX_PAGES		(PAGE_SIZE / sizeof(struct page *))
+
+typedef unsigned int aio_context_t;
+
+/* I/O control block (the same layout as in Linux/i386) */
+struct iocb {
+	__u64 aio_data;			/* returned in the event */
+	__u32 aio_key;
+	__u32 aio_rw_flags;
+	__u16 aio_lio_opcode;		/* IOCB_CMD_* */
+	__s16 aio_reqprio;
+	__u32 aio_fildes;
+	__u64 aio_buf;
+	__u64 aio_nbytes;
+	__s64 aio_offset;
+	__u64 aio_reserved2;
+	__u32 aio_flags;		/* IOCB_FLAG_* */
+	__u32 aio_resfd;
+};
+
+struct io_event {
+	__u64 data;			/* the aio_data of the request */
+	__u64 obj;			/* user address of the iocb */
+	__s64 res;			/* bytes transferred or -errno */
+	__s64 res2;
+};
+
+/* a request queued to the kaiod threads */
+struct kiocb {
+	struct aio_ctx *ctx;
+	__u64 data;
+	__u64 obj;
+	int opcode;
+	unsigned int fd;		/* index in fd_table */
+	unsigned int resfd;		/* index in fd_table (0 = none) */
+	__off_t offset;
+	unsigned int poffset;		/* offset in the first page */
+	__size_t count;
+	int nr_pages;
+	struct page **pages;		/* pinned user buffer */
+	struct kiocb *next;
+};
+
+/*
+ * The context id is the address of a read-only page mapped in the process,
+ * so that it's unique and libaio, which checks for a completion ring there,
+ * falls back to io_getevents().
+ */
+struct aio_ctx {
+	aio_context_t id;
+	struct mm *mm;
+	int max_events;
+	int nr_reqs;			/* requests in flight and events unreaped */
+	int nr_running;			/* requests being served by kaiod */
+	int users;			/* system calls using the context */
+	int dead;
+	int head;			/* first event in the ring */
+	int nr_events;
+	struct io_event *events;
+	struct aio_ctx *next;
+};
+
+int aio_setup(unsigned int, aio_context_t *);
+int aio_destroy(aio_context_t);
+int aio_submit(aio_context_t, int, struct iocb **);
+int aio_cancel(aio_context_t, struct iocb *, struct io_event *);
+int aio_getevents(aio_context_t, int, int, struct io_event *, const struct timespec *);
+void exit_aio(struct mm *);
+int kaiod(void);
+
+#endif /* _FIWIX_AIO_H */
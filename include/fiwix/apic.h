@@ -0,0 +1,84 @@
+/*
+ * fiwix/include/fiwix/apic.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_APIC_H
+#define _FIWIX_APIC_H
+
+#define LAPIC_DEF_ADDR	0xFEE00000	/* default Local APIC base address */
+#define IOAPIC_DEF_ADDR	0xFEC00000	/* default I/O APIC base address */
+
+#define IRQ_VECTOR_BASE	0x20		/* vector of IRQ 0 (as with the PIC) */
+
+/* Local APIC registers (offsets from its base address) */
+#define LAPIC_ID	0x020	/* Local APIC ID */
+#define LAPIC_VER	0x030	/* Local APIC Version */
+#define LAPIC_TPR	0x080	/* Task Priority */
+#define LAPIC_EOI	0x0B0	/* End Of Interrupt */
+#define LAPIC_SVR	0x0F0	/* Spurious Interrupt Vector */
+#define LAPIC_ESR	0x280	/* Error Status */
+#define LAPIC_ICRL	0x300	/* Interrupt Command (bits 0-31) */
+#define LAPIC_ICRH	0x310	/* Interrupt Command (bits 32-63) */
+#define LAPIC_LVT_TIMER	0x320	/* LVT Timer */
+#define LAPIC_LVT_LINT0	0x350	/* LVT LINT0 */
+#define LAPIC_TIMER_ICR	0x380	/* Timer Initial Count */
+#define LAPIC_TIMER_CCR	0x390	/* Timer Current Count */
+#define LAPIC_TIMER_DCR	0x3E0	/* Timer Divide Configuration */
+
+#define LAPIC_SVR_ENABLE	0x100	/* APIC software enable */
+#define LAPIC_SPURIOUS_VECTOR	0xFF
+
+/* Local Vector Table flags */
+#define LVT_MASKED		0x00010000
+#define LVT_PERIODIC		0x00020000	/* timer periodic mode */
+#define LAPIC_TIMER_DIV16	0x03		/* timer counts bus clock / 16 */
+
+/* Interrupt Command Register flags */
+#define ICR_FIXED		0x00000000	/* Fixed delivery mode */
+#define ICR_INIT		0x00000500	/* INIT delivery mode */
+#define ICR_STARTUP		0x00000600	/* Start-Up delivery mode */
+#define ICR_BUSY		0x00001000	/* delivery status (send pending) */
+#define ICR_ASSERT		0x00004000	/* level assert */
+#define ICR_LEVEL		0x00008000	/* level triggered */
+
+#define LAPIC_ID_SHIFT		24
+
+/* I/O APIC registers */
+#define IOAPIC_REGSEL		0x00	/* register select */
+#define IOAPIC_WIN		0x10	/* register window */
+#define IOAPIC_VER		0x01	/* version and max. redirection entry */
+#define IOAPIC_REDTBL		0x10	/* first redirection table entry */
+
+/* redirection table entry flags */
+#define IOREDTBL_LOW		0x00002000	/* active low polarity */
+#define IOREDTBL_LEVEL		0x00008000	/* level triggered */
+#define IOREDTBL_MASKED		0x00010000
+
+/* Interrupt Mode Configuration Register */
+#define IMCR_ADDR		0x22
+#define IMCR_DATA		0x23
+#define IMCR_SELECT		0x70
+#define IMCR_APIC		0x01	/* route the INTR and NMI to the APIC */
+
+extern unsigned int lapic_addr;
+extern int apic_enabled;
+extern unsigned int lapic_timer_count;
+
+unsigned int lapic_read(int);
+void lapic_write(int, unsigned int);
+int lapic_get_id(void);
+void lapic_send_ipi(int, unsigned int);
+void lapic_eoi(void);
+void lapic_enable(void);
+unsigned int lapic_timer_calibrate(int);
+int lapic_timer_init(int);
+void lapic_timer_periodic(void);
+void lapic_timer_oneshot(unsigned int);
+void ioapic_enable_irq(int);
+void ioapic_disable_irq(int);
+void apic_init(void);
+
+#endif /* _FIWIX_APIC_H */
@@ -58,12 +58,25 @@ extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
 extern void unknown_irq(void);
+extern void resched_ipi(void);
+extern void smp_timer_ipi(void);
+extern void tlb_ipi(void);
 
 extern void switch_to_user_mode(void);
 extern void sighandler_trampoline(void);
 extern void end_sighandler_trampoline(void);
 extern void syscall(void);
+extern void sysenter_entry(void);
+extern char vsyscall_sysenter[];
+extern char end_vsyscall_sysenter[];
+extern char vsyscall_int80[];
+extern char end_vsyscall_int80[];
+extern char vsyscall_gettimeofday[];
+extern char end_vsyscall_gettimeofday[];
+extern char vsyscall_time[];
+extern char end_vsyscall_time[];
 extern void return_from_syscall(void);
+extern void ret_from_fork(void);
 extern void do_switch(unsigned int *, unsigned int *, unsigned int, unsigned int, unsigned int, unsigned short int);
 
 int cpuid(void);
@@ -96,7 +109,17 @@ void invalidate_tlb(void);
 #define NOP() __asm__ __volatile__ ("nop":::"memory")
 #define HLT() __asm__ __volatile__ ("hlt":::"memory")
 
+#define CLTS() __asm__ __volatile__ ("clts":::"memory")
+
+#define GET_CR0(cr0) __asm__ __volatile__ ("movl %%cr0, %0" : "=r" (cr0));
+#define SET_CR0(cr0) __asm__ __volatile__ ("movl %0, %%cr0" :: "r" (cr0));
 #define GET_CR2(cr2) __asm__ __volatile__ ("movl %%cr2, %0" : "=r" (cr2));
+#define GET_CR3(cr3) __asm__ __volatile__ ("movl %%cr3, %0" : "=r" (cr3));
+#define SET_CR3(cr3) __asm__ __volatile__ ("movl %0, %%cr3" :: "r" (cr3) : "memory");
+#define GET_CR4(cr4) __asm__ __volatile__ ("movl %%cr4, %0" : "=r" (cr4));
+#define SET_CR4(cr4) __asm__ __volatile__ ("movl %0, %%cr4" :: "r" (cr4));
+#define INVLPG(addr) __asm__ __volatile__ ("invlpg (%0)" :: "r" (addr) : "memory");
+#define WRMSR(msr, lo, hi) __asm__ __volatile__ ("wrmsr" :: "c" (msr), "a" (lo), "d" (hi));
 #define GET_ESP(esp) __asm__ __volatile__ ("movl %%esp, %0" : "=r" (esp));
 #define SET_ESP(esp) __asm__ __volatile__ ("movl %0, %%esp" :: "r" (esp));
 
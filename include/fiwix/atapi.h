@@ -46,6 +46,7 @@ enum {
 
 int send_packet_command(unsigned char *, struct ide *, struct ata_drv *, int);
 int atapi_read_data(__dev_t, char *, struct ide *, struct ata_drv *, int, int);
+int atapi_read_sectors(__dev_t, char **, struct ide *, struct ata_drv *, int);
 int atapi_cmd_testunit(struct ide *, struct ata_drv *);
 int atapi_cmd_reqsense(struct ide *, struct ata_drv *);
 int atapi_cmd_startstop(int, struct ide *, struct ata_drv *);
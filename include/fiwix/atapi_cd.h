@@ -11,6 +11,7 @@
 #include <fiwix/fs.h>
 
 #define ATAPI_CD_SECTSIZE	BLKSIZE_2K	/* sector size (in bytes) */
+#define ATAPI_CD_READAHEAD	16		/* sectors per READ(10) command */
 
 int atapi_cd_open(struct inode *, struct fd *);
 int atapi_cd_close(struct inode *, struct fd *);
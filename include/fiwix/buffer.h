@@ -15,6 +15,7 @@
 #define BUFFER_VALID	0x01
 #define BUFFER_LOCKED	0x02
 #define BUFFER_DIRTY	0x04
+#define BUFFER_DIRECT	0x08	/* data is the device memory itself */
 
 #define BLK_READ	1
 #define BLK_WRITE	2
@@ -46,6 +47,8 @@ extern unsigned int buffer_hash_table_size;	/* size in bytes */
 struct buffer *bread(__dev_t, __blk_t, int);
 void bwrite(struct buffer *);
 void brelse(struct buffer *);
+int brw_direct(int, __dev_t, __blk_t, char *, int);
+int direct_io(int, struct inode *, struct fd *, char *, __size_t);
 void sync_buffers(__dev_t);
 void invalidate_buffers(__dev_t);
 int reclaim_buffers(void);
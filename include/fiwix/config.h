@@ -10,6 +10,7 @@
 
 /* kernel tuning */
 #define NR_PROCS		64	/* max. number of processes */
+#define NR_CPUS			8	/* max. number of processors */
 #define NR_CALLOUTS		NR_PROCS	/* max. active callouts */
 #define NR_MOUNT_POINTS		8	/* max. number of mounted filesystems */
 #define NR_OPENS		1024	/* max. number of opened files */
@@ -35,6 +36,16 @@
 					   interrupts */
 #define RAMDISK_DRIVES		1	/* num. of all-purpose ramdisk drives */
 #define NR_SYSCONSOLES		1	/* max. number of system consoles */
+#define SERIAL_FIFO_TRIGGER	8	/* receive FIFO trigger level in bytes
+					   (1, 4, 8 or 14) */
+#define FAULT_AROUND_PAGES	16	/* max. cached pages mapped in a single
+					   file page fault (power of 2) */
+#define EXT2_PREALLOC_BLOCKS	8	/* blocks reserved ahead for an ext2
+					   file being written (1 = disabled) */
+#define MSYNC_INTERVAL		30	/* secs. between writebacks of the shared
+					   file mappings */
+#define NR_AIO_WORKERS		2	/* num. of kaiod threads serving the
+					   asynchronous I/O requests */
 
 
 /* toggle configuration options */
@@ -48,14 +59,23 @@
 #define CONFIG_OFFSET64
 #undef CONFIG_VM_SPLIT22
 #undef CONFIG_FS_MINIX
+#define CONFIG_FS_TMPFS
 #undef CONFIG_MMAP2
 #define CONFIG_NET
 #define CONFIG_PRINTK64
+#define CONFIG_PSE
+#undef CONFIG_PGE
+#undef CONFIG_PREEMPT
+#undef CONFIG_HRTIMERS
+#undef CONFIG_VSYSCALL
+#undef CONFIG_APIC
+#undef CONFIG_SMP
 
 
 /* configuration options to help debugging */
 #define CONFIG_VERBOSE_SEGFAULTS
 #undef CONFIG_QEMU_DEBUGCON
+#undef CONFIG_LATENCY_TEST
 
 
 #ifdef CUSTOM_CONFIG_H
@@ -41,6 +41,11 @@
 #define CPU_RES30	0x40000000	/* Reserved */
 #define CPU_PBE		0x80000000	/* Pending Break Enable */
 
+#define CR4_PSE		0x00000010	/* Page Size Extensions */
+#define CR4_PGE		0x00000080	/* Page Global Enable */
+#define CR4_OSFXSR	0x00000200	/* FXSAVE/FXRSTOR and SSE support */
+#define CR4_OSXMMEXCPT	0x00000400	/* unmasked SIMD FP exceptions */
+
 #define RESERVED_DESC	0x80000000	/* TLB descriptor reserved */
 
 struct cpu {
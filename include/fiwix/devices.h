@@ -29,6 +29,8 @@ struct device {
 	void *device_data;		/* mostly used for minor sizes, in KB */
 	struct fs_operations *fsop;
 	struct device *next;
+	/* returns the address of a block kept in memory (optional) */
+	char *(*direct_access)(__dev_t, __blk_t, int);
 };
 
 extern struct device *chr_device_table[NR_CHRDEV];
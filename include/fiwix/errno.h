@@ -128,5 +128,6 @@
 
 #define ENOMEDIUM	123	/* No medium found			*/
 #define EMEDIUMTYPE	124	/* Wrong medium type			*/
+#define ECANCELED	125	/* Operation Canceled			*/
 
 #endif	/* _FIWIX_ERRNO_H */
@@ -27,6 +27,7 @@
 #define O_NONBLOCK	  04000
 #define O_NDELAY	O_NONBLOCK
 #define O_SYNC		 010000
+#define O_DIRECT	 040000	/* bypass the page and buffer caches */
 
 #define F_DUPFD		0	/* duplicate file descriptor */
 #define F_GETFD		1	/* get file descriptor flags */
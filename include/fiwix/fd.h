@@ -13,7 +13,7 @@
 
 #define CHECK_UFD(ufd)							\
 {									\
-	if((ufd) > (OPEN_MAX - 1) || current->fd[(ufd)] == 0) {		\
+	if((ufd) > (OPEN_MAX - 1) || current->files->fd[(ufd)] == 0) {		\
 		return -EBADF;						\
 	}								\
 }									\
@@ -27,6 +27,7 @@ struct fd {
 #else
 	__off_t offset;			/* r/w pointer position */
 #endif /* CONFIG_OFFSET64 */
+	void *private_data;		/* filesystem specific data */
 };
 
 #endif /* _FIWIX_FS_H */
@@ -11,7 +11,7 @@
 #include <fiwix/types.h>
 #include <fiwix/limits.h>
 
-#define NR_FILESYSTEMS		6	/* supported filesystems */
+#define NR_FILESYSTEMS		7	/* supported filesystems */
 
 /* special device numbers for nodev filesystems */
 enum {
@@ -21,6 +21,9 @@ enum {
 	SOCK_DEV,
 };
 
+/* major number of the devices given to each mount of a nodev filesystem */
+#define UNNAMED_MAJOR		0
+
 struct filesystems {
 	const char *name;		/* filesystem name */
 	struct fs_operations *fsop;	/* filesystem operations */
@@ -44,6 +47,7 @@ struct filesystems *get_filesystem(const char *);
 void fs_init(void);
 
 struct superblock *get_superblock(__dev_t);
+__dev_t get_unnamed_dev(void);
 void sync_superblocks(__dev_t);
 int kern_mount(__dev_t, struct filesystems *);
 int mount_root(void);
@@ -167,6 +171,40 @@ void procfs_statfs(struct superblock *, struct statfs *);
 int procfs_read_superblock(__dev_t, struct superblock *);
 int procfs_init(void);
 
+/* tmpfs prototypes */
+int tmpfs_file_open(struct inode *, struct fd *);
+int tmpfs_file_close(struct inode *, struct fd *);
+int tmpfs_file_read(struct inode *, struct fd *, char *, __size_t);
+int tmpfs_file_write(struct inode *, struct fd *, const char *, __size_t);
+__loff_t tmpfs_file_llseek(struct inode *, __loff_t);
+int tmpfs_dir_open(struct inode *, struct fd *);
+int tmpfs_dir_close(struct inode *, struct fd *);
+int tmpfs_dir_read(struct inode *, struct fd *, char *, __size_t);
+int tmpfs_dir_write(struct inode *, struct fd *, const char *, __size_t);
+int tmpfs_dir_readdir(struct inode *, struct fd *, struct dirent *, __size_t);
+int tmpfs_dir_readdir64(struct inode *, struct fd *, struct dirent64 *, __size_t);
+int tmpfs_readlink(struct inode *, char *, __size_t);
+int tmpfs_followlink(struct inode *, struct inode *, struct inode **);
+int tmpfs_lookup(const char *, struct inode *, struct inode **);
+int tmpfs_rmdir(struct inode *, struct inode *);
+int tmpfs_link(struct inode *, struct inode *, char *);
+int tmpfs_unlink(struct inode *, struct inode *, char *);
+int tmpfs_symlink(struct inode *, char *, char *);
+int tmpfs_mkdir(struct inode *, char *, __mode_t);
+int tmpfs_mknod(struct inode *, char *, __mode_t, __dev_t);
+int tmpfs_truncate(struct inode *, __off_t);
+int tmpfs_create(struct inode *, char *, int, __mode_t, struct inode **);
+int tmpfs_rename(struct inode *, struct inode *, struct inode *, struct inode *, char *, char *);
+int tmpfs_read_inode(struct inode *);
+int tmpfs_write_inode(struct inode *);
+int tmpfs_ialloc(struct inode *, int);
+void tmpfs_ifree(struct inode *);
+void tmpfs_statfs(struct superblock *, struct statfs *);
+int tmpfs_read_superblock(__dev_t, struct superblock *);
+int tmpfs_remount_fs(struct superblock *, int);
+void tmpfs_release_superblock(struct superblock *);
+int tmpfs_init(void);
+
 #ifdef CONFIG_NET
 /* sockfs prototypes */
 int sockfs_open(struct inode *, struct fd *);
@@ -17,6 +17,7 @@
 #define FDC_MAJOR	2	/* fdd major number */
 
 #define FDC_SECTSIZE	512	/* sector size (in bytes) */
+#define FDC_MAX_CYLSIZE	(18 * 2 * FDC_SECTSIZE)	/* biggest cylinder (1.44MB) */
 #define FDC_TR_DEFAULT	0	/* timer reason is IRQ */
 #define FDC_TR_MOTOR	1	/* timer reason is motor on */
 
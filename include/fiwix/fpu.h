@@ -0,0 +1,67 @@
+/*
+ * fiwix/include/fiwix/fpu.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_FPU_H
+#define _FIWIX_FPU_H
+
+#include <fiwix/config.h>
+#include <fiwix/smp.h>
+
+#define CR0_TS		0x00000008	/* Task Switched */
+
+#define MXCSR_DEFAULT	0x1F80		/* all SIMD exceptions masked */
+
+/* FNSAVE/FRSTOR format */
+struct i387_fsave {
+	unsigned int cwd;
+	unsigned int swd;
+	unsigned int twd;
+	unsigned int fip;
+	unsigned int fcs;
+	unsigned int foo;
+	unsigned int fos;
+	unsigned int st_space[20];	/* 8 registers of 10 bytes */
+};
+
+/* FXSAVE/FXRSTOR format, it must be 16-byte aligned */
+struct i387_fxsave {
+	unsigned short int cwd;
+	unsigned short int swd;
+	unsigned short int twd;
+	unsigned short int fop;
+	unsigned int fip;
+	unsigned int fcs;
+	unsigned int foo;
+	unsigned int fos;
+	unsigned int mxcsr;
+	unsigned int mxcsr_mask;
+	unsigned int st_space[32];	/* 8 registers of 16 bytes */
+	unsigned int xmm_space[32];	/* 8 registers of 16 bytes */
+	unsigned int padding[56];
+} __attribute__((aligned(16)));
+
+union fpu_state {
+	struct i387_fsave fsave;
+	struct i387_fxsave fxsave;
+};
+
+struct proc;
+
+#ifdef CONFIG_SMP
+#define fpu_owner	(smp_this_cpu()->fpu_proc)
+#else
+extern struct proc *fpu_owner;
+#endif /* CONFIG_SMP */
+extern int fxsr_enabled;
+
+void fpu_save(struct proc *);
+void fpu_release(struct proc *);
+void fpu_switch(struct proc *);
+void fpu_restore(void);
+void fpu_init(void);
+
+#endif /* _FIWIX_FPU_H */
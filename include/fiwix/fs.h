@@ -19,6 +19,7 @@
 #include <fiwix/fs_iso9660.h>
 #include <fiwix/fs_proc.h>
 #include <fiwix/fs_sock.h>
+#include <fiwix/fs_tmpfs.h>
 
 #define BPS			512	/* bytes per sector */
 #define BLKSIZE_1K		1024	/* 1KB block size */
@@ -121,18 +122,23 @@ struct superblock {
 	unsigned int state;
 	struct fs_operations *fsop;
 	__u32 s_blocksize;
+	char *options;			/* mount options (only while mounting) */
 	union {
 #ifdef CONFIG_FS_MINIX
 		struct minix_sb_info minix;
 #endif /* CONFIG_FS_MINIX */
 		struct ext2_sb_info ext2;
 		struct iso9660_sb_info iso9660;
+#ifdef CONFIG_FS_TMPFS
+		struct tmpfs_sb_info tmpfs;
+#endif /* CONFIG_FS_TMPFS */
 	} u;
 };
 
 
 #define FSOP_REQUIRES_DEV	1	/* requires a block device */
 #define FSOP_KERN_MOUNT		2	/* mounted by kernel */
+#define FSOP_UNNAMED_DEV	4	/* gets a new device on every mount */
 
 struct fs_operations {
 	int flags;
@@ -154,6 +160,7 @@ struct fs_operations {
 	int (*readlink)(struct inode *, char *, __size_t);
 	int (*followlink)(struct inode *, struct inode *, struct inode **);
 	int (*bmap)(struct inode *, __off_t, int);
+	struct page *(*get_page)(struct inode *, __off_t, int);
 	int (*lookup)(const char *, struct inode *, struct inode **);
 	int (*rmdir)(struct inode *, struct inode *);
 	int (*link)(struct inode *, struct inode *, char *);
@@ -203,6 +210,8 @@ extern struct fs_operations ext2_dir_fsop;
 extern struct fs_operations ext2_symlink_fsop;
 extern int ext2_balloc(struct superblock *);
 extern void ext2_bfree(struct superblock *, int);
+extern int ext2_new_block(struct inode *);
+extern void ext2_discard_prealloc(struct inode *);
 
 /* fs_proc.h prototypes */
 extern struct fs_operations procfs_fsop;
@@ -226,6 +235,15 @@ void check_rrip_inode(struct iso9660_directory_record *, struct inode *);
 int get_rrip_filename(struct iso9660_directory_record *, struct inode *, char *);
 int get_rrip_symlink(struct inode *, char *);
 
+/* fs_tmpfs.h prototypes */
+extern struct fs_operations tmpfs_fsop;
+extern struct fs_operations tmpfs_file_fsop;
+extern struct fs_operations tmpfs_dir_fsop;
+extern struct fs_operations tmpfs_symlink_fsop;
+struct page *tmpfs_get_page(struct inode *, __off_t, int);
+void tmpfs_free_pages(struct inode *, __off_t);
+int tmpfs_init_dir(struct inode *, struct inode *);
+
 
 /* generic VFS function prototypes */
 void inode_lock(struct inode *);
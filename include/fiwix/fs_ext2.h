@@ -242,10 +242,33 @@ struct ext2_sb_info {
 	struct ext2_super_block sb;
 };
 
+#define EXT2_NR_EXTENTS		4	/* cached block runs per inode */
+
+/* run of contiguous blocks found by ext2_bmap() (len = 0 means unused) */
+struct ext2_extent {
+	__u32	ee_lblock;		/* first logical block */
+	__u32	ee_pblock;		/* first physical block */
+	__u32	ee_len;			/* number of blocks */
+};
+
 /* inode in memory */
 struct ext2_i_info {
 	__u32	i_data[EXT2_N_BLOCKS];	/* Pointers to blocks */
 	__u32	i_dtime;
+	struct ext2_extent i_extent[EXT2_NR_EXTENTS];
+	__u32	i_next_extent;		/* next slot to be replaced */
+	__u32	i_alloc_goal;		/* preferred block for next allocation */
+	__u32	i_prealloc_block;	/* first preallocated block */
+	__u32	i_prealloc_count;	/* number of preallocated blocks */
+};
+
+/* block allocation statistics (shown in /proc/ext2alloc) */
+struct ext2_alloc_stat {
+	unsigned int allocated;		/* blocks allocated to inodes */
+	unsigned int contiguous;	/* ... right after the previous one */
+	unsigned int prealloc_used;	/* ... taken from a preallocation */
+	unsigned int prealloc_freed;	/* preallocated blocks given back */
 };
+extern struct ext2_alloc_stat ext2_alloc_stat;
 
 #endif	/* _FIWIX_FS_EXT2_H */
@@ -19,7 +19,7 @@
 #define PROC_FD_INO		0x50000000	/* base for FD inodes */
 #define PROC_FD_LEV		2	/* array level for FDs */
 
-#define PROC_ARRAY_ENTRIES	22
+#define PROC_ARRAY_ENTRIES	24
 
 enum pid_dir_inodes {
 	PROC_PID_FD = PROC_PID_INO + 1001,
@@ -35,10 +35,29 @@ enum pid_dir_inodes {
 	PROC_PID_STATUS
 };
 
+#define PROC_SEQ_PAGES		(PAGE_SIZE / sizeof(char *))	/* 4MB max. */
+
 struct procfs_inode {
 	unsigned int i_lev;		/* array level (directory depth) */
 };
 
+/* snapshot of a procfs file kept in each open file descriptor */
+struct procfs_seq {
+	__pid_t pid;			/* PID of the directory (if any) */
+	unsigned int count;		/* size of the snapshot (in bytes) */
+	char **pages;			/* array of pages holding the snapshot */
+	char *tmp;			/* rendering buffer for a single record */
+	int error;
+};
+
+/* iterator used to generate a procfs file incrementally */
+struct procfs_seq_ops {
+	void *(*start)(struct procfs_seq *, int *);
+	void *(*next)(struct procfs_seq *, void *, int *);
+	void (*stop)(struct procfs_seq *, void *);
+	int (*show)(struct procfs_seq *, void *);
+};
+
 struct procfs_dir_entry {
 	__ino_t inode;
 	__mode_t mode;
@@ -47,17 +66,30 @@ struct procfs_dir_entry {
 	unsigned short int name_len;
 	char *name;
 	int (*data_fn)(char *, __pid_t);
+	struct procfs_seq_ops *seq_ops;
 };
 
 extern struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1];
+extern struct procfs_seq_ops seq_proc_stat;
+extern struct procfs_seq_ops seq_proc_pid_maps;
+
+int procfs_seq_printf(struct procfs_seq *, const char *, ...);
+void *procfs_seq_single_start(struct procfs_seq *, int *);
+void *procfs_seq_single_next(struct procfs_seq *, void *, int *);
+void procfs_seq_single_stop(struct procfs_seq *, void *);
+int procfs_seq_build(struct procfs_seq *, struct procfs_dir_entry *);
+int procfs_seq_read(struct procfs_seq *, unsigned int, char *, __size_t);
+void procfs_seq_release(struct procfs_seq *);
 
 int data_proc_buddyinfo(char *, __pid_t);
 int data_proc_cmdline(char *, __pid_t);
 int data_proc_cpuinfo(char *, __pid_t);
 int data_proc_devices(char *, __pid_t);
 int data_proc_dma(char *, __pid_t);
+int data_proc_ext2alloc(char *, __pid_t);
 int data_proc_filesystems(char *, __pid_t);
 int data_proc_interrupts(char *, __pid_t);
+int data_proc_latency(char *, __pid_t);
 int data_proc_loadavg(char *, __pid_t);
 int data_proc_locks(char *, __pid_t);
 int data_proc_meminfo(char *, __pid_t);
@@ -65,7 +97,6 @@ int data_proc_mounts(char *, __pid_t);
 int data_proc_partitions(char *, __pid_t);
 int data_proc_rtc(char *, __pid_t);
 int data_proc_self(char *, __pid_t);
-int data_proc_stat(char *, __pid_t);
 int data_proc_uptime(char *, __pid_t);
 int data_proc_fullversion(char *, __pid_t);
 int data_proc_unix(char *, __pid_t);
@@ -80,6 +111,7 @@ int data_proc_osrelease(char *, __pid_t);
 int data_proc_ostype(char *, __pid_t);
 int data_proc_version(char *, __pid_t);
 int data_proc_dirty_background_ratio(char *, __pid_t);
+int data_proc_tty_serial(char *, __pid_t);
 
 /* PID related functions */
 int data_proc_pid_fd(char *, __pid_t, __ino_t);
@@ -87,7 +119,6 @@ int data_proc_pid_cmdline(char *, __pid_t);
 int data_proc_pid_cwd(char *, __pid_t);
 int data_proc_pid_environ(char *, __pid_t);
 int data_proc_pid_exe(char *, __pid_t);
-int data_proc_pid_maps(char *, __pid_t);
 int data_proc_pid_mountinfo(char *, __pid_t);
 int data_proc_pid_root(char *, __pid_t);
 int data_proc_pid_stat(char *, __pid_t);
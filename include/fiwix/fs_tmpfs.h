@@ -0,0 +1,73 @@
+/*
+ * fiwix/include/fiwix/fs_tmpfs.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_FS_TMPFS
+
+#ifndef _FIWIX_FS_TMPFS_H
+#define _FIWIX_FS_TMPFS_H
+
+#include <fiwix/types.h>
+#include <fiwix/limits.h>
+
+#define TMPFS_ROOT_INO		1	/* root inode */
+#define TMPFS_SUPER_MAGIC	0x01021994	/* same as in Linux */
+
+/*
+ * tmpfs has no backing store. The contents of every file, directory and
+ * symlink live in page cache pages which are indexed by (dev, inode, offset)
+ * and never reclaimed, and the on-disk inodes are kept in an inode table
+ * made of pages that are allocated on demand.
+ *
+ * +---------+    +--------------+
+ * | itable -+--> | inode 1..N   |  (TMPFS_INODES_PER_PAGE inodes per page)
+ * |         |    +--------------+
+ * |         |    | inode N+1..  |
+ * +---------+    +--------------+
+ */
+
+#define TMPFS_INODES_PER_PAGE	(PAGE_SIZE / sizeof(struct tmpfs_inode))
+#define TMPFS_ITABLE_PAGES	(PAGE_SIZE / sizeof(struct tmpfs_inode *))
+#define TMPFS_MAX_INODES	(TMPFS_ITABLE_PAGES * TMPFS_INODES_PER_PAGE)
+
+#define TMPFS_DIR_ENTRY_LEN(name_len)	((8 + (name_len) + 3) & ~3)
+
+struct tmpfs_inode {
+	__u16 i_mode;
+	__u16 i_nlink;
+	__u32 i_uid;
+	__u32 i_gid;
+	__u32 i_size;
+	__u32 i_atime;
+	__u32 i_ctime;
+	__u32 i_mtime;
+	__u32 i_blocks;			/* in 512 bytes units */
+	__u32 i_rdev;			/* device number for devices */
+};
+
+/* directory entries never cross a page boundary */
+struct tmpfs_dir_entry {
+	__u32 inode;
+	__u16 rec_len;
+	__u16 name_len;
+	char name[NAME_MAX + 1];	/* not null-terminated */
+};
+
+struct tmpfs_sb_info {
+	struct tmpfs_inode **itable;	/* pages of the inode table */
+	__u32 s_inodes_count;		/* max. number of inodes */
+	__u32 s_free_inodes_count;
+	__u32 s_pages_count;		/* max. number of data pages */
+	__u32 s_free_pages_count;
+	__u32 s_last_ino;		/* last inode allocated */
+	__u16 s_mode;			/* permissions of the root directory */
+	__u32 s_uid;			/* owner of the root directory */
+	__u32 s_gid;
+};
+
+#endif /* _FIWIX_FS_TMPFS_H */
+
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,46 @@
+/*
+ * fiwix/include/fiwix/futex.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_FUTEX_H
+#define _FIWIX_FUTEX_H
+
+#include <fiwix/time.h>
+
+#define FUTEX_WAIT		0
+#define FUTEX_WAKE		1
+#define FUTEX_FD		2
+#define FUTEX_REQUEUE		3
+#define FUTEX_CMP_REQUEUE	4
+
+#define FUTEX_PRIVATE_FLAG	128
+#define FUTEX_CLOCK_REALTIME	256
+#define FUTEX_CMD_MASK		~(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME)
+
+/*
+ * A futex in a shared mapping (MAP_SHARED or shm) is identified by its page
+ * frame and the offset in it, so that all processes find the same waiters.
+ * A futex in a private mapping is identified by the address space and the
+ * user address, as its page frame might change on a copy-on-write fault.
+ */
+struct futex_key {
+	unsigned int object;	/* page (kernel address) or struct mm */
+	unsigned int offset;	/* offset in the page or user address */
+};
+
+struct futex_q {
+	struct futex_key key;
+	struct proc *p;
+	int woken;
+	struct futex_q *prev;
+	struct futex_q *next;
+};
+
+int futex_wait(int *, int, const struct timespec *);
+int futex_wake(int *, int);
+int futex_requeue(int *, int, int, int *, int, int);
+
+#endif /* _FIWIX_FUTEX_H */
@@ -0,0 +1,46 @@
+/*
+ * fiwix/include/fiwix/hrtimer.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_HRTIMER_H
+#define _FIWIX_HRTIMER_H
+
+#include <fiwix/config.h>
+#include <fiwix/time.h>
+
+#ifdef CONFIG_HRTIMERS
+
+#define HRTIMER_MIN_DELTA	20	/* min. one-shot interval (in usecs) */
+#define HRTIMER_MAX_DELTA	50000	/* max. one-shot interval (in usecs) */
+
+struct hrtimer {
+	unsigned long long int expires;	/* in TSC cycles */
+	void (*fn)(unsigned int);
+	unsigned int arg;
+	struct hrtimer *next;
+};
+
+/* clock-event device */
+struct clockevent {
+	void (*set_periodic)(void);
+	void (*set_oneshot)(unsigned int);	/* usecs */
+};
+
+extern int hrtimers_enabled;
+
+unsigned long long int tv2usecs(const struct timeval *);
+void usecs2tv(unsigned long long int, struct timeval *);
+void hrtimer_start(struct hrtimer *, unsigned long long int);
+unsigned long long int hrtimer_remaining(struct hrtimer *);
+int hrtimer_cancel(struct hrtimer *);
+void hrtimer_timeout(unsigned int);
+int hrtimer_interrupt(void);
+int hrtimer_offset(void);
+int hrtimer_init(void);
+
+#endif /* CONFIG_HRTIMERS */
+
+#endif /* _FIWIX_HRTIMER_H */
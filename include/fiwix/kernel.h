@@ -74,6 +74,8 @@ struct kernel_stat {
 	unsigned int irqs;		/* irq counter */
 	unsigned int sirqs;		/* spurious irq counter */
 	unsigned int ctxt;		/* context switches */
+	unsigned int tlb_flushes;	/* full TLB flushes (CR3 reloads) */
+	unsigned int tlb_page_flushes;	/* single-page TLB flushes (INVLPG) */
 	unsigned int ticks;		/* ticks (1/HZths of sec) since boot */
 	unsigned int system_time;	/* current system time (since the Epoch) */
 	unsigned int boot_time;		/* boot time (since the Epoch) */
@@ -0,0 +1,28 @@
+/*
+ * fiwix/include/fiwix/latency.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_LATENCY_H
+#define _FIWIX_LATENCY_H
+
+#include <fiwix/config.h>
+
+#ifdef CONFIG_LATENCY_TEST
+
+#define LATENCY_BUCKETS	1000	/* 1us per bucket, the last one holds the rest */
+
+struct latency_stats {
+	unsigned int samples;		/* number of wakeups measured */
+	unsigned int max;		/* worst latency seen (in us) */
+	unsigned int hist[LATENCY_BUCKETS];
+};
+extern struct latency_stats latency_stats;
+
+int klatencyd(void);
+
+#endif /* CONFIG_LATENCY_TEST */
+
+#endif /* _FIWIX_LATENCY_H */
@@ -0,0 +1,13 @@
+/*
+ * fiwix/include/fiwix/lz4.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_LZ4_H
+#define _FIWIX_LZ4_H
+
+int lz4_decompress(const char *, int, char *, int);
+
+#endif /* _FIWIX_LZ4_H */
@@ -24,6 +24,11 @@
 #define PT_ENTRIES		(PAGE_SIZE / sizeof(unsigned int))
 #define PD_ENTRIES		(PAGE_SIZE / sizeof(unsigned int))
 
+#define HPAGE_SIZE		0x400000	/* 4MB (PSE) */
+#define HPAGE_MASK		~(HPAGE_SIZE - 1)	/* 0xFFC00000 */
+#define HPAGE_ALIGN(addr)	(((addr) + (HPAGE_SIZE - 1)) & HPAGE_MASK)
+#define HPAGE_PAGES		(HPAGE_SIZE / PAGE_SIZE)
+
 #define PAGE_LOCKED		0x001
 #define PAGE_BUDDYLOW		0x010	/* page belongs to buddy_low */
 #define PAGE_RESERVED		0x100	/* kernel, BIOS address, ... */
@@ -58,6 +63,8 @@ extern unsigned int page_table_size;		/* size in bytes */
 extern unsigned int page_hash_table_size;	/* size in bytes */
 
 extern unsigned int *kpage_dir;
+extern int pse_enabled;
+extern int pge_enabled;
 
 
 /* buddy_low.c */
@@ -90,12 +97,17 @@ void kfree(unsigned int);
 void page_lock(struct page *);
 void page_unlock(struct page *);
 struct page *get_free_page(void);
+struct page *get_free_huge_page(void);
 struct page *search_page_hash(struct inode *, __off_t);
 void release_page(struct page *);
 int is_valid_page(int);
 void invalidate_inode_pages(struct inode *);
+void add_to_page_cache(struct page *, struct inode *, __off_t);
+void remove_from_page_cache(struct page *);
 void update_page_cache(struct inode *, __off_t, const char *, int);
 int write_page(struct page *, struct inode *, __off_t, unsigned int);
+void read_ahead_pages(struct inode *, __off_t, unsigned int);
+int kernel_read(struct inode *, __off_t, char *, unsigned int);
 int bread_page(struct page *, struct inode *, __off_t, char, char);
 int file_read(struct inode *, struct fd *, char *, __size_t);
 void reserve_pages(unsigned int, unsigned int);
@@ -106,11 +118,17 @@ unsigned int map_kaddr(unsigned int *,unsigned int, unsigned int, unsigned int,
 void bss_init(void);
 unsigned int setup_tmp_pgdir(unsigned int, unsigned int);
 unsigned int get_mapped_addr(struct proc *, unsigned int);
+struct page *get_user_page(unsigned int, int);
 int clone_pages(struct proc *);
 int free_page_tables(struct proc *);
 unsigned int map_page(struct proc *, unsigned int, unsigned int, unsigned int);
 unsigned int map_page_flags(struct proc *, unsigned int, unsigned int, unsigned int, int);
+unsigned int map_huge_page(struct proc *, unsigned int, unsigned int, unsigned int);
+unsigned int *split_huge_page(struct proc *, unsigned int *, int);
 int unmap_page(unsigned int);
+void flush_tlb(void);
+void flush_tlb_page(unsigned int);
+void flush_tlb_range(unsigned int, unsigned int);
 void mem_init(void);
 void mem_stats(void);
 
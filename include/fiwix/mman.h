@@ -25,6 +25,7 @@
 #define MAP_DENYWRITE	0x0800		/* -ETXTBSY */
 #define MAP_EXECUTABLE	0x1000		/* mark it as a executable */
 #define MAP_LOCKED	0x2000		/* pages are locked */
+#define MAP_HUGETLB	0x40000		/* use 4MB pages if possible */
 
 #define ZERO_PAGE	0x80000000	/* this page must be zero-filled */
 
@@ -36,6 +37,15 @@
 #define MCL_CURRENT	1	/* lock all current mappings */
 #define MCL_FUTURE	2	/* lock all future mappings */
 
+#define MADV_NORMAL	0	/* no special treatment */
+#define MADV_RANDOM	1	/* expect random page references */
+#define MADV_SEQUENTIAL	2	/* expect sequential page references */
+#define MADV_WILLNEED	3	/* will need these pages */
+#define MADV_DONTNEED	4	/* don't need these pages */
+
+#define MREMAP_MAYMOVE	1	/* the mapping can be moved */
+#define MREMAP_FIXED	2	/* move it to the address given */
+
 #define P_TEXT		1	/* text section */
 #define P_DATA		2	/* data section */
 #define P_BSS		3	/* BSS section */
@@ -43,6 +53,7 @@
 #define P_STACK		5	/* stack section */
 #define P_MMAP		6	/* mmap() section */
 #define P_SHM		7	/* shared memory section */
+#define P_VSYSCALL	8	/* vsyscall page */
 
 /* compatibility flags */
 #define MAP_ANON	MAP_ANONYMOUS
@@ -67,5 +78,9 @@ unsigned int get_unmapped_vma_region(unsigned int);
 int do_mmap(struct inode *, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, char, char, void *);
 int do_munmap(unsigned int, __size_t);
 int do_mprotect(struct vma *, unsigned int, __size_t, int);
+int do_madvise(unsigned int, __size_t, int);
+int do_mremap(unsigned int, __size_t, __size_t, int, unsigned int);
+int sync_mapped_pages(struct proc *, unsigned int, unsigned int);
+int kmsyncd(void);
 
 #endif /* _FIWIX_MMAN_H */
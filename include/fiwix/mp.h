@@ -0,0 +1,140 @@
+/*
+ * fiwix/include/fiwix/mp.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_MP_H
+#define _FIWIX_MP_H
+
+#include <fiwix/config.h>
+
+#ifdef CONFIG_APIC
+
+#include <fiwix/types.h>
+
+#define NR_IOAPICS		4	/* max. number of I/O APICs */
+#define NR_MP_BUSES		32	/* max. number of buses in the MP table */
+#define NR_MP_INTS		64	/* max. number of I/O interrupt entries */
+
+#define MP_FLOAT_SIGNATURE	0x5F504D5F	/* "_MP_" */
+#define MP_CONFIG_SIGNATURE	0x504D4350	/* "PCMP" */
+
+/* MP configuration table entry types */
+#define MP_PROCESSOR		0
+#define MP_BUS			1
+#define MP_IOAPIC		2
+#define MP_IOINTERRUPT		3
+#define MP_LOCALINTERRUPT	4
+
+#define MP_CPU_ENABLED		0x01
+#define MP_CPU_BSP		0x02
+#define MP_IOAPIC_ENABLED	0x01
+#define MP_IMCR_PRESENT		0x80	/* feature2: IMCR (PIC mode) present */
+
+/* I/O interrupt types */
+#define MP_INT			0	/* vectored interrupt */
+
+/* I/O interrupt flags (polarity and trigger mode) */
+#define MP_POLARITY_MASK	0x03
+#define MP_POLARITY_LOW		0x03
+#define MP_TRIGGER_MASK		0x0C
+#define MP_TRIGGER_LEVEL	0x0C
+
+/* bus types */
+#define MP_BUS_OTHER		0
+#define MP_BUS_ISA		1
+#define MP_BUS_PCI		2
+
+/* flags for cpu_info */
+#define CPU_IS_BSP		0x01	/* Bootstrap Processor */
+#define CPU_IS_ONLINE		0x02	/* AP has finished its startup */
+
+/* MP Floating Pointer Structure (Intel MultiProcessor Specification v1.4) */
+struct mp_floating {
+	__u32 signature;
+	__u32 config_addr;	/* physical address of the MP config table */
+	__u8 length;		/* in 16 byte units */
+	__u8 spec_rev;
+	__u8 checksum;
+	__u8 feature1;		/* default configuration type (if not zero) */
+	__u8 feature2;
+	__u8 feature3[3];
+} __attribute__((packed));
+
+struct mp_config {
+	__u32 signature;
+	__u16 length;
+	__u8 spec_rev;
+	__u8 checksum;
+	char oem_id[8];
+	char product_id[12];
+	__u32 oem_table;
+	__u16 oem_table_size;
+	__u16 entries;
+	__u32 lapic_addr;
+	__u16 ext_length;
+	__u8 ext_checksum;
+	__u8 reserved;
+} __attribute__((packed));
+
+struct mp_processor {
+	__u8 type;
+	__u8 lapic_id;
+	__u8 lapic_ver;
+	__u8 cpu_flags;
+	__u32 signature;
+	__u32 features;
+	__u32 reserved[2];
+} __attribute__((packed));
+
+struct mp_bus {
+	__u8 type;
+	__u8 bus_id;
+	char bus_type[6];
+} __attribute__((packed));
+
+struct mp_ioapic {
+	__u8 type;
+	__u8 ioapic_id;
+	__u8 ioapic_ver;
+	__u8 flags;
+	__u32 addr;
+} __attribute__((packed));
+
+struct mp_iointerrupt {
+	__u8 type;
+	__u8 int_type;
+	__u16 flags;
+	__u8 src_bus;
+	__u8 src_irq;		/* ISA: IRQ, PCI: device << 2 | INTx# */
+	__u8 dst_ioapic;
+	__u8 dst_pin;
+} __attribute__((packed));
+
+struct cpu_info {
+	int lapic_id;
+	int flags;
+};
+
+struct ioapic_info {
+	int id;
+	unsigned int addr;	/* physical address of its registers */
+};
+
+extern struct mp_floating *mp_floating;
+extern unsigned int mp_lapic_addr;
+extern struct cpu_info cpu_info[NR_CPUS];
+extern int mp_nr_cpus;
+extern struct ioapic_info ioapic_info[NR_IOAPICS];
+extern int mp_nr_ioapics;
+extern char mp_bus_type[NR_MP_BUSES];
+extern struct mp_iointerrupt mp_ints[NR_MP_INTS];
+extern int mp_nr_ints;
+
+int mp_init(void);
+
+#endif /* CONFIG_APIC */
+
+#endif /* _FIWIX_MP_H */
@@ -22,6 +22,8 @@
 #define MSG_STAT	11
 #define MSG_INFO	12
 
+#define MSG_HASH_SIZE	256		/* buckets in the message type index */
+
 struct msqid_ds {
 	struct ipc_perm msg_perm;	/* access permissions */
 	struct msg *msg_first;		/* ptr to the first message in queue */
@@ -29,8 +31,8 @@ struct msqid_ds {
 	__time_t msg_stime;		/* time of the last msgsnd() */
 	__time_t msg_rtime;		/* time of the last msgrcv() */
 	__time_t msg_ctime;		/* time of the last change */
-	unsigned int unused1;
-	unsigned int unused2;
+	unsigned int msg_mbytes;	/* memory used by the message texts */
+	unsigned int msg_ntypes;	/* number of different types in queue */
 	unsigned short int msg_cbytes;	/* number of bytes in queue */
 	unsigned short int msg_qnum;	/* number of messages in queue */
 	unsigned short int msg_qbytes;	/* max. number of bytes in queue */
@@ -52,17 +54,29 @@ struct msginfo {
 	int msgmnb;			/* MSGMNB */
 	int msgmni;			/* MSGMNI */
 	int msgssz;
-	int msgtql;			/* MSGTQL */
+	int msgtql;			/* MSGTQL or memory used (MSG_INFO) */
 	unsigned short int msgseg;
 };
 
 /* one msg structure for each message */
 struct msg {
 	struct msg *msg_next;		/* next message on queue */
+	struct msg *msg_prev;		/* previous message on queue */
+	struct msg *msg_tnext;		/* next message of the same type */
 	int msg_type;
 	char *msg_spot;			/* message text address */
 	__time_t msg_stime;		/* msgsnd time */
 	short int msg_ts;		/* message text size */
+	short int msg_as;		/* message text allocated size */
+};
+
+/* one msg_type structure for each message type present in a queue */
+struct msg_type {
+	struct msqid_ds *mq;
+	int type;
+	struct msg *first;		/* oldest message of this type */
+	struct msg *last;		/* newest message of this type */
+	struct msg_type *next;		/* next in hash bucket */
 };
 
 extern struct msqid_ds *msgque[];
@@ -76,6 +90,11 @@ struct msqid_ds *msg_get_new_mq(void);
 void msg_release_mq(struct msqid_ds *);
 struct msg *msg_get_new_md(void);
 void msg_release_md(struct msg *);
+int msg_alloc_text(struct msg *, int);
+void msg_free_text(struct msg *);
+void msg_enqueue(struct msqid_ds *, struct msg *);
+void msg_dequeue(struct msqid_ds *, struct msg *);
+struct msg *msg_find(struct msqid_ds *, int, int);
 int sys_msgsnd(int, const void *, __size_t, int);
 int sys_msgrcv(int, void *, __size_t, int, int);
 int sys_msgget(key_t, int);
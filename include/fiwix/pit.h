@@ -40,12 +40,14 @@
 
 #define ENABLE_TMR2G	0x01	/* timer 2 gate to speaker enable */
 #define ENABLE_SDATA	0x02	/* speaker data enable */
+#define TMR2_OUTPUT	0x20	/* timer 2 output status (read) */
 
 #define BEEP_FREQ	900	/* 900Hz */
 
 void pit_beep_on(void);
 void pit_beep_off(unsigned int);
 int pit_getcounter0(void);
+void pit_oneshot(unsigned int);
 void pit_init(unsigned short int);
 
 #endif /* _FIWIX_PIT_H */
@@ -17,6 +17,7 @@ struct vma {
 	char s_type;		/* segment type (P_TEXT, P_DATA, ...) */
 	struct inode *inode;	/* file inode */
 	char o_mode;		/* open mode (O_RDONLY, O_RDWR, ...) */
+	char advice;		/* MADV_NORMAL, MADV_SEQUENTIAL, ... */
 	void *object;		/* generic pointer (currently only for shm) */
 	struct vma *prev;
 	struct vma *next;
@@ -30,6 +31,10 @@ struct vma {
 #include <fiwix/time.h>
 #include <fiwix/resource.h>
 #include <fiwix/tty.h>
+#include <fiwix/hrtimer.h>
+#include <fiwix/fpu.h>
+#include <fiwix/segments.h>
+#include <fiwix/smp.h>
 
 #define IDLE		0		/* PID of idle */
 #define INIT		1		/* PID of /sbin/init */
@@ -41,6 +46,9 @@ struct vma {
 #define PF_PEXEC	0x00000002	/* has performed a sys_execve() */
 #define PF_USEREAL	0x00000004	/* use real UID in permission checks */
 #define PF_NOTINTERRUPT	0x00000008	/* non-interruptible sleeping */
+#define PF_USEDFPU	0x00000010	/* has used the FPU (has an FPU state) */
+#define PF_YIELD	0x00000020	/* gives up the CPU to its equals */
+#define PF_VFORK	0x00000040	/* parent waits for its exec or exit */
 
 #define MMAP_START	0x40000000	/* mmap()s start at 1GB */
 #define IS_SUPERUSER	(current->euid == 0)
@@ -49,6 +57,7 @@ struct vma {
 
 #define PG_LEADER(p)	((p)->pid == (p)->pgid)
 #define SESS_LEADER(p)	((p)->pid == (p)->pgid && (p)->pid == (p)->sid)
+#define TG_LEADER(p)	((p)->pid == (p)->tgid)
 
 #define FOR_EACH_PROCESS(p)		p = proc_table_head->next ; while(p)
 #define FOR_EACH_PROCESS_RUNNING(p)	p = proc_run_head ; while(p)
@@ -102,9 +111,42 @@ struct i386tss {
 	unsigned char io_bitmap[IO_BITMAP_SIZE + 1];
 };
 
+/*
+ * The following structures are shared (and reference counted) by the threads
+ * created by clone() with CLONE_VM, CLONE_FILES, CLONE_FS and CLONE_SIGHAND
+ * respectively. Otherwise every process has its own copy.
+ */
+struct mm {
+	int count;			/* processes (zombies included) using it */
+	int users;			/* processes alive using it */
+	struct vma *vma_table;		/* virtual memory-map addresses */
+	unsigned int brk_lower;		/* lower limit of the heap section */
+	unsigned int brk;		/* current limit of the heap */
+	unsigned int rss;
+};
+
+struct files {
+	int count;
+	unsigned short int fd[OPEN_MAX];
+	unsigned char fd_flags[OPEN_MAX];
+};
+
+struct fs_info {
+	int count;
+	struct inode *root;
+	struct inode *pwd;		/* process working directory */
+	__mode_t umask;
+};
+
+struct sighand {
+	int count;
+	struct sigaction action[NSIG];
+};
+
 struct proc {
 	struct i386tss tss;
-	__pid_t pid;			/* process ID */
+	__pid_t pid;			/* process ID (thread ID) */
+	__pid_t tgid;			/* thread group ID (process ID) */
 	__pid_t ppid;			/* parent process ID */
 	__pid_t pgid;			/* process group ID */
 	__pid_t sid;			/* session ID */
@@ -115,6 +157,9 @@ struct proc {
 	int state;			/* process state */
 	int priority;
 	int cpu_count;			/* time of process running */
+	int policy;			/* SCHED_OTHER, SCHED_FIFO or SCHED_RR */
+	int rt_priority;		/* static priority (real-time only) */
+	unsigned int rt_ticks;		/* ticks running without sleeping */
 	__time_t start_time;
 	int exit_code;	
 	void *sleep_address;
@@ -124,10 +169,8 @@ struct proc {
 	unsigned short int egid;	/* effective group ID */
 	unsigned short int suid;	/* saved user ID */
 	unsigned short int sgid;	/* saved group ID */
-	unsigned short int fd[OPEN_MAX];
-	unsigned char fd_flags[OPEN_MAX];
-	struct inode *root;
-	struct inode *pwd;		/* process working directory */
+	struct files *files;		/* file descriptors */
+	struct fs_info *fs;		/* root and working directories */
 	unsigned int entry_address;
 	char argv0[NAME_MAX + 1];
 	int argc;
@@ -135,13 +178,11 @@ struct proc {
 	int envc;
 	char **envp;
 	char pidstr[5];			/* PID number converted to string */
-	struct vma *vma_table;		/* virtual memory-map addresses */
-	unsigned int brk_lower;		/* lower limit of the heap section */
-	unsigned int brk;		/* current limit of the heap */
+	struct mm *mm;			/* address space */
 	__sigset_t sigpending;
 	__sigset_t sigblocked;
 	__sigset_t sigexecuting;
-	struct sigaction sigaction[NSIG];
+	struct sighand *sighand;	/* signal handlers */
 	struct sigcontext sc[NSIG];	/* each signal has its own context */
 	unsigned int sp;		/* current process' stack frame */
 	struct rusage usage;		/* process resource usage */
@@ -150,9 +191,21 @@ struct proc {
 	unsigned int it_virt_interval, it_virt_value;
 	unsigned int it_prof_interval, it_prof_value;
 	unsigned int timeout;
+#ifdef CONFIG_HRTIMERS
+	struct hrtimer it_real_timer;	/* ITIMER_REAL with usecs precision */
+	unsigned long long int it_real_incr;	/* its interval (in usecs) */
+#endif /* CONFIG_HRTIMERS */
 	struct rlimit rlim[RLIM_NLIMITS];
-	unsigned int rss;
-	__mode_t umask;
+	unsigned int faults_around;	/* page faults avoided by fault-around */
+	int preempt_count;		/* saved preempt_count while switched out */
+#ifdef CONFIG_SMP
+	int cpu;			/* CPU running it (-1 if none) */
+	int lock_depth;			/* saved lock_depth while switched out */
+#endif /* CONFIG_SMP */
+	union fpu_state fpu;		/* FPU/MMX/SSE registers */
+	struct seg_desc tls;		/* TLS descriptor (set_thread_area) */
+	int *set_child_tid;		/* set by the child (CLONE_CHILD_SETTID) */
+	int *clear_child_tid;		/* cleared on exit (CLONE_CHILD_CLEARTID) */
 	unsigned char loopcnt;		/* nested symlinks counter */
 #ifdef CONFIG_SYSVIPC
 	struct sem_undo *semundo;
@@ -165,8 +218,15 @@ struct proc {
 	struct proc *next_run;
 };
 
+#ifdef CONFIG_SMP
+#define current		(smp_this_cpu()->curproc)
+#else
 extern struct proc *current;
+#endif /* CONFIG_SMP */
 extern struct proc *proc_table;
+extern struct files kernel_files;
+extern struct fs_info kernel_fs;
+extern struct sighand kernel_sighand;
 
 int can_signal(struct proc *);
 int send_sig(struct proc *, __sigset_t);
@@ -182,10 +242,23 @@ void release_proc(struct proc *);
 int get_unused_pid(void);
 struct proc *get_proc_by_pid(__pid_t);
 
+struct files *dup_files(struct files *);
+struct fs_info *dup_fs(struct fs_info *);
+struct sighand *dup_sighand(struct sighand *);
+void kill_other_threads(void);
+int live_threads(struct proc *);
+void reap_zombie_threads(void);
+int exec_unshare(void);
+
+void set_kernel_proc(struct proc *);
 struct proc *kernel_process(const char *, int (*fn)(void));
 void proc_slot_init(struct proc *);
 void proc_init(void);
 
+void fork_child_settid(void);
+void vfork_done(void);
+int do_fork(unsigned int, unsigned int, int *, struct user_desc *, int *, struct sigcontext *);
+
 int elf_load(struct inode *, struct binargs *, struct sigcontext *, char *);
 int script_load(char *, char *, char *);
 
@@ -13,9 +13,38 @@
 #define RAMDISK_MAJOR	1	/* ramdisk device major number */
 #define RAMDISK_TOTAL	10	/* total number of ramdisk drives */
 
+#define RAMDISK_LZ4_MAGIC	0x345A4452	/* "RDZ4" */
+#define RAMDISK_CHUNKS_PER_TABLE	(PAGE_SIZE / sizeof(unsigned int))
+
+/*
+ * A compressed initrd image is a set of independent LZ4 blocks (chunks) of
+ * PAGE_SIZE bytes each once decompressed, so that only the chunks being
+ * accessed need to be decompressed:
+ *
+ * +--------+--------------------------+---------+---------+-----
+ * | header | offset[0] .. offset[N]   | chunk 0 | chunk 1 | ...
+ * +--------+--------------------------+---------+---------+-----
+ *
+ * offset[n] is the position of the chunk 'n' from the beginning of the image
+ * and offset[N] marks the end of the last chunk. A chunk whose length is
+ * PAGE_SIZE is stored uncompressed.
+ */
+struct ramdisk_lz4_header {
+	__u32 magic;
+	__u32 size;		/* uncompressed size (in bytes) */
+	__u32 chunk_size;	/* must be PAGE_SIZE */
+	__u32 nr_chunks;	/* N */
+	__u32 offset[1];	/* index of chunks (N + 1 entries) */
+};
+
 struct ramdisk {
 	char *addr;		/* ramdisk memory address */
 	int size;		/* in KB */
+	struct ramdisk_lz4_header *lz4;	/* compressed image (or NULL) */
+	unsigned int *chunk_dir;	/* tables of decompressed chunks */
+	int zsize;		/* compressed size, in KB */
+	int unpacked;		/* number of chunks decompressed */
+	unsigned long long int unpack_cycles;	/* time spent decompressing */
 };
 
 extern int ramdisk_minors;	/* initrd + RAMDISK_DRIVES + kexec */
@@ -25,9 +54,11 @@ int ramdisk_open(struct inode *, struct fd *);
 int ramdisk_close(struct inode *, struct fd *);
 int ramdisk_read(__dev_t, __blk_t, char *, int);
 int ramdisk_write(__dev_t, __blk_t, char *, int);
+char *ramdisk_direct_access(__dev_t, __blk_t, int);
 int ramdisk_ioctl(struct inode *, int, unsigned int);
 __loff_t ramdisk_llseek(struct inode *, __loff_t);
 
+void ramdisk_stats(void);
 void ramdisk_init(void);
 
 #endif /* _FIWIX_RAMDISK_H */
@@ -30,8 +30,15 @@
 #define RLIMIT_NOFILE	7		/* number of open files */
 #define RLIMIT_MEMLOCK	8		/* locked-in-memory address space */
 #define RLIMIT_AS	9		/* address space limit */
+#define RLIMIT_LOCKS	10		/* file locks (not used) */
+#define RLIMIT_SIGPENDING 11		/* pending signals (not used) */
+#define RLIMIT_MSGQUEUE	12		/* POSIX message queues (not used) */
+#define RLIMIT_NICE	13		/* ceiling of the nice value (not used) */
+#define RLIMIT_RTPRIO	14		/* ceiling of the real-time priority */
+#define RLIMIT_RTTIME	15		/* CPU time (usecs) of a real-time
+					   process without sleeping */
 
-#define RLIM_NLIMITS	10
+#define RLIM_NLIMITS	16
 
 struct rusage {
 	struct timeval ru_utime;	/* total amount of user time used */
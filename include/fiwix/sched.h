@@ -23,9 +23,42 @@
 #define PROC_INTERRUPTIBLE	1
 #define PROC_UNINTERRUPTIBLE	2
 
+/* clone() flags */
+#define CSIGNAL			0x000000FF	/* signal sent at exit */
+#define CLONE_VM		0x00000100	/* share the address space */
+#define CLONE_FS		0x00000200	/* share root, cwd and umask */
+#define CLONE_FILES		0x00000400	/* share the file descriptors */
+#define CLONE_SIGHAND		0x00000800	/* share the signal handlers */
+#define CLONE_VFORK		0x00004000	/* parent waits for exec or exit */
+#define CLONE_PARENT		0x00008000
+#define CLONE_THREAD		0x00010000	/* same thread group */
+#define CLONE_SETTLS		0x00080000	/* set the TLS descriptor */
+#define CLONE_PARENT_SETTID	0x00100000	/* store TID in the parent */
+#define CLONE_CHILD_CLEARTID	0x00200000	/* clear TID in the child at exit */
+#define CLONE_DETACHED		0x00400000
+#define CLONE_CHILD_SETTID	0x01000000	/* store TID in the child */
+
 #define DEF_PRIORITY	(20 * HZ / 100)	/* 200ms of time slice */
 
+/* scheduling policies */
+#define SCHED_OTHER	0		/* time-sharing (round robin) */
+#define SCHED_FIFO	1		/* real-time, runs until it blocks */
+#define SCHED_RR	2		/* real-time, with a time slice */
+
+#define MAX_RT_PRIO	99		/* static priorities 1-99 (real-time) */
+
+#define RT_POLICY(p)	((p)->policy != SCHED_OTHER)
+
+struct sched_param {
+	int sched_priority;
+};
+
+#ifdef CONFIG_SMP
+#define need_resched	(smp_this_cpu()->resched)
+#else
 extern int need_resched;
+#endif /* CONFIG_SMP */
+extern int preempt_count;
 
 #define SI_LOAD_SHIFT   16
 
@@ -49,7 +82,10 @@ extern unsigned int avenrun[3];		/* Load averages */
 
 
 void do_sched(void);
+void cond_resched(void);
+void preempt_irq(void);
 void set_tss(struct proc *);
+int set_scheduler(struct proc *, int, int);
 void sched_init(void);
 
 #endif /* _FIWIX_SCHED_H */
@@ -15,6 +15,7 @@
 #define USER_CS		0x18	/* user code segment */
 #define USER_DS		0x20	/* user data segment */
 #define TSS		0x28	/* TSS segment */
+#define TLS		0x30	/* TLS segment (set_thread_area) */
 
 #define USER_PL		0x03	/* User Privilege Level 3 */
 
@@ -22,13 +23,18 @@
 #define PAGE_PRESENT	0x001	/* Present */
 #define PAGE_RW		0x002	/* Read/Write */
 #define PAGE_USER	0x004	/* User */
+#define PAGE_PCD	0x010	/* Page-level Cache Disable */
+#define PAGE_ACCESSED	0x020	/* Accessed */
+#define PAGE_DIRTY	0x040	/* Dirty (written since it was cleared) */
+#define PAGE_PSE	0x080	/* 4MB Page Size (PDE only) */
+#define PAGE_GLOBAL	0x100	/* Global (not flushed when CR3 is loaded) */
 #define PAGE_NOALLOC	0x200	/* No Page Allocated (OS managed) */
 
 #ifndef ASM_FILE
 
 #include <fiwix/types.h>
 
-#define NR_GDT_ENTRIES	6	/* entries in GDT descriptor */
+#define NR_GDT_ENTRIES	7	/* entries in GDT descriptor */
 #define NR_IDT_ENTRIES	256	/* entries in IDT descriptor */
 
 /* low flags of Segment Descriptors */
@@ -67,6 +73,19 @@ struct seg_desc {
 	unsigned sd_hibase  :  8;	/* base address 24-31 bits */
 } __attribute__((packed));
 
+/* set_thread_area() and get_thread_area() */
+struct user_desc {
+	unsigned int entry_number;
+	unsigned int base_addr;
+	unsigned int limit;
+	unsigned int seg_32bit:1;
+	unsigned int contents:2;
+	unsigned int read_exec_only:1;
+	unsigned int limit_in_pages:1;
+	unsigned int seg_not_present:1;
+	unsigned int useable:1;
+};
+
 struct gate_desc {
 	unsigned gd_looffset: 16;	/* offset 0-15 bits */
 	unsigned gd_selector: 16;	/* segment selector */
@@ -74,6 +93,7 @@ struct gate_desc {
 	unsigned gd_hioffset: 16;	/* offset 16-31 bits */
 } __attribute__((packed));
 
+int set_tls_desc(struct seg_desc *, struct user_desc *);
 void gdt_init(void);
 void idt_init(void);
 
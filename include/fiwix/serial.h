@@ -54,6 +54,9 @@
 #define UART_FCR_CXMTR	0x04	/* clear transmitter */
 #define UART_FCR_DMA	0x08	/* DMA mode select */
 #define UART_FCR_FIFO64	0x20	/* enable 64 byte FIFO (16750 only) */
+#define UART_FCR_FIFO1	0x00	/* set to 1 byte 'trigger level' FIFO */
+#define UART_FCR_FIFO4	0x40	/* set to 4 bytes 'trigger level' FIFO */
+#define UART_FCR_FIFO8	0x80	/* set to 8 bytes 'trigger level' FIFO */
 #define UART_FCR_FIFO14	0xC0	/* set to 14 bytes 'trigger level' FIFO */
 
 /* Line Control Register */
@@ -86,6 +89,7 @@
 
 
 #define UART_FIFO_SIZE	16	/* 16 bytes */
+#define UART_BAUD_BASE	115200	/* 1.8432 MHz crystal / 16 */
 #define UART_HAS_FIFO	0x02	/* has FIFO working */
 #define UART_IS_8250	0x04	/* is a 8250 chip */
 #define UART_IS_16450	0x08	/* is a 16450 chip */
@@ -94,6 +98,46 @@
 
 #define UART_ACTIVE	0x80
 
+#define SERIAL_FLIP_SIZE	1024	/* size of each receive flip buffer */
+
+/* flags for TIOCGSERIAL and TIOCSSERIAL (same as in Linux) */
+#define ASYNC_SPD_HI	0x0010	/* use 57600 instead of 38400 bps */
+#define ASYNC_SPD_VHI	0x0020	/* use 115200 instead of 38400 bps */
+#define ASYNC_SPD_CUST	0x0030	/* use custom_divisor instead of 38400 bps */
+#define ASYNC_SPD_SHI	0x1000	/* use 230400 instead of 38400 bps */
+#define ASYNC_SPD_WARP	0x1010	/* use 460800 instead of 38400 bps */
+#define ASYNC_SPD_MASK	0x1030
+
+struct serial_struct {
+	int type;
+	int line;
+	unsigned int port;
+	int irq;
+	int flags;
+	int xmit_fifo_size;
+	int custom_divisor;
+	int baud_base;
+	unsigned short int close_delay;
+	char io_type;
+	char reserved_char[1];
+	int hub6;
+	unsigned short int closing_wait;
+	unsigned short int closing_wait2;
+	unsigned char *iomem_base;
+	unsigned short int iomem_reg_shift;
+	unsigned int port_high;
+	unsigned int iomap_base;
+};
+
+/* per-port counters, also returned by TIOCGICOUNT */
+struct serial_icounter_struct {
+	int cts, dsr, rng, dcd;
+	int rx, tx;
+	int frame, overrun, parity, brk;
+	int buf_overrun;
+	int reserved[9];
+};
+
 struct serial {
 	unsigned short int ioaddr;	/* port I/O address */
 	int iosize;
@@ -102,9 +146,28 @@ struct serial {
 	char *name;
 	short int lctrl;	/* line control flags (8N1, 7E2, ...) */
 	int flags;
+	int type;		/* UART chip type */
+	int baud_base;		/* UART input clock / 16 */
+	int custom_divisor;
+	int spd_flags;		/* ASYNC_SPD_* flags */
+	int xmit_fifo_size;	/* bytes written per THRE interrupt */
+	unsigned char fcr;	/* FIFO trigger level */
 	struct tty *tty;
+
+	/*
+	 * The interrupt handler fills flip_buf[flip_cur] while the bottom
+	 * half drains the other one into the tty read queue.
+	 */
+	int flip_cur;
+	int flip_count[2];
+	int flip_off;		/* drain offset in the other flip buffer */
+	unsigned char flip_buf[2][SERIAL_FLIP_SIZE];
+	struct serial_icounter_struct icount;
+
 	struct serial *next;
 };
+extern struct serial *serial_active;
+extern char *serial_chip[];
 
 int serial_open(struct tty *);
 int serial_close(struct tty *);
@@ -24,6 +24,7 @@ struct resource {
 
 void runnable(struct proc *);
 void not_runnable(struct proc *, int);
+void yield_cpu(struct proc *);
 int sleep(void *, int);
 void wakeup(void *);
 void wakeup_proc(struct proc *);
@@ -0,0 +1,74 @@
+/*
+ * fiwix/include/fiwix/smp.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_SMP_H
+#define _FIWIX_SMP_H
+
+#include <fiwix/config.h>
+
+#ifdef CONFIG_SMP
+
+#define SMP_BOOT_ADDR	0x9C000		/* AP trampoline (below KEXEC_BOOT_ADDR) */
+
+/* Inter-Processor Interrupts and the Local APIC timer of the APs */
+#define RESCHED_VECTOR		0xE0	/* run do_sched() */
+#define SMP_TIMER_VECTOR	0xE1	/* tick of the APs */
+#define TLB_VECTOR		0xF1	/* flush the TLB (never waits the lock) */
+
+#ifndef ASM_FILE
+
+#include <fiwix/segments.h>
+#include <fiwix/sigcontext.h>
+
+struct proc;
+
+/*
+ * Every CPU loads its own copy of the GDT, which is the first field of its
+ * smp_cpu structure. So the base address of the GDTR is also the address of
+ * the per-CPU data of the CPU running the code (see smp_this_cpu()).
+ */
+struct smp_cpu {
+	struct seg_desc gdt[NR_GDT_ENTRIES];
+	struct desc_r gdtr;
+	int id;				/* index in smp_cpus[] */
+	int lapic_id;
+	int online;
+	struct proc *curproc;		/* process running in this CPU */
+	struct proc *idle;		/* IDLE process of this CPU */
+	struct proc *fpu_proc;		/* owner of the FPU of this CPU */
+	int resched;			/* need_resched of this CPU */
+	int lock_depth;			/* nested lock_kernel() calls */
+};
+
+extern struct smp_cpu smp_cpus[NR_CPUS];
+extern int smp_nr_cpus;
+
+#define CURRENT_GDT	(smp_this_cpu()->gdt)
+
+void gdt_copy(struct smp_cpu *);
+struct smp_cpu *smp_this_cpu(void);
+void lock_kernel(void);
+void unlock_kernel(void);
+void smp_flush_tlb(void);
+void smp_drop_pgdir(unsigned int);
+void smp_kick(struct proc *);
+void smp_wakeup_idle(void);
+void smp_resched_interrupt(struct sigcontext);
+void smp_timer_interrupt(struct sigcontext);
+void smp_tlb_interrupt(void);
+void smp_ap_main(void);
+void smp_init(void);
+
+#endif /* ASM_FILE */
+
+#else
+
+#define CURRENT_GDT	gdt
+
+#endif /* CONFIG_SMP */
+
+#endif /* _FIWIX_SMP_H */
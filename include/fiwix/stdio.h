@@ -9,9 +9,11 @@
 #define _INCLUDE_STDIO_H
 
 #include <fiwix/tty.h>
+#include <fiwix/stdarg.h>
 
 void flush_log_buf(struct tty *);
 void printk(const char *, ...);
 int sprintk(char *, const char *, ...);
+int vsprintk(char *, const char *, va_list);
 
 #endif /* _INCLUDE_STDIO_H */
@@ -24,6 +24,9 @@
 #include <fiwix/sigcontext.h>
 #include <fiwix/mman.h>
 #include <fiwix/ipc.h>
+#include <fiwix/segments.h>
+#include <fiwix/sched.h>
+#include <fiwix/aio.h>
 
 #define NR_SYSCALLS	(sizeof(syscall_table) / sizeof(unsigned int))
 
@@ -35,6 +38,7 @@ int do_syscall(unsigned int, int, int, int, int, int, struct sigcontext);
 
 int sys_exit(int);
 void do_exit(int);
+void do_group_exit(int);
 #ifdef CONFIG_SYSCALL_6TH_ARG
 int sys_fork(int, int, int, int, int, int, struct sigcontext *);
 #else
@@ -150,6 +154,11 @@ int sys_sigreturn(unsigned int, int, int, int, int, int, struct sigcontext *);
 #else
 int sys_sigreturn(unsigned int, int, int, int, int, struct sigcontext *);
 #endif /* CONFIG_SYSCALL_6TH_ARG */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_clone(unsigned int, unsigned int, int *, struct user_desc *, int *, int, struct sigcontext *);
+#else
+int sys_clone(unsigned int, unsigned int, int *, struct user_desc *, int *, struct sigcontext *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
 int sys_setdomainname(const char *, int);
 int sys_newuname(struct new_utsname *);
 int sys_mprotect(unsigned int, __size_t, int);
@@ -163,11 +172,21 @@ int sys_llseek(unsigned int, unsigned int, unsigned int, __loff_t *, unsigned in
 int sys_getdents(unsigned int, struct dirent *, unsigned int);
 int sys_select(int, fd_set *, fd_set *, fd_set *, struct timeval *);
 int sys_flock(unsigned int, int);
+int sys_msync(unsigned int, __size_t, int);
 int sys_readv(int, struct iovec *, int);
 int sys_writev(int, struct iovec *, int);
 int sys_getsid(__pid_t);
 int sys_fdatasync(int);
+int sys_sched_setparam(__pid_t, const struct sched_param *);
+int sys_sched_getparam(__pid_t, struct sched_param *);
+int sys_sched_setscheduler(__pid_t, int, const struct sched_param *);
+int sys_sched_getscheduler(__pid_t);
+int sys_sched_yield(void);
+int sys_sched_get_priority_max(int);
+int sys_sched_get_priority_min(int);
+int sys_sched_rr_get_interval(__pid_t, struct timespec *);
 int sys_nanosleep(const struct timespec *, struct timespec *);
+int sys_mremap(unsigned int, __size_t, __size_t, int, unsigned int);
 int sys_chown(const char *, __uid_t, __gid_t);
 int sys_getcwd(char *, __size_t);
 #ifdef CONFIG_MMAP2
@@ -179,8 +198,24 @@ int sys_stat64(const char *, struct stat64 *);
 int sys_lstat64(const char *, struct stat64 *);
 int sys_fstat64(unsigned int, struct stat64 *);
 int sys_chown32(const char *, unsigned int, unsigned int);
+int sys_madvise(unsigned int, __size_t, int);
 int sys_getdents64(unsigned int, struct dirent64 *, unsigned int);
 int sys_fcntl64(unsigned int, int, unsigned int);
+int sys_gettid(void);
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_futex(int *, int, int, const struct timespec *, int *, int);
+#else
+int sys_futex(int *, int, int, const struct timespec *, int *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+int sys_set_thread_area(struct user_desc *);
+int sys_get_thread_area(struct user_desc *);
+int sys_io_setup(unsigned int, aio_context_t *);
+int sys_io_destroy(aio_context_t);
+int sys_io_getevents(aio_context_t, int, int, struct io_event *, const struct timespec *);
+int sys_io_submit(aio_context_t, int, struct iocb **);
+int sys_io_cancel(aio_context_t, struct iocb *, struct io_event *);
+int sys_exit_group(int);
+int sys_set_tid_address(int *);
 int sys_utimes(const char *, struct timeval times[2]);
 
 #endif /* _FIWIX_SYSCALLS_H */
@@ -8,9 +8,6 @@
 #ifndef _FIWIX_TIMER_H
 #define _FIWIX_TIMER_H
 
-#include <fiwix/types.h>
-#include <fiwix/sigcontext.h>
-
 #define TIMER_IRQ	0
 #define HZ		100	/* kernel's Hertz rate (100 = 10ms) */
 #define TICK		(1000000 / HZ)
@@ -26,6 +23,11 @@
 
 #define INFINITE_WAIT	0xFFFFFFFF
 
+#ifndef ASM_FILE
+
+#include <fiwix/types.h>
+#include <fiwix/sigcontext.h>
+
 struct callout {
 	int expires;
 	void (*fn)(unsigned int);
@@ -41,6 +43,7 @@ struct callout_req {
 void add_callout(struct callout_req *, unsigned int);
 void del_callout(struct callout_req *);
 void irq_timer(int, struct sigcontext *);
+void update_process_times(struct sigcontext *);
 void irq_timer_bh(struct sigcontext *);
 void do_callouts_bh(struct sigcontext *);
 void get_system_time(void);
@@ -48,4 +51,6 @@ void set_system_time(__time_t);
 int gettimeoffset(void);
 void timer_init(void);
 
+#endif /* ! ASM_FILE */
+
 #endif /* _FIWIX_TIMER_H */
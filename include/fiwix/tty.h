@@ -72,6 +72,7 @@ struct tty {
 	int (*open)(struct tty *);
 	int (*close)(struct tty *);
 	void (*set_termios)(struct tty *);
+	int (*ioctl)(struct tty *, int, unsigned int);
 };
 extern struct tty tty_table[];
 
@@ -91,6 +92,7 @@ int tty_select(struct inode *, int);
 void tty_init(void);
 
 int tty_queue_putchar(struct tty *, struct clist *, unsigned char);
+int tty_queue_putbuf(struct clist *, const unsigned char *, int);
 int tty_queue_unputchar(struct clist *);
 unsigned char tty_queue_getchar(struct clist *);
 void tty_queue_flush(struct clist *);
@@ -0,0 +1,73 @@
+/*
+ * fiwix/include/fiwix/vsyscall.h
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_VSYSCALL_H
+#define _FIWIX_VSYSCALL_H
+
+#include <fiwix/config.h>
+
+#ifdef CONFIG_VSYSCALL
+
+/* the page right below MMAP_START */
+#define VSYSCALL_ADDR	0x3FFFF000	/* vsyscall page in user space */
+
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
+/* layout of the vsyscall page */
+#define VSYSCALL_ENTRY		0x000	/* system call entry (AT_SYSINFO) */
+#define VSYSCALL_GETTIMEOFDAY	0x100	/* vsyscall_gettimeofday() */
+#define VSYSCALL_TIMEFN		0x200	/* vsyscall_time() */
+#define VSYSCALL_VTIME		0x800	/* struct vtime (AT_VTIME) */
+
+/* offsets in struct vtime */
+#define VT_GETTIMEOFDAY		0x00
+#define VT_TIME			0x04
+#define VT_SEQ			0x08
+#define VT_SEC			0x0C
+#define VT_TICKS		0x10
+#define VT_TSC_LO		0x14
+#define VT_TSC_HI		0x18
+#define VT_MHZ			0x1C
+#define VT_TZ_MINUTESWEST	0x20
+#define VT_TZ_DSTTIME		0x24
+
+#ifndef ASM_FILE
+
+#include <fiwix/sigcontext.h>
+
+/*
+ * Snapshot of the system time taken on every tick, which user programs read
+ * without entering the kernel. 'seq' is odd while it's being updated, so a
+ * reader must retry if it was odd or if it changed during the read.
+ */
+struct vtime {
+	unsigned int gettimeofday;	/* address of vsyscall_gettimeofday() */
+	unsigned int time;		/* address of vsyscall_time() */
+	unsigned int seq;
+	unsigned int sec;		/* CURRENT_TIME */
+	unsigned int ticks;		/* CURRENT_TICKS */
+	unsigned int tsc_lo;		/* TSC at the last tick */
+	unsigned int tsc_hi;
+	unsigned int mhz;		/* TSC cycles per usec (0 = no TSC) */
+	int tz_minuteswest;
+	int tz_dsttime;
+};
+
+extern int sysenter_enabled;
+
+int sysenter_args(struct sigcontext *);
+void vsyscall_update_time(void);
+unsigned int vsyscall_map(void);
+void vsyscall_init(void);
+
+#endif /* ! ASM_FILE */
+
+#endif /* CONFIG_VSYSCALL */
+
+#endif /* _FIWIX_VSYSCALL_H */
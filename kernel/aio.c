@@ -0,0 +1,658 @@
+/*
+ * fiwix/kernel/aio.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/aio.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/timer.h>
+#include <fiwix/hrtimer.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/buffer.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/locks.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+/*
+ * The block device drivers do their transfers synchronously, so the requests
+ * are served by a pool of kernel threads (kaiod) that take them from a single
+ * queue and call the read() and write() methods of the file on behalf of the
+ * process. The user buffer is pinned when the request is submitted and the
+ * data is copied straight into its pages, so the process doesn't need to be
+ * around when the request completes.
+ *
+ * The completed requests are reported as events in the ring of the context,
+ * and optionally by writing a byte to a pipe or FIFO (aio_resfd), so that a
+ * process can wait for them with select() along with other descriptors.
+ */
+
+static struct aio_ctx *aio_ctx_head;
+static struct kiocb *aio_queue_head;
+static struct kiocb *aio_queue_tail;
+
+static struct aio_ctx *get_ctx(aio_context_t id)
+{
+	unsigned int flags;
+	struct aio_ctx *ctx;
+
+	SAVE_FLAGS(flags); CLI();
+	for(ctx = aio_ctx_head; ctx; ctx = ctx->next) {
+		if(ctx->id == id && ctx->mm == current->mm) {
+			ctx->users++;
+			break;
+		}
+	}
+	RESTORE_FLAGS(flags);
+	return ctx;
+}
+
+static void put_ctx(struct aio_ctx *ctx)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	ctx->users--;
+	if(ctx->dead) {
+		wakeup(ctx);
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* drops a reference to an entry of fd_table as sys_close() does */
+static void put_fd(unsigned int fd)
+{
+	struct inode *i;
+
+	if(--fd_table[fd].count) {
+		return;
+	}
+	i = fd_table[fd].inode;
+	flock_release_inode(i);
+	if(i->fsop && i->fsop->close) {
+		i->fsop->close(i, &fd_table[fd]);
+	}
+	release_fd(fd);
+	iput(i);
+}
+
+static void release_req(struct kiocb *req)
+{
+	int n;
+
+	for(n = 0; n < req->nr_pages; n++) {
+		release_page(req->pages[n]);
+	}
+	if(req->pages) {
+		kfree((unsigned int)req->pages);
+	}
+	if(req->fd) {
+		put_fd(req->fd);
+	}
+	if(req->resfd) {
+		put_fd(req->resfd);
+	}
+	kfree((unsigned int)req);
+}
+
+static int do_rw(struct kiocb *req)
+{
+	struct fd fdt;
+	struct inode *i;
+	__size_t done, size;
+	unsigned int poffset;
+	int n, errno;
+
+	/* a private copy, so the file offset of the process is left untouched */
+	fdt = fd_table[req->fd];
+	fdt.offset = req->offset;
+	i = fdt.inode;
+
+	done = 0;
+	poffset = req->poffset;
+	for(n = 0; n < req->nr_pages && done < req->count; n++) {
+		size = MIN(PAGE_SIZE - poffset, req->count - done);
+		if(req->opcode == IOCB_CMD_PREAD) {
+			errno = i->fsop->read(i, &fdt, req->pages[n]->data + poffset, size);
+		} else {
+			errno = i->fsop->write(i, &fdt, req->pages[n]->data + poffset, size);
+		}
+		if(errno < 0) {
+			return done ? done : errno;
+		}
+		done += errno;
+		if(errno < size) {
+			break;
+		}
+		poffset = 0;
+	}
+	return done;
+}
+
+static int do_request(struct kiocb *req)
+{
+	struct inode *i;
+	__dev_t dev;
+
+	switch(req->opcode) {
+		case IOCB_CMD_PREAD:
+		case IOCB_CMD_PWRITE:
+			return do_rw(req);
+		case IOCB_CMD_FSYNC:
+		case IOCB_CMD_FDSYNC:
+			i = fd_table[req->fd].inode;
+			dev = S_ISBLK(i->i_mode) ? i->rdev : i->dev;
+			sync_superblocks(dev);
+			sync_inodes(dev);
+			sync_buffers(dev);
+			return 0;
+	}
+	return 0;
+}
+
+/* writes a byte to the pipe in aio_resfd, if someone is there to read it */
+static void notify_resfd(unsigned int fd)
+{
+	struct fd fdt;
+	struct inode *i;
+	char c;
+
+	i = fd_table[fd].inode;
+	if(!i->u.pipefs.i_readers) {
+		return;
+	}
+	fdt = fd_table[fd];
+	fdt.flags |= O_NONBLOCK;
+	c = 1;
+	i->fsop->write(i, &fdt, &c, 1);
+}
+
+static void complete_req(struct kiocb *req, int res)
+{
+	unsigned int flags;
+	struct aio_ctx *ctx;
+	struct io_event *ev;
+
+	ctx = req->ctx;
+	SAVE_FLAGS(flags); CLI();
+	if(!ctx->dead) {
+		/* there is always room since nr_reqs is bounded by max_events */
+		ev = &ctx->events[(ctx->head + ctx->nr_events) % ctx->max_events];
+		ev->data = req->data;
+		ev->obj = req->obj;
+		ev->res = res;
+		ev->res2 = 0;
+		ctx->nr_events++;
+	}
+	RESTORE_FLAGS(flags);
+
+	if(req->resfd && !ctx->dead) {
+		notify_resfd(req->resfd);
+	}
+	release_req(req);
+
+	SAVE_FLAGS(flags); CLI();
+	ctx->nr_running--;
+	wakeup(ctx);
+	RESTORE_FLAGS(flags);
+}
+
+static int submit_req(struct aio_ctx *ctx, struct iocb *iocb)
+{
+	unsigned int flags, addr, fd, resfd;
+	struct kiocb *req;
+	struct inode *i;
+	int n, errno;
+
+	if((errno = check_user_area(VERIFY_READ, iocb, sizeof(struct iocb)))) {
+		return errno;
+	}
+	CHECK_UFD(iocb->aio_fildes);
+	fd = current->files->fd[iocb->aio_fildes];
+	i = fd_table[fd].inode;
+
+	switch(iocb->aio_lio_opcode) {
+		case IOCB_CMD_PREAD:
+			if((fd_table[fd].flags & O_ACCMODE) == O_WRONLY) {
+				return -EBADF;
+			}
+			if(!i->fsop || !i->fsop->read) {
+				return -EINVAL;
+			}
+			break;
+		case IOCB_CMD_PWRITE:
+			if((fd_table[fd].flags & O_ACCMODE) == O_RDONLY) {
+				return -EBADF;
+			}
+			if(!i->fsop || !i->fsop->write) {
+				return -EINVAL;
+			}
+			break;
+		case IOCB_CMD_FSYNC:
+		case IOCB_CMD_FDSYNC:
+		case IOCB_CMD_NOOP:
+			break;
+		default:
+			return -EINVAL;
+	}
+	if(!S_ISREG(i->i_mode) && !S_ISBLK(i->i_mode)) {
+		return -EINVAL;
+	}
+	if(iocb->aio_offset < 0 || iocb->aio_offset > 0x7FFFFFFF || iocb->aio_nbytes > 0x7FFFFFFF) {
+		return -EINVAL;
+	}
+
+	resfd = 0;
+	if(iocb->aio_flags & IOCB_FLAG_RESFD) {
+		CHECK_UFD(iocb->aio_resfd);
+		resfd = current->files->fd[iocb->aio_resfd];
+		if(!S_ISFIFO(fd_table[resfd].inode->i_mode)) {
+			return -EINVAL;
+		}
+		if((fd_table[resfd].flags & O_ACCMODE) == O_RDONLY) {
+			return -EBADF;
+		}
+	}
+
+	/* the slot for the event is reserved now, so completion can't fail */
+	SAVE_FLAGS(flags); CLI();
+	if(ctx->nr_reqs >= ctx->max_events) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	ctx->nr_reqs++;
+	RESTORE_FLAGS(flags);
+
+	if(!(req = (struct kiocb *)kmalloc(sizeof(struct kiocb)))) {
+		errno = -ENOMEM;
+		goto unreserve;
+	}
+	memset_b(req, 0, sizeof(struct kiocb));
+	req->ctx = ctx;
+	req->data = iocb->aio_data;
+	req->obj = (unsigned int)iocb;
+	req->opcode = iocb->aio_lio_opcode;
+	req->offset = (__off_t)iocb->aio_offset;
+
+	if(req->opcode == IOCB_CMD_PREAD || req->opcode == IOCB_CMD_PWRITE) {
+		addr = (unsigned int)iocb->aio_buf;
+		req->count = (__size_t)iocb->aio_nbytes;
+		req->poffset = addr & ~PAGE_MASK;
+		n = (req->poffset + req->count + PAGE_SIZE - 1) / PAGE_SIZE;
+		if(n > AIO_MAX_PAGES) {
+			errno = -EINVAL;
+			goto free_req;
+		}
+		if((errno = check_user_area(req->opcode == IOCB_CMD_PREAD ? VERIFY_WRITE : VERIFY_READ, (void *)addr, req->count))) {
+			goto free_req;
+		}
+		if(n) {
+			if(!(req->pages = (struct page **)kmalloc(n * sizeof(struct page *)))) {
+				errno = -ENOMEM;
+				goto free_req;
+			}
+		}
+		addr &= PAGE_MASK;
+		for(; req->nr_pages < n; req->nr_pages++, addr += PAGE_SIZE) {
+			if(!(req->pages[req->nr_pages] = get_user_page(addr, req->opcode == IOCB_CMD_PREAD ? VERIFY_WRITE : VERIFY_READ))) {
+				errno = -EFAULT;
+				goto free_req;
+			}
+		}
+	}
+
+	req->fd = fd;
+	fd_table[fd].count++;
+	if(resfd) {
+		req->resfd = resfd;
+		fd_table[resfd].count++;
+	}
+
+	if(req->opcode == IOCB_CMD_NOOP) {
+		SAVE_FLAGS(flags); CLI();
+		ctx->nr_running++;
+		RESTORE_FLAGS(flags);
+		complete_req(req, 0);
+		return 0;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	if(aio_queue_tail) {
+		aio_queue_tail->next = req;
+	} else {
+		aio_queue_head = req;
+	}
+	aio_queue_tail = req;
+	wakeup(&aio_queue_head);
+	RESTORE_FLAGS(flags);
+	return 0;
+
+free_req:
+	release_req(req);
+unreserve:
+	SAVE_FLAGS(flags); CLI();
+	ctx->nr_reqs--;
+	RESTORE_FLAGS(flags);
+	return errno;
+}
+
+/* removes the queued requests that match, which must be freed afterwards */
+static struct kiocb *unqueue_reqs(struct aio_ctx *ctx, unsigned int obj)
+{
+	struct kiocb *req, *prev, *next, *list;
+
+	list = NULL;
+	prev = NULL;
+	for(req = aio_queue_head; req; req = next) {
+		next = req->next;
+		if(req->ctx == ctx && (!obj || req->obj == obj)) {
+			if(prev) {
+				prev->next = next;
+			} else {
+				aio_queue_head = next;
+			}
+			if(aio_queue_tail == req) {
+				aio_queue_tail = prev;
+			}
+			req->next = list;
+			list = req;
+			if(obj) {
+				break;
+			}
+		} else {
+			prev = req;
+		}
+	}
+	return list;
+}
+
+/* the context must be already unlinked from aio_ctx_head */
+static void kill_ctx(struct aio_ctx *ctx)
+{
+	unsigned int flags;
+	struct kiocb *req, *next;
+
+	SAVE_FLAGS(flags); CLI();
+	ctx->dead = 1;
+	req = unqueue_reqs(ctx, 0);
+	wakeup(ctx);
+	RESTORE_FLAGS(flags);
+
+	for(; req; req = next) {
+		next = req->next;
+		release_req(req);
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	while(ctx->nr_running || ctx->users) {
+		sleep(ctx, PROC_UNINTERRUPTIBLE);
+	}
+	RESTORE_FLAGS(flags);
+
+	kfree((unsigned int)ctx->events);
+	kfree((unsigned int)ctx);
+}
+
+static struct aio_ctx *unlink_ctx(aio_context_t id, struct mm *mm)
+{
+	unsigned int flags;
+	struct aio_ctx *ctx, *prev;
+
+	SAVE_FLAGS(flags); CLI();
+	prev = NULL;
+	for(ctx = aio_ctx_head; ctx; ctx = ctx->next) {
+		if((!id || ctx->id == id) && ctx->mm == mm) {
+			if(prev) {
+				prev->next = ctx->next;
+			} else {
+				aio_ctx_head = ctx->next;
+			}
+			break;
+		}
+		prev = ctx;
+	}
+	RESTORE_FLAGS(flags);
+	return ctx;
+}
+
+int aio_setup(unsigned int nr_events, aio_context_t *ctxp)
+{
+	unsigned int flags;
+	struct aio_ctx *ctx;
+	int errno;
+
+	if((errno = check_user_area(VERIFY_WRITE, ctxp, sizeof(aio_context_t)))) {
+		return errno;
+	}
+	if(*ctxp || !nr_events) {
+		return -EINVAL;
+	}
+	nr_events = MIN(nr_events, AIO_MAX_EVENTS);
+
+	if(!(ctx = (struct aio_ctx *)kmalloc(sizeof(struct aio_ctx)))) {
+		return -ENOMEM;
+	}
+	memset_b(ctx, 0, sizeof(struct aio_ctx));
+	if(!(ctx->events = (struct io_event *)kmalloc(nr_events * sizeof(struct io_event)))) {
+		kfree((unsigned int)ctx);
+		return -ENOMEM;
+	}
+	errno = do_mmap(NULL, 0, PAGE_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, 0, P_MMAP, 0, NULL);
+	if(errno < 0 && errno > -PAGE_SIZE) {
+		kfree((unsigned int)ctx->events);
+		kfree((unsigned int)ctx);
+		return errno;
+	}
+	ctx->id = errno;
+	ctx->mm = current->mm;
+	ctx->max_events = nr_events;
+
+	SAVE_FLAGS(flags); CLI();
+	ctx->next = aio_ctx_head;
+	aio_ctx_head = ctx;
+	RESTORE_FLAGS(flags);
+
+	*ctxp = ctx->id;
+	return 0;
+}
+
+int aio_destroy(aio_context_t id)
+{
+	struct aio_ctx *ctx;
+
+	if(!id || !(ctx = unlink_ctx(id, current->mm))) {
+		return -EINVAL;
+	}
+	kill_ctx(ctx);
+	do_munmap(id, PAGE_SIZE);
+	return 0;
+}
+
+/* returns the number of requests submitted */
+int aio_submit(aio_context_t id, int nr, struct iocb **iocbpp)
+{
+	struct aio_ctx *ctx;
+	int n, errno;
+
+	if(nr < 0 || !(ctx = get_ctx(id))) {
+		return -EINVAL;
+	}
+	nr = MIN(nr, ctx->max_events);
+	if((errno = check_user_area(VERIFY_READ, iocbpp, nr * sizeof(struct iocb *)))) {
+		put_ctx(ctx);
+		return errno;
+	}
+	for(n = 0; n < nr; n++) {
+		if((errno = submit_req(ctx, iocbpp[n]))) {
+			break;
+		}
+	}
+	put_ctx(ctx);
+	return n ? n : errno;
+}
+
+/* only requests not yet taken by a kaiod thread can be cancelled */
+int aio_cancel(aio_context_t id, struct iocb *iocb, struct io_event *result)
+{
+	unsigned int flags;
+	struct aio_ctx *ctx;
+	struct kiocb *req;
+	struct io_event ev;
+	int errno;
+
+	if((errno = check_user_area(VERIFY_WRITE, result, sizeof(struct io_event)))) {
+		return errno;
+	}
+	if(!iocb || !(ctx = get_ctx(id))) {
+		return -EINVAL;
+	}
+	SAVE_FLAGS(flags); CLI();
+	if((req = unqueue_reqs(ctx, (unsigned int)iocb))) {
+		ctx->nr_reqs--;
+	}
+	RESTORE_FLAGS(flags);
+	put_ctx(ctx);
+
+	if(!req) {
+		return -EAGAIN;
+	}
+	ev.data = req->data;
+	ev.obj = req->obj;
+	ev.res = -ECANCELED;
+	ev.res2 = 0;
+	release_req(req);
+	memcpy_b(result, &ev, sizeof(struct io_event));
+	return 0;
+}
+
+/* returns the number of events reaped */
+int aio_getevents(aio_context_t id, int min_nr, int nr, struct io_event *events, const struct timespec *timeout)
+{
+	struct aio_ctx *ctx;
+	struct io_event ev;
+	struct timeval tv;
+	unsigned int flags, ticks;
+	int n, errno;
+#ifdef CONFIG_HRTIMERS
+	struct hrtimer timer;
+	unsigned long long int usecs;
+#endif /* CONFIG_HRTIMERS */
+
+	if(min_nr < 0 || nr < min_nr) {
+		return -EINVAL;
+	}
+	ticks = 0;
+	if(timeout) {
+		if((errno = check_user_area(VERIFY_READ, timeout, sizeof(struct timespec)))) {
+			return errno;
+		}
+		if(timeout->tv_sec < 0 || timeout->tv_nsec >= 1000000000L || timeout->tv_nsec < 0) {
+			return -EINVAL;
+		}
+		tv.tv_sec = timeout->tv_sec;
+		tv.tv_usec = (timeout->tv_nsec + 999) / 1000;
+		if(!(ticks = tv2ticks(&tv))) {
+			ticks = 1;
+		}
+		/* a zero timeout only collects the events already available */
+		if(!tv.tv_sec && !tv.tv_usec) {
+			min_nr = 0;
+		}
+	}
+	if(!(ctx = get_ctx(id))) {
+		return -EINVAL;
+	}
+	/* no more than max_events can ever be pending */
+	nr = MIN(nr, ctx->max_events);
+	min_nr = MIN(min_nr, nr);
+	if((errno = check_user_area(VERIFY_WRITE, events, nr * sizeof(struct io_event)))) {
+		put_ctx(ctx);
+		return errno;
+	}
+
+	n = 0;
+	SAVE_FLAGS(flags); CLI();
+	current->timeout = ticks;
+#ifdef CONFIG_HRTIMERS
+	usecs = 0;
+	if(timeout && min_nr && hrtimers_enabled) {
+		usecs = tv2usecs(&tv);
+		current->timeout = INFINITE_WAIT;
+		timer.fn = hrtimer_timeout;
+		timer.arg = (unsigned int)current;
+		hrtimer_start(&timer, usecs);
+	}
+#endif /* CONFIG_HRTIMERS */
+	for(;;) {
+		while(n < nr && ctx->nr_events) {
+			ev = ctx->events[ctx->head];
+			ctx->head = (ctx->head + 1) % ctx->max_events;
+			ctx->nr_events--;
+			ctx->nr_reqs--;
+			RESTORE_FLAGS(flags);
+			memcpy_b(&events[n++], &ev, sizeof(struct io_event));
+			SAVE_FLAGS(flags); CLI();
+		}
+		if(n >= min_nr || ctx->dead || (timeout && !current->timeout)) {
+			break;
+		}
+		if(current->sigpending & ~current->sigblocked) {
+			errno = -EINTR;
+			break;
+		}
+		sleep(ctx, PROC_INTERRUPTIBLE);
+	}
+#ifdef CONFIG_HRTIMERS
+	if(usecs) {
+		hrtimer_cancel(&timer);
+	}
+#endif /* CONFIG_HRTIMERS */
+	current->timeout = 0;
+	RESTORE_FLAGS(flags);
+	put_ctx(ctx);
+
+	return n ? n : errno;
+}
+
+/* destroys the contexts left by the last user of the address space */
+void exit_aio(struct mm *mm)
+{
+	struct aio_ctx *ctx;
+
+	while((ctx = unlink_ctx(0, mm))) {
+		kill_ctx(ctx);
+	}
+}
+
+int kaiod(void)
+{
+	unsigned int flags;
+	struct kiocb *req;
+
+	for(;;) {
+		SAVE_FLAGS(flags); CLI();
+		if(!(req = aio_queue_head)) {
+			sleep(&aio_queue_head, PROC_UNINTERRUPTIBLE);
+			RESTORE_FLAGS(flags);
+			continue;
+		}
+		if(!(aio_queue_head = req->next)) {
+			aio_queue_tail = NULL;
+		}
+		req->next = NULL;
+		req->ctx->nr_running++;
+		RESTORE_FLAGS(flags);
+
+		complete_req(req, do_request(req));
+	}
+}
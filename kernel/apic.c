@@ -0,0 +1,342 @@
+/*
+ * fiwix/kernel/apic.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/config.h>
+#include <fiwix/apic.h>
+#include <fiwix/mp.h>
+#include <fiwix/pic.h>
+#include <fiwix/pit.h>
+#include <fiwix/irq.h>
+#include <fiwix/timer.h>
+#include <fiwix/cpu.h>
+#include <fiwix/mm.h>
+#include <fiwix/pci.h>
+#include <fiwix/errno.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_APIC
+
+unsigned int lapic_addr = 0;
+int apic_enabled = 0;
+unsigned int lapic_timer_count = 0;	/* timer counts per tick */
+
+/* an I/O APIC pin connected to an IRQ */
+struct ioapic_route {
+	int irq;
+	int ioapic;
+	int pin;
+	unsigned int flags;
+};
+static struct ioapic_route ioapic_routes[NR_MP_INTS];
+static int nr_ioapic_routes = 0;
+
+/*
+ * The registers of the APICs are mapped 1:1 in the kernel address space
+ * (uncached), as it's done with the framebuffer.
+ */
+static int apic_map(unsigned int addr)
+{
+	addr &= PAGE_MASK;
+	if(!map_kaddr(kpage_dir, addr, addr + PAGE_SIZE, 0, PAGE_PRESENT | PAGE_RW | PAGE_PCD)) {
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+unsigned int lapic_read(int reg)
+{
+	return *(volatile unsigned int *)(lapic_addr + reg);
+}
+
+void lapic_write(int reg, unsigned int value)
+{
+	*(volatile unsigned int *)(lapic_addr + reg) = value;
+}
+
+int lapic_get_id(void)
+{
+	return lapic_read(LAPIC_ID) >> LAPIC_ID_SHIFT;
+}
+
+void lapic_send_ipi(int lapic_id, unsigned int icr)
+{
+	lapic_write(LAPIC_ICRH, lapic_id << LAPIC_ID_SHIFT);
+	lapic_write(LAPIC_ICRL, icr);
+	while(lapic_read(LAPIC_ICRL) & ICR_BUSY);
+}
+
+void lapic_eoi(void)
+{
+	lapic_write(LAPIC_EOI, 0);
+}
+
+/* software enable of the Local APIC of the CPU running this code */
+void lapic_enable(void)
+{
+	lapic_write(LAPIC_TPR, 0);
+	lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+/*
+ * The frequency of the Local APIC timer depends on the bus clock, so it's
+ * calibrated by counting down during one tick measured with the PIT channel
+ * 2 (as in detect_cpuspeed()). It returns the counts per tick (with the
+ * divider set to 16), or 0 on error.
+ */
+unsigned int lapic_timer_calibrate(int hertz)
+{
+	unsigned int count;
+
+	lapic_write(LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | (IRQ_VECTOR_BASE + TIMER_IRQ));
+
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) & ~(ENABLE_SDATA | ENABLE_TMR2G));
+	outport_b(MODEREG, SEL_CHAN2 | LSB_MSB | TERM_COUNT | BINARY_CTR);
+	outport_b(CHANNEL2, (OSCIL / hertz) & 0xFF);
+	outport_b(CHANNEL2, (OSCIL / hertz) >> 8);
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) | ENABLE_TMR2G);
+
+	lapic_write(LAPIC_TIMER_ICR, 0xFFFFFFFF);
+	while(!(inport_b(PS2_SYSCTRL_B) & TMR2_OUTPUT));
+	count = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CCR);
+
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) & ~ENABLE_TMR2G);
+	lapic_write(LAPIC_TIMER_ICR, 0);
+	return count;
+}
+
+/*
+ * The Local APIC timer is set in periodic mode to deliver the vector of
+ * TIMER_IRQ, and the PIT interrupt stays masked in the I/O APIC.
+ */
+int lapic_timer_init(int hertz)
+{
+	unsigned int count;
+
+	if(!(count = lapic_timer_calibrate(hertz))) {
+		return -EINVAL;
+	}
+
+	ioapic_disable_irq(TIMER_IRQ);
+	lapic_timer_count = count;
+	lapic_timer_periodic();
+	return 0;
+}
+
+void lapic_timer_periodic(void)
+{
+	lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | (IRQ_VECTOR_BASE + TIMER_IRQ));
+	lapic_write(LAPIC_TIMER_ICR, lapic_timer_count);
+}
+
+/* programs the timer to interrupt only once after 'usecs' */
+void lapic_timer_oneshot(unsigned int usecs)
+{
+	unsigned int count;
+
+	count = usecs * (lapic_timer_count / TICK);
+	if(!count) {
+		count = 1;
+	}
+	lapic_write(LAPIC_LVT_TIMER, IRQ_VECTOR_BASE + TIMER_IRQ);
+	lapic_write(LAPIC_TIMER_ICR, count);
+}
+
+static unsigned int ioapic_read(int ioapic, int reg)
+{
+	volatile unsigned int *regs;
+
+	regs = (unsigned int *)ioapic_info[ioapic].addr;
+	regs[IOAPIC_REGSEL / sizeof(unsigned int)] = reg;
+	return regs[IOAPIC_WIN / sizeof(unsigned int)];
+}
+
+static void ioapic_write(int ioapic, int reg, unsigned int value)
+{
+	volatile unsigned int *regs;
+
+	regs = (unsigned int *)ioapic_info[ioapic].addr;
+	regs[IOAPIC_REGSEL / sizeof(unsigned int)] = reg;
+	regs[IOAPIC_WIN / sizeof(unsigned int)] = value;
+}
+
+static void ioapic_set_route(struct ioapic_route *r, int masked)
+{
+	unsigned int low;
+
+	low = (IRQ_VECTOR_BASE + r->irq) | r->flags | (masked ? IOREDTBL_MASKED : 0);
+	ioapic_write(r->ioapic, IOAPIC_REDTBL + (r->pin * 2) + 1, lapic_get_id() << LAPIC_ID_SHIFT);
+	ioapic_write(r->ioapic, IOAPIC_REDTBL + (r->pin * 2), low);
+}
+
+void ioapic_enable_irq(int irq)
+{
+	int n;
+
+	/* the tick comes from the Local APIC timer */
+	if(irq == TIMER_IRQ && lapic_timer_count) {
+		return;
+	}
+	for(n = 0; n < nr_ioapic_routes; n++) {
+		if(ioapic_routes[n].irq == irq) {
+			ioapic_set_route(&ioapic_routes[n], 0);
+		}
+	}
+}
+
+void ioapic_disable_irq(int irq)
+{
+	int n;
+
+	for(n = 0; n < nr_ioapic_routes; n++) {
+		if(ioapic_routes[n].irq == irq) {
+			ioapic_set_route(&ioapic_routes[n], 1);
+		}
+	}
+}
+
+/* returns the IRQ that the BIOS assigned to a PCI interrupt */
+static int get_pci_irq(int bus, int src_irq)
+{
+#ifdef CONFIG_PCI
+	struct pci_device *pdev;
+
+	for(pdev = pci_device_table; pdev; pdev = pdev->next) {
+		if(pdev->bus == bus && pdev->dev == (src_irq >> 2) && pdev->pin == (src_irq & 3) + 1) {
+			return pdev->irq;
+		}
+	}
+#endif /* CONFIG_PCI */
+	return -1;
+}
+
+static void add_ioapic_route(struct mp_iointerrupt *mpi)
+{
+	struct ioapic_route *r;
+	int n, ioapic, irq;
+	unsigned int flags;
+
+	for(ioapic = 0; ioapic < mp_nr_ioapics; ioapic++) {
+		if(ioapic_info[ioapic].id == mpi->dst_ioapic) {
+			break;
+		}
+	}
+	if(ioapic >= mp_nr_ioapics || mpi->src_bus >= NR_MP_BUSES) {
+		return;
+	}
+
+	switch(mp_bus_type[mpi->src_bus]) {
+		case MP_BUS_ISA:
+			/* ISA interrupts are active high and edge triggered */
+			irq = mpi->src_irq;
+			flags = 0;
+			break;
+		case MP_BUS_PCI:
+			/* PCI interrupts are active low and level triggered */
+			irq = get_pci_irq(mpi->src_bus, mpi->src_irq);
+			flags = IOREDTBL_LOW | IOREDTBL_LEVEL;
+			break;
+		default:
+			return;
+	}
+	if(irq < 0 || irq >= NR_IRQS) {
+		return;
+	}
+	if((mpi->flags & MP_POLARITY_MASK) == MP_POLARITY_LOW) {
+		flags |= IOREDTBL_LOW;
+	} else if(mpi->flags & MP_POLARITY_MASK) {
+		flags &= ~IOREDTBL_LOW;
+	}
+	if((mpi->flags & MP_TRIGGER_MASK) == MP_TRIGGER_LEVEL) {
+		flags |= IOREDTBL_LEVEL;
+	} else if(mpi->flags & MP_TRIGGER_MASK) {
+		flags &= ~IOREDTBL_LEVEL;
+	}
+
+	/* the same pin might be listed more than once */
+	for(n = 0; n < nr_ioapic_routes; n++) {
+		if(ioapic_routes[n].ioapic == ioapic && ioapic_routes[n].pin == mpi->dst_pin) {
+			return;
+		}
+	}
+	r = &ioapic_routes[nr_ioapic_routes++];
+	r->irq = irq;
+	r->ioapic = ioapic;
+	r->pin = mpi->dst_pin;
+	r->flags = flags;
+}
+
+/*
+ * If the system has an I/O APIC, the 8259 PICs are masked and every IRQ is
+ * routed through the I/O APIC to the Local APIC of the BSP, with the same
+ * vector it had with the PIC. The EOI is then a single write to the Local
+ * APIC. Otherwise, the PIC and the PIT are still used.
+ */
+void apic_init(void)
+{
+	int n, pins;
+
+	if(!(cpu_table.flags & CPU_APIC)) {
+		return;
+	}
+	if(mp_init() || !mp_lapic_addr) {
+		return;
+	}
+	if(apic_map(mp_lapic_addr)) {
+		printk("WARNING: %s(): unable to map the Local APIC.\n", __FUNCTION__);
+		return;
+	}
+	lapic_addr = mp_lapic_addr;
+	lapic_enable();
+
+	for(n = 0; n < mp_nr_ioapics; n++) {
+		if(apic_map(ioapic_info[n].addr)) {
+			printk("WARNING: %s(): unable to map the I/O APIC %d.\n", __FUNCTION__, ioapic_info[n].id);
+			return;
+		}
+	}
+	for(n = 0; n < mp_nr_ints; n++) {
+		if(mp_ints[n].int_type == MP_INT) {
+			add_ioapic_route(&mp_ints[n]);
+		}
+	}
+	if(!nr_ioapic_routes) {
+		return;
+	}
+
+	printk("apic      0x%08x        -\tMP spec v1.%d, %d CPU(s)\n", lapic_addr, mp_floating->spec_rev, mp_nr_cpus);
+	for(n = 0; n < mp_nr_ioapics; n++) {
+		pins = ((ioapic_read(n, IOAPIC_VER) >> 16) & 0xFF) + 1;
+		printk("ioapic    0x%08x        -\tid=%d pins=%d\n", ioapic_info[n].addr, ioapic_info[n].id, pins);
+	}
+
+	/* mask all the PIC IRQs and get the interrupts from the APIC */
+	outport_b(PIC_MASTER + DATA, OCW1);
+	outport_b(PIC_SLAVE + DATA, OCW1);
+	if(mp_floating->feature2 & MP_IMCR_PRESENT) {
+		outport_b(IMCR_ADDR, IMCR_SELECT);
+		outport_b(IMCR_DATA, IMCR_APIC);
+	}
+	lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+
+	for(n = 0; n < nr_ioapic_routes; n++) {
+		ioapic_set_route(&ioapic_routes[n], 1);
+	}
+	apic_enabled = 1;
+
+	/* IRQs already registered were enabled in the PIC */
+	for(n = 0; n < NR_IRQS; n++) {
+		if(irq_table[n]) {
+			ioapic_enable_irq(n);
+		}
+	}
+}
+
+#endif /* CONFIG_APIC */
@@ -5,12 +5,14 @@
  * Distributed under the terms of the Fiwix License.
  */
 
+#include <fiwix/config.h>
 #include <fiwix/asm.h>
 #include <fiwix/kernel.h>
 #include <fiwix/utsname.h>
 #include <fiwix/pic.h>
 #include <fiwix/pit.h>
 #include <fiwix/cpu.h>
+#include <fiwix/fpu.h>
 #include <fiwix/timer.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -55,7 +57,7 @@ static unsigned int detect_cpuspeed(void)
 	tsc1 = 0;
 	tsc1 = get_rdtsc();
 
-	while(!(inport_b(PS2_SYSCTRL_B) & 0x20));
+	while(!(inport_b(PS2_SYSCTRL_B) & TMR2_OUTPUT));
 
 	tsc2 = 0;
 	tsc2 = get_rdtsc();
@@ -201,6 +203,9 @@ void cpu_init(void)
 {
 	unsigned int n;
 	int maxcpuid;
+#if defined(CONFIG_PSE) || defined(CONFIG_PGE)
+	unsigned int cr4;
+#endif /* CONFIG_PSE || CONFIG_PGE */
 
 	memset_b(&cpu_table, 0, sizeof(cpu_table));
 	cpu_table.model = -1;
@@ -247,6 +252,22 @@ void cpu_init(void)
 			cpu_table.model = (_cpusignature >> 4) & 0xF;
 			cpu_table.stepping = _cpusignature & 0xF;
 			printk("model=%d stepping=%d\n", cpu_table.model, cpu_table.stepping);
+#ifdef CONFIG_PSE
+			/* enable 4MB pages, used by mem_init() and huge mappings */
+			if(_cpuflags & CPU_PSE) {
+				GET_CR4(cr4);
+				cr4 |= CR4_PSE;
+				SET_CR4(cr4);
+			}
+#endif /* CONFIG_PSE */
+#ifdef CONFIG_PGE
+			/* the kernel pages will be global, see mem_init() */
+			if(_cpuflags & CPU_PGE) {
+				GET_CR4(cr4);
+				cr4 |= CR4_PGE;
+				SET_CR4(cr4);
+			}
+#endif /* CONFIG_PGE */
 		}
 		if(!brand_str()) {
 			cpu_table.model_name = _brandstr;
@@ -261,4 +282,5 @@ void cpu_init(void)
 	strcpy(UTS_MACHINE, "i386");
 	strncpy(sys_utsname.machine, UTS_MACHINE, _UTSNAME_LENGTH);
 	cpu_table.has_fpu = getfpu();
+	fpu_init();
 }
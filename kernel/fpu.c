@@ -0,0 +1,156 @@
+/*
+ * fiwix/kernel/fpu.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/fpu.h>
+#include <fiwix/cpu.h>
+#include <fiwix/process.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+/*
+ * The FPU/MMX/SSE registers are switched lazily. The FPU keeps the state of
+ * the last process that used it (fpu_owner) and, when switching to any other
+ * process, the TS flag in CR0 is set so that its first FPU instruction raises
+ * the Device Not Available exception. Only then the state of the owner is
+ * saved and the state of the current process is restored. So processes that
+ * never use the FPU don't save or restore anything.
+ */
+
+#ifndef CONFIG_SMP
+struct proc *fpu_owner = NULL;
+#endif /* CONFIG_SMP */
+int fxsr_enabled = 0;
+
+static void stts(void)
+{
+	unsigned int cr0;
+
+	GET_CR0(cr0);
+	if(!(cr0 & CR0_TS)) {
+		cr0 |= CR0_TS;
+		SET_CR0(cr0);
+	}
+}
+
+static void save_state(struct proc *p)
+{
+	if(fxsr_enabled) {
+		__asm__ __volatile__ ("fxsave %0 ; fnclex" : "=m" (p->fpu.fxsave));
+	} else {
+		__asm__ __volatile__ ("fnsave %0 ; fwait" : "=m" (p->fpu.fsave));
+	}
+}
+
+static void restore_state(struct proc *p)
+{
+	if(fxsr_enabled) {
+		__asm__ __volatile__ ("fxrstor %0" : : "m" (p->fpu.fxsave));
+	} else {
+		__asm__ __volatile__ ("frstor %0" : : "m" (p->fpu.fsave));
+	}
+}
+
+/* saves the state of 'p' (which must be the owner) and gives up the FPU */
+void fpu_save(struct proc *p)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(fpu_owner == p) {
+		CLTS();
+		save_state(p);
+		fpu_owner = NULL;
+		stts();
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* forgets the state of 'p' (on exec and exit) */
+void fpu_release(struct proc *p)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(fpu_owner == p) {
+		fpu_owner = NULL;
+		stts();
+	}
+	p->flags &= ~PF_USEDFPU;
+	RESTORE_FLAGS(flags);
+}
+
+/* called (with interrupts disabled) on every context switch */
+void fpu_switch(struct proc *next)
+{
+	if(!cpu_table.has_fpu) {
+		return;
+	}
+#ifdef CONFIG_SMP
+	/*
+	 * The next time the owner runs it might be on another CPU, so its
+	 * state is saved now. The restore is still made lazily.
+	 */
+	if(fpu_owner && fpu_owner != next) {
+		CLTS();
+		save_state(fpu_owner);
+		fpu_owner = NULL;
+	}
+#endif /* CONFIG_SMP */
+	if(next == fpu_owner) {
+		CLTS();
+	} else {
+		stts();
+	}
+}
+
+/* Device Not Available: gives the FPU to the current process */
+void fpu_restore(void)
+{
+	unsigned int flags, mxcsr;
+
+	SAVE_FLAGS(flags); CLI();
+	CLTS();
+	if(fpu_owner != current) {
+		if(fpu_owner) {
+			save_state(fpu_owner);
+		}
+		if(current->flags & PF_USEDFPU) {
+			restore_state(current);
+		} else {
+			__asm__ __volatile__ ("fninit");
+			if(fxsr_enabled && (cpu_table.flags & CPU_SSE)) {
+				mxcsr = MXCSR_DEFAULT;
+				__asm__ __volatile__ ("ldmxcsr %0" : : "m" (mxcsr));
+			}
+			current->flags |= PF_USEDFPU;
+		}
+		fpu_owner = current;
+	}
+	RESTORE_FLAGS(flags);
+}
+
+void fpu_init(void)
+{
+	unsigned int cr4;
+
+	if(!cpu_table.has_fpu) {
+		return;
+	}
+	if(cpu_table.flags & CPU_FXSR) {
+		GET_CR4(cr4);
+		cr4 |= CR4_OSFXSR;
+		if(cpu_table.flags & CPU_SSE) {
+			cr4 |= CR4_OSXMMEXCPT;
+		}
+		SET_CR4(cr4);
+		fxsr_enabled = 1;
+	}
+	fpu_owner = NULL;
+	stts();
+}
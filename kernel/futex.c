@@ -0,0 +1,259 @@
+/*
+ * fiwix/kernel/futex.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/futex.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/timer.h>
+#include <fiwix/hrtimer.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#define NR_FUTEX_BUCKETS	((NR_PROCS * 10) / 100)	/* 10% of NR_PROCS */
+#define FUTEX_HASH(key)		((((key)->object >> 2) + ((key)->offset >> 2)) % (NR_FUTEX_BUCKETS))
+
+static struct futex_q *futex_hash_table[NR_FUTEX_BUCKETS];
+
+static int get_futex_key(int *uaddr, struct futex_key *key)
+{
+	struct vma *vma;
+	unsigned int addr, pte;
+	int errno;
+
+	addr = (unsigned int)uaddr;
+	if(addr & (sizeof(int) - 1)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, uaddr, sizeof(int)))) {
+		return errno;
+	}
+	if(!(vma = find_vma_region(addr))) {
+		return -EFAULT;
+	}
+
+	/* the page must be present (it might fault here) */
+	(void)*(volatile int *)uaddr;
+
+	if(!(vma->flags & MAP_SHARED) && vma->s_type != P_SHM) {
+		key->object = (unsigned int)current->mm;
+		key->offset = addr;
+		return 0;
+	}
+	pte = get_mapped_addr(current, addr);
+	if(!(pte & PAGE_PRESENT)) {
+		return -EFAULT;
+	}
+	pte &= PAGE_MASK;
+	key->object = P2V(pte);
+	key->offset = addr & ~PAGE_MASK;
+	return 0;
+}
+
+/* the waiters are queued at the tail, so they are woken up in FIFO order */
+static void queue_futex(struct futex_q *q)
+{
+	struct futex_q **h, *last;
+
+	h = &futex_hash_table[FUTEX_HASH(&q->key)];
+	q->next = NULL;
+	if(!*h) {
+		q->prev = NULL;
+		*h = q;
+		return;
+	}
+	for(last = *h; last->next; last = last->next);
+	last->next = q;
+	q->prev = last;
+}
+
+static void unqueue_futex(struct futex_q *q)
+{
+	struct futex_q **h;
+
+	h = &futex_hash_table[FUTEX_HASH(&q->key)];
+	if(q->next) {
+		q->next->prev = q->prev;
+	}
+	if(q->prev) {
+		q->prev->next = q->next;
+	}
+	if(*h == q) {
+		*h = q->next;
+	}
+	q->prev = q->next = NULL;
+}
+
+static void wake_futex(struct futex_q *q)
+{
+	unqueue_futex(q);
+	q->woken = 1;
+	wakeup_proc(q->p);
+}
+
+static int same_key(struct futex_key *a, struct futex_key *b)
+{
+	return a->object == b->object && a->offset == b->offset;
+}
+
+int futex_wait(int *uaddr, int val, const struct timespec *timeout)
+{
+	struct futex_q q;
+	struct timeval tv;
+	unsigned int flags, ticks;
+	int errno;
+#ifdef CONFIG_HRTIMERS
+	struct hrtimer timer;
+	unsigned long long int usecs;
+#endif /* CONFIG_HRTIMERS */
+
+	if((errno = get_futex_key(uaddr, &q.key))) {
+		return errno;
+	}
+	ticks = 0;
+	if(timeout) {
+		if((errno = check_user_area(VERIFY_READ, timeout, sizeof(struct timespec)))) {
+			return errno;
+		}
+		if(timeout->tv_sec < 0 || timeout->tv_nsec >= 1000000000L || timeout->tv_nsec < 0) {
+			return -EINVAL;
+		}
+		tv.tv_sec = timeout->tv_sec;
+		tv.tv_usec = (timeout->tv_nsec + 999) / 1000;
+		if(!(ticks = tv2ticks(&tv))) {
+			ticks = 1;
+		}
+	}
+
+	/*
+	 * Interrupts are disabled from the comparison until the process sleeps
+	 * so that a futex_wake() can't be missed in the meantime.
+	 */
+	SAVE_FLAGS(flags); CLI();
+	if(*uaddr != val) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	if(timeout && !tv.tv_sec && !tv.tv_usec) {
+		RESTORE_FLAGS(flags);
+		return -ETIMEDOUT;
+	}
+	q.p = current;
+	q.woken = 0;
+	queue_futex(&q);
+
+	current->timeout = ticks;
+#ifdef CONFIG_HRTIMERS
+	usecs = 0;
+	if(timeout && hrtimers_enabled) {
+		usecs = tv2usecs(&tv);
+		current->timeout = INFINITE_WAIT;
+		timer.fn = hrtimer_timeout;
+		timer.arg = (unsigned int)current;
+		hrtimer_start(&timer, usecs);
+	}
+#endif /* CONFIG_HRTIMERS */
+
+	sleep(&q, PROC_INTERRUPTIBLE);
+
+#ifdef CONFIG_HRTIMERS
+	if(usecs) {
+		hrtimer_cancel(&timer);
+	}
+#endif /* CONFIG_HRTIMERS */
+	ticks = current->timeout;
+	current->timeout = 0;
+	if(!q.woken) {
+		unqueue_futex(&q);
+	}
+	RESTORE_FLAGS(flags);
+
+	if(q.woken) {
+		return 0;
+	}
+	if(timeout && !ticks) {
+		return -ETIMEDOUT;
+	}
+	return -EINTR;
+}
+
+/* returns the number of waiters woken up */
+int futex_wake(int *uaddr, int nr_wake)
+{
+	struct futex_key key;
+	struct futex_q *q, *next;
+	unsigned int flags;
+	int errno, count;
+
+	if((errno = get_futex_key(uaddr, &key))) {
+		return errno;
+	}
+
+	count = 0;
+	SAVE_FLAGS(flags); CLI();
+	q = futex_hash_table[FUTEX_HASH(&key)];
+	while(q && count < nr_wake) {
+		next = q->next;
+		if(same_key(&q->key, &key)) {
+			wake_futex(q);
+			count++;
+		}
+		q = next;
+	}
+	RESTORE_FLAGS(flags);
+	return count;
+}
+
+/*
+ * Wakes up 'nr_wake' waiters of 'uaddr' and moves up to 'nr_requeue' of the
+ * rest to wait on 'uaddr2' instead. If 'cmp' is set, nothing is done unless
+ * 'uaddr' still contains 'val'. Returns the number of waiters affected.
+ */
+int futex_requeue(int *uaddr, int nr_wake, int nr_requeue, int *uaddr2, int cmp, int val)
+{
+	struct futex_key key, key2;
+	struct futex_q *q, *next;
+	unsigned int flags;
+	int errno, count, requeued;
+
+	if((errno = get_futex_key(uaddr, &key))) {
+		return errno;
+	}
+	if((errno = get_futex_key(uaddr2, &key2))) {
+		return errno;
+	}
+
+	count = requeued = 0;
+	SAVE_FLAGS(flags); CLI();
+	if(cmp && *uaddr != val) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	q = futex_hash_table[FUTEX_HASH(&key)];
+	while(q && (count < nr_wake || requeued < nr_requeue)) {
+		next = q->next;
+		if(same_key(&q->key, &key)) {
+			if(count < nr_wake) {
+				wake_futex(q);
+				count++;
+			} else {
+				unqueue_futex(q);
+				q->key = key2;
+				queue_futex(q);
+				requeued++;
+			}
+		}
+		q = next;
+	}
+	RESTORE_FLAGS(flags);
+	return count + requeued;
+}
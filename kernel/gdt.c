@@ -9,7 +9,9 @@
 #include <fiwix/types.h>
 #include <fiwix/segments.h>
 #include <fiwix/process.h>
+#include <fiwix/smp.h>
 #include <fiwix/limits.h>
+#include <fiwix/errno.h>
 #include <fiwix/string.h>
 
 struct seg_desc gdt[NR_GDT_ENTRIES];
@@ -30,6 +32,53 @@ static void gdt_set_entry(int num, unsigned int base_addr, unsigned int limit, c
 	gdt[num].sd_hibase = (base_addr >> 24) & 0xFF;
 }
 
+/*
+ * Builds the TLS descriptor from the user_desc passed to set_thread_area()
+ * or clone(). An empty user_desc clears it.
+ */
+int set_tls_desc(struct seg_desc *d, struct user_desc *u)
+{
+	unsigned char loflags, hiflags;
+
+	if(!u->base_addr && !u->limit && !u->contents && u->read_exec_only && !u->seg_32bit && !u->limit_in_pages && u->seg_not_present && !u->useable) {
+		memset_b(d, 0, sizeof(struct seg_desc));
+		return 0;
+	}
+	/* conforming code segments are not allowed */
+	if(u->contents == 3 && !u->seg_not_present) {
+		return -EINVAL;
+	}
+
+	loflags = SD_CD | SD_DPL3 | (u->contents << 2) | ((!u->read_exec_only) << 1) | 1;
+	if(!u->seg_not_present) {
+		loflags |= SD_PRESENT;
+	}
+	hiflags = u->useable;
+	if(u->seg_32bit) {
+		hiflags |= SD_OPSIZE32;
+	}
+	if(u->limit_in_pages) {
+		hiflags |= SD_PAGE4KB;
+	}
+	d->sd_lolimit = u->limit & 0xFFFF;
+	d->sd_lobase = u->base_addr & 0xFFFFFF;
+	d->sd_loflags = loflags;
+	d->sd_hilimit = (u->limit >> 16) & 0x0F;
+	d->sd_hiflags = hiflags;
+	d->sd_hibase = (u->base_addr >> 24) & 0xFF;
+	return 0;
+}
+
+#ifdef CONFIG_SMP
+/* each CPU runs on its own copy of the GDT (see smp_this_cpu()) */
+void gdt_copy(struct smp_cpu *cpu)
+{
+	memcpy_b(cpu->gdt, gdt, sizeof(gdt));
+	cpu->gdtr.limit = sizeof(gdt) - 1;
+	cpu->gdtr.base_addr = (unsigned int)cpu->gdt;
+}
+#endif /* CONFIG_SMP */
+
 void gdt_init(void)
 {
 	unsigned char loflags;
@@ -49,5 +98,13 @@ void gdt_init(void)
 	loflags = SD_TSSPRESENT;
 	gdt_set_entry(TSS, 0, sizeof(struct i386tss), loflags, SD_OPSIZE32);
 
+	/* TLS is loaded on every context switch */
+	gdt_set_entry(TLS, 0, 0, 0, 0);
+
+#ifdef CONFIG_SMP
+	gdt_copy(&smp_cpus[0]);
+	load_gdt((unsigned int)&smp_cpus[0].gdtr);
+#else
 	load_gdt((unsigned int)&gdtr);
+#endif /* CONFIG_SMP */
 }
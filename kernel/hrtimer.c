@@ -0,0 +1,264 @@
+/*
+ * fiwix/kernel/hrtimer.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/hrtimer.h>
+#include <fiwix/timer.h>
+#include <fiwix/time.h>
+#include <fiwix/cpu.h>
+#include <fiwix/pit.h>
+#include <fiwix/apic.h>
+#include <fiwix/process.h>
+#include <fiwix/sleep.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_HRTIMERS
+
+/*
+ * The high-resolution timers are kept in a singly linked list ordered by
+ * their expiration time, which is measured with the TSC.
+ *
+ * While the first timer doesn't expire before the next tick, the clock-event
+ * device runs in periodic mode at HZ as usual. Otherwise it's switched to
+ * one-shot mode and programmed for the next event (the first timer or the
+ * next tick, whichever comes first), and the ticks are emulated comparing
+ * the TSC with the time at which the next tick is due. Once there are no
+ * timers left before the next tick, the device goes back to periodic mode.
+ */
+
+int hrtimers_enabled = 0;
+
+static unsigned int mhz;			/* TSC cycles per usec */
+static unsigned int cycles_per_tick;
+static unsigned long long int last_tick;	/* TSC at the last tick */
+static unsigned long long int next_tick;	/* TSC at the next tick */
+static int oneshot;
+static int in_interrupt;
+static struct hrtimer *hrtimer_head;
+static struct clockevent *clockevent;
+
+static void pit_set_periodic(void)
+{
+	pit_init(HZ);
+}
+
+static struct clockevent pit_clockevent = {
+	&pit_set_periodic,
+	&pit_oneshot
+};
+
+#ifdef CONFIG_APIC
+static struct clockevent lapic_clockevent = {
+	&lapic_timer_periodic,
+	&lapic_timer_oneshot
+};
+#endif /* CONFIG_APIC */
+
+static void program_next_event(unsigned long long int now)
+{
+	unsigned long long int next;
+	unsigned int usecs;
+
+	next = next_tick;
+	if(hrtimer_head && hrtimer_head->expires < next) {
+		next = hrtimer_head->expires;
+	} else if(!oneshot) {
+		return;
+	}
+
+	usecs = next > now ? (unsigned int)(next - now) / mhz : 0;
+	if(usecs < HRTIMER_MIN_DELTA) {
+		usecs = HRTIMER_MIN_DELTA;
+	}
+	if(usecs > HRTIMER_MAX_DELTA) {
+		usecs = HRTIMER_MAX_DELTA;
+	}
+	oneshot = 1;
+	clockevent->set_oneshot(usecs);
+}
+
+unsigned long long int tv2usecs(const struct timeval *tv)
+{
+	return (unsigned long long int)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void usecs2tv(unsigned long long int usecs, struct timeval *tv)
+{
+	tv->tv_sec = usecs / 1000000;
+	tv->tv_usec = usecs % 1000000;
+}
+
+void hrtimer_start(struct hrtimer *t, unsigned long long int usecs)
+{
+	unsigned int flags;
+	unsigned long long int now;
+	struct hrtimer *h, *prev;
+
+	SAVE_FLAGS(flags); CLI();
+	now = get_rdtsc();
+	t->expires = now + usecs * mhz;
+
+	prev = NULL;
+	h = hrtimer_head;
+	while(h && h->expires <= t->expires) {
+		prev = h;
+		h = h->next;
+	}
+	t->next = h;
+	if(prev) {
+		prev->next = t;
+	} else {
+		hrtimer_head = t;
+		if(!in_interrupt) {
+			program_next_event(now);
+		}
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* returns the usecs left for a pending timer */
+unsigned long long int hrtimer_remaining(struct hrtimer *t)
+{
+	unsigned int flags;
+	unsigned long long int now, usecs;
+	struct hrtimer *h;
+
+	usecs = 0;
+	SAVE_FLAGS(flags); CLI();
+	now = get_rdtsc();
+	for(h = hrtimer_head; h; h = h->next) {
+		if(h == t) {
+			if(t->expires > now) {
+				usecs = (t->expires - now) / mhz;
+			}
+			break;
+		}
+	}
+	RESTORE_FLAGS(flags);
+	return usecs;
+}
+
+/* returns 1 if the timer was still pending */
+int hrtimer_cancel(struct hrtimer *t)
+{
+	unsigned int flags;
+	struct hrtimer *h, *prev;
+
+	SAVE_FLAGS(flags); CLI();
+	prev = NULL;
+	for(h = hrtimer_head; h; h = h->next) {
+		if(h == t) {
+			if(prev) {
+				prev->next = h->next;
+			} else {
+				hrtimer_head = h->next;
+			}
+			RESTORE_FLAGS(flags);
+			return 1;
+		}
+		prev = h;
+	}
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+/* ends a sleep bounded by 'current->timeout' (nanosleep, select) */
+void hrtimer_timeout(unsigned int arg)
+{
+	struct proc *p;
+
+	p = (struct proc *)arg;
+	p->timeout = 0;
+	wakeup_proc(p);
+}
+
+/*
+ * Called from the timer interrupt (with interrupts disabled) to run the
+ * expired timers. Returns 1 if a tick is due.
+ */
+int hrtimer_interrupt(void)
+{
+	unsigned long long int now;
+	struct hrtimer *t;
+	int tick;
+
+	now = get_rdtsc();
+	tick = 1;
+	if(oneshot) {
+		if(now < next_tick) {
+			tick = 0;
+		} else {
+			last_tick = next_tick;
+			next_tick += cycles_per_tick;
+			if(next_tick <= now) {
+				/* some ticks were lost */
+				last_tick = now;
+				next_tick = now + cycles_per_tick;
+			}
+		}
+	} else {
+		last_tick = now;
+		next_tick = now + cycles_per_tick;
+	}
+
+	in_interrupt = 1;
+	while((t = hrtimer_head) && t->expires <= now) {
+		hrtimer_head = t->next;
+		t->fn(t->arg);
+	}
+	in_interrupt = 0;
+
+	if(oneshot && tick && (!hrtimer_head || hrtimer_head->expires >= next_tick)) {
+		clockevent->set_periodic();
+		oneshot = 0;
+		last_tick = now;
+		next_tick = now + cycles_per_tick;
+	} else {
+		program_next_event(now);
+	}
+	return tick;
+}
+
+/* usecs elapsed since the last tick */
+int hrtimer_offset(void)
+{
+	unsigned int flags, usecs;
+
+	SAVE_FLAGS(flags); CLI();
+	usecs = (unsigned int)(get_rdtsc() - last_tick) / mhz;
+	RESTORE_FLAGS(flags);
+
+	return usecs < TICK ? usecs : TICK - 1;
+}
+
+int hrtimer_init(void)
+{
+	if(!(cpu_table.flags & CPU_TSC) || cpu_table.hz < 1000000) {
+		return -1;
+	}
+
+	/* rounded up so that timers never expire earlier than requested */
+	mhz = (cpu_table.hz + 999999) / 1000000;
+	cycles_per_tick = cpu_table.hz / HZ;
+
+	clockevent = &pit_clockevent;
+#ifdef CONFIG_APIC
+	if(lapic_timer_count) {
+		clockevent = &lapic_clockevent;
+	}
+#endif /* CONFIG_APIC */
+
+	hrtimer_head = NULL;
+	oneshot = 0;
+	last_tick = get_rdtsc();
+	next_tick = last_tick + cycles_per_tick;
+	hrtimers_enabled = 1;
+	return 0;
+}
+
+#endif /* CONFIG_HRTIMERS */
@@ -8,6 +8,7 @@
 #include <fiwix/asm.h>
 #include <fiwix/types.h>
 #include <fiwix/segments.h>
+#include <fiwix/smp.h>
 #include <fiwix/string.h>
 
 struct gate_desc idt[NR_IDT_ENTRIES];
@@ -56,5 +57,11 @@ void idt_init(void)
 
 	set_idt_entry(0x80, (__off_t)&syscall, SD_32TRAPGATE | SD_DPL3 | SD_PRESENT);
 
+#ifdef CONFIG_SMP
+	set_idt_entry(RESCHED_VECTOR, (__off_t)&resched_ipi, SD_32INTRGATE | SD_PRESENT);
+	set_idt_entry(SMP_TIMER_VECTOR, (__off_t)&smp_timer_ipi, SD_32INTRGATE | SD_PRESENT);
+	set_idt_entry(TLB_VECTOR, (__off_t)&tlb_ipi, SD_32INTRGATE | SD_PRESENT);
+#endif /* CONFIG_SMP */
+
 	load_idt((unsigned int)&idtr);
 }
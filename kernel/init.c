@@ -55,14 +55,35 @@ void init_init(void)
 	/* INIT slot was already created in main.c */
 	init = &proc_table[INIT];
 
+	if(!(init->mm = (struct mm *)kmalloc(sizeof(struct mm)))) {
+		goto init_init__die;
+	}
+	memset_b(init->mm, 0, sizeof(struct mm));
+	init->mm->count = init->mm->users = 1;
+	if(!(init->files = (struct files *)kmalloc(sizeof(struct files)))) {
+		goto init_init__die;
+	}
+	memset_b(init->files, 0, sizeof(struct files));
+	init->files->count = 1;
+	if(!(init->fs = (struct fs_info *)kmalloc(sizeof(struct fs_info)))) {
+		goto init_init__die;
+	}
+	init->fs->count = 1;
+	if(!(init->sighand = (struct sighand *)kmalloc(sizeof(struct sighand)))) {
+		goto init_init__die;
+	}
+	memset_b(init->sighand, 0, sizeof(struct sighand));
+	init->sighand->count = 1;
+
 	/* INIT process starts with the current (kernel) Page Directory */
 	if(!(pgdir = (void *)kmalloc(PAGE_SIZE))) {
 		goto init_init__die;
 	}
-	init->rss++;
+	init->mm->rss++;
 	memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
 	init->tss.cr3 = V2P((unsigned int)pgdir);
 
+	init->tgid = init->pid;
 	init->ppid = 0;
 	init->pgid = 0;
 	init->sid = 0;
@@ -74,17 +95,14 @@ void init_init(void)
 	init->uid = init->gid = 0;
 	init->euid = init->egid = 0;
 	init->suid = init->sgid = 0;
-	memset_b(init->fd, 0, sizeof(init->fd));
-	memset_b(init->fd_flags, 0, sizeof(init->fd_flags));
-	init->root = current->root;
-	init->pwd = current->pwd;
+	init->fs->root = current->fs->root;
+	init->fs->pwd = current->fs->pwd;
 	strcpy(init->argv0, init_argv[0]);
 	init_argv[1] = init_args;
 	sprintk(init->pidstr, "%d", init->pid);
 	init->sigpending = 0;
 	init->sigblocked = 0;
 	init->sigexecuting = 0;
-	memset_b(init->sigaction, 0, sizeof(init->sigaction));
 	memset_b(&init->usage, 0, sizeof(struct rusage));
 	memset_b(&init->cusage, 0, sizeof(struct rusage));
 	init->timeout = 0;
@@ -95,14 +113,15 @@ void init_init(void)
 	init->rlim[RLIMIT_NOFILE].rlim_max = NR_OPENS;
 	init->rlim[RLIMIT_NPROC].rlim_cur = CHILD_MAX;
 	init->rlim[RLIMIT_NPROC].rlim_max = NR_PROCS;
-	init->umask = 0022;
+	init->rlim[RLIMIT_RTPRIO].rlim_cur = init->rlim[RLIMIT_RTPRIO].rlim_max = 0;
+	init->fs->umask = 0022;
 
 	/* setup the stack */
 	if(!(init->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		goto init_init__die;
 	}
 	init->tss.esp0 += PAGE_SIZE - 4;
-	init->rss++;
+	init->mm->rss++;
 	init->tss.ss0 = KERNEL_DS;
 
 	/* setup the init_trampoline */
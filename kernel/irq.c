@@ -10,6 +10,7 @@
 #include <fiwix/errno.h>
 #include <fiwix/irq.h>
 #include <fiwix/pic.h>
+#include <fiwix/apic.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 #include <fiwix/sigcontext.h>
@@ -86,11 +87,37 @@ void add_bh(struct bh *new)
 	RESTORE_FLAGS(flags);
 }
 
+static void run_irq_handlers(int num, struct interrupt *irq, struct sigcontext *sc)
+{
+	kstat.irqs++;
+	irq->ticks++;
+	do {
+		irq->handler(num, sc);
+		irq = irq->next;
+	} while(irq);
+}
+
 /* each ISR points to this function (interrupts are disabled) */
 void irq_handler(int num, struct sigcontext sc)
 {
 	struct interrupt *irq;
 
+#ifdef CONFIG_APIC
+	/*
+	 * The Local APIC won't deliver this vector again until the EOI, so
+	 * there is no need to mask it in the I/O APIC.
+	 */
+	if(apic_enabled) {
+		if((irq = irq_table[num])) {
+			run_irq_handlers(num, irq, &sc);
+		} else {
+			kstat.sirqs++;
+		}
+		lapic_eoi();
+		return;
+	}
+#endif /* CONFIG_APIC */
+
 	disable_irq(num);
 
 	irq = irq_table[num];
@@ -102,13 +129,7 @@ void irq_handler(int num, struct sigcontext sc)
 	}
 
 	ack_pic_irq(num);
-
-	kstat.irqs++;
-	irq->ticks++;
-	do {
-		irq->handler(num, &sc);
-		irq = irq->next;
-	} while(irq);
+	run_irq_handlers(num, irq, &sc);
 
 end:
 	enable_irq(num);
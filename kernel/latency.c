@@ -0,0 +1,67 @@
+/*
+ * fiwix/kernel/latency.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/latency.h>
+#include <fiwix/cpu.h>
+#include <fiwix/timer.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_LATENCY_TEST
+
+/*
+ * The scheduling latency is the time elapsed since a process is woken up
+ * (from the timer bottom half) until it actually gets the CPU. klatencyd
+ * measures it once every tick and keeps a histogram of the results, which
+ * is shown in /proc/latency.
+ */
+struct latency_stats latency_stats;
+
+static struct callout_req latency_creq;
+static unsigned long long int latency_wakeup;
+
+static void latency_timer(unsigned int arg)
+{
+	latency_wakeup = get_rdtsc();
+	wakeup(&latency_stats);
+}
+
+int klatencyd(void)
+{
+	unsigned int flags, mhz, us;
+
+	if(!(cpu_table.flags & CPU_TSC) || !(mhz = cpu_table.hz / 1000000)) {
+		printk("WARNING: %s(): no TSC available, latency test disabled.\n", __FUNCTION__);
+		for(;;) {
+			sleep(&klatencyd, PROC_UNINTERRUPTIBLE);
+		}
+	}
+
+	memset_b(&latency_stats, 0, sizeof(struct latency_stats));
+	for(;;) {
+		latency_creq.fn = latency_timer;
+		latency_creq.arg = 0;
+		SAVE_FLAGS(flags); CLI();
+		add_callout(&latency_creq, 1);
+		sleep(&latency_stats, PROC_UNINTERRUPTIBLE);
+		RESTORE_FLAGS(flags);
+
+		/* the 64bit difference is truncated to avoid libgcc's __udivdi3 */
+		us = (unsigned int)(get_rdtsc() - latency_wakeup) / mhz;
+		latency_stats.samples++;
+		latency_stats.hist[MIN(us, LATENCY_BUCKETS - 1)]++;
+		if(us > latency_stats.max) {
+			latency_stats.max = us;
+		}
+	}
+}
+
+#endif /* CONFIG_LATENCY_TEST */
@@ -29,9 +29,15 @@
 #include <fiwix/keyboard.h>
 #include <fiwix/sched.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/ipc.h>
 #include <fiwix/kexec.h>
 #include <fiwix/sysconsole.h>
+#include <fiwix/latency.h>
+#include <fiwix/apic.h>
+#include <fiwix/smp.h>
+#include <fiwix/vsyscall.h>
+#include <fiwix/aio.h>
 
 int kparm_memsize;
 int kparm_extmemsize;
@@ -77,6 +83,7 @@ static void set_default_values(void)
 void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_addr)
 {
 	struct proc *init;
+	int n;
 
 	_last_data_addr = last_boot_addr - PAGE_OFFSET;
 	memset_b(&kstat, 0, sizeof(kstat));
@@ -114,6 +121,10 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	pci_init();
 #endif /* CONFIG_PCI */
 
+#ifdef CONFIG_APIC
+	apic_init();
+#endif /* CONFIG_APIC */
+
 	video_init();
 	console_init();
 	timer_init();
@@ -122,6 +133,9 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	sleep_init();
 	buffer_init();
 	sched_init();
+#ifdef CONFIG_VSYSCALL
+	vsyscall_init();
+#endif /* CONFIG_VSYSCALL */
 	inode_init();
 	fd_init();
 
@@ -142,7 +156,7 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	set_tss(current);
 	load_tr(TSS);
 	current->tss.cr3 = V2P((unsigned int)kpage_dir);
-	current->flags |= PF_KPROC;
+	set_kernel_proc(current);
 	sprintk(current->argv0, "%s", "idle");
 
 	/* PID 1 is for the INIT process */
@@ -152,6 +166,17 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 
 	kernel_process("kswapd", kswapd);	/* PID 2 */
 	kernel_process("kbdflushd", kbdflushd);	/* PID 3 */
+	kernel_process("kmsyncd", kmsyncd);
+	for(n = 0; n < NR_AIO_WORKERS; n++) {
+		kernel_process("kaiod", kaiod);
+	}
+#ifdef CONFIG_LATENCY_TEST
+	kernel_process("klatencyd", klatencyd);
+#endif /* CONFIG_LATENCY_TEST */
+
+#ifdef CONFIG_SMP
+	smp_init();
+#endif /* CONFIG_SMP */
 
 	/* kswapd will take over the rest of the kernel initialization */
 	need_resched = 1;
@@ -213,6 +238,18 @@ void cpu_idle()
 		if(need_resched) {
 			do_sched();
 		}
+#ifdef CONFIG_SMP
+		/* other CPUs can enter the kernel while this one is halted */
+		CLI();
+		unlock_kernel();
+		if(!need_resched) {
+			STI();
+			HLT();
+		}
+		lock_kernel();
+		STI();
+#else
 		HLT();
+#endif /* CONFIG_SMP */
 	}
 }
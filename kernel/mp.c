@@ -0,0 +1,199 @@
+/*
+ * fiwix/kernel/mp.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/config.h>
+#include <fiwix/mp.h>
+#include <fiwix/apic.h>
+#include <fiwix/irq.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_APIC
+
+struct mp_floating *mp_floating = NULL;
+unsigned int mp_lapic_addr = 0;
+struct cpu_info cpu_info[NR_CPUS];
+int mp_nr_cpus = 0;
+struct ioapic_info ioapic_info[NR_IOAPICS];
+int mp_nr_ioapics = 0;
+char mp_bus_type[NR_MP_BUSES];
+struct mp_iointerrupt mp_ints[NR_MP_INTS];
+int mp_nr_ints = 0;
+
+static int mp_checksum(unsigned char *addr, int len)
+{
+	unsigned char sum;
+
+	for(sum = 0; len > 0; len--) {
+		sum += *addr++;
+	}
+	return sum;
+}
+
+static struct mp_floating *mp_scan(unsigned int from, unsigned int len)
+{
+	struct mp_floating *mpf;
+
+	for(; len >= sizeof(struct mp_floating); from += 16, len -= 16) {
+		mpf = (struct mp_floating *)P2V(from);
+		if(mpf->signature == MP_FLOAT_SIGNATURE && !mp_checksum((unsigned char *)mpf, mpf->length * 16)) {
+			return mpf;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * The MP Floating Pointer Structure is in the first KB of the EBDA, in the
+ * last KB of the base memory, or in the BIOS ROM between 0xF0000 and 0xFFFFF.
+ */
+static struct mp_floating *mp_find(void)
+{
+	struct mp_floating *mpf;
+	unsigned int addr;
+
+	addr = *(unsigned short int *)P2V(0x40E) << 4;
+	if(addr && (mpf = mp_scan(addr, 1024))) {
+		return mpf;
+	}
+	addr = (*(unsigned short int *)P2V(0x413) - 1) * 1024;
+	if((mpf = mp_scan(addr, 1024))) {
+		return mpf;
+	}
+	return mp_scan(0xF0000, 0x10000);
+}
+
+static void add_cpu(int lapic_id, int flags)
+{
+	if(mp_nr_cpus >= NR_CPUS) {
+		printk("WARNING: %s(): CPU with APIC ID %d ignored (NR_CPUS = %d).\n", __FUNCTION__, lapic_id, NR_CPUS);
+		return;
+	}
+	cpu_info[mp_nr_cpus].lapic_id = lapic_id;
+	cpu_info[mp_nr_cpus].flags = flags;
+	mp_nr_cpus++;
+}
+
+static void add_ioapic(int id, unsigned int addr)
+{
+	if(mp_nr_ioapics >= NR_IOAPICS) {
+		printk("WARNING: %s(): I/O APIC %d ignored (NR_IOAPICS = %d).\n", __FUNCTION__, id, NR_IOAPICS);
+		return;
+	}
+	ioapic_info[mp_nr_ioapics].id = id;
+	ioapic_info[mp_nr_ioapics].addr = addr;
+	mp_nr_ioapics++;
+}
+
+/*
+ * A default configuration has two CPUs and one I/O APIC whose first 16 pins
+ * are connected to the ISA IRQs of the same number.
+ */
+static void mp_default_config(void)
+{
+	struct mp_iointerrupt *mpi;
+	int n;
+
+	mp_lapic_addr = LAPIC_DEF_ADDR;
+	add_cpu(0, CPU_IS_BSP);
+	add_cpu(1, 0);
+	add_ioapic(2, IOAPIC_DEF_ADDR);
+	mp_bus_type[0] = MP_BUS_ISA;
+	for(n = 0; n < NR_IRQS; n++) {
+		mpi = &mp_ints[mp_nr_ints++];
+		mpi->type = MP_IOINTERRUPT;
+		mpi->int_type = MP_INT;
+		mpi->flags = 0;
+		mpi->src_bus = 0;
+		mpi->src_irq = n;
+		mpi->dst_ioapic = 2;
+		mpi->dst_pin = n;
+	}
+	/* the 8254 timer is connected to the pin 2 */
+	mp_ints[0].dst_pin = 2;
+}
+
+static int mp_parse(struct mp_config *mpc)
+{
+	struct mp_processor *mpp;
+	struct mp_bus *mpb;
+	struct mp_ioapic *mpa;
+	unsigned char *entry;
+	int n;
+
+	mp_lapic_addr = mpc->lapic_addr;
+	entry = (unsigned char *)(mpc + 1);
+	for(n = 0; n < mpc->entries; n++) {
+		switch(*entry) {
+			case MP_PROCESSOR:
+				mpp = (struct mp_processor *)entry;
+				if(mpp->cpu_flags & MP_CPU_ENABLED) {
+					add_cpu(mpp->lapic_id, mpp->cpu_flags & MP_CPU_BSP ? CPU_IS_BSP : 0);
+				}
+				entry += sizeof(struct mp_processor);
+				break;
+			case MP_BUS:
+				mpb = (struct mp_bus *)entry;
+				if(mpb->bus_id < NR_MP_BUSES) {
+					if(!strncmp(mpb->bus_type, "ISA", 3)) {
+						mp_bus_type[mpb->bus_id] = MP_BUS_ISA;
+					} else if(!strncmp(mpb->bus_type, "PCI", 3)) {
+						mp_bus_type[mpb->bus_id] = MP_BUS_PCI;
+					}
+				}
+				entry += sizeof(struct mp_bus);
+				break;
+			case MP_IOAPIC:
+				mpa = (struct mp_ioapic *)entry;
+				if(mpa->flags & MP_IOAPIC_ENABLED) {
+					add_ioapic(mpa->ioapic_id, mpa->addr);
+				}
+				entry += sizeof(struct mp_ioapic);
+				break;
+			case MP_IOINTERRUPT:
+				if(mp_nr_ints < NR_MP_INTS) {
+					memcpy_b(&mp_ints[mp_nr_ints++], entry, sizeof(struct mp_iointerrupt));
+				}
+				entry += sizeof(struct mp_iointerrupt);
+				break;
+			case MP_LOCALINTERRUPT:
+				entry += 8;
+				break;
+			default:
+				printk("WARNING: %s(): unknown MP table entry type %d.\n", __FUNCTION__, *entry);
+				return mp_nr_cpus ? 0 : -1;
+		}
+	}
+	return 0;
+}
+
+int mp_init(void)
+{
+	struct mp_config *mpc;
+
+	memset_b(mp_bus_type, MP_BUS_OTHER, sizeof(mp_bus_type));
+	if(!(mp_floating = mp_find())) {
+		return -1;
+	}
+	if(mp_floating->feature1) {
+		mp_default_config();
+		return 0;
+	}
+
+	if(!mp_floating->config_addr || mp_floating->config_addr >= (kstat.physical_pages << PAGE_SHIFT)) {
+		return -1;
+	}
+	mpc = (struct mp_config *)P2V(mp_floating->config_addr);
+	if(mpc->signature != MP_CONFIG_SIGNATURE || mp_checksum((unsigned char *)mpc, mpc->length)) {
+		return -1;
+	}
+	return mp_parse(mpc);
+}
+
+#endif /* CONFIG_APIC */
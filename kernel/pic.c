@@ -9,6 +9,7 @@
 #include <fiwix/kernel.h>
 #include <fiwix/config.h>
 #include <fiwix/pic.h>
+#include <fiwix/apic.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -32,6 +33,13 @@ void enable_irq(int irq)
 {
 	int addr;
 
+#ifdef CONFIG_APIC
+	if(apic_enabled) {
+		ioapic_enable_irq(irq);
+		return;
+	}
+#endif /* CONFIG_APIC */
+
 	addr = (irq > 7) ? PIC_SLAVE + DATA : PIC_MASTER + DATA;
 	irq &= 0x0007;
 
@@ -42,6 +50,13 @@ void disable_irq(int irq)
 {
 	int addr;
 
+#ifdef CONFIG_APIC
+	if(apic_enabled) {
+		ioapic_disable_irq(irq);
+		return;
+	}
+#endif /* CONFIG_APIC */
+
 	addr = (irq > 7) ? PIC_SLAVE + DATA : PIC_MASTER + DATA;
 	irq &= 0x0007;
 
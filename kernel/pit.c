@@ -32,6 +32,23 @@ int pit_getcounter0(void)
 	return count;
 }
 
+/* programs the counter 0 to interrupt only once after 'usecs' */
+void pit_oneshot(unsigned int usecs)
+{
+	unsigned int count;
+
+	count = usecs * (OSCIL / 1000) / 1000;
+	if(count > 0xFFFF) {
+		count = 0xFFFF;
+	}
+	if(!count) {
+		count = 1;
+	}
+	outport_b(MODEREG, SEL_CHAN0 | LSB_MSB | TERM_COUNT | BINARY_CTR);
+	outport_b(CHANNEL0, count & 0xFF);	/* LSB */
+	outport_b(CHANNEL0, count >> 8);	/* MSB */
+}
+
 void pit_init(unsigned short int hertz)
 {
 	outport_b(MODEREG, SEL_CHAN0 | LSB_MSB | RATE_GEN | BINARY_CTR);
@@ -6,18 +6,26 @@
  */
 
 #include <fiwix/kernel.h>
+#include <fiwix/asm.h>
 #include <fiwix/mm.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
 #include <fiwix/errno.h>
 #include <fiwix/process.h>
 #include <fiwix/timer.h>
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 #include <fiwix/stddef.h>
 
+extern struct seg_desc gdt[NR_GDT_ENTRIES];
+
 struct proc *proc_table;
+#ifndef CONFIG_SMP
 struct proc *current;
+#endif /* CONFIG_SMP */
 
 struct proc *proc_pool_head;
 struct proc *proc_table_head;
@@ -30,6 +38,15 @@ static struct resource pid_resource = { 0, 0 };
 int nr_processes = 0;
 __pid_t lastpid = 0;
 
+/*
+ * The kernel processes share these structures. Zombies also point to the
+ * last three, since they have already released their own ones.
+ */
+static struct mm kernel_mm;
+struct files kernel_files;
+struct fs_info kernel_fs;
+struct sighand kernel_sighand;
+
 /* sum up child (and its children) statistics */
 void add_crusage(struct proc *p, struct rusage *cru)
 {
@@ -70,7 +87,7 @@ void get_rusage(struct proc *p, struct rusage *ru)
 	 * then the child statistics should not be added to the values returned
 	 * by RUSAGE_CHILDREN.
 	 */
-	if(current->sigaction[SIGCHLD - 1].sa_handler == SIG_IGN) {
+	if(current->sighand->action[SIGCHLD - 1].sa_handler == SIG_IGN) {
 		return;
 	}
 
@@ -121,7 +138,7 @@ struct proc *get_next_zombie(struct proc *parent)
 	}
 
 	FOR_EACH_PROCESS(p) {
-		if(p->ppid == parent->pid && p->state == PROC_ZOMBIE) {
+		if(p->ppid == parent->pid && p->state == PROC_ZOMBIE && TG_LEADER(p) && !live_threads(p)) {
 			return p;
 		}
 		p = p->next;
@@ -133,14 +150,29 @@ struct proc *get_next_zombie(struct proc *parent)
 __pid_t remove_zombie(struct proc *p)
 {
 	struct proc *pp;
+	unsigned int cr3;
 	__pid_t pid;
 
 	pid = p->pid;
 	kfree(p->tss.esp0);
-	p->rss--;
-	kfree(P2V(p->tss.cr3));
-	p->rss--;
-	pp = get_proc_by_pid(p->ppid);
+	p->mm->rss--;
+
+	/* the last thread frees the Page Directory */
+	if(!--p->mm->count) {
+		/* a kernel process (lazy TLB) might be still using it */
+		GET_CR3(cr3);
+		if(cr3 == p->tss.cr3) {
+			SET_CR3(V2P((unsigned int)kpage_dir));
+		}
+#ifdef CONFIG_SMP
+		smp_drop_pgdir(p->tss.cr3);
+#endif /* CONFIG_SMP */
+		kfree(P2V(p->tss.cr3));
+		kfree((unsigned int)p->mm);
+	}
+
+	/* threads are not counted as children */
+	pp = TG_LEADER(p) ? get_proc_by_pid(p->ppid) : NULL;
 	release_proc(p);
 	if(pp) {
 		pp->children--;
@@ -250,10 +282,10 @@ loop:
 	}
 	FOR_EACH_PROCESS(p) {
 		/*
-		 * Make sure the kernel never reuses active pid, pgid
-		 * or sid values.
+		 * Make sure the kernel never reuses active pid, tgid,
+		 * pgid or sid values.
 		 */
-		if(lastpid == p->pid || lastpid == p->pgid || lastpid == p->sid) {
+		if(lastpid == p->pid || lastpid == p->tgid || lastpid == p->pgid || lastpid == p->sid) {
 			goto loop;
 		}
 		p = p->next;
@@ -277,6 +309,170 @@ struct proc *get_proc_by_pid(__pid_t pid)
 	return NULL;
 }
 
+/* returns a copy of the file descriptors table */
+struct files *dup_files(struct files *files)
+{
+	struct files *new;
+	int n;
+
+	if(!(new = (struct files *)kmalloc(sizeof(struct files)))) {
+		return NULL;
+	}
+	memcpy_b(new, files, sizeof(struct files));
+	new->count = 1;
+	for(n = 0; n < OPEN_MAX; n++) {
+		if(new->fd[n]) {
+			fd_table[new->fd[n]].count++;
+		}
+	}
+	return new;
+}
+
+struct fs_info *dup_fs(struct fs_info *fs)
+{
+	struct fs_info *new;
+
+	if(!(new = (struct fs_info *)kmalloc(sizeof(struct fs_info)))) {
+		return NULL;
+	}
+	memcpy_b(new, fs, sizeof(struct fs_info));
+	new->count = 1;
+	if(new->root) {
+		new->root->count++;
+	}
+	if(new->pwd) {
+		new->pwd->count++;
+	}
+	return new;
+}
+
+struct sighand *dup_sighand(struct sighand *sighand)
+{
+	struct sighand *new;
+
+	if(!(new = (struct sighand *)kmalloc(sizeof(struct sighand)))) {
+		return NULL;
+	}
+	memcpy_b(new, sighand, sizeof(struct sighand));
+	new->count = 1;
+	return new;
+}
+
+/* sends SIGKILL to the rest of threads in the group of the current process */
+void kill_other_threads(void)
+{
+	struct proc *p;
+
+	FOR_EACH_PROCESS(p) {
+		if(p->tgid == current->tgid && p != current && p->state != PROC_ZOMBIE) {
+			send_sig(p, SIGKILL);
+		}
+		p = p->next;
+	}
+}
+
+/* returns the number of threads (other than 'p') still alive in its group */
+int live_threads(struct proc *p)
+{
+	struct proc *q;
+	int count;
+
+	count = 0;
+	FOR_EACH_PROCESS(q) {
+		if(q->tgid == p->tgid && q != p && q->state != PROC_ZOMBIE) {
+			count++;
+		}
+		q = q->next;
+	}
+	return count;
+}
+
+/*
+ * Nobody waits for the threads (other than the group leader), so kswapd
+ * removes them once they have exited.
+ */
+void reap_zombie_threads(void)
+{
+	struct proc *p, *next;
+
+	FOR_EACH_PROCESS(p) {
+		next = p->next;
+		if(p->state == PROC_ZOMBIE && !TG_LEADER(p)) {
+			remove_zombie(p);
+		}
+		p = next;
+	}
+}
+
+/*
+ * Called by execve() before the point of no return. The other threads are
+ * killed and the current one becomes a process with its own address space,
+ * file descriptors and signal handlers.
+ */
+int exec_unshare(void)
+{
+	struct mm *mm;
+	struct files *files;
+	struct sighand *sighand;
+	struct proc *pp;
+	unsigned int *pgdir;
+
+	if(current->files->count > 1) {
+		if(!(files = dup_files(current->files))) {
+			return -ENOMEM;
+		}
+		current->files->count--;
+		current->files = files;
+	}
+	if(current->sighand->count > 1) {
+		if(!(sighand = dup_sighand(current->sighand))) {
+			return -ENOMEM;
+		}
+		current->sighand->count--;
+		current->sighand = sighand;
+	}
+	if(current->mm->users > 1) {
+		if(!(mm = (struct mm *)kmalloc(sizeof(struct mm)))) {
+			return -ENOMEM;
+		}
+		if(!(pgdir = (void *)kmalloc(PAGE_SIZE))) {
+			kfree((unsigned int)mm);
+			return -ENOMEM;
+		}
+		memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
+		memset_b(mm, 0, sizeof(struct mm));
+		mm->count = mm->users = 1;
+		current->mm->count--;
+		current->mm->users--;
+		current->mm = mm;
+		current->tss.cr3 = V2P((unsigned int)pgdir);
+		SET_CR3(current->tss.cr3);
+	}
+
+	kill_other_threads();
+	if(!TG_LEADER(current)) {
+		current->tgid = current->pid;
+		if((pp = get_proc_by_pid(current->ppid))) {
+			pp->children++;
+		}
+	}
+	memset_b(&current->tls, 0, sizeof(struct seg_desc));
+	memset_b(&CURRENT_GDT[TLS / sizeof(struct seg_desc)], 0, sizeof(struct seg_desc));
+	return 0;
+}
+
+/* makes a process use the structures of the kernel processes */
+void set_kernel_proc(struct proc *p)
+{
+	p->flags |= PF_KPROC;
+	p->mm = &kernel_mm;
+	p->files = &kernel_files;
+	p->fs = &kernel_fs;
+	p->sighand = &kernel_sighand;
+	kernel_mm.count++;
+	kernel_mm.users++;
+}
+
 struct proc *kernel_process(const char *name, int (*fn)(void))
 {
 	struct proc *p;
@@ -284,15 +480,16 @@ struct proc *kernel_process(const char *name, int (*fn)(void))
 	p = get_proc_free();
 	proc_slot_init(p);
 	p->pid = get_unused_pid();
+	p->tgid = p->pid;
 	p->ppid = 0;
-	p->flags |= PF_KPROC;
+	set_kernel_proc(p);
 	p->priority = DEF_PRIORITY;
 	if(!(p->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		release_proc(p);
 		return NULL;
 	}
 	p->tss.esp0 += PAGE_SIZE - 4;
-	p->rss++;
+	p->mm->rss++;
 	p->tss.cr3 = V2P((unsigned int)kpage_dir);
 	p->tss.eip = (unsigned int)fn;
 	p->tss.esp = p->tss.esp0;
@@ -328,6 +525,10 @@ void proc_slot_init(struct proc *p)
 
 	p->tss.io_bitmap[IO_BITMAP_SIZE] = ~0;	/* extra byte must be all 1's */
 	p->state = PROC_IDLE;
+#ifdef CONFIG_SMP
+	p->cpu = -1;
+	p->lock_depth = 1;	/* it starts running inside the kernel */
+#endif /* CONFIG_SMP */
 }
 
 void proc_init(void)
@@ -349,4 +550,8 @@ void proc_init(void)
 		free_proc_slots++;
 	} while(n--);
 	proc_table_head = proc_table_tail = NULL;
+
+	for(n = 0; n < NSIG; n++) {
+		kernel_sighand.action[n].sa_handler = SIG_IGN;
+	}
 }
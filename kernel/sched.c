@@ -12,23 +12,61 @@
 #include <fiwix/sleep.h>
 #include <fiwix/segments.h>
 #include <fiwix/timer.h>
+#include <fiwix/vsyscall.h>
 #include <fiwix/pic.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
+#include <fiwix/errno.h>
 
 extern struct seg_desc gdt[NR_GDT_ENTRIES];
+#ifndef CONFIG_SMP
 int need_resched = 0;
+#endif /* CONFIG_SMP */
+int preempt_count = 0;		/* kernel preemption is disabled if non-zero */
 
 static void context_switch(struct proc *next)
 {
 	struct proc *prev;
+	unsigned int cr3;
+#ifdef CONFIG_SMP
+	struct smp_cpu *cpu;
+#endif /* CONFIG_SMP */
 
 	CLI();
 	kstat.ctxt++;
 	prev = current;
+	prev->preempt_count = preempt_count;
+	preempt_count = next->preempt_count;
+#ifdef CONFIG_SMP
+	/* the kernel lock stays held by this CPU across the switch */
+	cpu = smp_this_cpu();
+	prev->lock_depth = cpu->lock_depth;
+	cpu->lock_depth = next->lock_depth;
+	prev->cpu = -1;
+	next->cpu = cpu->id;
+#endif /* CONFIG_SMP */
 	set_tss(next);
+	fpu_switch(next);
+	CURRENT_GDT[TLS / sizeof(struct seg_desc)] = next->tls;
+#ifdef CONFIG_VSYSCALL
+	if(sysenter_enabled) {
+		WRMSR(MSR_SYSENTER_ESP, next->tss.esp0, 0);
+	}
+#endif /* CONFIG_VSYSCALL */
 	current = next;
-	do_switch(&prev->tss.esp, &prev->tss.eip, next->tss.esp, next->tss.eip, next->tss.cr3, TSS);
+
+	/*
+	 * Kernel processes only use the kernel half of the address space,
+	 * which is the same in all page directories, so they just keep the
+	 * current one and save a TLB flush (lazy TLB).
+	 */
+	GET_CR3(cr3);
+	if(!(next->flags & PF_KPROC) && next->tss.cr3 != cr3) {
+		cr3 = next->tss.cr3;
+		kstat.tlb_flushes++;
+	}
+	do_switch(&prev->tss.esp, &prev->tss.eip, next->tss.esp, next->tss.eip, cr3, TSS);
 	STI();
 }
 
@@ -36,17 +74,29 @@ void set_tss(struct proc *p)
 {
 	struct seg_desc *g;
 
-	g = &gdt[TSS / sizeof(struct seg_desc)];
+	g = &CURRENT_GDT[TSS / sizeof(struct seg_desc)];
 
 	g->sd_lobase = (unsigned int)&p->tss;
 	g->sd_loflags = SD_TSSPRESENT;
 	g->sd_hibase = (char)(((unsigned int)&p->tss) >> 24);
 }
 
-/* Round Robin algorithm */
+/*
+ * The real-time processes (SCHED_FIFO and SCHED_RR) always run before the
+ * rest, the one with the highest static priority first. Among those with the
+ * same priority, the running one keeps the CPU unless it yields or its time
+ * slice (SCHED_RR) expires, otherwise it's the one that has been waiting the
+ * longest (the last one in the running queue).
+ *
+ * The rest of processes (SCHED_OTHER) share the CPU using a Round Robin
+ * algorithm.
+ *
+ * With SMP all the CPUs pick their processes from the same running queue,
+ * skipping those that are already running in another CPU.
+ */
 void do_sched(void)
 {
-	int count;
+	int count, rt_priority;
 	struct proc *p, *selected;
 
 	/* let the current running process consume its time slice */
@@ -54,19 +104,40 @@ void do_sched(void)
 		return;
 	}
 
+	preempt_count++;
 	need_resched = 0;
 	for(;;) {
 		count = -1;
+		rt_priority = 0;
+#ifdef CONFIG_SMP
+		selected = smp_this_cpu()->idle;
+#else
 		selected = &proc_table[IDLE];
+#endif /* CONFIG_SMP */
+		if(current->state == PROC_RUNNING && RT_POLICY(current) && !(current->flags & PF_YIELD)) {
+			rt_priority = current->rt_priority;
+			selected = current;
+		}
 
 		FOR_EACH_PROCESS_RUNNING(p) {
-			if(p->cpu_count > count) {
+#ifdef CONFIG_SMP
+			if(p->cpu >= 0 && p != current) {
+				p = p->next_run;
+				continue;
+			}
+#endif /* CONFIG_SMP */
+			if(RT_POLICY(p)) {
+				if(p->rt_priority > rt_priority || (p->rt_priority == rt_priority && selected != current)) {
+					rt_priority = p->rt_priority;
+					selected = p;
+				}
+			} else if(!rt_priority && p->cpu_count > count) {
 				count = p->cpu_count;
 				selected = p;
 			}
 			p = p->next_run;
 		}
-		if(count) {
+		if(rt_priority || count) {
 			break;
 		}
 
@@ -76,10 +147,68 @@ void do_sched(void)
 			p = p->next_run;
 		}
 	}
+	current->flags &= ~PF_YIELD;
 	if(current != selected) {
 		context_switch(selected);
 	}
+	preempt_count--;
+}
+
+/*
+ * Changes the scheduling policy and the static priority of a process. Only
+ * the superuser can raise the real-time priority over RLIMIT_RTPRIO.
+ */
+int set_scheduler(struct proc *p, int policy, int priority)
+{
+	if(policy != SCHED_OTHER && policy != SCHED_FIFO && policy != SCHED_RR) {
+		return -EINVAL;
+	}
+	if(policy == SCHED_OTHER ? priority != 0 : (priority < 1 || priority > MAX_RT_PRIO)) {
+		return -EINVAL;
+	}
+	if(!IS_SUPERUSER) {
+		if(current->euid != p->uid && current->euid != p->euid) {
+			return -EPERM;
+		}
+		if(policy != SCHED_OTHER && priority > p->rlim[RLIMIT_RTPRIO].rlim_cur) {
+			/* it can always lower its own priority */
+			if(p->policy == SCHED_OTHER || priority > p->rt_priority) {
+				return -EPERM;
+			}
+		}
+	}
+
+	p->policy = policy;
+	p->rt_priority = priority;
+	p->rt_ticks = 0;
+	if(!p->cpu_count) {
+		p->cpu_count = p->priority;
+	}
+	need_resched = 1;
+	return 0;
+}
+
+/* voluntary preemption point for long-running loops in the kernel */
+void cond_resched(void)
+{
+	if(need_resched) {
+		do_sched();
+	}
+}
+
+#ifdef CONFIG_PREEMPT
+/*
+ * Called on the way back from an interrupt or an exception that interrupted
+ * the kernel. The interrupted code is preempted only if it's not holding any
+ * resource nor running an interrupt handler.
+ */
+void preempt_irq(void)
+{
+	if(need_resched && !preempt_count) {
+		do_sched();
+	}
 }
+#endif /* CONFIG_PREEMPT */
 
 void sched_init(void)
 {
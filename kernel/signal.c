@@ -15,6 +15,7 @@
 #include <fiwix/sched.h>
 #include <fiwix/syscalls.h>
 #include <fiwix/mm.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -72,13 +73,13 @@ int send_sig(struct proc *p, __sigset_t signum)
 	switch(signum) {
 		case SIGFPE:
 		case SIGSEGV:
-			if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
-				p->sigaction[signum - 1].sa_handler = SIG_DFL;
+			if(p->sighand->action[signum - 1].sa_handler == SIG_IGN) {
+				p->sighand->action[signum - 1].sa_handler = SIG_DFL;
 			}
 			break;
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_DFL) {
+	if(p->sighand->action[signum - 1].sa_handler == SIG_DFL) {
 		/*
 		 * INIT process is special, it only gets signals that have the
 		 * signal handler installed. This avoids to bring down the
@@ -94,7 +95,7 @@ int send_sig(struct proc *p, __sigset_t signum)
 		}
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
+	if(p->sighand->action[signum - 1].sa_handler == SIG_IGN) {
 		/* if SIGCHLD is ignored reap its children (prevent zombies) */
 		if(signum == SIGCHLD) {
 			while(sys_waitpid(-1, NULL, WNOHANG) > 0) {
@@ -110,6 +111,10 @@ int send_sig(struct proc *p, __sigset_t signum)
 	/* wake up the process only if the signal is not blocked */
 	if(!(p->sigblocked & (1 << (signum - 1)))) {
 		wakeup_proc(p);
+#ifdef CONFIG_SMP
+		/* it might be running in user mode in another CPU */
+		smp_kick(p);
+#endif /* CONFIG_SMP */
 	}
 
 	return 0;
@@ -128,18 +133,18 @@ int issig(void)
 	for(signum = 1, mask = 1; signum < NSIG; signum++, mask <<= 1) {
 		if(current->sigpending & mask) {
 			if(signum == SIGCHLD) {
-				if(current->sigaction[signum - 1].sa_handler == SIG_IGN) {
+				if(current->sighand->action[signum - 1].sa_handler == SIG_IGN) {
 					/* this process ignores SIGCHLD */
 					while((p = get_next_zombie(current))) {
 						remove_zombie(p);
 					}
 				} else {
-					if(current->sigaction[signum - 1].sa_handler != SIG_DFL) {
+					if(current->sighand->action[signum - 1].sa_handler != SIG_DFL) {
 						return signum;
 					}
 				}
 			} else {
-				if(current->sigaction[signum - 1].sa_handler != SIG_IGN) {
+				if(current->sighand->action[signum - 1].sa_handler != SIG_IGN) {
 					return signum;
 				}
 			}
@@ -162,7 +167,7 @@ void psig(unsigned int stack)
 		if(current->sigpending & mask) {
 			current->sigpending &= ~mask;
 
-			if((unsigned int)current->sigaction[signum - 1].sa_handler) {
+			if((unsigned int)current->sighand->action[signum - 1].sa_handler) {
 
 				/*
 				 * page_not_present() may have raised a SIGSEGV if it
@@ -175,11 +180,11 @@ void psig(unsigned int stack)
 				 */
 				if(!find_vma_region(sc->oldesp)) {
 					printk("WARNING: %s(): no stack region in vma table for process %d. Terminated.\n", __FUNCTION__, current->pid);
-					do_exit(signum);
+					do_group_exit(signum);
 				}
 
 				current->sigexecuting = mask;
-				if(!(current->sigaction[signum - 1].sa_flags & SA_NODEFER)) {
+				if(!(current->sighand->action[signum - 1].sa_flags & SA_NODEFER)) {
 					current->sigblocked |= mask;
 				}
 
@@ -191,16 +196,16 @@ void psig(unsigned int stack)
 				sc->oldesp -= 4;
 				sc->oldesp &= ~3;	/* round up */
 				memcpy_b((void *)sc->oldesp, sighandler_trampoline, len);
-				sc->ecx = (unsigned int)current->sigaction[signum - 1].sa_handler;
+				sc->ecx = (unsigned int)current->sighand->action[signum - 1].sa_handler;
 				sc->eax= signum;
 				sc->eip = sc->oldesp;
 
-				if(current->sigaction[signum - 1].sa_flags & SA_RESETHAND) {
-					current->sigaction[signum - 1].sa_handler = SIG_DFL;
+				if(current->sighand->action[signum - 1].sa_flags & SA_RESETHAND) {
+					current->sighand->action[signum - 1].sa_handler = SIG_DFL;
 				}
 				return;
 			}
-			if(current->sigaction[signum - 1].sa_handler == SIG_DFL) {
+			if(current->sighand->action[signum - 1].sa_handler == SIG_DFL) {
 				switch(signum) {
 					case SIGCONT:
 						runnable(current);
@@ -212,7 +217,7 @@ void psig(unsigned int stack)
 					case SIGTTOU:
 						current->exit_code = signum;
 						not_runnable(current, PROC_STOPPED);
-						if(!(current->sigaction[signum - 1].sa_flags & SA_NOCLDSTOP)) {
+						if(!(current->sighand->action[signum - 1].sa_flags & SA_NOCLDSTOP)) {
 							if((p = get_proc_by_pid(current->ppid))) {
 								send_sig(p, SIGCHLD);
 								/* needed for job control */
@@ -224,7 +229,7 @@ void psig(unsigned int stack)
 					case SIGCHLD:
 						break;
 					default:
-						do_exit(signum);
+						do_group_exit(signum);
 				}
 			}
 		}
@@ -254,6 +259,19 @@ int kill_pid(__pid_t pid, __sigset_t signum, int sender)
 		}
 		p = p->next;
 	}
+
+	/* the group leader has exited, but the rest of its threads haven't */
+	FOR_EACH_PROCESS(p) {
+		if(p->tgid == pid && p->state != PROC_ZOMBIE) {
+			if(sender == USER) {
+				if(!can_signal(p)) {
+					return -EPERM;
+				}
+			}
+			return send_sig(p, signum);
+		}
+		p = p->next;
+	}
 	return -ESRCH;
 }
 
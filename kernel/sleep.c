@@ -12,6 +12,7 @@
 #include <fiwix/sched.h>
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -38,6 +39,9 @@ void runnable(struct proc *p)
 	}
 	proc_run_head = p;
 	p->state = PROC_RUNNING;
+#ifdef CONFIG_SMP
+	smp_wakeup_idle();
+#endif /* CONFIG_SMP */
 	RESTORE_FLAGS(flags);
 }
 
@@ -60,6 +64,33 @@ void not_runnable(struct proc *p, int state)
 	RESTORE_FLAGS(flags);
 }
 
+/*
+ * Moves a running process to the head of the running queue, so it will be
+ * the last one to be selected among the real-time processes of the same
+ * priority.
+ */
+void yield_cpu(struct proc *p)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(p != proc_run_head) {
+		if(p->next_run) {
+			p->next_run->prev_run = p->prev_run;
+		}
+		if(p->prev_run) {
+			p->prev_run->next_run = p->next_run;
+		}
+		p->prev_run = NULL;
+		p->next_run = proc_run_head;
+		proc_run_head->prev_run = p;
+		proc_run_head = p;
+	}
+	p->flags |= PF_YIELD;
+	need_resched = 1;
+	RESTORE_FLAGS(flags);
+}
+
 int sleep(void *address, int state)
 {
 	unsigned int flags;
@@ -93,6 +124,7 @@ int sleep(void *address, int state)
 		*h = current;
 	}
 	current->sleep_address = address;
+	current->rt_ticks = 0;
 	if(state == PROC_UNINTERRUPTIBLE) {
 		current->flags |= PF_NOTINTERRUPT;
 	}
@@ -200,6 +232,7 @@ void lock_resource(struct resource *resource)
 		}
 	}
 	resource->locked = 1;
+	preempt_count++;
 	RESTORE_FLAGS(flags);
 }
 
@@ -209,6 +242,9 @@ void unlock_resource(struct resource *resource)
 
 	SAVE_FLAGS(flags); CLI();
 	resource->locked = 0;
+	if(preempt_count) {
+		preempt_count--;
+	}
 	if(resource->wanted) {
 		resource->wanted = 0;
 		wakeup(resource);
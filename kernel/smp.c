@@ -0,0 +1,383 @@
+/*
+ * fiwix/kernel/smp.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/config.h>
+#include <fiwix/smp.h>
+#include <fiwix/mp.h>
+#include <fiwix/apic.h>
+#include <fiwix/cpu.h>
+#include <fiwix/segments.h>
+#include <fiwix/mm.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/timer.h>
+#include <fiwix/fpu.h>
+#include <fiwix/vsyscall.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_SMP
+
+#ifndef CONFIG_APIC
+#error "CONFIG_SMP requires CONFIG_APIC"
+#endif /* CONFIG_APIC */
+
+extern char smp_trampoline[], smp_trampoline_end[];
+extern struct desc_r idtr;
+
+struct smp_cpu smp_cpus[NR_CPUS];
+int smp_nr_cpus = 1;
+
+/* used by the trampoline and smp_ap_entry() */
+unsigned int smp_boot_cr3;
+unsigned int smp_boot_cr4;
+unsigned int smp_ap_stack;
+
+static struct smp_cpu *smp_boot_cpu;	/* the AP being started */
+static volatile int smp_ap_online;
+static unsigned int smp_timer_count;	/* Local APIC timer counts per tick */
+
+/*
+ * The Big Kernel Lock. Only one CPU at a time runs kernel code, so the rest
+ * of the kernel still relies on disabling interrupts for mutual exclusion.
+ * It's taken on every entry to the kernel and released when returning to
+ * user mode or halting in cpu_idle(). The CPU that holds it can take it
+ * again (from nested interrupts), and keeps it across context switches.
+ */
+static volatile int kernel_flag = 0;
+static volatile int kernel_owner = -1;
+
+/* TLB shootdown */
+static volatile int tlb_pending;
+static volatile unsigned int tlb_drop_cr3;
+
+static int test_and_set(volatile int *lock)
+{
+	int old;
+
+	old = 1;
+	__asm__ __volatile__ ("xchgl %0, %1" : "+r" (old), "+m" (*lock) : : "memory");
+	return old;
+}
+
+static void smp_delay(unsigned int usecs)
+{
+	unsigned long long int end;
+
+	end = get_rdtsc() + (unsigned long long int)usecs * (cpu_table.hz / 1000000);
+	while(get_rdtsc() < end);
+}
+
+static void send_ipi(struct smp_cpu *cpu, int vector)
+{
+	lapic_send_ipi(cpu->lapic_id, ICR_FIXED | ICR_ASSERT | vector);
+}
+
+struct smp_cpu *smp_this_cpu(void)
+{
+	struct desc_r gdtr;
+
+	__asm__ __volatile__ ("sgdt %0" : "=m" (gdtr));
+	return (struct smp_cpu *)gdtr.base_addr;
+}
+
+void lock_kernel(void)
+{
+	struct smp_cpu *cpu;
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	cpu = smp_this_cpu();
+	if(kernel_owner != cpu->id) {
+		while(test_and_set(&kernel_flag)) {
+			/* let the TLB shootdowns in while waiting */
+			STI();
+			while(kernel_flag) {
+				__asm__ __volatile__ ("rep ; nop" : : : "memory");
+			}
+			CLI();
+		}
+		kernel_owner = cpu->id;
+	}
+	cpu->lock_depth++;
+	RESTORE_FLAGS(flags);
+}
+
+void unlock_kernel(void)
+{
+	struct smp_cpu *cpu;
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	cpu = smp_this_cpu();
+	if(!--cpu->lock_depth) {
+		kernel_owner = -1;
+		__asm__ __volatile__ ("" : : : "memory");
+		kernel_flag = 0;
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/*
+ * Makes all the other CPUs flush their TLBs and waits until they are done.
+ * If 'cr3' is not zero, the CPUs still using that page directory (a kernel
+ * process with the lazy TLB) switch to kpage_dir, since it's about to be
+ * freed.
+ */
+static void tlb_shootdown(unsigned int cr3)
+{
+	struct smp_cpu *cpu, *me;
+	unsigned int flags;
+	int n;
+
+	if(smp_nr_cpus < 2) {
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	me = smp_this_cpu();
+	tlb_drop_cr3 = cr3;
+	tlb_pending = smp_nr_cpus - 1;
+	for(n = 0; n < NR_CPUS; n++) {
+		cpu = &smp_cpus[n];
+		if(cpu->online && cpu != me) {
+			send_ipi(cpu, TLB_VECTOR);
+		}
+	}
+	while(tlb_pending) {
+		__asm__ __volatile__ ("rep ; nop" : : : "memory");
+	}
+	RESTORE_FLAGS(flags);
+}
+
+void smp_flush_tlb(void)
+{
+	tlb_shootdown(0);
+}
+
+void smp_drop_pgdir(unsigned int cr3)
+{
+	tlb_shootdown(cr3);
+}
+
+/* makes a process running in another CPU enter the kernel */
+void smp_kick(struct proc *p)
+{
+	struct smp_cpu *cpu;
+
+	if(p->cpu < 0 || p->cpu == smp_this_cpu()->id) {
+		return;
+	}
+	cpu = &smp_cpus[p->cpu];
+	cpu->resched = 1;
+	send_ipi(cpu, RESCHED_VECTOR);
+}
+
+/* a new process is runnable, so an idle CPU is awakened to pick it */
+void smp_wakeup_idle(void)
+{
+	struct smp_cpu *cpu, *me;
+	int n;
+
+	me = smp_this_cpu();
+	for(n = 0; n < NR_CPUS; n++) {
+		cpu = &smp_cpus[n];
+		if(!cpu->online || cpu == me || cpu->curproc != cpu->idle) {
+			continue;
+		}
+		if(!cpu->resched) {
+			cpu->resched = 1;
+			send_ipi(cpu, RESCHED_VECTOR);
+		}
+		return;
+	}
+}
+
+void smp_resched_interrupt(struct sigcontext sc)
+{
+	need_resched = 1;
+	lapic_eoi();
+}
+
+void smp_timer_interrupt(struct sigcontext sc)
+{
+	lapic_eoi();
+	update_process_times(&sc);
+}
+
+void smp_tlb_interrupt(void)
+{
+	unsigned int cr3;
+
+	GET_CR3(cr3);
+	if(tlb_drop_cr3 && cr3 == tlb_drop_cr3) {
+		cr3 = V2P((unsigned int)kpage_dir);
+	}
+	SET_CR3(cr3);
+	lapic_eoi();
+	__asm__ __volatile__ ("lock ; decl %0" : "+m" (tlb_pending) : : "memory");
+}
+
+/* creates the IDLE process of an AP, it will run on the boot stack */
+static struct proc *create_idle(unsigned int stack)
+{
+	struct proc *p;
+
+	if(!(p = get_proc_free())) {
+		return NULL;
+	}
+	proc_slot_init(p);
+	p->tss.esp0 = stack;
+	p->tss.cr3 = V2P((unsigned int)kpage_dir);
+	set_kernel_proc(p);
+	sprintk(p->pidstr, "%d", p->pid);
+	sprintk(p->argv0, "%s", "idle");
+	return p;
+}
+
+static int boot_ap(struct cpu_info *ci, struct smp_cpu *cpu)
+{
+	int n;
+
+	if(!(smp_ap_stack = kmalloc(PAGE_SIZE))) {
+		return -1;
+	}
+	smp_ap_stack += PAGE_SIZE - 4;
+	if(!(cpu->idle = create_idle(smp_ap_stack))) {
+		kfree(smp_ap_stack - (PAGE_SIZE - 4));
+		return -1;
+	}
+	cpu->curproc = cpu->idle;
+	cpu->lapic_id = ci->lapic_id;
+	gdt_copy(cpu);
+	smp_boot_cpu = cpu;
+	smp_ap_online = 0;
+
+	/* INIT-SIPI-SIPI sequence */
+	lapic_write(LAPIC_ESR, 0);
+	lapic_send_ipi(ci->lapic_id, ICR_INIT | ICR_ASSERT | ICR_LEVEL);
+	smp_delay(10000);
+	lapic_send_ipi(ci->lapic_id, ICR_INIT | ICR_LEVEL);
+	for(n = 0; n < 2 && !smp_ap_online; n++) {
+		lapic_send_ipi(ci->lapic_id, ICR_STARTUP | (SMP_BOOT_ADDR >> PAGE_SHIFT));
+		smp_delay(200);
+	}
+
+	/* give it up to 100ms to come online */
+	for(n = 0; n < 100 && !smp_ap_online; n++) {
+		smp_delay(1000);
+	}
+	if(!smp_ap_online) {
+		release_proc(cpu->idle);
+		cpu->idle = cpu->curproc = NULL;
+		kfree(smp_ap_stack - (PAGE_SIZE - 4));
+		return -1;
+	}
+	ci->flags |= CPU_IS_ONLINE;
+	return 0;
+}
+
+/*
+ * This is the first C code executed by an Application Processor. Once it
+ * has loaded its own GDT and TSS, it waits for the kernel lock and enters the
+ * scheduler with its IDLE process, as the BSP does.
+ */
+void smp_ap_main(void)
+{
+	struct smp_cpu *cpu;
+
+	cpu = smp_boot_cpu;
+	load_gdt((unsigned int)&cpu->gdtr);
+	load_idt((unsigned int)&idtr);
+	lapic_enable();
+	fpu_init();
+#ifdef CONFIG_VSYSCALL
+	if(sysenter_enabled) {
+		WRMSR(MSR_SYSENTER_CS, KERNEL_CS, 0);
+		WRMSR(MSR_SYSENTER_ESP, current->tss.esp0, 0);
+		WRMSR(MSR_SYSENTER_EIP, (unsigned int)sysenter_entry, 0);
+	}
+#endif /* CONFIG_VSYSCALL */
+	set_tss(current);
+	load_tr(TSS);
+	current->cpu = cpu->id;
+	smp_ap_online = 1;
+
+	/* the IPIs are sent only to the CPUs that are online */
+	lock_kernel();
+	cpu->online = 1;
+	smp_nr_cpus++;
+	invalidate_tlb();
+
+	/* the tick of this CPU */
+	lapic_write(LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | SMP_TIMER_VECTOR);
+	lapic_write(LAPIC_TIMER_ICR, smp_timer_count);
+
+	STI();
+	cpu_idle();
+}
+
+void smp_init(void)
+{
+	struct smp_cpu *cpu;
+	struct cpu_info *ci;
+	unsigned int *pgdir;
+	int n, online;
+
+	/* the BSP runs the IDLE process (PID 0) and holds the kernel lock */
+	cpu = &smp_cpus[0];
+	cpu->lapic_id = lapic_addr ? lapic_get_id() : 0;
+	cpu->online = 1;
+	cpu->idle = current;
+	current->cpu = cpu->id;
+	lock_kernel();
+
+	/* apic_init() has already read the MP table and mapped the Local APIC */
+	if(!lapic_addr || !(cpu_table.flags & CPU_TSC) || mp_nr_cpus < 2) {
+		return;
+	}
+	if(!(smp_timer_count = lapic_timer_calibrate(HZ))) {
+		return;
+	}
+
+	/* the trampoline needs a 1:1 mapping of the first 4MB of memory */
+	if(!(pgdir = (unsigned int *)kmalloc(PAGE_SIZE))) {
+		return;
+	}
+	memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
+	pgdir[0] = kpage_dir[GET_PGDIR(PAGE_OFFSET)];
+	smp_boot_cr3 = V2P((unsigned int)pgdir);
+	GET_CR4(smp_boot_cr4);
+	memcpy_b((void *)P2V(SMP_BOOT_ADDR), smp_trampoline, smp_trampoline_end - smp_trampoline);
+
+	online = 1;
+	for(n = 0; n < mp_nr_cpus && online < NR_CPUS; n++) {
+		ci = &cpu_info[n];
+		if(ci->lapic_id == cpu->lapic_id) {
+			ci->flags |= CPU_IS_BSP | CPU_IS_ONLINE;
+			continue;
+		}
+		smp_cpus[online].id = online;
+		if(boot_ap(ci, &smp_cpus[online])) {
+			printk("smp       -                 -\tAPIC ID %d failed to start\n", ci->lapic_id);
+			continue;
+		}
+		online++;
+	}
+	printk("smp       0x%08x        -\t%d CPUs online\n", SMP_BOOT_ADDR, online);
+
+	/* a late AP might still be using it */
+	if(online == mp_nr_cpus) {
+		kfree((unsigned int)pgdir);
+	}
+}
+
+#endif /* CONFIG_SMP */
@@ -31,7 +31,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 	 * calls sys_open() and sys_execve() from init_trampoline(),
 	 * but these calls are trusted.
 	 */
-	if(!current->vma_table) {
+	if(!current->mm->vma_table) {
 		return 0;
 	}
 
@@ -43,7 +43,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 		 * and let 'do_page_fault()' to handle the imminent page
 		 * fault as soon as the kernel will try to access it.
 		 */
-		vma = current->vma_table->prev;
+		vma = current->mm->vma_table->prev;
 		if(vma) {
 			if(vma->s_type == P_STACK) {
 				if(start < vma->start && start > vma->prev->end) {
@@ -316,7 +316,7 @@ void *syscall_table[] = {
 #endif /* CONFIG_SYSVIPC */
 	sys_fsync,
 	sys_sigreturn,
-	NULL,	/* sys_clone */		/* 120 */
+	sys_clone,			/* 120 */
 	sys_setdomainname,
 	sys_newuname,
 	NULL,	/* sys_modify_ldt */
@@ -340,7 +340,7 @@ void *syscall_table[] = {
 	sys_getdents,
 	sys_select,
 	sys_flock,
-	NULL,	/* sys_msync */
+	sys_msync,
 	sys_readv,			/* 145 */
 	sys_writev,
 	sys_getsid,
@@ -350,16 +350,16 @@ void *syscall_table[] = {
 	NULL,	/* sys_munlock */
 	NULL,	/* sys_mlockall */
 	NULL,	/* sys_munlockall */
-	NULL,	/* sys_sched_setparam */
-	NULL,	/* sys_sched_getparam */	/* 155 */
-	NULL,	/* sys_sched_setscheduler */
-	NULL,	/* sys_sched_getscheduler */
-	NULL,	/* sys_sched_yield */
-	NULL,	/* sys_sched_get_priority_max */
-	NULL,	/* sys_sched_get_priority_min */	/* 160 */
-	NULL,	/* sys_sched_rr_get_interval */
+	sys_sched_setparam,
+	sys_sched_getparam,		/* 155 */
+	sys_sched_setscheduler,
+	sys_sched_getscheduler,
+	sys_sched_yield,
+	sys_sched_get_priority_max,
+	sys_sched_get_priority_min,	/* 160 */
+	sys_sched_rr_get_interval,
 	sys_nanosleep,
-	NULL,	/* sys_mremap */
+	sys_mremap,
 	NULL,
 	NULL,				/* 165 */
 	NULL,
@@ -419,12 +419,12 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
-	NULL,
+	sys_madvise,
 	sys_getdents64,			/* 220 */
 	sys_fcntl64,
 	NULL,
 	NULL,
-	NULL,
+	sys_gettid,
 	NULL,				/* 225 */
 	NULL,
 	NULL,
@@ -440,25 +440,25 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
-	NULL,				/* 240 */
-	NULL,
-	NULL,
-	NULL,
-	NULL,
-	NULL,				/* 245 */
-	NULL,
-	NULL,
+	sys_futex,			/* 240 */
 	NULL,
 	NULL,
+	sys_set_thread_area,
+	sys_get_thread_area,
+	sys_io_setup,			/* 245 */
+	sys_io_destroy,
+	sys_io_getevents,
+	sys_io_submit,
+	sys_io_cancel,
 	NULL,				/* 250 */
 	NULL,
-	NULL,
+	sys_exit_group,
 	NULL,
 	NULL,
 	NULL,				/* 255 */
 	NULL,
 	NULL,
-	NULL,
+	sys_set_tid_address,
 	NULL,
 	NULL,				/* 260 */
 	NULL,
@@ -37,8 +37,8 @@ int sys_chroot(const char *dirname)
 		free_name(tmp_name);
 		return -ENOTDIR;
 	}
-	iput(current->root);
-	current->root = i;
+	iput(current->fs->root);
+	current->fs->root = i;
 	free_name(tmp_name);
 	return 0;
 }
@@ -20,7 +20,7 @@ int sys_close(unsigned int ufd)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	fd = current->fd[ufd];
+	fd = current->files->fd[ufd];
 	release_user_fd(ufd);
 
 	if(--fd_table[fd].count) {
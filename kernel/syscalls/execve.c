@@ -240,8 +240,6 @@ static int copy_strings(struct binargs *barg, char *argv[], char *envp[])
 static int do_execve(const char *filename, char *argv[], char *envp[], struct sigcontext *sc)
 {
 	char interpreter[NAME_MAX + 1], args[NAME_MAX + 1], name[NAME_MAX + 1];
-	__blk_t block;
-	struct buffer *buf;
 	struct inode *i;
 	struct binargs barg;
 	char *data;
@@ -282,27 +280,21 @@ loop:
 		return -EACCES;
 	}
 
-	if((block = bmap(i, 0, FOR_READING)) < 0) {
-		iput(i);
-		free_barg_pages(&barg);
-		kfree((unsigned int)data);
-		return block;
-	}
-	if(!(buf = bread(i->dev, block, i->sb->s_blocksize))) {
+	/*
+	 * The header is read through the file's own read operation, so that
+	 * filesystems without blocks underneath (i.e. tmpfs) can run programs.
+	 * It's copied to a separate page to make sure that it won't conflict
+	 * while zeroing the BSS fractional page, in case that the same page is
+	 * requested during the page fault.
+	 */
+	memset_b(data, 0, PAGE_SIZE);
+	if((errno = kernel_read(i, 0, data, PAGE_SIZE)) < 0) {
 		iput(i);
 		free_barg_pages(&barg);
 		kfree((unsigned int)data);
-		return -EIO;
+		return errno;
 	}
 
-	/*
-	 * The contents of the buffer is copied and then freed immediately to
-	 * make sure that it won't conflict while zeroing the BSS fractional
-	 * page, in case that the same block is requested during the page fault.
-	 */
-	memcpy_b(data, buf->data, i->sb->s_blocksize);
-	brelse(buf);
-
 	errno = elf_load(i, &barg, sc, data);
 	if(errno == -ENOEXEC) {
 		/* OK, looks like it was not an ELF binary; let's see if it is a script */
@@ -360,7 +352,7 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 
 	strncpy(current->argv0, tmp_name, NAME_MAX);
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n] && (current->fd_flags[n] & FD_CLOEXEC)) {
+		if(current->files->fd[n] && (current->files->fd_flags[n] & FD_CLOEXEC)) {
 			sys_close(n);
 		}
 	}
@@ -370,14 +362,16 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 	current->sigpending = 0;
 	current->sigexecuting = 0;
 	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		if(current->sigaction[n].sa_handler != SIG_IGN) {
-			current->sigaction[n].sa_handler = SIG_DFL;
+		current->sighand->action[n].sa_mask = 0;
+		current->sighand->action[n].sa_flags = 0;
+		if(current->sighand->action[n].sa_handler != SIG_IGN) {
+			current->sighand->action[n].sa_handler = SIG_DFL;
 		}
 	}
 	current->sleep_address = NULL;
+	fpu_release(current);
 	current->flags |= PF_PEXEC;
+	vfork_done();
 	free_name(tmp_name);
 	return 0;
 }
@@ -11,6 +11,9 @@
 #include <fiwix/process.h>
 #include <fiwix/sched.h>
 #include <fiwix/mman.h>
+#include <fiwix/mm.h>
+#include <fiwix/futex.h>
+#include <fiwix/aio.h>
 #include <fiwix/sleep.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -20,6 +23,19 @@
 #include <fiwix/sem.h>
 #endif /* CONFIG_SYSVIPC */
 
+/* notifies the parent about the child's death */
+static void notify_parent(struct proc *child)
+{
+	struct proc *p;
+
+	if((p = get_proc_by_pid(child->ppid))) {
+		send_sig(p, SIGCHLD);
+		if(p->sleep_address == &sys_wait4) {
+			wakeup_proc(p);
+		}
+	}
+}
+
 void do_exit(int exit_code)
 {
 	int n;
@@ -37,7 +53,27 @@ void do_exit(int exit_code)
 	}
 #endif /* CONFIG_SYSVIPC */
 
-	release_binary();
+#ifdef CONFIG_HRTIMERS
+	hrtimer_cancel(&current->it_real_timer);
+#endif /* CONFIG_HRTIMERS */
+
+	fpu_release(current);
+	vfork_done();
+
+	/* CLONE_CHILD_CLEARTID, used by the thread libraries to join */
+	if(current->clear_child_tid) {
+		if(!check_user_area(VERIFY_WRITE, current->clear_child_tid, sizeof(int))) {
+			*current->clear_child_tid = 0;
+			futex_wake(current->clear_child_tid, 1);
+		}
+		current->clear_child_tid = NULL;
+	}
+
+	/* the address space is released by the last thread using it */
+	if(!--current->mm->users) {
+		exit_aio(current->mm);
+		release_binary();
+	}
 	current->argv = NULL;
 	current->envp = NULL;
 
@@ -56,12 +92,11 @@ void do_exit(int exit_code)
 		/* make INIT inherit the children of this exiting process */
 		if(p->ppid == current->pid) {
 			p->ppid = INIT;
-			init->children++;
-			current->children--;
-			if(p->state == PROC_ZOMBIE) {
-				send_sig(init, SIGCHLD);
-				if(init->sleep_address == &sys_wait4) {
-					wakeup_proc(init);
+			if(TG_LEADER(p)) {
+				init->children++;
+				current->children--;
+				if(p->state == PROC_ZOMBIE && !live_threads(p)) {
+					notify_parent(p);
 				}
 			}
 		}
@@ -72,16 +107,28 @@ void do_exit(int exit_code)
 		disassociate_ctty(current->ctty);
 	}
 
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			sys_close(n);
+	if(!--current->files->count) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(current->files->fd[n]) {
+				sys_close(n);
+			}
 		}
+		kfree((unsigned int)current->files);
+	}
+	current->files = &kernel_files;
+
+	if(!--current->fs->count) {
+		iput(current->fs->root);
+		iput(current->fs->pwd);
+		kfree((unsigned int)current->fs);
 	}
+	current->fs = &kernel_fs;
+
+	if(!--current->sighand->count) {
+		kfree((unsigned int)current->sighand);
+	}
+	current->sighand = &kernel_sighand;
 
-	iput(current->root);
-	current->root = NULL;
-	iput(current->pwd);
-	current->pwd = NULL;
 	current->exit_code = exit_code;
 	if(!--nr_processes) {
 		printk("\n");
@@ -92,28 +139,41 @@ void do_exit(int exit_code)
 		stop_kernel();
 	}
 
-	/* notify the parent about the child's death */
-	if((p = get_proc_by_pid(current->ppid))) {
-		send_sig(p, SIGCHLD);
-		if(p->sleep_address == &sys_wait4) {
-			wakeup_proc(p);
-		}
-	}
-
 	current->sigpending = 0;
 	current->sigblocked = 0;
 	current->sigexecuting = 0;
-	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		current->sigaction[n].sa_handler = SIG_IGN;
-	}
 
+	CLI();
+	/*
+	 * The parent is notified when the whole thread group is gone, so the
+	 * last thread to exit notifies the death of the group leader.
+	 */
+	if(!live_threads(current)) {
+		if(TG_LEADER(current)) {
+			notify_parent(current);
+		} else {
+			p = get_proc_by_pid(current->tgid);
+			if(p && p->state == PROC_ZOMBIE) {
+				notify_parent(p);
+			}
+		}
+	}
 	not_runnable(current, PROC_ZOMBIE);
+	if(!TG_LEADER(current)) {
+		/* kswapd will remove this thread */
+		wakeup(&kswapd);
+	}
 	need_resched = 1;
 	do_sched();
 }
 
+/* terminates all the threads in the group */
+void do_group_exit(int exit_code)
+{
+	kill_other_threads();
+	do_exit(exit_code);
+}
+
 int sys_exit(int exit_code)
 {
 #ifdef __DEBUG__
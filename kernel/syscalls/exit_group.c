@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/exit_group.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_exit_group(int exit_code)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_exit_group(%d)\n", current->pid, exit_code);
+#endif /*__DEBUG__ */
+
+	do_group_exit((exit_code & 0xFF) << 8);
+	return 0;
+}
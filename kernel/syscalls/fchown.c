@@ -25,7 +25,7 @@ int sys_fchown(unsigned int ufd, __uid_t owner, __gid_t group)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 
 	if(IS_RDONLY_FS(i)) {
 		return -EROFS;
@@ -14,6 +14,8 @@
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
 #include <fiwix/mm.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -22,7 +24,7 @@ static void free_vma_table(struct proc *p)
 {
 	struct vma *vma, *tmp;
 
-	vma = p->vma_table;
+	vma = p->mm->vma_table;
 	while(vma) {
 		tmp = vma;
 		vma = vma->next;
@@ -30,23 +32,121 @@ static void free_vma_table(struct proc *p)
 	}
 }
 
-#ifdef CONFIG_SYSCALL_6TH_ARG
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
-#else
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
-#endif /* CONFIG_SYSCALL_6TH_ARG */
+static void put_files(struct files *files)
+{
+	int n;
+
+	if(!--files->count) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(files->fd[n]) {
+				fd_table[files->fd[n]].count--;
+			}
+		}
+		kfree((unsigned int)files);
+	}
+}
+
+static void put_fs(struct fs_info *fs)
+{
+	if(!--fs->count) {
+		iput(fs->root);
+		iput(fs->pwd);
+		kfree((unsigned int)fs);
+	}
+}
+
+/* shares or copies the file descriptors, directories and signal handlers */
+static int copy_shared(struct proc *child, unsigned int flags)
+{
+	if(flags & CLONE_FILES) {
+		child->files->count++;
+	} else if(!(child->files = dup_files(current->files))) {
+		return -ENOMEM;
+	}
+	if(flags & CLONE_FS) {
+		child->fs->count++;
+	} else if(!(child->fs = dup_fs(current->fs))) {
+		put_files(child->files);
+		return -ENOMEM;
+	}
+	if(flags & CLONE_SIGHAND) {
+		child->sighand->count++;
+	} else if(!(child->sighand = dup_sighand(current->sighand))) {
+		put_fs(child->fs);
+		put_files(child->files);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void put_shared(struct proc *child)
+{
+	put_files(child->files);
+	put_fs(child->fs);
+	if(!--child->sighand->count) {
+		kfree((unsigned int)child->sighand);
+	}
+}
+
+/* the child created with CLONE_CHILD_SETTID stores its TID before returning */
+void fork_child_settid(void)
+{
+	STI();
+	if(!check_user_area(VERIFY_WRITE, current->set_child_tid, sizeof(int))) {
+		*current->set_child_tid = current->pid;
+	}
+}
+
+/* wakes up the parent of a CLONE_VFORK child (on exec and exit) */
+void vfork_done(void)
+{
+	if(current->flags & PF_VFORK) {
+		current->flags &= ~PF_VFORK;
+		wakeup(current);
+	}
+}
+
+/*
+ * Creates a child process, sharing with the parent the address space, the
+ * file descriptors, the root and working directories, or the signal handlers
+ * according to the clone() flags. The signal sent to the parent when the
+ * child exits (CSIGNAL) is always SIGCHLD. With CLONE_VFORK the parent is
+ * suspended until the child calls execve() or exits.
+ */
+int do_fork(unsigned int flags, unsigned int newsp, int *parent_tid, struct user_desc *tls, int *child_tid, struct sigcontext *sc)
 {
 	int count, pages;
-	unsigned int n;
 	unsigned int *child_pgdir;
 	struct sigcontext *stack;
 	struct proc *child, *p;
 	struct vma *vma, *child_vma;
+	struct seg_desc tls_desc;
 	__pid_t pid;
+	int errno;
 
-#ifdef __DEBUG__
-	printk("(pid %d) sys_fork()\n", current->pid);
-#endif /*__DEBUG__ */
+	/* threads must share the signal handlers and these the address space */
+	if((flags & CLONE_THREAD) && !(flags & CLONE_SIGHAND)) {
+		return -EINVAL;
+	}
+	if((flags & CLONE_SIGHAND) && !(flags & CLONE_VM)) {
+		return -EINVAL;
+	}
+	if(flags & CLONE_SETTLS) {
+		if((errno = check_user_area(VERIFY_READ, tls, sizeof(struct user_desc)))) {
+			return errno;
+		}
+		if(tls->entry_number != -1 && tls->entry_number != TLS / sizeof(struct seg_desc)) {
+			return -EINVAL;
+		}
+		if((errno = set_tls_desc(&tls_desc, tls))) {
+			return errno;
+		}
+	}
+	if(flags & CLONE_PARENT_SETTID) {
+		if((errno = check_user_area(VERIFY_WRITE, parent_tid, sizeof(int)))) {
+			return errno;
+		}
+	}
 
 	/* check the number of processes already allocated by this UID */
 	count = 0;
@@ -68,6 +168,9 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 		return -EAGAIN;
 	}
 
+	/* the child inherits the FPU state */
+	fpu_save(current);
+
 	/* 
 	 * This memcpy() will overwrite the prev and next pointers, so that's
 	 * the reason why proc_slot_init() is separated from get_proc_free().
@@ -78,81 +181,126 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->pid = pid;
 	sprintk(child->pidstr, "%d", child->pid);
 
-	if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
-		release_proc(child);
-		return -ENOMEM;
+	if(flags & CLONE_THREAD) {
+		child->tgid = current->tgid;
+		child->ppid = current->ppid;
+	} else {
+		child->tgid = pid;
+		child->ppid = current->pid;
+	}
+	child->flags = current->flags & PF_USEDFPU;
+	if(flags & CLONE_VFORK) {
+		child->flags |= PF_VFORK;
 	}
-	child->rss++;
-	memcpy_b(child_pgdir, kpage_dir, PAGE_SIZE);
-	child->tss.cr3 = V2P((unsigned int)child_pgdir);
-
-	child->ppid = current->pid;
-	child->flags = 0;
 	child->children = 0;
 	child->cpu_count = child->priority;
 	child->start_time = CURRENT_TICKS;
 	child->sleep_address = NULL;
 
-	vma = current->vma_table;
-	child->vma_table = NULL;
-	while(vma) {
-		if(!(child_vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
-			kfree((unsigned int)child_pgdir);
-			free_vma_table(child);
-			release_proc(child);
-			return -ENOMEM;
-		}
-		*child_vma = *vma;
-		child_vma->prev = child_vma->next = NULL;
-		if(child_vma->inode) {
-			child_vma->inode->count++;
-		}
-		if(!child->vma_table) {
-			child->vma_table = child_vma;
-		} else {
-			child_vma->prev = child->vma_table->prev;
-			child->vma_table->prev->next = child_vma;
-		}
-		child->vma_table->prev = child_vma;
-		vma = vma->next;
-	}
-
 	child->sigpending = 0;
 	child->sigexecuting = 0;
 	memset_b(&child->sc, 0, sizeof(struct sigcontext));
 	memset_b(&child->usage, 0, sizeof(struct rusage));
 	memset_b(&child->cusage, 0, sizeof(struct rusage));
+	child->faults_around = 0;
+	child->preempt_count = 0;
 	child->it_real_interval = 0;
 	child->it_real_value = 0;
 	child->it_virt_interval = 0;
 	child->it_virt_value = 0;
 	child->it_prof_interval = 0;
 	child->it_prof_value = 0;
+#ifdef CONFIG_HRTIMERS
+	memset_b(&child->it_real_timer, 0, sizeof(struct hrtimer));
+	child->it_real_incr = 0;
+#endif /* CONFIG_HRTIMERS */
 #ifdef CONFIG_SYSVIPC
-	current->semundo = NULL;
+	child->semundo = NULL;
 #endif /* CONFIG_SYSVIPC */
+	if(flags & CLONE_SETTLS) {
+		child->tls = tls_desc;
+	}
+	child->set_child_tid = (flags & CLONE_CHILD_SETTID) ? child_tid : NULL;
+	child->clear_child_tid = (flags & CLONE_CHILD_CLEARTID) ? child_tid : NULL;
 
-
-	if(!(child->tss.esp0 = kmalloc(PAGE_SIZE))) {
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
+	if(copy_shared(child, flags)) {
 		release_proc(child);
 		return -ENOMEM;
 	}
-
-	if(!(pages = clone_pages(child))) {
-		printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
-		free_page_tables(child);
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
+	if(!(child->tss.esp0 = kmalloc(PAGE_SIZE))) {
+		put_shared(child);
 		release_proc(child);
 		return -ENOMEM;
 	}
-	child->rss += pages;
-	invalidate_tlb();
+
+	if(flags & CLONE_VM) {
+		child->mm->count++;
+		child->mm->users++;
+	} else {
+		if(!(child->mm = (struct mm *)kmalloc(sizeof(struct mm)))) {
+			kfree(child->tss.esp0);
+			put_shared(child);
+			release_proc(child);
+			return -ENOMEM;
+		}
+		memcpy_b(child->mm, current->mm, sizeof(struct mm));
+		child->mm->count = child->mm->users = 1;
+
+		if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
+			kfree((unsigned int)child->mm);
+			kfree(child->tss.esp0);
+			put_shared(child);
+			release_proc(child);
+			return -ENOMEM;
+		}
+		child->mm->rss = 1;
+		memcpy_b(child_pgdir, kpage_dir, PAGE_SIZE);
+		child->tss.cr3 = V2P((unsigned int)child_pgdir);
+
+		vma = current->mm->vma_table;
+		child->mm->vma_table = NULL;
+		while(vma) {
+			if(!(child_vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
+				kfree((unsigned int)child_pgdir);
+				free_vma_table(child);
+				kfree((unsigned int)child->mm);
+				kfree(child->tss.esp0);
+				put_shared(child);
+				release_proc(child);
+				return -ENOMEM;
+			}
+			*child_vma = *vma;
+			child_vma->prev = child_vma->next = NULL;
+			if(child_vma->inode) {
+				child_vma->inode->count++;
+			}
+			if(!child->mm->vma_table) {
+				child->mm->vma_table = child_vma;
+			} else {
+				child_vma->prev = child->mm->vma_table->prev;
+				child->mm->vma_table->prev->next = child_vma;
+			}
+			child->mm->vma_table->prev = child_vma;
+			vma = vma->next;
+		}
+
+		if(!(pages = clone_pages(child))) {
+			printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
+			free_page_tables(child);
+			kfree((unsigned int)child_pgdir);
+			free_vma_table(child);
+			kfree((unsigned int)child->mm);
+			kfree(child->tss.esp0);
+			put_shared(child);
+			release_proc(child);
+			return -ENOMEM;
+		}
+		child->mm->rss += pages;
+		flush_tlb();
+	}
 
 	child->tss.esp0 += PAGE_SIZE - 4;
-	child->rss++;
+	child->mm->rss++;
 	child->tss.ss0 = KERNEL_DS;
 
 	memcpy_b((unsigned int *)(child->tss.esp0 & PAGE_MASK), (void *)((unsigned int)(sc) & PAGE_MASK), PAGE_SIZE);
@@ -161,24 +309,51 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->tss.eip = (unsigned int)return_from_syscall;
 	child->tss.esp = (unsigned int)stack;
 	stack->eax = 0;		/* child returns 0 */
+	if(newsp) {
+		stack->oldesp = newsp;
+	}
 
-	/* increase file descriptors usage */
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			fd_table[current->fd[n]].count++;
+	if(child->set_child_tid) {
+		if(flags & CLONE_VM) {
+			/* it's the same memory */
+			if(!check_user_area(VERIFY_WRITE, child_tid, sizeof(int))) {
+				*child_tid = child->pid;
+			}
+			child->set_child_tid = NULL;
+		} else {
+			child->tss.eip = (unsigned int)ret_from_fork;
 		}
 	}
-	if(current->root) {
-		current->root->count++;
-	}
-	if(current->pwd) {
-		current->pwd->count++;
+	if(flags & CLONE_PARENT_SETTID) {
+		*parent_tid = child->pid;
 	}
 
 	kstat.processes++;
 	nr_processes++;
-	current->children++;
+	if(TG_LEADER(child)) {
+		current->children++;
+	}
 	runnable(child);
 
-	return child->pid;	/* parent returns child's PID */
+	/* the parent waits until the child releases the address space */
+	if(flags & CLONE_VFORK) {
+		while(child->pid == pid && child->flags & PF_VFORK) {
+			sleep(child, PROC_UNINTERRUPTIBLE);
+		}
+	}
+
+	return pid;	/* parent returns child's PID */
+}
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_fork()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	return do_fork(0, 0, NULL, NULL, NULL, sc);
 }
@@ -28,7 +28,7 @@ int sys_fstat(unsigned int ufd, struct old_stat *statbuf)
 	if((errno = check_user_area(VERIFY_WRITE, statbuf, sizeof(struct old_stat)))) {
 		return errno;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	statbuf->st_dev = i->dev;
 	statbuf->st_ino = i->inode;
 	statbuf->st_mode = i->i_mode;
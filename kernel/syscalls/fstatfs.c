@@ -27,7 +27,7 @@ int sys_fstatfs(unsigned int ufd, struct statfs *statfsbuf)
 	if((errno = check_user_area(VERIFY_WRITE, statfsbuf, sizeof(struct statfs)))) {
 		return errno;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(i->sb && i->sb->fsop && i->sb->fsop->statfs) {
 		i->sb->fsop->statfs(i->sb, statfsbuf);
 		return 0;
@@ -25,7 +25,7 @@ int sys_fsync(unsigned int ufd)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(!S_ISREG(i->i_mode)) {
 		return -EINVAL;
 	}
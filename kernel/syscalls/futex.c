@@ -0,0 +1,42 @@
+/*
+ * fiwix/kernel/syscalls/futex.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+#include <fiwix/futex.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_futex(int *uaddr, int op, int val, const struct timespec *timeout, int *uaddr2, int val3)
+#else
+int sys_futex(int *uaddr, int op, int val, const struct timespec *timeout, int *uaddr2)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_futex(0x%08x, %d, %d, 0x%08x, 0x%08x)\n", current->pid, (unsigned int)uaddr, op, val, (unsigned int)timeout, (unsigned int)uaddr2);
+#endif /*__DEBUG__ */
+
+	switch(op & FUTEX_CMD_MASK) {
+		case FUTEX_WAIT:
+			return futex_wait(uaddr, val, timeout);
+		case FUTEX_WAKE:
+			return futex_wake(uaddr, val);
+		case FUTEX_REQUEUE:
+			/* the 4th argument is the number of waiters to requeue */
+			return futex_requeue(uaddr, val, (int)timeout, uaddr2, 0, 0);
+#ifdef CONFIG_SYSCALL_6TH_ARG
+		case FUTEX_CMP_REQUEUE:
+			return futex_requeue(uaddr, val, (int)timeout, uaddr2, 1, val3);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+	}
+	return -ENOSYS;
+}
@@ -0,0 +1,52 @@
+/*
+ * fiwix/kernel/syscalls/get_thread_area.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/segments.h>
+#include <fiwix/process.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_get_thread_area(struct user_desc *u_info)
+{
+	struct seg_desc *d;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_get_thread_area(0x%08x)\n", current->pid, (unsigned int)u_info);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, u_info, sizeof(struct user_desc)))) {
+		return errno;
+	}
+	if(u_info->entry_number != TLS / sizeof(struct seg_desc)) {
+		return -EINVAL;
+	}
+
+	d = &current->tls;
+	memset_b(u_info, 0, sizeof(struct user_desc));
+	u_info->entry_number = TLS / sizeof(struct seg_desc);
+	if(!(d->sd_loflags & SD_PRESENT) && !d->sd_lobase && !d->sd_hibase && !d->sd_lolimit && !d->sd_hilimit) {
+		/* empty descriptor */
+		u_info->read_exec_only = 1;
+		u_info->seg_not_present = 1;
+		return 0;
+	}
+	u_info->base_addr = d->sd_lobase | (d->sd_hibase << 24);
+	u_info->limit = d->sd_lolimit | (d->sd_hilimit << 16);
+	u_info->seg_32bit = (d->sd_hiflags & SD_OPSIZE32) ? 1 : 0;
+	u_info->contents = (d->sd_loflags >> 2) & 3;
+	u_info->read_exec_only = (d->sd_loflags & 2) ? 0 : 1;
+	u_info->limit_in_pages = (d->sd_hiflags & SD_PAGE4KB) ? 1 : 0;
+	u_info->seg_not_present = (d->sd_loflags & SD_PRESENT) ? 0 : 1;
+	u_info->useable = d->sd_hiflags & 1;
+	return 0;
+}
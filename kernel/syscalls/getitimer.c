@@ -30,6 +30,13 @@ int sys_getitimer(int which, struct itimerval *curr_value)
 
 	switch(which) {
 		case ITIMER_REAL:
+#ifdef CONFIG_HRTIMERS
+			if(hrtimers_enabled) {
+				usecs2tv(current->it_real_incr, &curr_value->it_interval);
+				usecs2tv(hrtimer_remaining(&current->it_real_timer), &curr_value->it_value);
+				break;
+			}
+#endif /* CONFIG_HRTIMERS */
 			ticks2tv(current->it_real_interval, &curr_value->it_interval);
 			ticks2tv(current->it_real_value, &curr_value->it_value);
 			break;
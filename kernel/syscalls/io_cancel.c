@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/io_cancel.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/aio.h>
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_io_cancel(aio_context_t ctx, struct iocb *iocb, struct io_event *result)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_io_cancel(0x%08x, 0x%08x, 0x%08x)\n", current->pid, ctx, (unsigned int)iocb, (unsigned int)result);
+#endif /*__DEBUG__ */
+
+	return aio_cancel(ctx, iocb, result);
+}
@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/io_destroy.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/aio.h>
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_io_destroy(aio_context_t ctx)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_io_destroy(0x%08x)\n", current->pid, ctx);
+#endif /*__DEBUG__ */
+
+	return aio_destroy(ctx);
+}
@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/io_getevents.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/aio.h>
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_io_getevents(aio_context_t ctx, int min_nr, int nr, struct io_event *events, const struct timespec *timeout)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_io_getevents(0x%08x, %d, %d, 0x%08x, 0x%08x)\n", current->pid, ctx, min_nr, nr, (unsigned int)events, (unsigned int)timeout);
+#endif /*__DEBUG__ */
+
+	return aio_getevents(ctx, min_nr, nr, events, timeout);
+}
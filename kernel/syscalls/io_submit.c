@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/io_submit.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/aio.h>
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_io_submit(aio_context_t ctx, int nr, struct iocb **iocbpp)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_io_submit(0x%08x, %d, 0x%08x)\n", current->pid, ctx, nr, (unsigned int)iocbpp);
+#endif /*__DEBUG__ */
+
+	return aio_submit(ctx, nr, iocbpp);
+}
@@ -22,7 +22,7 @@ int sys_ioctl(unsigned int fd, int cmd, unsigned int arg)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(fd);
-	i = fd_table[current->fd[fd]].inode;
+	i = fd_table[current->files->fd[fd]].inode;
 	if(i->fsop && i->fsop->ioctl) {
 		errno = i->fsop->ioctl(i, cmd, arg);
 
@@ -0,0 +1,38 @@
+/*
+ * fiwix/kernel/syscalls/madvise.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_madvise(unsigned int addr, __size_t length, int advice)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_madvise(0x%08x, %d, %d)\n", current->pid, addr, length, advice);
+#endif /*__DEBUG__ */
+
+	if(addr & ~PAGE_MASK) {
+		return -EINVAL;
+	}
+	if(advice < MADV_NORMAL || advice > MADV_DONTNEED) {
+		return -EINVAL;
+	}
+	length = PAGE_ALIGN(length);
+	if(addr + length < addr) {
+		return -EINVAL;
+	}
+	if(!length) {
+		return 0;
+	}
+	return do_madvise(addr, length, advice);
+}
@@ -18,6 +18,45 @@
 #include <fiwix/process.h>
 #endif /*__DEBUG__ */
 
+/* the mount options are only available while the filesystem is being mounted */
+static int read_superblock(struct filesystems *fs, __dev_t dev, struct superblock *sb, const void *data)
+{
+	int errno;
+
+	sb->options = NULL;
+	if(data) {
+		if((errno = malloc_name(data, &sb->options)) < 0) {
+			sb->options = NULL;
+			return errno;
+		}
+	}
+	errno = fs->fsop->read_superblock(dev, sb);
+	if(sb->options) {
+		free_name(sb->options);
+		sb->options = NULL;
+	}
+	return errno;
+}
+
+static int remount_fs(struct filesystems *fs, struct superblock *sb, int flags, const void *data)
+{
+	int errno;
+
+	sb->options = NULL;
+	if(data) {
+		if((errno = malloc_name(data, &sb->options)) < 0) {
+			sb->options = NULL;
+			return errno;
+		}
+	}
+	errno = fs->fsop->remount_fs(sb, flags);
+	if(sb->options) {
+		free_name(sb->options);
+		sb->options = NULL;
+	}
+	return errno;
+}
+
 int sys_mount(const char *source, const char *target, const char *fstype, unsigned int flags, const void *data)
 {
 	struct inode *i_source, *i_target;
@@ -59,7 +98,7 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 		}
 		fs = mp->fs;
 		if(fs->fsop && fs->fsop->remount_fs) {
-			if((errno = fs->fsop->remount_fs(&mp->sb, flags))) {
+			if((errno = remount_fs(fs, &mp->sb, flags, data))) {
 				iput(i_target);
 				free_name(tmp_target);
 				return errno;
@@ -77,7 +116,8 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 			 * FIXME: if there are files opened in RW mode then
 			 * we can't continue and must return -EBUSY.
 			 */
-			if(fs->fsop && fs->fsop->release_superblock) {
+			/* filesystems without a device have nothing to flush */
+			if(fs->fsop->flags & FSOP_REQUIRES_DEV && fs->fsop->release_superblock) {
 				fs->fsop->release_superblock(&mp->sb);
 			}
 			sync_superblocks(dev);
@@ -110,6 +150,14 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 		return -ENODEV;
 	}
 	dev = fs->fsop->fsdev;
+	if(fs->fsop->flags & FSOP_UNNAMED_DEV) {
+		if(!(dev = get_unnamed_dev())) {
+			iput(i_target);
+			free_name(tmp_target);
+			free_name(tmp_fstype);
+			return -EBUSY;
+		}
+	}
 
 	if((errno = malloc_name(source, &tmp_source)) < 0) {
 		iput(i_target);
@@ -167,9 +215,9 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 
 	mp->sb.flags = flags;
 	if(fs->fsop->read_superblock) {
-		if((errno = fs->fsop->read_superblock(dev, &mp->sb))) {
-			i_source->fsop->close(i_source, NULL);
+		if((errno = read_superblock(fs, dev, &mp->sb, data))) {
 			if(fs->fsop->flags == FSOP_REQUIRES_DEV) {
+				i_source->fsop->close(i_source, NULL);
 				iput(i_source);
 			}
 			iput(i_target);
@@ -0,0 +1,25 @@
+/*
+ * fiwix/kernel/syscalls/mremap.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_mremap(unsigned int addr, __size_t old_len, __size_t new_len, int flags, unsigned int new_addr)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mremap(0x%08x, %d, %d, 0x%x, 0x%08x)\n", current->pid, addr, old_len, new_len, flags, new_addr);
+#endif /*__DEBUG__ */
+
+	return do_mremap(addr, old_len, new_len, flags, new_addr);
+}
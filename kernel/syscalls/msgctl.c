@@ -25,8 +25,8 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 	struct msqid_ds *mq;
 	struct msginfo *mi;
 	struct ipc_perm *perm;
-	struct msg *m, *mn;
-	int errno;
+	struct msg *m;
+	int errno, n;
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_msgctl(%d, %d, 0x%x)\n", current->pid, msqid, cmd, (int)buf);
@@ -86,16 +86,15 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 			if(!IS_SUPERUSER && current->euid != perm->uid && current->euid != perm->cuid) {
 				return -EPERM;
 			}
-			if((m = mq->msg_first)) {
-				do {
-					mq->msg_qnum--;
-					mq->msg_cbytes -= m->msg_ts;
-					num_msgs--;
-					mn = m->msg_next;
-					msg_release_md(m);
-					m = mn;
-				} while(m);
+			lock_resource(&ipcmsg_resource);
+			while((m = mq->msg_first)) {
+				msg_dequeue(mq, m);
+				msg_free_text(m);
+				unlock_resource(&ipcmsg_resource);
+				msg_release_md(m);
+				lock_resource(&ipcmsg_resource);
 			}
+			unlock_resource(&ipcmsg_resource);
 			msg_release_mq(mq);
 			msgque[msqid % MSGMNI] = (struct msqid_ds *)IPC_UNUSED;
 			num_queues--;
@@ -121,7 +120,12 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 				mi->msgpool = num_queues;
 				mi->msgmap = num_msgs;
 				mi->msgssz = 0;		/* FIXME: pending to do */
-				mi->msgtql = 0;		/* FIXME: pending to do */
+				mi->msgtql = 0;
+				for(n = 0; n <= max_mqid; n++) {
+					if(msgque[n] != IPC_UNUSED) {
+						mi->msgtql += msgque[n]->msg_mbytes;
+					}
+				}
 				mi->msgseg = 0;		/* FIXME: pending to do */
 			} else {
 				mi->msgpool = 0;	/* FIXME: pending to do */
@@ -10,6 +10,7 @@
 #include <fiwix/string.h>
 #include <fiwix/errno.h>
 #include <fiwix/process.h>
+#include <fiwix/mm.h>
 #include <fiwix/ipc.h>
 #include <fiwix/msg.h>
 
@@ -70,6 +71,195 @@ void msg_release_md(struct msg *msg)
 	unlock_resource(&ipcmsg_resource);
 }
 
+/*
+ * Message texts are allocated with kmalloc(), so small messages are served by
+ * the size classes of the buddy_low allocator instead of taking a full page.
+ */
+int msg_alloc_text(struct msg *m, int size)
+{
+	int level;
+
+	if(!(m->msg_spot = (void *)kmalloc(size))) {
+		return -ENOMEM;
+	}
+	m->msg_as = PAGE_SIZE;
+	for(level = 0; level < BUDDY_MAX_LEVEL; level++) {
+		if(size + sizeof(struct bl_head) <= bl_blocksize[level]) {
+			m->msg_as = bl_blocksize[level];
+			break;
+		}
+	}
+	return 0;
+}
+
+void msg_free_text(struct msg *m)
+{
+	if(m->msg_spot) {
+		kfree((unsigned int)m->msg_spot);
+		m->msg_spot = NULL;
+	}
+}
+
+/*
+ * The message type index keeps, for each type present in a queue, the list of
+ * its messages in arrival order. This makes a typed msgrcv() independent of
+ * the length of the queue.
+ */
+static struct msg_type msgtype_pool[MSGTQL];
+static struct msg_type *msgtype_hash[MSG_HASH_SIZE];
+
+#define MSGTYPE_HASH(mq, type)	((((mq) - msgque_pool) * 31 + (unsigned int)(type)) % MSG_HASH_SIZE)
+
+static struct msg_type *msgtype_lookup(struct msqid_ds *mq, int type)
+{
+	struct msg_type *mt;
+
+	mt = msgtype_hash[MSGTYPE_HASH(mq, type)];
+	while(mt) {
+		if(mt->mq == mq && mt->type == type) {
+			break;
+		}
+		mt = mt->next;
+	}
+	return mt;
+}
+
+static struct msg_type *msgtype_get(struct msqid_ds *mq, int type)
+{
+	struct msg_type *mt;
+	int n;
+
+	if((mt = msgtype_lookup(mq, type))) {
+		return mt;
+	}
+
+	/* there are never more types than messages, so this can't fail */
+	for(n = 0; n < MSGTQL; n++) {
+		if(!msgtype_pool[n].mq) {
+			mt = &msgtype_pool[n];
+			break;
+		}
+	}
+	mt->mq = mq;
+	mt->type = type;
+	mt->first = mt->last = NULL;
+	mt->next = msgtype_hash[MSGTYPE_HASH(mq, type)];
+	msgtype_hash[MSGTYPE_HASH(mq, type)] = mt;
+	mq->msg_ntypes++;
+	return mt;
+}
+
+static void msgtype_put(struct msg_type *mt)
+{
+	struct msg_type **h;
+
+	h = &msgtype_hash[MSGTYPE_HASH(mt->mq, mt->type)];
+	while(*h) {
+		if(*h == mt) {
+			*h = mt->next;
+			break;
+		}
+		h = &(*h)->next;
+	}
+	mt->mq->msg_ntypes--;
+	memset_b(mt, 0, sizeof(struct msg_type));
+}
+
+/* the caller must hold ipcmsg_resource */
+void msg_enqueue(struct msqid_ds *mq, struct msg *m)
+{
+	struct msg_type *mt;
+
+	m->msg_next = m->msg_tnext = NULL;
+	m->msg_prev = mq->msg_last;
+	if(!mq->msg_first) {
+		mq->msg_first = mq->msg_last = m;
+	} else {
+		mq->msg_last->msg_next = m;
+		mq->msg_last = m;
+	}
+
+	mt = msgtype_get(mq, m->msg_type);
+	if(!mt->first) {
+		mt->first = mt->last = m;
+	} else {
+		mt->last->msg_tnext = m;
+		mt->last = m;
+	}
+
+	mq->msg_qnum++;
+	mq->msg_cbytes += m->msg_ts;
+	mq->msg_mbytes += m->msg_as;
+	num_msgs++;
+}
+
+/*
+ * Removes a message from its queue. Since messages are always received in
+ * arrival order within their type, 'm' is always the first of its type.
+ * The caller must hold ipcmsg_resource.
+ */
+void msg_dequeue(struct msqid_ds *mq, struct msg *m)
+{
+	struct msg_type *mt;
+
+	if(m->msg_prev) {
+		m->msg_prev->msg_next = m->msg_next;
+	} else {
+		mq->msg_first = m->msg_next;
+	}
+	if(m->msg_next) {
+		m->msg_next->msg_prev = m->msg_prev;
+	} else {
+		mq->msg_last = m->msg_prev;
+	}
+
+	if((mt = msgtype_lookup(mq, m->msg_type))) {
+		if(!(mt->first = m->msg_tnext)) {
+			msgtype_put(mt);
+		}
+	}
+
+	mq->msg_qnum--;
+	mq->msg_cbytes -= m->msg_ts;
+	mq->msg_mbytes -= m->msg_as;
+	num_msgs--;
+}
+
+/* returns the message that msgrcv() must receive, or NULL */
+struct msg *msg_find(struct msqid_ds *mq, int msgtyp, int msgflg)
+{
+	struct msg_type *mt;
+	struct msg *m, *found;
+
+	if(!msgtyp) {
+		return mq->msg_first;
+	}
+
+	if(msgtyp > 0) {
+		if(!(msgflg & MSG_EXCEPT)) {
+			mt = msgtype_lookup(mq, msgtyp);
+			return mt ? mt->first : NULL;
+		}
+		for(m = mq->msg_first; m; m = m->msg_next) {
+			if(m->msg_type != msgtyp) {
+				return m;
+			}
+		}
+		return NULL;
+	}
+
+	/* the first message with the lowest type less than or equal to |msgtyp| */
+	found = NULL;
+	for(m = mq->msg_first; m; m = m->msg_next) {
+		if(m->msg_type <= -msgtyp) {
+			if(!found || m->msg_type < found->msg_type) {
+				found = m;
+			}
+		}
+	}
+	return found;
+}
+
 void msg_init(void)
 {
 	int n;
@@ -79,6 +269,8 @@ void msg_init(void)
 	}
 	memset_b(msgque_pool, 0, sizeof(msgque_pool));
 	memset_b(msg_pool, 0, sizeof(msg_pool));
+	memset_b(msgtype_pool, 0, sizeof(msgtype_pool));
+	memset_b(msgtype_hash, 0, sizeof(msgtype_hash));
 	num_queues = num_msgs = max_mqid = msg_seq = 0;
 }
 
@@ -154,7 +346,7 @@ init:
 	mq->msg_first = mq->msg_last = NULL;
 	mq->msg_stime = mq->msg_rtime = 0;
 	mq->msg_ctime = CURRENT_TIME;
-	mq->unused1 = mq->unused2 = 0;
+	mq->msg_mbytes = mq->msg_ntypes = 0;
 	mq->msg_cbytes = mq->msg_qnum = 0;
 	mq->msg_qbytes = MSGMNB;
 	mq->msg_lspid = mq->msg_lrpid = 0;
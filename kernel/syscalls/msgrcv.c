@@ -26,8 +26,8 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 {
 	struct msqid_ds *mq;
 	struct msgbuf *mb;
-	struct msg *m, *mprev;
-	int errno, found, count;
+	struct msg *m;
+	int errno, count;
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_msgrcv(%d, 0x%08x, %d, %d, 0x%x)\n", current->pid, msqid, (int)msgp, msgsz, msgtyp, msgflg);
@@ -43,40 +43,11 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 	if(mq == IPC_UNUSED) {
 		return -EINVAL;
 	}
-	found = 0;
-	mprev = NULL;
 	for(;;) {
 		if(!ipc_has_perms(&mq->msg_perm, IPC_R)) {
 			return -EACCES;
 		}
-		if((m = mq->msg_first)) {
-			if(!msgtyp) {
-				break;
-			} else if(msgtyp > 0) {
-				if(msgflg & MSG_EXCEPT) {
-					while(m) {
-						if(m->msg_type != msgtyp) {
-							found = 1;
-							break;
-						}
-						mprev = m;
-						m = m->msg_next;
-					}
-				} else {
-					while(m) {
-						if(m->msg_type == msgtyp) {
-							found = 1;
-							break;
-						}
-						mprev = m;
-						m = m->msg_next;
-					}
-				}
-			} else {
-				/* FIXME: pending to do */
-			}
-		}
-		if(found) {
+		if((m = msg_find(mq, msgtyp, msgflg))) {
 			break;
 		}
 		if(msgflg & IPC_NOWAIT) {
@@ -105,18 +76,11 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 	memcpy_b(mb->mtext, m->msg_spot, count);
 
 	lock_resource(&ipcmsg_resource);
-	kfree((unsigned int)m->msg_spot);
-	if(!mprev) {
-		mq->msg_first = m->msg_next;
-	} else {
-		mprev->msg_next = m->msg_next;
-	}
+	msg_dequeue(mq, m);
 	mq->msg_rtime = mq->msg_ctime = CURRENT_TIME;
-	mq->msg_qnum--;
-	mq->msg_cbytes -= m->msg_ts;
 	mq->msg_lrpid = current->pid;
-	num_msgs--;
 	unlock_resource(&ipcmsg_resource);
+	msg_free_text(m);
 	msg_release_md(m);
 	wakeup(mq);
 	return count;
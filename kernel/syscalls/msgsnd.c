@@ -72,9 +72,8 @@ int sys_msgsnd(int msqid, const void *msgp, __size_t msgsz, int msgflg)
 	if(!(m = msg_get_new_md())) {
 		return -ENOMEM;
 	}
-	m->msg_next = NULL;
 	m->msg_type = mb->mtype;
-	if(!(m->msg_spot = (void *)kmalloc(PAGE_SIZE))) {
+	if(msg_alloc_text(m, msgsz)) {
 		msg_release_md(m);
 		return -ENOMEM;
 	}
@@ -82,17 +81,9 @@ int sys_msgsnd(int msqid, const void *msgp, __size_t msgsz, int msgflg)
 	m->msg_stime = CURRENT_TIME;
 	m->msg_ts = msgsz;
 	lock_resource(&ipcmsg_resource);
-	if(!mq->msg_first) {
-		mq->msg_first = mq->msg_last = m;
-	} else {
-		mq->msg_last->msg_next = m;
-		mq->msg_last = m;
-	}
+	msg_enqueue(mq, m);
 	mq->msg_stime = mq->msg_ctime = CURRENT_TIME;
-	mq->msg_qnum++;
-	mq->msg_cbytes += msgsz;
 	mq->msg_lspid = current->pid;
-	num_msgs++;
 	unlock_resource(&ipcmsg_resource);
 	wakeup(mq);
 	return 0;
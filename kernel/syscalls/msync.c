@@ -0,0 +1,81 @@
+/*
+ * fiwix/kernel/syscalls/msync.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/process.h>
+#include <fiwix/buffer.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_msync(unsigned int addr, __size_t length, int flags)
+{
+	struct vma *vma;
+	unsigned int end, next;
+	__dev_t dev;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_msync(0x%08x, %d, 0x%x)\n", current->pid, addr, length, flags);
+#endif /*__DEBUG__ */
+
+	if(addr & ~PAGE_MASK) {
+		return -EINVAL;
+	}
+	if(flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) {
+		return -EINVAL;
+	}
+	if((flags & MS_ASYNC) && (flags & MS_SYNC)) {
+		return -EINVAL;
+	}
+	length = PAGE_ALIGN(length);
+	end = addr + length;
+	if(end < addr) {
+		return -ENOMEM;
+	}
+
+	/* the whole range must be mapped */
+	next = addr;
+	for(vma = current->mm->vma_table; vma && vma->start < end; vma = vma->next) {
+		if(vma->end <= addr) {
+			continue;
+		}
+		if(vma->start > next) {
+			break;
+		}
+		next = vma->end;
+	}
+	if(next < end) {
+		return -ENOMEM;
+	}
+
+	/* the modified pages are written to the buffer cache */
+	if((errno = sync_mapped_pages(current, addr, end)) < 0) {
+		return errno;
+	}
+
+	/* and then to the disk, unless it's asynchronous */
+	if(flags & MS_SYNC) {
+		for(vma = current->mm->vma_table; vma && vma->start < end; vma = vma->next) {
+			if(vma->end <= addr || !vma->inode || !(vma->flags & MAP_SHARED)) {
+				continue;
+			}
+			dev = vma->inode->dev;
+			sync_inodes(dev);
+			sync_buffers(dev);
+		}
+	}
+
+	/* MS_INVALIDATE: the shared mappings already use the page cache */
+	return 0;
+}
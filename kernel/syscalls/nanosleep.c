@@ -9,6 +9,7 @@
 #include <fiwix/fs.h>
 #include <fiwix/time.h>
 #include <fiwix/timer.h>
+#include <fiwix/hrtimer.h>
 #include <fiwix/process.h>
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
@@ -22,6 +23,10 @@ int sys_nanosleep(const struct timespec *req, struct timespec *rem)
 {
 	int errno, nsec;
 	unsigned int timeout, flags;
+#ifdef CONFIG_HRTIMERS
+	struct hrtimer timer;
+	unsigned long long int usecs;
+#endif /* CONFIG_HRTIMERS */
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_nanosleep(0x%08x, 0x%08x)\n", current->pid, (unsigned int)req, (unsigned int)rem);
@@ -34,6 +39,38 @@ int sys_nanosleep(const struct timespec *req, struct timespec *rem)
 		return -EINVAL;
 	}
 
+#ifdef CONFIG_HRTIMERS
+	if(hrtimers_enabled) {
+		usecs = (unsigned long long int)req->tv_sec * 1000000 + (req->tv_nsec + 999) / 1000;
+		if(!usecs) {
+			return 0;
+		}
+		timer.fn = hrtimer_timeout;
+		timer.arg = (unsigned int)current;
+
+		SAVE_FLAGS(flags); CLI();
+		current->timeout = INFINITE_WAIT;
+		hrtimer_start(&timer, usecs);
+		sleep(&sys_nanosleep, PROC_INTERRUPTIBLE);
+		usecs = hrtimer_remaining(&timer);
+		hrtimer_cancel(&timer);
+		timeout = current->timeout;
+		current->timeout = 0;
+		RESTORE_FLAGS(flags);
+		if(timeout) {
+			if(rem) {
+				if((errno = check_user_area(VERIFY_WRITE, rem, sizeof(struct timespec)))) {
+					return errno;
+				}
+				rem->tv_sec = usecs / 1000000;
+				rem->tv_nsec = (usecs % 1000000) * 1000;
+			}
+			return -EINTR;
+		}
+		return 0;
+	}
+#endif /* CONFIG_HRTIMERS */
+
 	/*
 	 * Since the current maximum precision of the kernel is only 10ms, we
 	 * need to convert any lower request to a minimum of 10ms, even knowing
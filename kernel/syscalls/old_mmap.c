@@ -39,10 +39,10 @@ int old_mmap(struct mmap *mmap)
 	flags = 0;
 	if(!(mmap->flags & MAP_ANONYMOUS)) {
 		CHECK_UFD(mmap->fd);
-		if(!(i = fd_table[current->fd[mmap->fd]].inode)) {
+		if(!(i = fd_table[current->files->fd[mmap->fd]].inode)) {
 			return -EBADF;
 		}
-		flags = fd_table[current->fd[mmap->fd]].flags & O_ACCMODE;
+		flags = fd_table[current->files->fd[mmap->fd]].flags & O_ACCMODE;
 	}
 	page = do_mmap(i, mmap->start, mmap->length, mmap->prot, mmap->flags, mmap->offset, P_MMAP, flags, NULL);
 #ifdef __DEBUG__
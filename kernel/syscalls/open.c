@@ -107,6 +107,16 @@ int sys_open(const char *filename, int flags, __mode_t mode)
 		mode = 0;
 	}
 
+	/* direct I/O needs the blocks of a regular file or a block device */
+	if(flags & O_DIRECT) {
+		if(!S_ISBLK(i->i_mode) && !(S_ISREG(i->i_mode) && i->fsop && i->fsop->bmap)) {
+			iput(i);
+			iput(dir);
+			free_name(tmp_name);
+			return -EINVAL;
+		}
+	}
+
 	if((flags & O_ACCMODE) == O_RDONLY) {
 		perms = TO_READ;
 	} else if((flags & O_ACCMODE) == O_WRONLY) {
@@ -139,7 +149,7 @@ int sys_open(const char *filename, int flags, __mode_t mode)
 #endif /*__DEBUG__ */
 
 	fd_table[fd].flags = flags;
-	current->fd[ufd] = fd;
+	current->files->fd[ufd] = fd;
 	if(i->fsop && i->fsop->open) {
 		if((errno = i->fsop->open(i, &fd_table[fd])) < 0) {
 			release_fd(fd);
@@ -0,0 +1,30 @@
+/*
+ * fiwix/kernel/syscalls/sched_get_priority_min.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_get_priority_min(int policy)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_get_priority_min(%d)\n", current->pid, policy);
+#endif /*__DEBUG__ */
+
+	switch(policy) {
+		case SCHED_FIFO:
+		case SCHED_RR:
+			return 1;
+		case SCHED_OTHER:
+			return 0;
+	}
+	return -EINVAL;
+}
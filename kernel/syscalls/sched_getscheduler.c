@@ -0,0 +1,35 @@
+/*
+ * fiwix/kernel/syscalls/sched_getscheduler.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_getscheduler(__pid_t pid)
+{
+	struct proc *p;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_getscheduler(%d)\n", current->pid, pid);
+#endif /*__DEBUG__ */
+
+	if(pid < 0) {
+		return -EINVAL;
+	}
+	if(!pid) {
+		return current->policy;
+	}
+	if(!(p = get_proc_by_pid(pid))) {
+		return -ESRCH;
+	}
+	return p->policy;
+}
@@ -0,0 +1,49 @@
+/*
+ * fiwix/kernel/syscalls/sched_rr_get_interval.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+#include <fiwix/timer.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_rr_get_interval(__pid_t pid, struct timespec *tp)
+{
+	struct proc *p;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_rr_get_interval(%d, 0x%08x)\n", current->pid, pid, (unsigned int)tp);
+#endif /*__DEBUG__ */
+
+	if(pid < 0) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_WRITE, tp, sizeof(struct timespec)))) {
+		return errno;
+	}
+	if(!pid) {
+		p = current;
+	} else if(!(p = get_proc_by_pid(pid))) {
+		return -ESRCH;
+	}
+
+	/* SCHED_FIFO has no time slice */
+	if(p->policy == SCHED_FIFO) {
+		tp->tv_sec = tp->tv_nsec = 0;
+		return 0;
+	}
+	tp->tv_sec = p->priority / HZ;
+	tp->tv_nsec = (p->priority % HZ) * (1000000000 / HZ);
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * fiwix/kernel/syscalls/sched_setscheduler.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_setscheduler(__pid_t pid, int policy, const struct sched_param *param)
+{
+	struct proc *p;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_setscheduler(%d, %d, 0x%08x)\n", current->pid, pid, policy, (unsigned int)param);
+#endif /*__DEBUG__ */
+
+	if(pid < 0) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, param, sizeof(struct sched_param)))) {
+		return errno;
+	}
+	if(!pid) {
+		return set_scheduler(current, policy, param->sched_priority);
+	}
+	if(!(p = get_proc_by_pid(pid))) {
+		return -ESRCH;
+	}
+	return set_scheduler(p, policy, param->sched_priority);
+}
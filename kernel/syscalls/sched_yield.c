@@ -0,0 +1,32 @@
+/*
+ * fiwix/kernel/syscalls/sched_yield.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_yield(void)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_yield()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	if(RT_POLICY(current)) {
+		/* the rest of processes with the same priority run first */
+		yield_cpu(current);
+	} else {
+		/* its time slice ends here */
+		current->cpu_count = 0;
+		need_resched = 1;
+	}
+	do_sched();
+	return 0;
+}
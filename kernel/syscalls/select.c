@@ -5,10 +5,12 @@
  * Distributed under the terms of the Fiwix License.
  */
 
+#include <fiwix/asm.h>
 #include <fiwix/types.h>
 #include <fiwix/fs.h>
 #include <fiwix/process.h>
 #include <fiwix/timer.h>
+#include <fiwix/hrtimer.h>
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
 #include <fiwix/errno.h>
@@ -51,15 +53,16 @@ static int do_check(struct inode *i, int flag)
 int do_select(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds, fd_set *res_rfds, fd_set *res_wfds, fd_set *res_efds)
 {
 	int n, count;
+	unsigned int flags;
 	struct inode *i;
 
 	count = 0;
 	for(;;) {
 		for(n = 0; n < nfds; n++) {
-			if(!current->fd[n]) {
+			if(!current->files->fd[n]) {
 				continue;
 			}
-			i = fd_table[current->fd[n]].inode;
+			i = fd_table[current->files->fd[n]].inode;
 			if(__FD_ISSET(n, rfds)) {
 				if(do_check(i, SEL_R)) {
 					__FD_SET(n, res_rfds);
@@ -80,10 +83,14 @@ int do_select(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds, fd_set *res_rf
 			}
 		}
 
+		/* the timeout might expire from an interrupt in the meantime */
+		SAVE_FLAGS(flags); CLI();
 		if(count || !current->timeout || current->sigpending & ~current->sigblocked) {
+			RESTORE_FLAGS(flags);
 			break;
 		}
 		sleep(&do_select, PROC_INTERRUPTIBLE);
+		RESTORE_FLAGS(flags);
 	}
 
 	return count;
@@ -95,6 +102,12 @@ int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, s
 	fd_set rfds, wfds, efds;
 	fd_set res_rfds, res_wfds, res_efds;
 	int errno;
+#ifdef CONFIG_HRTIMERS
+	struct hrtimer timer;
+	unsigned long long int usecs;
+
+	usecs = 0;
+#endif /* CONFIG_HRTIMERS */
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_select(%d, 0x%08x, 0x%08x, 0x%08x, 0x%08x [%d])\n", current->pid, nfds, (int)readfds, (int)writefds, (int)exceptfds, (int)timeout, (int)timeout ? tv2ticks(timeout): 0);
@@ -139,6 +152,14 @@ int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, s
 
 	if(timeout) {
 		t = tv2ticks(timeout);
+#ifdef CONFIG_HRTIMERS
+		if(hrtimers_enabled && (usecs = tv2usecs(timeout))) {
+			t = INFINITE_WAIT;
+			timer.fn = hrtimer_timeout;
+			timer.arg = (unsigned int)current;
+			hrtimer_start(&timer, usecs);
+		}
+#endif /* CONFIG_HRTIMERS */
 	} else {
 		t = INFINITE_WAIT;
 	}
@@ -148,7 +169,15 @@ int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, s
 	__FD_ZERO(&res_efds);
 
 	current->timeout = t;
-	if((errno = do_select(nfds, &rfds, &wfds, &efds, &res_rfds, &res_wfds, &res_efds)) < 0) {
+	errno = do_select(nfds, &rfds, &wfds, &efds, &res_rfds, &res_wfds, &res_efds);
+#ifdef CONFIG_HRTIMERS
+	if(usecs) {
+		usecs = hrtimer_remaining(&timer);
+		hrtimer_cancel(&timer);
+	}
+#endif /* CONFIG_HRTIMERS */
+	if(errno < 0) {
+		current->timeout = 0;
 		return errno;
 	}
 	t = current->timeout;
@@ -164,6 +193,12 @@ int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, s
 		memcpy_b(exceptfds, &res_efds, sizeof(fd_set));
 	}
 	if(timeout) {
+#ifdef CONFIG_HRTIMERS
+		if(usecs || t == INFINITE_WAIT) {
+			usecs2tv(usecs, timeout);
+			return errno;
+		}
+#endif /* CONFIG_HRTIMERS */
 		ticks2tv(t, timeout);
 	}
 	return errno;
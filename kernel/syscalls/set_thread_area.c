@@ -0,0 +1,49 @@
+/*
+ * fiwix/kernel/syscalls/set_thread_area.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/segments.h>
+#include <fiwix/process.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+extern struct seg_desc gdt[NR_GDT_ENTRIES];
+
+/* there is only one TLS entry, the one with the TLS selector */
+int sys_set_thread_area(struct user_desc *u_info)
+{
+	struct seg_desc desc;
+	unsigned int flags;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_set_thread_area(0x%08x)\n", current->pid, (unsigned int)u_info);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, u_info, sizeof(struct user_desc)))) {
+		return errno;
+	}
+	if(u_info->entry_number == -1) {
+		u_info->entry_number = TLS / sizeof(struct seg_desc);
+	}
+	if(u_info->entry_number != TLS / sizeof(struct seg_desc)) {
+		return -EINVAL;
+	}
+	if((errno = set_tls_desc(&desc, u_info))) {
+		return errno;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	current->tls = desc;
+	CURRENT_GDT[TLS / sizeof(struct seg_desc)] = desc;
+	RESTORE_FLAGS(flags);
+	return 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * fiwix/kernel/syscalls/set_tid_address.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_set_tid_address(int *tidptr)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_set_tid_address(0x%08x)\n", current->pid, (unsigned int)tidptr);
+#endif /*__DEBUG__ */
+
+	current->clear_child_tid = tidptr;
+	return current->pid;
+}
@@ -9,6 +9,7 @@
 #include <fiwix/fs.h>
 #include <fiwix/time.h>
 #include <fiwix/timer.h>
+#include <fiwix/vsyscall.h>
 #include <fiwix/process.h>
 #include <fiwix/errno.h>
 
@@ -41,6 +42,9 @@ int sys_settimeofday(const struct timeval *tv, const struct timezone *tz)
 		}
 		kstat.tz_minuteswest = tz->tz_minuteswest;
 		kstat.tz_dsttime = tz->tz_dsttime;
+#ifdef CONFIG_VSYSCALL
+		vsyscall_update_time();
+#endif /* CONFIG_VSYSCALL */
 	}
 	return 0;
 }
@@ -20,12 +20,70 @@
 #include <fiwix/stdio.h>
 
 #ifdef CONFIG_SYSVIPC
+/*
+ * Tries to map the 4MB region that contains 'cr2' with a single 4MB page.
+ * This is only possible if the attach starts at a 4MB boundary and the pages
+ * of the segment in that region are either not allocated yet or were
+ * allocated as a 4MB page by a previous attach.
+ */
+static int shm_map_huge_page(struct vma *vma, unsigned int cr2)
+{
+	struct shmid_ds *seg;
+	unsigned int addr, base, index;
+	int n;
+
+	base = cr2 & HPAGE_MASK;
+	if(!pse_enabled || (vma->start & ~HPAGE_MASK) || base + HPAGE_SIZE > vma->end) {
+		return 1;
+	}
+
+	seg = (struct shmid_ds *)vma->object;
+	index = (base - vma->start) / PAGE_SIZE;
+	addr = seg->shm_pages[index];
+
+	if(!addr) {
+		for(n = 1; n < HPAGE_PAGES; n++) {
+			if(seg->shm_pages[index + n]) {
+				return 1;
+			}
+		}
+		if(!(addr = map_huge_page(current, base, 0, vma->prot))) {
+			return 1;
+		}
+		for(n = 0; n < HPAGE_PAGES; n++) {
+			seg->shm_pages[index + n] = addr + (n * PAGE_SIZE);
+		}
+		shm_rss += HPAGE_PAGES;
+	} else {
+		if(V2P(addr) & ~HPAGE_MASK) {
+			return 1;
+		}
+		for(n = 1; n < HPAGE_PAGES; n++) {
+			if(seg->shm_pages[index + n] != addr + (n * PAGE_SIZE)) {
+				return 1;
+			}
+		}
+		if(!map_huge_page(current, base, V2P(addr), vma->prot)) {
+			return 1;
+		}
+	}
+	for(n = 0; n < HPAGE_PAGES; n++) {
+		page_table[(V2P(addr) >> PAGE_SHIFT) + n].count++;
+	}
+
+	return 0;
+}
+
 int shm_map_page(struct vma *vma, unsigned int cr2)
 {
 	struct shmid_ds *seg;
 	struct page *pg;
 	unsigned int addr, index;
 
+	if(!shm_map_huge_page(vma, cr2)) {
+		return 0;
+	}
+
 	seg = (struct shmid_ds *)vma->object;
 	index = (cr2 - vma->start) / PAGE_SIZE;
 	addr = seg->shm_pages[index];
@@ -82,8 +140,16 @@ int sys_shmat(int shmid, char *shmaddr, int shmflg, unsigned int *raddr)
 			return -EINVAL;
 		}
 	} else {
-		if(!(addr = get_unmapped_vma_region(seg->shm_segsz))) {
-			return -ENOMEM;
+		if(pse_enabled && seg->shm_segsz >= HPAGE_SIZE) {
+			/* a 4MB boundary allows the use of 4MB pages */
+			if(!(addr = get_unmapped_vma_region(seg->shm_segsz + HPAGE_SIZE - PAGE_SIZE))) {
+				return -ENOMEM;
+			}
+			addr = HPAGE_ALIGN(addr);
+		} else {
+			if(!(addr = get_unmapped_vma_region(seg->shm_segsz))) {
+				return -ENOMEM;
+			}
 		}
 	}
 
@@ -21,7 +21,7 @@ int sys_umask(__mode_t mask)
 	printk("(pid %d) sys_umask(%d)\n", current->pid, mask);
 #endif /*__DEBUG__ */
 
-	old_umask = current->umask;
-	current->umask = mask & (S_IRWXU | S_IRWXG | S_IRWXO);
+	old_umask = current->fs->umask;
+	current->fs->umask = mask & (S_IRWXU | S_IRWXG | S_IRWXO);
 	return old_umask;
 }
@@ -35,7 +35,7 @@ int sys_wait4(__pid_t pid, int *status, int options, struct rusage *ru)
 	while(current->children) {
 		flag = 0;
 		FOR_EACH_PROCESS(p) {
-			if(p->ppid != current->pid) {
+			if(p->ppid != current->pid || !TG_LEADER(p)) {
 				p = p->next;
 				continue;
 			}
@@ -72,7 +72,8 @@ int sys_wait4(__pid_t pid, int *status, int options, struct rusage *ru)
 					}
 					return p->pid;
 				}
-				if(p->state == PROC_ZOMBIE) {
+				/* the leader is reported once all its threads have exited */
+				if(p->state == PROC_ZOMBIE && !live_threads(p)) {
 					add_rusage(p);
 					if(status) {
 						*status = p->exit_code;
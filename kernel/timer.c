@@ -11,10 +11,13 @@
 #include <fiwix/cmos.h>
 #include <fiwix/pit.h>
 #include <fiwix/timer.h>
+#include <fiwix/hrtimer.h>
+#include <fiwix/vsyscall.h>
 #include <fiwix/time.h>
 #include <fiwix/irq.h>
 #include <fiwix/sched.h>
 #include <fiwix/pic.h>
+#include <fiwix/apic.h>
 #include <fiwix/cmos.h>
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
@@ -174,10 +177,19 @@ void del_callout(struct callout_req *creq)
 
 void irq_timer(int num, struct sigcontext *sc)
 {
+#ifdef CONFIG_HRTIMERS
+	if(hrtimers_enabled && !hrtimer_interrupt()) {
+		return;
+	}
+#endif /* CONFIG_HRTIMERS */
+
 	if((++kstat.ticks % HZ) == 0) {
 		CURRENT_TIME++;
 		kstat.uptime++;
 	}
+#ifdef CONFIG_VSYSCALL
+	vsyscall_update_time();
+#endif /* CONFIG_VSYSCALL */
 
 	timer_bh.flags |= BH_ACTIVE;
 }
@@ -193,10 +205,43 @@ void ticks2tv(int ticks, struct timeval *tv)
 	tv->tv_usec = (ticks % HZ) * 1000000 / HZ;
 }
 
+#ifdef CONFIG_HRTIMERS
+static void it_real_fn(unsigned int arg)
+{
+	struct proc *p;
+
+	p = (struct proc *)arg;
+	send_sig(p, SIGALRM);
+	if(p->it_real_incr) {
+		hrtimer_start(&p->it_real_timer, p->it_real_incr);
+	}
+}
+#endif /* CONFIG_HRTIMERS */
+
 int setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
 {
+#ifdef CONFIG_HRTIMERS
+	unsigned long long int usecs;
+#endif /* CONFIG_HRTIMERS */
+
 	switch(which) {
 		case ITIMER_REAL:
+#ifdef CONFIG_HRTIMERS
+			if(hrtimers_enabled) {
+				if((unsigned int)old_value) {
+					usecs2tv(current->it_real_incr, &old_value->it_interval);
+					usecs2tv(hrtimer_remaining(&current->it_real_timer), &old_value->it_value);
+				}
+				hrtimer_cancel(&current->it_real_timer);
+				current->it_real_incr = tv2usecs(&new_value->it_interval);
+				if((usecs = tv2usecs(&new_value->it_value))) {
+					current->it_real_timer.fn = it_real_fn;
+					current->it_real_timer.arg = (unsigned int)current;
+					hrtimer_start(&current->it_real_timer, usecs);
+				}
+				break;
+			}
+#endif /* CONFIG_HRTIMERS */
 			if((unsigned int)old_value) {
 				ticks2tv(current->it_real_interval, &old_value->it_interval);
 				ticks2tv(current->it_real_value, &old_value->it_value);
@@ -252,10 +297,9 @@ unsigned int mktime(struct mt *mt)
 	return seconds;
 }
 
-void irq_timer_bh(struct sigcontext *sc)
+/* charges the tick to the process running in this CPU */
+void update_process_times(struct sigcontext *sc)
 {
-	struct proc *p;
-
 	if(sc->cs == KERNEL_CS) {
 		current->usage.ru_stime.tv_usec += TICK;
 		if(current->usage.ru_stime.tv_usec >= 1000000) {
@@ -295,6 +339,31 @@ void irq_timer_bh(struct sigcontext *sc)
 		}
 	}
 
+	if(current->pid > IDLE && RT_POLICY(current)) {
+		/* protection against runaway real-time processes */
+		current->rt_ticks++;
+		if(current->rt_ticks > current->rlim[RLIMIT_RTTIME].rlim_max / (1000000 / HZ)) {
+			send_sig(current, SIGKILL);
+		} else if(current->rt_ticks > current->rlim[RLIMIT_RTTIME].rlim_cur / (1000000 / HZ)) {
+			send_sig(current, SIGXCPU);
+		}
+
+		/* SCHED_FIFO has no time slice */
+		if(current->policy == SCHED_RR && --current->cpu_count <= 0) {
+			current->cpu_count = current->priority;
+			yield_cpu(current);
+		}
+	} else if(current->pid > IDLE && --current->cpu_count <= 0) {
+		current->cpu_count = 0;
+		need_resched = 1;
+	}
+}
+
+void irq_timer_bh(struct sigcontext *sc)
+{
+	struct proc *p;
+
+	update_process_times(sc);
 	calc_load();
 	FOR_EACH_PROCESS(p) {
 		if(p->timeout > 0 && p->timeout < INFINITE_WAIT) {
@@ -325,11 +394,6 @@ void irq_timer_bh(struct sigcontext *sc)
 			callouts_bh.flags |= BH_ACTIVE;
 		}
 	}
-
-	if(current->pid > IDLE && --current->cpu_count <= 0) {
-		current->cpu_count = 0;
-		need_resched = 1;
-	}
 }
 
 void do_callouts_bh(struct sigcontext *sc)
@@ -423,12 +487,21 @@ void set_system_time(__time_t t)
 	cmos_write_date(CMOS_CENTURY, (y - (y % 100)) / 100);
 
 	CURRENT_TIME = t;
+#ifdef CONFIG_VSYSCALL
+	vsyscall_update_time();
+#endif /* CONFIG_VSYSCALL */
 }
 
 int gettimeoffset(void)
 {
 	int count;
 
+#ifdef CONFIG_HRTIMERS
+	if(hrtimers_enabled) {
+		return hrtimer_offset();
+	}
+#endif /* CONFIG_HRTIMERS */
+
 	count = pit_getcounter0();
 	count = (LATCH - count) * TICK;
 	count /= LATCH;
@@ -439,12 +512,21 @@ int gettimeoffset(void)
 void timer_init(void)
 {
 	int n;
+	char *type;
 	struct callout *c;
 
 	add_bh(&timer_bh);
 	add_bh(&callouts_bh);
 
 	pit_init(HZ);
+	type = "PIT";
+
+	/* with SMP the PIT stays as the tick, the APs use their Local APIC */
+#if defined(CONFIG_APIC) && !defined(CONFIG_SMP)
+	if(apic_enabled && !lapic_timer_init(HZ)) {
+		type = "APIC";
+	}
+#endif /* CONFIG_APIC && !CONFIG_SMP */
 
 	memset_b(callout_pool, 0, sizeof(callout_pool));
 
@@ -457,7 +539,13 @@ void timer_init(void)
 	}
 	callout_head = NULL;
 
-	printk("clock     -                 %d\ttype=PIT Hz=%d\n", TIMER_IRQ, HZ);
+	printk("clock     -                 %d\ttype=%s Hz=%d", TIMER_IRQ, type, HZ);
+#ifdef CONFIG_HRTIMERS
+	if(!hrtimer_init()) {
+		printk(" hrtimers");
+	}
+#endif /* CONFIG_HRTIMERS */
+	printk("\n");
 	if(!register_irq(TIMER_IRQ, &irq_config_timer)) {
 		enable_irq(TIMER_IRQ);
 	}
@@ -144,6 +144,11 @@ void do_invalid_opcode(unsigned int trap, struct sigcontext *sc)
 
 void do_no_math_coprocessor(unsigned int trap, struct sigcontext *sc)
 {
+	if(cpu_table.has_fpu) {
+		fpu_restore();
+		return;
+	}
+
 	/* floating-point emulation would go here */
 
 	if(dump_registers(trap, sc)) {
@@ -250,7 +255,7 @@ void do_simd_fault(unsigned int trap, struct sigcontext *sc)
 	if(dump_registers(trap, sc)) {
 		PANIC("");
 	}
-	send_sig(current, SIGSEGV);
+	send_sig(current, SIGFPE);
 	return;
 }
 
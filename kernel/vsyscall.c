@@ -0,0 +1,138 @@
+/*
+ * fiwix/kernel/vsyscall.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/vsyscall.h>
+#include <fiwix/segments.h>
+#include <fiwix/cpu.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_VSYSCALL
+
+/*
+ * The vsyscall page is mapped (read-only) at VSYSCALL_ADDR in every process.
+ * It contains:
+ *
+ * - a routine that enters the kernel with the same registers as 'int $0x80'
+ *   does, using SYSENTER if the processor supports it, or just 'int $0x80'
+ *   otherwise. Its address is passed in the AT_SYSINFO auxiliary vector.
+ *
+ * - the time data (struct vtime), updated on every tick, along with the
+ *   routines vsyscall_gettimeofday() and vsyscall_time() that read it without
+ *   entering the kernel. Its address is passed in AT_VTIME.
+ */
+
+int sysenter_enabled = 0;
+static unsigned int vsyscall_page = 0;
+static struct vtime *vtime = NULL;
+
+/*
+ * SYSENTER doesn't save the user %ecx, %edx and %ebp registers since they
+ * are used to return, so the user routine saves them in its stack and passes
+ * the stack pointer in %ebp.
+ */
+int sysenter_args(struct sigcontext *sc)
+{
+	unsigned int *ustack;
+
+	ustack = (unsigned int *)sc->oldesp;
+	if(check_user_area(VERIFY_READ, ustack, 3 * sizeof(unsigned int))) {
+		return -EFAULT;
+	}
+	sc->ebp = ustack[0];
+	sc->edx = ustack[1];
+	sc->ecx = ustack[2];
+	return 0;
+}
+
+void vsyscall_update_time(void)
+{
+	unsigned int flags;
+	unsigned long long int tsc;
+
+	if(!vtime) {
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	tsc = vtime->mhz ? get_rdtsc() : 0;
+	vtime->seq++;
+	__asm__ __volatile__("" : : : "memory");
+	vtime->sec = CURRENT_TIME;
+	vtime->ticks = CURRENT_TICKS;
+	vtime->tsc_lo = (unsigned int)tsc;
+	vtime->tsc_hi = (unsigned int)(tsc >> 32);
+	vtime->tz_minuteswest = kstat.tz_minuteswest;
+	vtime->tz_dsttime = kstat.tz_dsttime;
+	__asm__ __volatile__("" : : : "memory");
+	vtime->seq++;
+	RESTORE_FLAGS(flags);
+}
+
+/* returns the address for AT_SYSINFO, or 0 if the page couldn't be mapped */
+unsigned int vsyscall_map(void)
+{
+	int errno;
+
+	if(!vsyscall_page) {
+		return 0;
+	}
+	errno = do_mmap(NULL, VSYSCALL_ADDR, PAGE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_FIXED, 0, P_VSYSCALL, 0, NULL);
+	if(errno < 0 && errno > -PAGE_SIZE) {
+		return 0;
+	}
+	if(!map_page_flags(current, VSYSCALL_ADDR, V2P(vsyscall_page), PROT_READ | PROT_EXEC, PAGE_NOALLOC)) {
+		do_munmap(VSYSCALL_ADDR, PAGE_SIZE);
+		return 0;
+	}
+	current->mm->rss++;
+	return VSYSCALL_ADDR + VSYSCALL_ENTRY;
+}
+
+void vsyscall_init(void)
+{
+	if(!(vsyscall_page = kmalloc(PAGE_SIZE))) {
+		printk("WARNING: %s(): unable to allocate the vsyscall page.\n", __FUNCTION__);
+		return;
+	}
+	memset_b((void *)vsyscall_page, 0, PAGE_SIZE);
+
+	/* the SEP flag is wrongly reported by the early Pentium Pro */
+	if(cpu_table.flags & CPU_SEP) {
+		if(cpu_table.family != 6 || cpu_table.model >= 3 || cpu_table.stepping >= 3) {
+			sysenter_enabled = 1;
+		}
+	}
+
+	if(sysenter_enabled) {
+		memcpy_b((void *)vsyscall_page, vsyscall_sysenter, end_vsyscall_sysenter - vsyscall_sysenter);
+		WRMSR(MSR_SYSENTER_CS, KERNEL_CS, 0);
+		WRMSR(MSR_SYSENTER_ESP, current->tss.esp0, 0);
+		WRMSR(MSR_SYSENTER_EIP, (unsigned int)sysenter_entry, 0);
+	} else {
+		memcpy_b((void *)vsyscall_page, vsyscall_int80, end_vsyscall_int80 - vsyscall_int80);
+	}
+
+	memcpy_b((void *)(vsyscall_page + VSYSCALL_GETTIMEOFDAY), vsyscall_gettimeofday, end_vsyscall_gettimeofday - vsyscall_gettimeofday);
+	memcpy_b((void *)(vsyscall_page + VSYSCALL_TIMEFN), vsyscall_time, end_vsyscall_time - vsyscall_time);
+	vtime = (struct vtime *)(vsyscall_page + VSYSCALL_VTIME);
+	vtime->gettimeofday = VSYSCALL_ADDR + VSYSCALL_GETTIMEOFDAY;
+	vtime->time = VSYSCALL_ADDR + VSYSCALL_TIMEFN;
+	if(cpu_table.flags & CPU_TSC) {
+		vtime->mhz = (cpu_table.hz + 500000) / 1000000;
+	}
+	vsyscall_update_time();
+}
+
+#endif /* CONFIG_VSYSCALL */
@@ -0,0 +1,91 @@
+/*
+ * fiwix/lib/lz4.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/lz4.h>
+
+#define LZ4_MIN_MATCH	4
+
+/* reads the extra bytes of a length that doesn't fit in its 4 bits */
+static int get_length(const unsigned char **ip, const unsigned char *iend, int len)
+{
+	unsigned char c;
+
+	if(len != 15) {
+		return len;
+	}
+	do {
+		if(*ip >= iend) {
+			return -1;
+		}
+		c = *(*ip)++;
+		len += c;
+	} while(c == 255);
+	return len;
+}
+
+/*
+ * Decompresses a raw LZ4 block (without the frame header) of 'srclen' bytes
+ * into 'dst', checking that neither buffer is overrun. Returns the number of
+ * bytes decompressed or -1 if the block is corrupt.
+ */
+int lz4_decompress(const char *src, int srclen, char *dst, int dstlen)
+{
+	const unsigned char *ip, *iend, *match;
+	unsigned char *op, *oend;
+	unsigned char token;
+	unsigned int offset;
+	int len;
+
+	ip = (const unsigned char *)src;
+	iend = ip + srclen;
+	op = (unsigned char *)dst;
+	oend = op + dstlen;
+
+	while(ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		if((len = get_length(&ip, iend, token >> 4)) < 0) {
+			return -1;
+		}
+		if(len > iend - ip || len > oend - op) {
+			return -1;
+		}
+		while(len--) {
+			*op++ = *ip++;
+		}
+
+		/* the last sequence has no match */
+		if(ip == iend) {
+			break;
+		}
+
+		/* match */
+		if(iend - ip < 2) {
+			return -1;
+		}
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(!offset || offset > op - (unsigned char *)dst) {
+			return -1;
+		}
+		if((len = get_length(&ip, iend, token & 15)) < 0) {
+			return -1;
+		}
+		len += LZ4_MIN_MATCH;
+		if(len > oend - op) {
+			return -1;
+		}
+		/* byte by byte, the source may overlap with the destination */
+		match = op - offset;
+		while(len--) {
+			*op++ = *match++;
+		}
+	}
+
+	return op - (unsigned char *)dst;
+}
@@ -434,3 +434,9 @@ int sprintk(char *buffer, const char *format, ...)
 	va_end(args);
 	return strlen(buffer);
 }
+
+int vsprintk(char *buffer, const char *format, va_list args)
+{
+	do_printk(buffer, format, args);
+	return strlen(buffer);
+}
@@ -42,6 +42,12 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 	pde = GET_PGDIR(cr2);
 	pte = GET_PGTBL(cr2);
 	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	if(pgdir[pde] & PAGE_PSE) {
+		if(!split_huge_page(current, pgdir, pde)) {
+			printk("%s(): not enough memory!\n", __FUNCTION__);
+			return 1;
+		}
+	}
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	page = (pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT;
 
@@ -59,12 +65,12 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 			printk("%s(): not enough memory!\n", __FUNCTION__);
 			return 1;
 		}
-		current->rss++;
+		current->mm->rss++;
 		memcpy_b((void *)addr, (void *)P2V((page << PAGE_SHIFT)), PAGE_SIZE);
 		pgtbl[pte] = V2P(addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
 		kfree(P2V((page << PAGE_SHIFT)));
-		current->rss--;
-		invalidate_tlb();
+		current->mm->rss--;
+		flush_tlb_page(cr2);
 		return 0;
 	} else {
 		/* last page of Copy On Write procedure */
@@ -76,7 +82,7 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 				return 0;
 			}
 			pgtbl[pte] = (page << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
-			invalidate_tlb();
+			flush_tlb_page(cr2);
 			return 0;
 		}
 	}
@@ -84,9 +90,83 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 	return 1;
 }
 
+/*
+ * Maps the pages of the file that are already in the page cache around the
+ * faulting address, so the next accesses to them won't fault. Only mappings
+ * that can share the cached pages are considered, and the pages never go
+ * beyond the page table of the faulting address.
+ */
+static void fault_around(struct vma *vma, unsigned int cr2)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int addr, start, end, file_offset;
+	struct page *pg;
+
+	start = cr2 & ~((FAULT_AROUND_PAGES * PAGE_SIZE) - 1);
+	end = start + (FAULT_AROUND_PAGES * PAGE_SIZE);
+	start = MAX(start, vma->start);
+	end = MIN(end, vma->end);
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	if(!(pgdir[GET_PGDIR(cr2)] & PAGE_PRESENT) || pgdir[GET_PGDIR(cr2)] & PAGE_PSE) {
+		return;
+	}
+	pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(cr2)] & PAGE_MASK));
+
+	for(addr = start; addr < end; addr += PAGE_SIZE) {
+		if(pgtbl[GET_PGTBL(addr)] & PAGE_PRESENT) {
+			continue;
+		}
+		file_offset = addr - vma->start + vma->offset;
+		if(file_offset >= vma->inode->i_size) {
+			break;
+		}
+		if(!(pg = search_page_hash(vma->inode, file_offset))) {
+			continue;
+		}
+		/* the page might be still being read from the disk */
+		if(pg->flags & PAGE_LOCKED) {
+			release_page(pg);
+			continue;
+		}
+		if(!map_page(current, addr, (unsigned int)V2P(pg->data), vma->prot)) {
+			release_page(pg);
+			break;
+		}
+		current->faults_around++;
+	}
+}
+
+/*
+ * MADV_SEQUENTIAL: the rest of the current window of the file and the next
+ * one are read into the page cache ahead of time, and the pages of a shared
+ * mapping that were left two windows behind are unmapped so that they can be
+ * reclaimed early.
+ */
+static void fault_sequential(struct vma *vma, unsigned int cr2)
+{
+	unsigned int window, start, end;
+
+	window = FAULT_AROUND_PAGES * PAGE_SIZE;
+	start = (cr2 & PAGE_MASK) + PAGE_SIZE;
+	end = MIN((cr2 & ~(window - 1)) + (window * 2), vma->end);
+	if(start < end) {
+		read_ahead_pages(vma->inode, start - vma->start + vma->offset, end - start);
+	}
+
+	if(vma->flags & MAP_SHARED) {
+		end = (cr2 & ~(window - 1)) - window;
+		start = end - window;
+		if(end > start && start >= vma->start && end <= cr2) {
+			free_vma_pages(vma, start, window);
+			flush_tlb_range(start, window);
+		}
+	}
+}
+
 static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext *sc)
 {
-	unsigned int addr, file_offset;
+	unsigned int addr, base, file_offset;
 	struct page *pg;
 
 	if(!vma) {
@@ -115,9 +195,20 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 		file_offset &= PAGE_MASK;
 		pg = NULL;
 
-		if(!(vma->prot & PROT_WRITE) || vma->flags & MAP_SHARED) {
-			/* check if it's already in cache */
-			if((pg = search_page_hash(vma->inode, file_offset))) {
+		/* check if it's already in cache */
+		if(!(pg = search_page_hash(vma->inode, file_offset))) {
+			/* filesystems without blocks keep their data in the page cache */
+			if(vma->inode->fsop->get_page && file_offset < vma->inode->i_size) {
+				if(!(pg = vma->inode->fsop->get_page(vma->inode, file_offset, vma->flags & MAP_SHARED ? FOR_WRITING : FOR_READING))) {
+					if(vma->flags & MAP_SHARED) {
+						send_sig(current, SIGBUS);
+						return 0;
+					}
+				}
+			}
+		}
+		if(pg) {
+			if(!(vma->prot & PROT_WRITE) || vma->flags & MAP_SHARED) {
 				if(!map_page(current, cr2, (unsigned int)V2P(pg->data), vma->prot)) {
 					printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
 					return 1;
@@ -125,6 +216,17 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 				page_lock(pg);
 				addr = (unsigned int)pg->data;
 				page_unlock(pg);
+			} else {
+				/* private writable pages get a copy of the cached page */
+				if(!(addr = map_page(current, cr2, 0, vma->prot))) {
+					printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
+					release_page(pg);
+					return 1;
+				}
+				page_lock(pg);
+				memcpy_b((void *)(addr & PAGE_MASK), pg->data, PAGE_SIZE);
+				page_unlock(pg);
+				release_page(pg);
 			}
 		}
 		if(!pg) {
@@ -132,12 +234,25 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 				printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
 				return 1;
 			}
-			pg = &page_table[V2P(addr) >> PAGE_SHIFT];
-			if(bread_page(pg, vma->inode, file_offset, vma->prot, vma->flags)) {
-				unmap_page(cr2);
-				return 1;
+			if(vma->inode->fsop->get_page) {
+				/* a hole, or beyond the end of the file */
+				memset_b((void *)(addr & PAGE_MASK), 0, PAGE_SIZE);
+			} else {
+				pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+				if(bread_page(pg, vma->inode, file_offset, vma->prot, vma->flags)) {
+					unmap_page(cr2);
+					return 1;
+				}
+				current->usage.ru_majflt++;
+			}
+		}
+		if(vma->advice == MADV_SEQUENTIAL) {
+			fault_sequential(vma, cr2);
+		}
+		if(!(vma->prot & PROT_WRITE) || vma->flags & MAP_SHARED) {
+			if(vma->advice != MADV_RANDOM) {
+				fault_around(vma, cr2);
 			}
-			current->usage.ru_majflt++;
 		}
 	} else {
 		current->usage.ru_minflt++;
@@ -149,6 +264,16 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 			}
 		}
 #endif /* CONFIG_SYSVIPC */
+		if(vma->flags & MAP_HUGETLB) {
+			/* the whole 4MB page must fit inside the vma region */
+			base = cr2 & HPAGE_MASK;
+			if(base >= vma->start && base + HPAGE_SIZE <= vma->end) {
+				if((addr = map_huge_page(current, base, 0, vma->prot))) {
+					memset_b((void *)addr, 0, HPAGE_SIZE);
+					return 0;
+				}
+			}
+		}
 	}
 
 	if(vma->flags & ZERO_PAGE) {
@@ -304,5 +429,5 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 
 	dump_registers(trap, sc);
 	show_vma_regions(current);
-	do_exit(SIGTERM);
+	do_group_exit(SIGTERM);
 }
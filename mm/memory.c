@@ -8,6 +8,7 @@
 
 #include <fiwix/kernel.h>
 #include <fiwix/asm.h>
+#include <fiwix/cpu.h>
 #include <fiwix/multiboot1.h>
 #include <fiwix/mm.h>
 #include <fiwix/mman.h>
@@ -17,6 +18,7 @@
 #include <fiwix/buffer.h>
 #include <fiwix/fs.h>
 #include <fiwix/kexec.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -24,7 +26,12 @@
 #define KERNEL_DATA_SIZE	((int)_edata - (int)_etext)
 #define KERNEL_BSS_SIZE		((int)_end - (int)_edata)
 
+/* larger ranges are invalidated with a full TLB flush */
+#define TLB_FLUSH_MAX		32
+
 unsigned int *kpage_dir;
+int pse_enabled = 0;
+int pge_enabled = 0;
 
 unsigned int proc_table_size = 0;
 unsigned int buffer_hash_table_size = 0;
@@ -45,6 +52,12 @@ unsigned int map_kaddr(unsigned int *page_dir, unsigned int from, unsigned int t
 	for(n = from; n < to; n += PAGE_SIZE) {
 		pde = GET_PGDIR(n);
 		pte = GET_PGTBL(n);
+		if(page_dir[pde] & PAGE_PSE) {
+			if(!split_huge_page(NULL, page_dir, pde)) {
+				printk("%s(): no memory\n", __FUNCTION__);
+				return 0;
+			}
+		}
 		if(!(page_dir[pde] & ~PAGE_MASK)) {
 			if (!addr) {
 				paddr = kmalloc(PAGE_SIZE);
@@ -132,10 +145,81 @@ unsigned int get_mapped_addr(struct proc *p, unsigned int addr)
 	pgdir = (unsigned int *)P2V(p->tss.cr3);
 	pde = GET_PGDIR(addr);
 	pte = GET_PGTBL(addr);
+	if(pgdir[pde] & PAGE_PSE) {
+		return ((pgdir[pde] & HPAGE_MASK) + (pte << PAGE_SHIFT)) | (pgdir[pde] & ~PAGE_MASK & ~PAGE_PSE);
+	}
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	return pgtbl[pte];
 }
 
+/*
+ * Makes sure the user page that contains 'addr' is mapped (and writable if
+ * 'type' is VERIFY_WRITE) and takes a reference to it, so that it stays in
+ * memory while a device transfers data straight from or to it. The page
+ * must be given back with release_page().
+ */
+struct page *get_user_page(unsigned int addr, int type)
+{
+	volatile char *p;
+	unsigned int flags, pte;
+	struct page *pg;
+
+	/* touching the page lets do_page_fault() map it or break the COW */
+	p = (volatile char *)addr;
+	if(type == VERIFY_WRITE) {
+		*p = *p;
+	} else {
+		pte = *p;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	pte = get_mapped_addr(current, addr);
+	if(!(pte & PAGE_PRESENT) || (type == VERIFY_WRITE && !(pte & PAGE_RW))) {
+		RESTORE_FLAGS(flags);
+		return NULL;
+	}
+	if(!is_valid_page(pte >> PAGE_SHIFT)) {
+		/* not a RAM page (i.e. a mapped framebuffer) */
+		RESTORE_FLAGS(flags);
+		return NULL;
+	}
+	pg = &page_table[pte >> PAGE_SHIFT];
+	if(pg->flags & PAGE_RESERVED || !pg->data) {
+		/* reserved pages (kernel, BIOS areas) are not reference counted */
+		RESTORE_FLAGS(flags);
+		return NULL;
+	}
+	pg->count++;
+	RESTORE_FLAGS(flags);
+	return pg;
+}
+
+/*
+ * Replaces a 4MB page directory entry by a page table that maps the same
+ * page frames with 4KB pages, so that a part of the region can be changed
+ * on its own (copy-on-write, partial unmap, etc.).
+ */
+unsigned int *split_huge_page(struct proc *p, unsigned int *pgdir, int pde)
+{
+	unsigned int *pgtbl;
+	unsigned int addr, flags;
+	int n;
+
+	if(!(pgtbl = (unsigned int *)kmalloc(PAGE_SIZE))) {
+		return NULL;
+	}
+	if(p) {
+		p->mm->rss++;
+	}
+	addr = pgdir[pde] & HPAGE_MASK;
+	flags = pgdir[pde] & ~PAGE_MASK & ~PAGE_PSE;
+	for(n = 0; n < PT_ENTRIES; n++) {
+		pgtbl[n] = (addr + (n << PAGE_SHIFT)) | flags;
+	}
+	pgdir[pde] = V2P((unsigned int)pgtbl) | (flags & (PAGE_PRESENT | PAGE_RW | PAGE_USER));
+	return pgtbl;
+}
+
 int clone_pages(struct proc *child)
 {
 	unsigned int *src_pgdir, *dst_pgdir;
@@ -148,7 +232,7 @@ int clone_pages(struct proc *child)
 
 	src_pgdir = (unsigned int *)P2V(current->tss.cr3);
 	dst_pgdir = (unsigned int *)P2V(child->tss.cr3);
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 	pages = 0;
 
 	while(vma) {
@@ -159,6 +243,14 @@ int clone_pages(struct proc *child)
 		for(n = vma->start; n < vma->end; n += PAGE_SIZE) {
 			pde = GET_PGDIR(n);
 			pte = GET_PGTBL(n);
+			if(src_pgdir[pde] & PAGE_PSE) {
+				/* copy-on-write works on 4KB pages */
+				if(!split_huge_page(current, src_pgdir, pde)) {
+					printk("%s(): returning 0!\n", __FUNCTION__);
+					return 0;
+				}
+				flush_tlb_page(n);
+			}
 			if(src_pgdir[pde] & PAGE_PRESENT) {
 				src_pgtbl = (unsigned int *)P2V((src_pgdir[pde] & PAGE_MASK));
 				if(!(dst_pgdir[pde] & PAGE_PRESENT)) {
@@ -166,7 +258,7 @@ int clone_pages(struct proc *child)
 						printk("%s(): returning 0!\n", __FUNCTION__);
 						return 0;
 					}
-					current->rss++;
+					current->mm->rss++;
 					pages++;
 					dst_pgdir[pde] = V2P(c_addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
 					memset_b((void *)c_addr, 0, PAGE_SIZE);
@@ -208,6 +300,9 @@ int free_page_tables(struct proc *p)
 
 	pgdir = (unsigned int *)P2V(p->tss.cr3);
 	for(n = 0, count = 0; n < PD_ENTRIES; n++) {
+		if(pgdir[n] & PAGE_PSE) {
+			continue;
+		}
 		if((pgdir[n] & (PAGE_PRESENT | PAGE_RW | PAGE_USER)) == (PAGE_PRESENT | PAGE_RW | PAGE_USER)) {
 			kfree(P2V(pgdir[n]) & PAGE_MASK);
 			pgdir[n] = 0;
@@ -232,11 +327,16 @@ unsigned int map_page_flags(struct proc *p, unsigned int vaddr, unsigned int add
 	pde = GET_PGDIR(vaddr);
 	pte = GET_PGTBL(vaddr);
 
+	if(pgdir[pde] & PAGE_PSE) {
+		if(!split_huge_page(p, pgdir, pde)) {
+			return 0;
+		}
+	}
 	if(!(pgdir[pde] & PAGE_PRESENT)) {	/* allocating page table */
 		if(!(newaddr = kmalloc(PAGE_SIZE))) {
 			return 0;
 		}
-		p->rss++;
+		p->mm->rss++;
 		pgdir[pde] = V2P(newaddr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
 		memset_b((void *)newaddr, 0, PAGE_SIZE);
 	}
@@ -247,7 +347,7 @@ unsigned int map_page_flags(struct proc *p, unsigned int vaddr, unsigned int add
 				return 0;
 			}
 			addr = V2P(addr);
-			p->rss++;
+			p->mm->rss++;
 		}
 		pgtbl[pte] = addr | PAGE_PRESENT | PAGE_USER | flags;
 	}
@@ -257,6 +357,87 @@ unsigned int map_page_flags(struct proc *p, unsigned int vaddr, unsigned int add
 	return P2V(addr);
 }
 
+/*
+ * Maps the 4MB region that contains 'vaddr' with a single PSE page directory
+ * entry. If 'addr' is zero a new set of contiguous page frames is allocated.
+ * It returns 0 if the region has already a page table or if there are no
+ * contiguous page frames available, so the caller can use 4KB pages instead.
+ */
+unsigned int map_huge_page(struct proc *p, unsigned int vaddr, unsigned int addr, unsigned int prot)
+{
+	unsigned int *pgdir;
+	struct page *pg;
+	int pde;
+
+	if(!pse_enabled) {
+		return 0;
+	}
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	pde = GET_PGDIR(vaddr);
+
+	if(pgdir[pde] & PAGE_PRESENT) {
+		return 0;
+	}
+	if(!addr) {
+		if(!(pg = get_free_huge_page())) {
+			return 0;
+		}
+		addr = pg->page << PAGE_SHIFT;
+		p->mm->rss += HPAGE_PAGES;
+	}
+	pgdir[pde] = addr | PAGE_PRESENT | PAGE_USER | PAGE_PSE;
+	if(prot & PROT_WRITE) {
+		pgdir[pde] |= PAGE_RW;
+	}
+	return P2V(addr);
+}
+
+/*
+ * Flushes the TLB entries of the current address space. The kernel pages are
+ * kept if they are global (CONFIG_PGE).
+ */
+void flush_tlb(void)
+{
+	kstat.tlb_flushes++;
+	invalidate_tlb();
+#ifdef CONFIG_SMP
+	smp_flush_tlb();
+#endif /* CONFIG_SMP */
+}
+
+void flush_tlb_page(unsigned int vaddr)
+{
+	/* INVLPG was introduced in the i486 */
+	if(cpu_table.family < 4) {
+		flush_tlb();
+		return;
+	}
+	kstat.tlb_page_flushes++;
+	INVLPG(vaddr);
+#ifdef CONFIG_SMP
+	smp_flush_tlb();
+#endif /* CONFIG_SMP */
+}
+
+void flush_tlb_range(unsigned int start, unsigned int length)
+{
+	unsigned int n;
+
+	if(cpu_table.family < 4 || length > TLB_FLUSH_MAX * PAGE_SIZE) {
+		flush_tlb();
+		return;
+	}
+	for(n = start & PAGE_MASK; n < start + length; n += PAGE_SIZE) {
+		kstat.tlb_page_flushes++;
+		INVLPG(n);
+	}
+#ifdef CONFIG_SMP
+	/* the other CPUs flush their whole TLB only once */
+	smp_flush_tlb();
+#endif /* CONFIG_SMP */
+}
+
 int unmap_page(unsigned int vaddr)
 {
 	unsigned int *pgdir, *pgtbl;
@@ -270,6 +451,11 @@ int unmap_page(unsigned int vaddr)
 		printk("WARNING: %s(): trying to unmap an unallocated pde '0x%08x'\n", __FUNCTION__, vaddr);
 		return 1;
 	}
+	if(pgdir[pde] & PAGE_PSE) {
+		if(!split_huge_page(current, pgdir, pde)) {
+			return 1;
+		}
+	}
 
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	if(!(pgtbl[pte] & PAGE_PRESENT)) {
@@ -280,10 +466,11 @@ int unmap_page(unsigned int vaddr)
 	desc = pgtbl[pte];
 	addr = desc & PAGE_MASK;
 	pgtbl[pte] = 0;
+	flush_tlb_page(vaddr);
 	if (!(desc & PAGE_NOALLOC)) {
 		kfree(P2V(addr));
 	}
-	current->rss--;
+	current->mm->rss--;
 	return 0;
 }
 
@@ -296,12 +483,37 @@ void mem_init(void)
 {
 	unsigned int sizek;
 	unsigned int physical_memory, physical_page_tables;
-	unsigned int *pgtbl;
-	int n, pages, last_ramdisk;
+	unsigned int *pgtbl, global;
+	int n, pte, pages, last_ramdisk;
 
+	global = 0;
 	physical_page_tables = (kstat.physical_pages / 1024) + ((kstat.physical_pages % 1024) ? 1 : 0);
 	physical_memory = (kstat.physical_pages << PAGE_SHIFT);	/* in bytes */
 
+#ifdef CONFIG_PGE
+	/* the kernel pages are the same in every address space */
+	if(cpu_table.flags & CPU_PGE) {
+		pge_enabled = 1;
+		global = PAGE_GLOBAL;
+	}
+#endif /* CONFIG_PGE */
+
+#ifdef CONFIG_PSE
+	if(cpu_table.flags & CPU_PSE) {
+		pse_enabled = 1;
+		/*
+		 * Every complete 4MB chunk of physical memory, except the
+		 * first one, is mapped with a single 4MB page and needs no
+		 * page table. The first chunk keeps 4KB pages since the memory
+		 * types of its first megabyte (fixed-range MTRRs) may differ
+		 * inside a single large page.
+		 */
+		if(kstat.physical_pages / 1024 > 1) {
+			physical_page_tables -= (kstat.physical_pages / 1024) - 1;
+		}
+	}
+#endif /* CONFIG_PSE */
+
 	/* align _last_data_addr to the next page */
 	_last_data_addr = PAGE_ALIGN(_last_data_addr);
 
@@ -316,11 +528,16 @@ void mem_init(void)
 	_last_data_addr += physical_page_tables * PAGE_SIZE;
 
 	/* Page Directory and Page Tables initialization */
-	for(n = 0; n < kstat.physical_pages; n++) {
-		pgtbl[n] = (n << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW;
+	for(n = 0, pte = 0; n < kstat.physical_pages; n++) {
 		if(!(n % 1024)) {
-			kpage_dir[GET_PGDIR(PAGE_OFFSET) + (n / 1024)] = (unsigned int)&pgtbl[n] | PAGE_PRESENT | PAGE_RW;
+			if(pse_enabled && n && n + 1024 <= kstat.physical_pages) {
+				kpage_dir[GET_PGDIR(PAGE_OFFSET) + (n / 1024)] = (n << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | PAGE_PSE | global;
+				n += 1024 - 1;
+				continue;
+			}
+			kpage_dir[GET_PGDIR(PAGE_OFFSET) + (n / 1024)] = (unsigned int)&pgtbl[pte] | PAGE_PRESENT | PAGE_RW;
 		}
+		pgtbl[pte++] = (n << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | global;
 	}
 	activate_kpage_dir();
 
@@ -422,6 +639,10 @@ void mem_init(void)
 	vcbuf = (short int *)_last_data_addr;
 	_last_data_addr += (video.columns * video.lines * SCREENS_LOG * 2 * sizeof(short int));
 
+#ifdef CONFIG_SMP
+	bios_map_reserve(SMP_BOOT_ADDR, SMP_BOOT_ADDR + PAGE_SIZE);
+#endif /* CONFIG_SMP */
+
 #ifdef CONFIG_KEXEC
 	if(kexec_size > 0) {
 		bios_map_reserve(KEXEC_BOOT_ADDR, KEXEC_BOOT_ADDR + (PAGE_SIZE * 2));
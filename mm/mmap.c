@@ -30,7 +30,7 @@ void show_vma_regions(struct proc *p)
 	unsigned int n;
 	int count;
 
-	vma = p->vma_table;
+	vma = p->mm->vma_table;
 	n = 0;
 	printk("num  address range         flag offset     dev   inode      mod section cnt\n");
 	printk("---- --------------------- ---- ---------- ----- ---------- --- ------- ----\n");
@@ -63,6 +63,8 @@ void show_vma_regions(struct proc *p)
 			case P_SHM:	section = "shm  ";
 					break;
 #endif /* CONFIG_SYSVIPC */
+			case P_VSYSCALL: section = "vsys ";
+					break;
 			default:
 				section = NULL;
 				break;
@@ -88,7 +90,7 @@ static void insert_vma_region(struct vma *vma)
 {
 	struct vma *vmat;
 
-	vmat = current->vma_table;
+	vmat = current->mm->vma_table;
 
 	while(vmat) {
 		if(vmat->start > vma->start) {
@@ -99,16 +101,16 @@ static void insert_vma_region(struct vma *vma)
 
 	if(!vmat) {
 		/* append */
-		vma->prev = current->vma_table->prev;
-		current->vma_table->prev->next = vma;
-		current->vma_table->prev = vma;
+		vma->prev = current->mm->vma_table->prev;
+		current->mm->vma_table->prev->next = vma;
+		current->mm->vma_table->prev = vma;
 	} else {
 		/* insert */
 		vma->prev = vmat->prev;
 		vma->next = vmat;
-		if(vmat == current->vma_table) {
+		if(vmat == current->mm->vma_table) {
 			/* insert in the head */
-			current->vma_table = vma;
+			current->mm->vma_table = vma;
 		} else {
 			/* insert in the middle */
 			vmat->prev->next = vma;
@@ -126,9 +128,9 @@ static void add_vma_region(struct vma *vma)
 	unsigned int flags;
 
 	SAVE_FLAGS(flags); CLI();
-	if(!current->vma_table) {
-		current->vma_table = vma;
-		current->vma_table->prev = vma;
+	if(!current->mm->vma_table) {
+		current->mm->vma_table = vma;
+		current->mm->vma_table->prev = vma;
 	} else {
 		insert_vma_region(vma);
 	}
@@ -152,15 +154,15 @@ static void del_vma_region(struct vma *vma)
 		vma->next->prev = vma->prev;
 	}
 	if(vma->prev) {
-		if(vma != current->vma_table) {
+		if(vma != current->mm->vma_table) {
 			vma->prev->next = vma->next;
 		}
 	}
 	if(!vma->next) {
-		current->vma_table->prev = vma->prev;
+		current->mm->vma_table->prev = vma->prev;
 	}
-	if(vma == current->vma_table) {
-		current->vma_table = vma->next;
+	if(vma == current->mm->vma_table) {
+		current->mm->vma_table = vma->next;
 	}
 	RESTORE_FLAGS(flags);
 
@@ -172,8 +174,9 @@ static int can_be_merged(struct vma *a, struct vma *b)
 	if((a->end == b->start) &&
 	   (a->prot == b->prot) &&
 	   (a->flags == b->flags) &&
-	   (a->offset == b->offset) &&
+	   (a->inode ? a->offset + (a->end - a->start) == b->offset : a->offset == b->offset) &&
 	   (a->s_type == b->s_type) &&
+	   (a->advice == b->advice) &&
 #ifdef CONFIG_SYSVIPC
 	   (a->s_type != P_SHM) &&
 #endif /* CONFIG_SYSVIPC */
@@ -184,14 +187,13 @@ static int can_be_merged(struct vma *a, struct vma *b)
 	return 0;
 }
 
-static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length)
+/*
+ * Removes the range from the vma. If it's in the middle, 'new' (allocated by
+ * the caller) becomes the part after it.
+ */
+static void cut_vma_region(struct vma *vma, unsigned int start, __ssize_t length, struct vma *new)
 {
-	struct vma *new;
-
-	if(start + length < vma->end) {
-		if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
-			return -ENOMEM;
-		}
+	if(new) {
 		memset_b(new, 0, sizeof(struct vma));
 		new->start = start + length;
 		new->end = vma->end;
@@ -201,8 +203,12 @@ static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length
 		new->s_type = vma->s_type;
 		new->inode = vma->inode;
 		new->o_mode = vma->o_mode;
-	} else {
-		new = NULL;
+		new->advice = vma->advice;
+		if(new->inode) {
+			/* the rest of the file mapping keeps its own offset */
+			new->offset += new->start - vma->start;
+			new->inode->count++;
+		}
 	}
 
 	if(vma->start == start) {
@@ -217,7 +223,19 @@ static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length
 	if(new) {
 		add_vma_region(new);
 	}
+}
 
+static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length)
+{
+	struct vma *new;
+
+	new = NULL;
+	if(start + length < vma->end) {
+		if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
+			return -ENOMEM;
+		}
+	}
+	cut_vma_region(vma, start, length, new);
 	return 0;
 }
 
@@ -229,6 +247,9 @@ void merge_vma_regions(struct vma *a, struct vma *b)
 	if(b->start == a->end) {
 		if(can_be_merged(a, b)) {
 			a->end = b->end;
+			if(b->inode) {
+				iput(b->inode);
+			}
 			del_vma_region(b);
 			return;
 		}
@@ -238,6 +259,7 @@ void merge_vma_regions(struct vma *a, struct vma *b)
 		if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
 			return;
 		}
+		memset_b(new, 0, sizeof(struct vma));
 		new->start = b->end;
 		new->end = a->end;
 		new->prot = a->prot;
@@ -246,15 +268,25 @@ void merge_vma_regions(struct vma *a, struct vma *b)
 		new->s_type = a->s_type;
 		new->inode = a->inode;
 		new->o_mode = a->o_mode;
+		new->advice = a->advice;
+		if(new->inode) {
+			new->offset += new->start - a->start;
+		}
 		free_vma_pages(a, b->start, b->end - b->start);
-		invalidate_tlb();
+		flush_tlb_range(b->start, b->end - b->start);
 		a->end = b->start;
 		if(a->start == a->end) {
+			if(a->inode) {
+				iput(a->inode);
+			}
 			del_vma_region(a);
 		}
 		if(new->start >= new->end) {
 			kfree((unsigned int)new);
 		} else {
+			if(new->inode) {
+				new->inode->count++;
+			}
 			insert_vma_region(new);
 		}
 	}
@@ -274,6 +306,29 @@ void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 	for(n = 0; n < (length / PAGE_SIZE); n++) {
 		pde = GET_PGDIR(start + (n * PAGE_SIZE));
 		pte = GET_PGTBL(start + (n * PAGE_SIZE));
+		if(pgdir[pde] & PAGE_PSE) {
+			/* a whole 4MB page is released at once */
+			if(!pte && (length / PAGE_SIZE) - n >= HPAGE_PAGES) {
+				offset = pgdir[pde] & HPAGE_MASK;
+				for(pte = 0; pte < HPAGE_PAGES; pte++) {
+					kfree(P2V(offset));
+					offset += PAGE_SIZE;
+				}
+				current->mm->rss -= HPAGE_PAGES;
+#ifdef CONFIG_SYSVIPC
+				if(vma->object) {
+					shm_rss -= HPAGE_PAGES;
+				}
+#endif /* CONFIG_SYSVIPC */
+				pgdir[pde] = 0;
+				n += HPAGE_PAGES - 1;
+				continue;
+			}
+			if(!split_huge_page(current, pgdir, pde)) {
+				printk("WARNING: %s(): unable to split the 4MB page at 0x%08x.\n", __FUNCTION__, start + (n * PAGE_SIZE));
+				continue;
+			}
+		}
 		if(pgdir[pde] & PAGE_PRESENT) {
 			pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 			if(pgtbl[pte] & PAGE_PRESENT) {
@@ -285,14 +340,17 @@ void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 						continue;
 					}
 
-					if(vma->prot & PROT_WRITE && vma->flags & MAP_SHARED) {
+					/* only the pages written through the mapping */
+					if(vma->inode && vma->flags & MAP_SHARED && pgtbl[pte] & PAGE_DIRTY) {
 						offset = start - vma->start + vma->offset + n * PAGE_SIZE;
-						write_page(pg, vma->inode, offset, PAGE_SIZE);
+						if(offset < vma->inode->i_size) {
+							write_page(pg, vma->inode, offset, PAGE_SIZE);
+						}
 					}
 
 					kfree(P2V(pgtbl[pte]) & PAGE_MASK);
 				}
-				current->rss--;
+				current->mm->rss--;
 #ifdef CONFIG_SYSVIPC
 				if(vma->object) {
 					shm_rss--;
@@ -308,7 +366,7 @@ void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 				}
 				if(pte == PT_ENTRIES) {
 					kfree((unsigned int)pgtbl & PAGE_MASK);
-					current->rss--;
+					current->mm->rss--;
 					pgdir[pde] = 0;
 				}
 			}
@@ -320,7 +378,7 @@ void release_binary(void)
 {
 	struct vma *vma, *tmp;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		tmp = vma->next;
@@ -329,7 +387,7 @@ void release_binary(void)
 		vma = tmp;
 	}
 
-	invalidate_tlb();
+	flush_tlb();
 }
 
 struct vma *find_vma_region(unsigned int addr)
@@ -341,7 +399,7 @@ struct vma *find_vma_region(unsigned int addr)
 	}
 
 	addr &= PAGE_MASK;
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if((addr >= vma->start) && (addr < vma->end)) {
@@ -356,7 +414,7 @@ struct vma *find_vma_intersection(unsigned int start, unsigned int end)
 {
 	struct vma *vma;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if(end <= vma->start) {
@@ -374,7 +432,7 @@ int expand_heap(unsigned int new)
 {
 	struct vma *vma, *heap;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 	heap = NULL;
 
 	while(vma) {
@@ -406,7 +464,7 @@ unsigned int get_unmapped_vma_region(unsigned int length)
 	}
 
 	addr = MMAP_START;
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if(vma->start < MMAP_START) {
@@ -464,11 +522,17 @@ int do_mmap(struct inode *i, unsigned int start, unsigned int length, unsigned i
 		}
 		i->count++;
 
+		/* 4MB pages are only used for anonymous mappings */
+		flags &= ~MAP_HUGETLB;
+
 	/* anonymous mapping */
 	} else {
 		if((flags & MAP_TYPE) != MAP_PRIVATE) {
 			return -EINVAL;
 		}
+		if(!pse_enabled) {
+			flags &= ~MAP_HUGETLB;
+		}
 
 		/* anonymous objects must be filled with zeros */
 		flags |= ZERO_PAGE;
@@ -485,7 +549,14 @@ int do_mmap(struct inode *i, unsigned int start, unsigned int length, unsigned i
 			return -EINVAL;
 		}
 	} else {
-		start = get_unmapped_vma_region(length);
+		if(flags & MAP_HUGETLB) {
+			/* leave room enough to start at a 4MB boundary */
+			if((start = get_unmapped_vma_region(length + HPAGE_SIZE - PAGE_SIZE))) {
+				start = HPAGE_ALIGN(start);
+			}
+		} else {
+			start = get_unmapped_vma_region(length);
+		}
 		if(!start) {
 			printk("WARNING: %s(): unable to get an unmapped vma region.\n", __FUNCTION__);
 			return -ENOMEM;
@@ -540,16 +611,63 @@ int do_munmap(unsigned int addr, __size_t length)
 			}
 
 			free_vma_pages(vma, addr, size);
-			invalidate_tlb();
+			flush_tlb_range(addr, size);
 			free_vma_region(vma, addr, size);
 			length -= size;
 			addr += size;
+		} else {
+			/* skip the holes in the range */
+			length -= PAGE_SIZE;
+			addr += PAGE_SIZE;
 		}
 	}
 
 	return 0;
 }
 
+/*
+ * Applies the write permission of a new protection to the pages already
+ * mapped in a range. Private pages become writable only if they aren't shared
+ * with anyone, the rest will get their own copy on the next write fault.
+ */
+static void protect_vma_pages(struct vma *vma, unsigned int start, __size_t length, int prot)
+{
+	unsigned int n, *pgdir, *pgtbl;
+	unsigned int pde, pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	for(n = start; n < start + length; n += PAGE_SIZE) {
+		pde = GET_PGDIR(n);
+		pte = GET_PGTBL(n);
+		if(pgdir[pde] & PAGE_PSE) {
+			if(!split_huge_page(current, pgdir, pde)) {
+				printk("WARNING: %s(): unable to split the 4MB page at 0x%08x.\n", __FUNCTION__, n);
+				continue;
+			}
+		}
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			continue;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		if(!(pgtbl[pte] & PAGE_PRESENT)) {
+			continue;
+		}
+		if(!(prot & PROT_WRITE)) {
+			pgtbl[pte] &= ~PAGE_RW;
+			continue;
+		}
+		if(!(pgtbl[pte] & PAGE_NOALLOC) && !(vma->flags & MAP_SHARED)) {
+			pg = &page_table[pgtbl[pte] >> PAGE_SHIFT];
+			if(pg->count > 1 || pg->inode || pg->flags & (PAGE_COW | PAGE_RESERVED)) {
+				continue;
+			}
+		}
+		pgtbl[pte] |= PAGE_RW;
+	}
+	flush_tlb_range(start, length);
+}
+
 int do_mprotect(struct vma *vma, unsigned int addr, __size_t length, int prot)
 {
 	struct vma *new;
@@ -566,7 +684,215 @@ int do_mprotect(struct vma *vma, unsigned int addr, __size_t length, int prot)
 	new->s_type = vma->s_type;
 	new->inode = vma->inode;
 	new->o_mode = vma->o_mode;
+	new->advice = vma->advice;
+	if(new->inode) {
+		new->offset += addr - vma->start;
+		new->inode->count++;
+	}
+	protect_vma_pages(vma, addr, length, prot);
 	add_vma_region(new);
 
 	return 0;
 }
+
+int do_madvise(unsigned int start, __size_t length, int advice)
+{
+	struct vma *vma;
+	unsigned int addr, end, from, to;
+
+	end = start + length;
+	addr = start;
+	for(vma = current->mm->vma_table; vma && vma->start < end; vma = vma->next) {
+		if(vma->end <= start) {
+			continue;
+		}
+		if(vma->start > addr) {
+			break;
+		}
+		from = MAX(start, vma->start);
+		to = MIN(end, vma->end);
+		addr = to;
+
+		switch(advice) {
+			case MADV_NORMAL:
+			case MADV_RANDOM:
+			case MADV_SEQUENTIAL:
+				/* it applies to the whole region */
+				vma->advice = advice;
+				break;
+			case MADV_WILLNEED:
+				if(vma->inode && S_ISREG(vma->inode->i_mode)) {
+					read_ahead_pages(vma->inode, from - vma->start + vma->offset, to - from);
+				}
+				break;
+			case MADV_DONTNEED:
+				if(vma->s_type == P_SHM || vma->s_type == P_VSYSCALL) {
+					break;
+				}
+				/* they will be read again or zero-filled on the next fault */
+				free_vma_pages(vma, from, to - from);
+				flush_tlb_range(from, to - from);
+				break;
+		}
+	}
+
+	/* part of the range is not mapped */
+	if(addr < end) {
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/* moves the page table entries of a region instead of copying its pages */
+static int move_vma(struct vma *vma, unsigned int addr, __size_t old_len, __size_t new_len, unsigned int new_addr)
+{
+	struct vma *new, *tail;
+	unsigned int *pgdir, *pgtbl, *new_pgtbl;
+	unsigned int n, pde, pte, newaddr;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+
+	/*
+	 * Everything that can fail is done before moving anything, including
+	 * the allocation of the vma left after the range if it's in the middle.
+	 */
+	for(n = addr; n < addr + old_len; n += PAGE_SIZE) {
+		pde = GET_PGDIR(n);
+		if(pgdir[pde] & PAGE_PSE) {
+			if(!split_huge_page(current, pgdir, pde)) {
+				return -ENOMEM;
+			}
+		}
+	}
+	for(n = new_addr; n < new_addr + MIN(old_len, new_len); n += PAGE_SIZE) {
+		pde = GET_PGDIR(n);
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			if(!(newaddr = kmalloc(PAGE_SIZE))) {
+				return -ENOMEM;
+			}
+			current->mm->rss++;
+			memset_b((void *)newaddr, 0, PAGE_SIZE);
+			pgdir[pde] = V2P(newaddr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+		}
+	}
+	if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
+		return -ENOMEM;
+	}
+	tail = NULL;
+	if(addr + old_len < vma->end) {
+		if(!(tail = (struct vma *)kmalloc(sizeof(struct vma)))) {
+			kfree((unsigned int)new);
+			return -ENOMEM;
+		}
+	}
+	memset_b(new, 0, sizeof(struct vma));
+	new->start = new_addr;
+	new->end = new_addr + new_len;
+	new->prot = vma->prot;
+	new->flags = vma->flags;
+	new->offset = vma->offset;
+	new->s_type = vma->s_type;
+	new->inode = vma->inode;
+	new->o_mode = vma->o_mode;
+	new->advice = vma->advice;
+	new->object = vma->object;
+	if(new->inode) {
+		new->offset += addr - vma->start;
+		new->inode->count++;
+	}
+
+	for(n = 0; n < MIN(old_len, new_len); n += PAGE_SIZE) {
+		pde = GET_PGDIR(addr + n);
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			continue;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		new_pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(new_addr + n)] & PAGE_MASK));
+		new_pgtbl[GET_PGTBL(new_addr + n)] = pgtbl[GET_PGTBL(addr + n)];
+		pgtbl[GET_PGTBL(addr + n)] = 0;
+	}
+
+	/* check if the page tables left empty by the move can be freed */
+	for(n = addr & HPAGE_MASK; n < addr + MIN(old_len, new_len); n += HPAGE_SIZE) {
+		pde = GET_PGDIR(n);
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			continue;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		for(pte = 0; pte < PT_ENTRIES; pte++) {
+			if(pgtbl[pte] & PAGE_MASK) {
+				break;
+			}
+		}
+		if(pte == PT_ENTRIES) {
+			kfree((unsigned int)pgtbl & PAGE_MASK);
+			current->mm->rss--;
+			pgdir[pde] = 0;
+		}
+	}
+	flush_tlb_range(addr, old_len);
+
+	/* the pages left (when shrinking) are released as in munmap() */
+	free_vma_pages(vma, addr, old_len);
+	cut_vma_region(vma, addr, old_len, tail);
+	add_vma_region(new);
+	return new_addr;
+}
+
+int do_mremap(unsigned int addr, __size_t old_len, __size_t new_len, int flags, unsigned int new_addr)
+{
+	struct vma *vma;
+
+	if(addr & ~PAGE_MASK || flags & ~(MREMAP_MAYMOVE | MREMAP_FIXED)) {
+		return -EINVAL;
+	}
+	if(flags & MREMAP_FIXED && !(flags & MREMAP_MAYMOVE)) {
+		return -EINVAL;
+	}
+	old_len = PAGE_ALIGN(old_len);
+	new_len = PAGE_ALIGN(new_len);
+	if(!old_len || !new_len || addr + old_len < addr) {
+		return -EINVAL;
+	}
+	if(!(vma = find_vma_region(addr)) || addr + old_len > vma->end) {
+		return -EFAULT;
+	}
+	if(vma->s_type != P_MMAP) {
+		return -EINVAL;
+	}
+
+	if(flags & MREMAP_FIXED) {
+		if(new_addr & ~PAGE_MASK || new_addr + new_len > PAGE_OFFSET || new_addr + new_len < new_addr) {
+			return -EINVAL;
+		}
+		if(new_addr < addr + old_len && addr < new_addr + new_len) {
+			return -EINVAL;
+		}
+		do_munmap(new_addr, new_len);
+		return move_vma(vma, addr, old_len, new_len, new_addr);
+	}
+
+	if(new_len <= old_len) {
+		if(new_len < old_len) {
+			do_munmap(addr + new_len, old_len - new_len);
+		}
+		return addr;
+	}
+
+	/* the region is expanded in place if there is room after it */
+	if(addr + old_len == vma->end) {
+		if(addr + new_len <= PAGE_OFFSET && addr + new_len > addr) {
+			if(!find_vma_intersection(vma->end, addr + new_len)) {
+				vma->end = addr + new_len;
+				return addr;
+			}
+		}
+	}
+	if(!(flags & MREMAP_MAYMOVE)) {
+		return -ENOMEM;
+	}
+	if(!(new_addr = get_unmapped_vma_region(new_len))) {
+		return -ENOMEM;
+	}
+	return move_vma(vma, addr, old_len, new_len, new_addr);
+}
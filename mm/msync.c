@@ -0,0 +1,174 @@
+/*
+ * fiwix/mm/msync.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/stat.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/timer.h>
+#include <fiwix/string.h>
+
+/*
+ * The pages of a shared file mapping are the pages of the page cache, so a
+ * write through the mapping only sets the Dirty bit of the PTE. These pages
+ * are written back to the file when the mapping goes away, on msync(), and
+ * every MSYNC_INTERVAL seconds by kmsyncd.
+ */
+
+#define NR_SYNC_PAGES	16	/* pages collected on every pass */
+
+struct sync_page {
+	struct page *pg;
+	struct inode *inode;
+	__off_t offset;
+};
+
+static struct callout_req msync_creq;
+
+/*
+ * Collects the pages of the shared file mappings of 'p' in the range from
+ * '*addr' to 'end' that have the Dirty bit set. The bit is cleared and both
+ * the page and the inode are referenced, so they can be written once the
+ * interrupts are enabled again, even if the mapping has gone by then.
+ */
+static int collect_dirty_pages(struct proc *p, unsigned int *addr, unsigned int end, struct sync_page *sp)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int n, last, pde, pte, offset, cr3;
+	struct vma *vma;
+	int count;
+
+	GET_CR3(cr3);
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	count = 0;
+	for(vma = p->mm->vma_table; vma && count < NR_SYNC_PAGES; vma = vma->next) {
+		if(vma->end <= *addr) {
+			continue;
+		}
+		if(vma->start >= end) {
+			break;
+		}
+		if(!vma->inode || !(vma->flags & MAP_SHARED) || !S_ISREG(vma->inode->i_mode)) {
+			continue;
+		}
+		last = MIN(end, vma->end);
+		for(n = MAX(*addr, vma->start); n < last && count < NR_SYNC_PAGES; n += PAGE_SIZE) {
+			pde = GET_PGDIR(n);
+			if(!(pgdir[pde] & PAGE_PRESENT) || pgdir[pde] & PAGE_PSE) {
+				continue;
+			}
+			pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+			pte = GET_PGTBL(n);
+			if((pgtbl[pte] & (PAGE_PRESENT | PAGE_DIRTY | PAGE_NOALLOC)) != (PAGE_PRESENT | PAGE_DIRTY)) {
+				continue;
+			}
+			pgtbl[pte] &= ~PAGE_DIRTY;
+
+			/* kernel processes keep the page directory of the last process */
+			if(p->tss.cr3 == cr3) {
+				flush_tlb_page(n);
+			}
+			offset = n - vma->start + vma->offset;
+			if(offset >= vma->inode->i_size) {
+				continue;
+			}
+			sp[count].pg = &page_table[pgtbl[pte] >> PAGE_SHIFT];
+			sp[count].pg->count++;
+			sp[count].inode = vma->inode;
+			sp[count].inode->count++;
+			sp[count].offset = offset;
+			count++;
+		}
+		*addr = n;
+	}
+	return count;
+}
+
+/* returns the number of pages written back, or the first error found */
+int sync_mapped_pages(struct proc *p, unsigned int start, unsigned int end)
+{
+	struct sync_page sp[NR_SYNC_PAGES];
+	struct mm *mm;
+	unsigned int flags;
+	__pid_t pid;
+	int n, count, total, errno, retval;
+
+	pid = p->pid;
+	mm = p->mm;
+	total = errno = 0;
+	do {
+		SAVE_FLAGS(flags); CLI();
+		/* the process might have gone while the pages were written */
+		if(p->pid != pid || p->mm != mm || !p->state || p->state == PROC_ZOMBIE) {
+			RESTORE_FLAGS(flags);
+			break;
+		}
+		count = collect_dirty_pages(p, &start, end, sp);
+		RESTORE_FLAGS(flags);
+
+		for(n = 0; n < count; n++) {
+			/* the file might have been truncated in the meantime */
+			if(sp[n].offset < sp[n].inode->i_size) {
+				if((retval = write_page(sp[n].pg, sp[n].inode, sp[n].offset, PAGE_SIZE)) < 0) {
+					if(!errno) {
+						errno = retval;
+					}
+				} else {
+					total++;
+				}
+			}
+			release_page(sp[n].pg);
+			iput(sp[n].inode);
+		}
+	} while(count == NR_SYNC_PAGES);
+
+	return errno ? errno : total;
+}
+
+static void msync_timer(unsigned int arg)
+{
+	wakeup(&kmsyncd);
+}
+
+int kmsyncd(void)
+{
+	struct proc *p, *q;
+	unsigned int flags;
+	int n, m;
+
+	for(;;) {
+		msync_creq.fn = msync_timer;
+		msync_creq.arg = 0;
+		SAVE_FLAGS(flags); CLI();
+		add_callout(&msync_creq, MSYNC_INTERVAL * HZ);
+		sleep(&kmsyncd, PROC_UNINTERRUPTIBLE);
+		RESTORE_FLAGS(flags);
+
+		for(n = 0; n < NR_PROCS; n++) {
+			p = &proc_table[n];
+			if(!p->state || p->state == PROC_ZOMBIE || p->flags & PF_KPROC) {
+				continue;
+			}
+
+			/* the threads share the address space */
+			for(m = 0; m < n; m++) {
+				q = &proc_table[m];
+				if(q->state && q->state != PROC_ZOMBIE && q->mm == p->mm) {
+					break;
+				}
+			}
+			if(m == n) {
+				sync_mapped_pages(p, 0, PAGE_OFFSET);
+			}
+		}
+	}
+}
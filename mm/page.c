@@ -26,6 +26,7 @@
 #include <fiwix/kernel.h>
 #include <fiwix/mm.h>
 #include <fiwix/mman.h>
+#include <fiwix/fcntl.h>
 #include <fiwix/bios.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
@@ -203,6 +204,54 @@ struct page *get_free_page(void)
 	return pg;
 }
 
+/*
+ * Returns the first page of HPAGE_PAGES free page frames which are physically
+ * contiguous and aligned to a 4MB boundary, so they can be mapped by a single
+ * PSE page directory entry. Every page frame is handled as if it had been
+ * obtained from get_free_page(), so it will be freed one by one. It returns
+ * NULL if the memory is too fragmented, and then the caller falls back to
+ * 4KB pages.
+ */
+struct page *get_free_huge_page(void)
+{
+	unsigned int flags;
+	struct page *pg;
+	int n, i;
+
+	if(kstat.free_pages - HPAGE_PAGES <= kstat.min_free_pages) {
+		return NULL;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+
+	for(n = 0; n + HPAGE_PAGES <= NR_PAGES; n += HPAGE_PAGES) {
+		for(i = 0; i < HPAGE_PAGES; i++) {
+			pg = &page_table[n + i];
+			if(pg->count || pg->flags & PAGE_RESERVED) {
+				break;
+			}
+		}
+		if(i < HPAGE_PAGES) {
+			continue;
+		}
+
+		for(i = 0; i < HPAGE_PAGES; i++) {
+			pg = &page_table[n + i];
+			remove_from_free_list(pg);
+			remove_from_hash(pg);
+			pg->count = 1;
+			pg->inode = 0;
+			pg->offset = 0;
+			pg->dev = 0;
+		}
+		RESTORE_FLAGS(flags);
+		return &page_table[n];
+	}
+
+	RESTORE_FLAGS(flags);
+	return NULL;
+}
+
 struct page *search_page_hash(struct inode *inode, __off_t offset)
 {
 	struct page *pg;
@@ -287,6 +336,36 @@ void invalidate_inode_pages(struct inode *i)
 	}
 }
 
+/*
+ * Filesystems without a backing store (tmpfs) keep the data of their files
+ * in pages that are inserted in the page cache by these two functions. Such
+ * pages are never placed on the free list since the filesystem holds always a
+ * reference on them.
+ */
+void add_to_page_cache(struct page *pg, struct inode *i, __off_t offset)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	pg->inode = i->inode;
+	pg->offset = offset;
+	pg->dev = i->dev;
+	insert_to_hash(pg);
+	RESTORE_FLAGS(flags);
+}
+
+void remove_from_page_cache(struct page *pg)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	remove_from_hash(pg);
+	pg->inode = 0;
+	pg->offset = 0;
+	pg->dev = 0;
+	RESTORE_FLAGS(flags);
+}
+
 void update_page_cache(struct inode *i, __off_t offset, const char *buf, int count)
 {
 	__off_t poffset;
@@ -328,6 +407,21 @@ int write_page(struct page *pg, struct inode *i, __off_t offset, unsigned int le
 	return errno;
 }
 
+/* reads the contents of a file through its own read operation */
+int kernel_read(struct inode *i, __off_t offset, char *buffer, unsigned int length)
+{
+	struct fd fdt;
+
+	fdt.inode = i;
+	fdt.flags = 0;
+	fdt.count = 0;
+	fdt.offset = offset;
+	if(i->fsop && i->fsop->read) {
+		return i->fsop->read(i, &fdt, buffer, length);
+	}
+	return -EINVAL;
+}
+
 int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char flags)
 {
 	__blk_t block;
@@ -371,11 +465,47 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	return retval;
 }
 
+/* brings the pages of a file in the range given into the page cache */
+void read_ahead_pages(struct inode *i, __off_t offset, unsigned int length)
+{
+	unsigned int addr, end;
+	struct page *pg;
+
+	/* there is nothing to read if the file has no blocks underneath */
+	if(!i->fsop || !i->fsop->bmap) {
+		return;
+	}
+
+	end = MIN(offset + length, i->i_size);
+	inode_lock(i);
+	for(offset &= PAGE_MASK; offset < end; offset += PAGE_SIZE) {
+		if((pg = search_page_hash(i, offset))) {
+			release_page(pg);
+			continue;
+		}
+		if(kstat.free_pages <= kstat.min_free_pages) {
+			break;
+		}
+		if(!(addr = kmalloc(PAGE_SIZE))) {
+			break;
+		}
+		pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+		if(bread_page(pg, i, offset, 0, MAP_SHARED)) {
+			kfree(addr);
+			break;
+		}
+		/* it stays in the page cache */
+		kfree(addr);
+	}
+	inode_unlock(i);
+}
+
 int file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
 {
 	__size_t total_read;
 	unsigned int addr, poffset, bytes;
 	struct page *pg;
+	int errno;
 
 	inode_lock(i);
 
@@ -383,6 +513,13 @@ int file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count
 		fd_table->offset = i->i_size;
 	}
 
+	if(fd_table->flags & O_DIRECT) {
+		if((errno = direct_io(BLK_READ, i, fd_table, buffer, count)) != -EAGAIN) {
+			inode_unlock(i);
+			return errno;
+		}
+	}
+
 	total_read = 0;
 
 	for(;;) {
@@ -418,6 +555,7 @@ int file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count
 		fd_table->offset += bytes;
 		kfree(addr);
 		page_unlock(pg);
+		cond_resched();
 	}
 
 	inode_unlock(i);
@@ -41,6 +41,7 @@ int kswapd(void)
 	mem_stats();
 	fs_init();
 	mount_root();
+	ramdisk_stats();
 	init_init();
 
 	/* make sure interrupts are enabled after initializing devices */
@@ -48,6 +49,7 @@ int kswapd(void)
 
 	for(;;) {
 		sleep(&kswapd, PROC_UNINTERRUPTIBLE);
+		reap_zombie_threads();
 		if((kstat.pages_reclaimed = reclaim_buffers())) {
 			continue;
 		}
@@ -29,7 +29,7 @@ static int check_sd(int sd)
 	struct inode *i;
 
 	CHECK_UFD(sd);
-	i = fd_table[current->fd[sd]].inode;
+	i = fd_table[current->files->fd[sd]].inode;
 	if(!i || !i->u.sockfs.sock.state) {
 		return -ENOTSOCK;
 	}
@@ -77,7 +77,7 @@ static int sock_alloc(struct socket **s)
 		iput(i);
 		return -EMFILE;
 	}
-	current->fd[ufd] = fd;
+	current->files->fd[ufd] = fd;
 	i = fd_table[fd].inode;
 	ns = &i->u.sockfs.sock;
 	ns->state = SS_UNCONNECTED;
@@ -91,7 +91,7 @@ static struct socket *get_socket_from_fd(int fd)
 {
 	struct inode *i;
 
-	i = fd_table[current->fd[fd]].inode;
+	i = fd_table[current->files->fd[fd]].inode;
 	return &i->u.sockfs.sock;
 }
 
@@ -106,7 +106,7 @@ void sock_free(struct socket *s)
 	fd = ((unsigned int)s->fd - (unsigned int)&fd_table[0]) / sizeof(struct fd);
 
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n] == fd) {
+		if(current->files->fd[n] == fd) {
 			ufd = n;
 			break;
 		}
@@ -263,7 +263,7 @@ int accept(int sd, struct sockaddr *addr, int *addrlen)
 		return -EOPNOTSUPP;
 	}
 	while(!(sc = remove_socket_from_queue(ss))) {
-		if(fd_table[current->fd[sd]].flags & O_NONBLOCK) {
+		if(fd_table[current->files->fd[sd]].flags & O_NONBLOCK) {
 			return -EAGAIN;
 		}
 		if(sleep(ss, PROC_INTERRUPTIBLE)) {